@@ -0,0 +1,150 @@
+/**
+ * @file anticipo.c
+ * @brief Captura de huella anticipada mientras se escribe la contraseña.
+ */
+
+#include "anticipo.h"
+#include "latencia.h"
+#include "pico/stdlib.h"
+
+static const uint8_t gen_img[] = {0x01};
+static const uint8_t img2tz[] = {0x02, 1};
+
+/**
+ * @brief Indica si hay un dedo apoyado de forma estable, sin bloquear.
+ */
+static bool dedo_apoyado(anticipo_t *a) {
+    int toque = a->lector->config.toque;
+
+    if (toque < 0) {
+        return time_reached(a->desde);
+    }
+    if (!gpio_get(toque)) {
+        a->tocando = false;
+        return false;
+    }
+    if (!a->tocando) {
+        a->tocando = true;
+        a->desde = make_timeout_time_ms(AS608_TOQUE_ESTABLE_MS);
+    }
+    if (!time_reached(a->desde)) {
+        return false;
+    }
+    as608_touch_stable(a->lector);
+    return true;
+}
+
+/**
+ * @brief Pasa a la etapa siguiente enviando su instrucción.
+ */
+static void iniciar(anticipo_t *a, anticipo_estado_t etapa, const uint8_t *params, size_t len) {
+    a->estado = etapa;
+    as608_start(a->lector, params, len);
+}
+
+/**
+ * @brief Vuelve a esperar el dedo tras una captura sin imagen.
+ */
+static void esperar_dedo(anticipo_t *a) {
+    a->estado = ANTICIPO_ESPERA_DEDO;
+    a->tocando = false;
+    a->desde = make_timeout_time_ms(ANTICIPO_REINTENTO_MS);
+}
+
+static void terminar(anticipo_t *a, uint8_t c) {
+    a->codigo = c;
+    a->estado = ANTICIPO_LISTO;
+}
+
+void anticipo_init(anticipo_t *a, as608_t *lector) {
+    a->lector = lector;
+    a->estado = ANTICIPO_INACTIVO;
+}
+
+void anticipo_armar(anticipo_t *a) {
+    a->estado = ANTICIPO_ESPERA_DEDO;
+    a->tocando = false;
+    a->desde = get_absolute_time();
+    a->posicion = a->puntaje = 0;
+}
+
+void anticipo_avanzar(anticipo_t *a) {
+    uint8_t resp[4] = {0};
+    uint8_t c;
+
+    switch (a->estado) {
+        case ANTICIPO_ESPERA_DEDO:
+            if (dedo_apoyado(a)) {
+                latencia_abrir(LAT_DEDO_RELE);
+                iniciar(a, ANTICIPO_CAPTURA, gen_img, sizeof(gen_img));
+            }
+            break;
+        case ANTICIPO_CAPTURA:
+            c = as608_poll(a->lector, NULL, 0);
+            if (c == AS608_OK) {
+                iniciar(a, ANTICIPO_EXTRACCION, img2tz, sizeof(img2tz));
+            } else if (c == AS608_SIN_DEDO || c == AS608_FALLO_CAPTURA || c == AS608_ERROR_COM) {
+                esperar_dedo(a);
+            } else if (c != AS608_EN_CURSO) {
+                terminar(a, c);
+            }
+            break;
+        case ANTICIPO_EXTRACCION:
+            c = as608_poll(a->lector, NULL, 0);
+            if (c == AS608_OK) {
+                uint16_t n = as608_search_count(a->lector);
+                uint8_t search[] = {0x04, 1, 0x00, 0x00, (n >> 8) & 0xFF, n & 0xFF};
+                iniciar(a, ANTICIPO_BUSQUEDA, search, sizeof(search));
+            } else if (c != AS608_EN_CURSO) {
+                terminar(a, c);
+            }
+            break;
+        case ANTICIPO_BUSQUEDA:
+            c = as608_poll(a->lector, resp, sizeof(resp));
+            if (c != AS608_EN_CURSO) {
+                a->posicion = (resp[0] << 8) | resp[1];
+                a->puntaje = (resp[2] << 8) | resp[3];
+                terminar(a, c);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+anticipo_estado_t anticipo_estado(const anticipo_t *a) {
+    return a->estado;
+}
+
+uint8_t anticipo_esperar(anticipo_t *a, uint16_t *page_id, uint16_t *score, uint32_t timeout_ms) {
+    if (a->estado == ANTICIPO_INACTIVO) {
+        return AS608_EN_CURSO;
+    }
+    absolute_time_t limite = make_timeout_time_ms(timeout_ms);
+    while (a->estado != ANTICIPO_LISTO) {
+        if (a->estado == ANTICIPO_ESPERA_DEDO) {
+            if (time_reached(limite)) {
+                a->estado = ANTICIPO_INACTIVO;
+                return AS608_SIN_DEDO;
+            }
+            sleep_ms(5);
+        }
+        anticipo_avanzar(a);
+    }
+    a->estado = ANTICIPO_INACTIVO;
+    if (page_id) {
+        *page_id = a->posicion;
+    }
+    if (score) {
+        *score = a->puntaje;
+    }
+    return a->codigo;
+}
+
+void anticipo_cancelar(anticipo_t *a) {
+    if (a->estado == ANTICIPO_CAPTURA || a->estado == ANTICIPO_EXTRACCION || a->estado == ANTICIPO_BUSQUEDA) {
+        as608_cancel(a->lector);
+        as608_poll(a->lector, NULL, 0);
+    }
+    a->estado = ANTICIPO_INACTIVO;
+}
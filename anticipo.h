@@ -0,0 +1,89 @@
+/**
+ * @file anticipo.h
+ * @brief Captura de huella anticipada mientras se escribe la contraseña.
+ *
+ * En el ingreso (B) el sensor se arma en cuanto se elige el usuario. Una máquina de estados que el
+ * bucle principal avanza sin bloquear espera el dedo y encadena GenImg, Img2Tz y Search con
+ * instrucciones asíncronas (as608_start/as608_poll); el módulo procesa cada una mientras el
+ * microcontrolador atiende el teclado y verifica la contraseña. El resultado solo se consulta
+ * después de aceptar la contraseña, así que el doble factor cuesta max(PIN, huella) en lugar de
+ * la suma.
+ *
+ * Cada captura anticipada es una instancia anticipo_t ligada a un lector, así que varios lectores
+ * pueden estar armados y capturando a la vez.
+ */
+
+#ifndef ANTICIPO_H
+#define ANTICIPO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "as608.h"
+#include "pico/time.h"
+
+#define ANTICIPO_REINTENTO_MS 250 ///< Pausa antes de repetir GenImg cuando el módulo no vio el dedo
+
+/**
+ * @brief Estado de la captura anticipada.
+ */
+typedef enum {
+    ANTICIPO_INACTIVO,
+    ANTICIPO_ESPERA_DEDO,  ///< Armado; esperando un toque estable
+    ANTICIPO_CAPTURA,      ///< GenImg en curso
+    ANTICIPO_EXTRACCION,   ///< Img2Tz en curso
+    ANTICIPO_BUSQUEDA,     ///< Search en curso
+    ANTICIPO_LISTO         ///< Resultado disponible
+} anticipo_estado_t;
+
+/**
+ * @brief Captura anticipada sobre un lector.
+ */
+typedef struct {
+    as608_t *lector;
+    anticipo_estado_t estado;
+    uint8_t codigo;            ///< Resultado de la última etapa
+    uint16_t posicion, puntaje;
+    bool tocando;              ///< La línea de toque está alta desde 'desde'
+    absolute_time_t desde;     ///< Fin del toque estable, o de la pausa antes de reintentar GenImg
+} anticipo_t;
+
+/**
+ * @brief Liga la captura anticipada a un lector; queda inactiva.
+ *
+ * @param a Captura anticipada.
+ * @param lector Lector ya inicializado.
+ */
+void anticipo_init(anticipo_t *a, as608_t *lector);
+
+/**
+ * @brief Arma el sensor y empieza a esperar el dedo.
+ */
+void anticipo_armar(anticipo_t *a);
+
+/**
+ * @brief Avanza la máquina de estados sin bloquear. Se llama en cada vuelta del bucle principal.
+ */
+void anticipo_avanzar(anticipo_t *a);
+
+/**
+ * @brief Estado actual.
+ */
+anticipo_estado_t anticipo_estado(const anticipo_t *a);
+
+/**
+ * @brief Espera el resultado de la captura anticipada y desarma el módulo.
+ *
+ * @param page_id Posición de la huella encontrada (puede ser NULL).
+ * @param score Puntaje de coincidencia (puede ser NULL).
+ * @param timeout_ms Plazo para que aparezca el dedo si todavía no se apoyó.
+ * @return uint8_t AS608_EN_CURSO si no estaba armado; si no, el código de la captura, extracción o
+ * búsqueda (AS608_SIN_DEDO si venció el plazo sin dedo).
+ */
+uint8_t anticipo_esperar(anticipo_t *a, uint16_t *page_id, uint16_t *score, uint32_t timeout_ms);
+
+/**
+ * @brief Abandona la captura anticipada (p. ej. al volver al menú).
+ */
+void anticipo_cancelar(anticipo_t *a);
+
+#endif // ANTICIPO_H
@@ -3,32 +3,79 @@
  * @brief Funciones para el funcionamiento del lector AS608 con la raspberry pi pico
  */
 
+#include <string.h>
 #include "as608.h"
 #include "hardware/uart.h"
+#include "hardware/dma.h"
 #include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "latencia.h"
+#include "reloj.h"
+#include "perfilador.h"
+#include "metricas.h"
+#include "ram.h"
 
 
+/**
+ * Política de cada instrucción. El plazo es por intento (envío -> respuesta completa; la lectura
+ * no hace pausas entre bytes, así que solo se suma el tiempo en el cable, unos 2 ms a 57600
+ * baudios) y queda en 2-4 veces la latencia esperada del módulo, con un piso de 200-800 ms para
+ * las instrucciones rápidas; Search y Empty tienen más margen porque crecen con la biblioteca.
+ * Un plazo vencido se reintenta una sola vez: si el segundo intento tampoco responde el enlace
+ * está caído y seguir esperando no sirve. Solo las instrucciones de captura reintentan los
+ * códigos transitorios: repetir Img2Tz sobre la misma imagen daría el mismo resultado.
+ */
+static const as608_politica_t politicas[] = {
+    // ins   esperado limite reintentos espera transitorios
+    {0x01,   250,     600,   2,         150,   true},  // GenImg
+    {0x02,   350,     1400,  1,         50,    false}, // Img2Tz
+    {0x03,   60,      500,   1,         50,    false}, // Match
+    {0x04,   350,     1800,  1,         50,    false}, // Search
+    {0x05,   120,     500,   1,         50,    false}, // RegModel
+    {0x06,   80,      500,   1,         50,    false}, // Store
+    {0x07,   40,      500,   1,         50,    false}, // LoadChar
+    {0x08,   40,      500,   1,         50,    false}, // UpChar (confirmación)
+    {0x09,   40,      500,   1,         50,    false}, // DownChar (confirmación)
+    {0x0A,   40,      500,   1,         50,    false}, // UpImage (confirmación y cada paquete)
+    {0x0C,   50,      800,   1,         50,    false}, // DeletChar
+    {0x0D,   200,     2800,  1,         100,   false}, // Empty
+    {0x0E,   30,      500,   1,         50,    false}, // SetSysPara (escribe la flash del módulo)
+    {0x0F,   10,      300,   1,         50,    false}, // ReadSysPara
+    {0x11,   850,     2000,  2,         150,   true},  // Identify
+    {0x13,   10,      200,   2,         50,    false}, // VfyPwd
+    {0x1D,   10,      300,   1,         50,    false}, // TempleteNum
+    {0x1F,   10,      300,   1,         50,    false}, // ReadConList
+};
+static const as608_politica_t politica_defecto = {0x00, 100, 1000, 1, 50, false};
 
-// Definiciones de UART
-#define UART_ID uart1
-#define BAUD_RATE 57600  // Asegúrate de usar la tasa de baudios correcta para el AS608
-
-// Pines del UART
-#define UART_TX_PIN 8
-#define UART_RX_PIN 9
+static void as608_drain(as608_t *s);
+static bool as608_read_byte(as608_t *s, uint8_t *byte, absolute_time_t limit);
+static void as608_power_on(as608_t *s);
+static void as608_touch_init(as608_t *s);
 
-#define TIMEOUT_MS 10000  // Tiempo de espera máximo en milisegundos
+/**
+ * @brief Reprograma el divisor del UART con la frecuencia actual de clk_peri.
+ */
+static void as608_reloj(void *ctx) {
+    as608_t *s = ctx;
+    uart_set_baudrate(s->config.uart, s->config.baudios);
+}
 
-volatile int index = 0;
 /**
  * @brief Inicializa el sensor de huellas AS608.
  */
-void as608_init() {
-    stdio_init_all();
-    uart_init(UART_ID, BAUD_RATE);
-    gpio_set_function(UART_TX_PIN, GPIO_FUNC_UART);
-    gpio_set_function(UART_RX_PIN, GPIO_FUNC_UART);
-    sleep_ms(5000);
+void as608_init(as608_t *s, const as608_config_t *config) {
+    memset(s, 0, sizeof(*s));
+    s->config = *config;
+    s->tam_paquete = AS608_DATA_PACKET;
+    s->busqueda_cantidad = AS608_BUSQUEDA_POSICIONES;
+    s->encendido = true;
+    uart_init(s->config.uart, s->config.baudios);
+    reloj_registrar(as608_reloj, s);
+    gpio_set_function(s->config.tx, GPIO_FUNC_UART);
+    gpio_set_function(s->config.rx, GPIO_FUNC_UART);
+    as608_touch_init(s);
 }
 
 
@@ -38,9 +85,13 @@ void as608_init() {
  * @param command Comando a enviar.
  * @param len Longitud del comando.
  */
-void as608_send_command(const uint8_t *command, size_t len) {
+void as608_send_command(as608_t *s, const uint8_t *command, size_t len) {
+    as608_power_on(s);
+    s->instruccion = (len > 9) ? command[9] : 0;
+    as608_drain(s);
+    s->inicio_comando = time_us_64();
     for (size_t i = 0; i < len; i++) {
-        uart_putc(UART_ID, command[i]);
+        uart_putc(s->config.uart, command[i]);
     }
     // Enviar comando al módulo AS608
     printf("Enviando comando: ");
@@ -57,47 +108,138 @@ void as608_send_command(const uint8_t *command, size_t len) {
  * @param len Longitud esperada de la respuesta.
  * @return true si la respuesta es válida, false en caso contrario.
  */
-uint8_t as608_read_response(uint8_t *response, size_t len) {
-    absolute_time_t timeout_time = make_timeout_time_ms(TIMEOUT_MS);
-    index = 0;  // Reiniciar el índice de recepción
-    
-    while (index < len) {
-        if (uart_is_readable(UART_ID)) {
-            response[index] = uart_getc(UART_ID);
-            printf("%02X ", response[index]);
-            index=index+1;
-
-        } else if (time_reached(timeout_time)) {
-            printf("\n");
-            index = 0;
+uint8_t as608_read_response(as608_t *s, uint8_t *response, size_t len) {
+    absolute_time_t timeout_time = make_timeout_time_ms(as608_policy(s->instruccion)->limite_ms);
+
+    // Sin pausas entre bytes, como as608_read_packet: el plazo solo espera al módulo
+    for (size_t index = 0; index < len; index++) {
+        if (!as608_read_byte(s, &response[index], timeout_time)) {
+            if (s->cancelado) {
+                printf("Comando %02X cancelado.\n", s->instruccion);
+                return AS608_CANCELADO;
+            }
             printf("Se demoro mas tiempo del que se esperaba.\n");
             return -1; // Salir si se supera el tiempo de espera
         }
-        sleep_ms(10); // Esperar un poco entre caracteres
+    }
+    latencia_registrar(latencia_etapa_as608(s->instruccion), (uint32_t)(time_us_64() - s->inicio_comando));
+    for (size_t index = 0; index < len; index++) {
+        printf("%02X ", response[index]);
     }
     printf("\n");
-    //print_response(*response, len);
     return response[9];
 }
 
+/**
+ * @brief Devuelve la política de reintentos y plazos de una instrucción.
+ */
+const as608_politica_t *as608_policy(uint8_t ins) {
+    for (size_t i = 0; i < sizeof(politicas) / sizeof(politicas[0]); i++) {
+        if (politicas[i].instruccion == ins) {
+            return &politicas[i];
+        }
+    }
+    return &politica_defecto;
+}
+
+/**
+ * @brief Indica si un código de confirmación es transitorio (vale la pena repetir la captura).
+ */
+bool as608_is_transient(uint8_t codigo) {
+    switch (codigo) {
+        case AS608_SIN_DEDO:
+        case AS608_FALLO_CAPTURA:
+        case AS608_IMAGEN_MALA:
+        case AS608_POCOS_RASGOS:
+        case AS608_ERROR_COM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Abandona la instrucción en curso. Se puede llamar desde una interrupción.
+ */
+void as608_cancel(as608_t *s) {
+    if (s->en_curso) {
+        s->cancelado = true;
+    }
+}
+
+/**
+ * @brief Descarta los bytes pendientes del UART (p. ej. la respuesta tardía de un intento
+ * abandonado) para que no se confundan con la respuesta siguiente.
+ */
+static void as608_drain(as608_t *s) {
+    while (uart_is_readable(s->config.uart)) {
+        uart_getc(s->config.uart);
+    }
+    as608_desbordes(s);
+}
+
+/**
+ * @brief Ejecuta una instrucción con el formato fijo de las funciones originales aplicando su política.
+ *
+ * Los errores de comunicación se reintentan siempre (hasta el número de reintentos de la
+ * política); los códigos transitorios solo si la política lo indica. Entre intentos se espera
+ * la pausa de la política, que se duplica en cada reintento.
+ *
+ * @param cmd Paquete completo.
+ * @param len Longitud del paquete.
+ * @param response Buffer de la respuesta.
+ * @param rlen Longitud esperada de la respuesta.
+ * @return uint8_t Código de confirmación, AS608_ERROR_COM o AS608_CANCELADO.
+ */
+static uint8_t as608_transaction(as608_t *s, const uint8_t *cmd, size_t len, uint8_t *response, size_t rlen) {
+    const as608_politica_t *pol = as608_policy(cmd[9]);
+    uint32_t espera = pol->espera_ms;
+    uint8_t codigo = AS608_ERROR_COM;
+    uint8_t sin_respuesta = 0;
+    uint32_t ciclos = perfilador_entrar();
+
+    s->cancelado = false;
+    s->en_curso = true;
+    for (uint8_t intento = 0; intento <= pol->reintentos; intento++) {
+        if (intento > 0) {
+            printf("Reintento %u de %02X (codigo %02X)\n", intento, cmd[9], codigo);
+            metricas_contar(MET_AS608_REINTENTOS);
+            sleep_ms(espera);
+            espera *= 2;
+        }
+        as608_send_command(s, cmd, len);
+        codigo = as608_read_response(s, response, rlen);
+        if (codigo == AS608_ERROR_COM) {
+            metricas_contar(MET_AS608_SIN_RESPUESTA);
+        }
+        bool repetir = (codigo == AS608_ERROR_COM) ? (++sin_respuesta < 2)
+                     : (pol->reintentar_transitorios && as608_is_transient(codigo));
+        if (!repetir || s->cancelado) {
+            break;
+        }
+    }
+    s->en_curso = false;
+    perfilador_salir(PERF_AS608, ciclos);
+    codigo = s->cancelado ? AS608_CANCELADO : codigo;
+    metricas_codigo(cmd[9], codigo);
+    return codigo;
+}
+
 
 /**
  * @brief Verifica la contraseña del sensor AS608.
  * 
  * @return Código de estado del sensor.
  */
-uint8_t as608_verify_password(void) {
+uint8_t as608_verify_password(as608_t *s) {
     // Comando para verificar la contraseña
     uint8_t cmd[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x07, 0x13, 0x00, 0x00, 0x00, 0x00, 0x10, 0x1B};
     
     // Buffer para la respuesta del sensor
     uint8_t response[12];
     
-    // Enviar el comando al sensor
-    as608_send_command(cmd, sizeof(cmd));
-    
-    // Leer la respuesta del sensor
-    uint8_t status = as608_read_response(response, 12);
+    // Enviar el comando al sensor y leer la respuesta
+    uint8_t status = as608_transaction(s, cmd, sizeof(cmd), response, 12);
     
     // Verificar el código de confirmación en la respuesta
     if (status == 0) {
@@ -118,11 +260,10 @@ uint8_t as608_verify_password(void) {
  * 
  * @return Código de estado del sensor.
  */
-uint8_t as608_get_image(void) {
+uint8_t as608_get_image(as608_t *s) {
     uint8_t cmd[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x03, 0x01, 0x00, 0x05};
     uint8_t response[12];
-    as608_send_command(cmd, sizeof(cmd));
-    return as608_read_response(response, 12);
+    return as608_transaction(s, cmd, sizeof(cmd), response, 12);
 }
 
 /**
@@ -131,11 +272,10 @@ uint8_t as608_get_image(void) {
  * @param slot Buffer donde almacenar la plantilla (1 o 2).
  * @return Código de estado del sensor.
  */
-uint8_t as608_image_to_template(uint8_t slot) {
+uint8_t as608_image_to_template(as608_t *s, uint8_t slot) {
     uint8_t cmd[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x04, 0x02, slot, 0x00, 0x07 + slot};
     uint8_t response[12];
-    as608_send_command(cmd, sizeof(cmd));
-    return as608_read_response(response, 12);
+    return as608_transaction(s, cmd, sizeof(cmd), response, 12);
 }
 
 /**
@@ -143,12 +283,11 @@ uint8_t as608_image_to_template(uint8_t slot) {
  * 
  * @return Código de estado del sensor.
  */
-uint8_t as608_create_model(void) {
+uint8_t as608_create_model(as608_t *s) {
     uint8_t cmd[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x03, 0x05, 0x00, 0x09};
 
     uint8_t response[12];
-    as608_send_command(cmd, sizeof(cmd));
-    return as608_read_response(response, 12);
+    return as608_transaction(s, cmd, sizeof(cmd), response, 12);
 }
 
 /**
@@ -157,7 +296,7 @@ uint8_t as608_create_model(void) {
  * @param id ID donde almacenar la plantilla.
  * @return Código de estado del sensor.
  */
-uint8_t as608_store_model(uint16_t id) {
+uint8_t as608_store_model(as608_t *s, uint16_t id) {
     uint8_t id_high = (id >> 8) & 0xFF; // Obtiene el byte alto del ID
     uint8_t id_low = id & 0xFF; // Obtiene el byte bajo del ID
 
@@ -180,19 +319,21 @@ uint8_t as608_store_model(uint16_t id) {
     cmd[14] = checksum & 0xFF; // Asigna el byte bajo del checksum
 
     uint8_t response[12]; // Buffer para almacenar la respuesta del sensor
-    as608_send_command(cmd, sizeof(cmd)); // Envía el comando al sensor
-    return as608_read_response(response, 12); // Lee la respuesta del sensor y devuelve el código de estado
+    return as608_transaction(s, cmd, sizeof(cmd), response, 12); // Envía el comando y devuelve el código de estado
 }
 
 
 /**
- * @brief Busca una huella en la base de datos.
+ * @brief Busca una huella en la base de datos y devuelve la posición y el puntaje.
  * 
+ * @param page_id Posición de la huella encontrada (puede ser NULL).
+ * @param score Puntaje de coincidencia (puede ser NULL).
  * @return Código de estado del sensor.
  */
-uint8_t as608_search_model(void) {
+uint8_t as608_search(as608_t *s, uint16_t *page_id, uint16_t *score) {
     uint8_t cmd[] = {
-        0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x08, 0x04, 0x01, 0x00, 0x00, 0x00, 0x64, 0x00, 0x00
+        0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x08, 0x04, 0x01, 0x00, 0x00,
+        (s->busqueda_cantidad >> 8) & 0xFF, s->busqueda_cantidad & 0xFF, 0x00, 0x00
     };
     uint16_t checksum = 0;
     for (int i = 6; i < 15; i++) {
@@ -201,9 +342,41 @@ uint8_t as608_search_model(void) {
     cmd[15] = (checksum >> 8) & 0xFF;
     cmd[16] = checksum & 0xFF;
     
-    uint8_t response[16];
-    as608_send_command(cmd, sizeof(cmd));
-    return as608_read_response(response, 16);
+    uint8_t response[16] = {0};
+    uint8_t status = as608_transaction(s, cmd, sizeof(cmd), response, 16);
+    // Respuesta: ... confirmación (9), PageID (10-11), MatchScore (12-13), checksum
+    if (page_id) {
+        *page_id = (response[10] << 8) | response[11];
+    }
+    if (score) {
+        *score = (response[12] << 8) | response[13];
+    }
+    return status;
+}
+
+/**
+ * @brief Fija cuántas posiciones, desde la 0, recorre Search.
+ * 
+ * @param cantidad Posiciones a recorrer (al menos 1).
+ */
+void as608_set_search_count(as608_t *s, uint16_t cantidad) {
+    s->busqueda_cantidad = cantidad ? cantidad : 1;
+}
+
+/**
+ * @brief Posiciones que recorre Search.
+ */
+uint16_t as608_search_count(const as608_t *s) {
+    return s->busqueda_cantidad;
+}
+
+/**
+ * @brief Busca una huella en la base de datos.
+ * 
+ * @return Código de estado del sensor.
+ */
+uint8_t as608_search_model(as608_t *s) {
+    return as608_search(s, NULL, NULL);
 }
 
 
@@ -213,23 +386,20 @@ uint8_t as608_search_model(void) {
  * @param id ID de la huella a eliminar.
  * @return Código de estado del sensor.
  */
-uint8_t as608_delete_model(uint16_t id) {
-    uint8_t id_high = (id >> 8) & 0xFF;
-    uint8_t id_low = id & 0xFF;
-    uint8_t cmd[] = {
-        0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x07, // Longitud corregida
-        0x0C, id_high, id_low, 0x00, 0x01, 0x00, 0x00
-    };
-    uint16_t checksum = 0;
-    for (int i = 6; i < 14; i++) {
-        checksum += cmd[i];
-    }
-    cmd[14] = (checksum >> 8) & 0xFF;
-    cmd[15] = checksum & 0xFF;
-    
-    uint8_t response[12];
-    as608_send_command(cmd, sizeof(cmd));
-    return as608_read_response(response, 12);
+uint8_t as608_delete_model(as608_t *s, uint16_t id) {
+    return as608_delete_range(s, id, 1);
+}
+
+/**
+ * @brief Elimina un tramo de posiciones contiguas (DeletChar con cantidad).
+ * 
+ * @param id Primera posición.
+ * @param cantidad Posiciones a borrar.
+ * @return Código de estado del sensor.
+ */
+uint8_t as608_delete_range(as608_t *s, uint16_t id, uint16_t cantidad) {
+    uint8_t params[] = {0x0C, (id >> 8) & 0xFF, id & 0xFF, (cantidad >> 8) & 0xFF, cantidad & 0xFF};
+    return as608_command(s, params, sizeof(params), NULL, 0);
 }
 
 
@@ -238,18 +408,855 @@ uint8_t as608_delete_model(uint16_t id) {
  * 
  * @return Código de estado del sensor.
  */
-uint8_t as608_empty_database(void) {
+uint8_t as608_empty_database(as608_t *s) {
     // Comando para vaciar la base de datos
     uint8_t cmd[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x03, 0x0D, 0x00, 0x11};
     
     // Buffer para la respuesta del sensor
     uint8_t response[12];
     
-    // Enviar el comando al sensor
-    as608_send_command(cmd, sizeof(cmd));
-    
-    // Leer la respuesta del sensor
-    return as608_read_response(response, 12);
+    // Enviar el comando al sensor y leer la respuesta
+    return as608_transaction(s, cmd, sizeof(cmd), response, 12);
+}
+
+
+
+
+/**
+ * @brief Envía un paquete con el identificador y los datos indicados, calculando el checksum.
+ * 
+ * @param pid Identificador del paquete (AS608_PID_*).
+ * @param data Contenido del paquete (instrucción y parámetros, o datos).
+ * @param len Longitud del contenido.
+ */
+void as608_send_packet(as608_t *s, uint8_t pid, const uint8_t *data, size_t len) {
+    uint16_t length = len + 2;  // El campo de longitud incluye el checksum
+    uint8_t header[] = {
+        0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, pid, (length >> 8) & 0xFF, length & 0xFF
+    };
+    uint16_t checksum = pid + header[7] + header[8];
+    for (size_t i = 0; i < len; i++) {
+        checksum += data[i];
+    }
+    uint8_t tail[] = {(checksum >> 8) & 0xFF, checksum & 0xFF};
+
+    as608_power_on(s);
+    uart_write_blocking(s->config.uart, header, sizeof(header));
+    uart_write_blocking(s->config.uart, data, len);
+    uart_write_blocking(s->config.uart, tail, sizeof(tail));
+}
+
+/**
+ * @brief Espera un byte del UART hasta el tiempo límite.
+ */
+static bool EN_RAM(as608_read_byte)(as608_t *s, uint8_t *byte, absolute_time_t limit) {
+    while (!uart_is_readable(s->config.uart)) {
+        if (time_reached(limit) || s->cancelado) {
+            return false;
+        }
+    }
+    *byte = uart_getc(s->config.uart);
+    return true;
+}
+
+/**
+ * @brief Lee un paquete completo del sensor sin pausas entre bytes y verifica el checksum.
+ * 
+ * @param pid Identificador del paquete recibido.
+ * @param data Buffer donde se copia el contenido.
+ * @param max Tamaño del buffer.
+ * @param timeout_ms Tiempo máximo de espera del paquete.
+ * @return Longitud del contenido, o -1 si hubo error.
+ */
+int EN_RAM(as608_read_packet)(as608_t *s, uint8_t *pid, uint8_t *data, size_t max, uint32_t timeout_ms) {
+    absolute_time_t limit = make_timeout_time_ms(timeout_ms);
+    uint8_t header[9];
+    uint8_t byte;
+
+    // Sincronizar con el encabezado 0xEF 0x01
+    header[0] = 0;
+    while (true) {
+        if (!as608_read_byte(s, &byte, limit)) {
+            return -1;
+        }
+        if (header[0] == 0xEF && byte == 0x01) {
+            break;
+        }
+        header[0] = byte;
+    }
+    for (int i = 2; i < 9; i++) {
+        if (!as608_read_byte(s, &header[i], limit)) {
+            return -1;
+        }
+    }
+    *pid = header[6];
+    size_t length = (header[7] << 8) | header[8];
+    if (length < 2 || length - 2 > max) {
+        return -1;
+    }
+    uint16_t checksum = header[6] + header[7] + header[8];
+    for (size_t i = 0; i < length - 2; i++) {
+        if (!as608_read_byte(s, &data[i], limit)) {
+            return -1;
+        }
+        checksum += data[i];
+    }
+    uint8_t sum_high, sum_low;
+    if (!as608_read_byte(s, &sum_high, limit) || !as608_read_byte(s, &sum_low, limit)) {
+        return -1;
+    }
+    if (((sum_high << 8) | sum_low) != checksum) {
+        printf("Checksum invalido en paquete %02X\n", *pid);
+        metricas_contar(MET_AS608_CHECKSUM);
+        return -1;
+    }
+    return length - 2;
+}
+
+/**
+ * @brief Envía una instrucción y espera el paquete de respuesta con la política indicada.
+ * 
+ * @param params Instrucción seguida de sus parámetros.
+ * @param len Longitud de params.
+ * @param resp Buffer para los datos de la respuesta después del código de confirmación (puede ser NULL).
+ * @param max Tamaño de resp.
+ * @param pol Plazo y reintentos.
+ * @return Código de confirmación, AS608_ERROR_COM o AS608_CANCELADO.
+ */
+static uint8_t as608_command_policy(as608_t *s, const uint8_t *params, size_t len, uint8_t *resp, size_t max,
+                                   const as608_politica_t *pol) {
+    uint32_t espera = pol->espera_ms;
+    uint8_t ack[64];
+    uint8_t pid;
+    uint8_t codigo = AS608_ERROR_COM;
+    uint8_t sin_respuesta = 0;
+    int n = 0;
+    uint32_t ciclos = perfilador_entrar();
+
+    s->cancelado = false;
+    s->en_curso = true;
+    for (uint8_t intento = 0; intento <= pol->reintentos && !s->cancelado; intento++) {
+        if (intento > 0) {
+            metricas_contar(MET_AS608_REINTENTOS);
+            sleep_ms(espera);
+            espera *= 2;
+        }
+        as608_drain(s);
+        uint64_t inicio = time_us_64();
+        as608_send_packet(s, AS608_PID_COMMAND, params, len);
+        n = as608_read_packet(s, &pid, ack, sizeof(ack), pol->limite_ms);
+        if (n < 1 || pid != AS608_PID_ACK) {
+            codigo = AS608_ERROR_COM;
+            metricas_contar(MET_AS608_SIN_RESPUESTA);
+            if (++sin_respuesta < 2) {
+                continue;
+            }
+            break;
+        }
+        latencia_registrar(latencia_etapa_as608(params[0]), (uint32_t)(time_us_64() - inicio));
+        codigo = ack[0];
+        if (!(pol->reintentar_transitorios && as608_is_transient(codigo))) {
+            break;
+        }
+    }
+    s->en_curso = false;
+    perfilador_salir(PERF_AS608, ciclos);
+    if (s->cancelado) {
+        metricas_codigo(params[0], AS608_CANCELADO);
+        return AS608_CANCELADO;
+    }
+    metricas_codigo(params[0], codigo);
+    if (resp && codigo != AS608_ERROR_COM) {
+        for (int i = 1; i < n && (size_t)(i - 1) < max; i++) {
+            resp[i - 1] = ack[i];
+        }
+    }
+    return codigo;
+}
+
+/**
+ * @brief Envía una instrucción y espera el paquete de respuesta aplicando la política de la instrucción.
+ */
+uint8_t as608_command(as608_t *s, const uint8_t *params, size_t len, uint8_t *resp, size_t max) {
+    return as608_command_policy(s, params, len, resp, max, as608_policy(params[0]));
+}
+
+/**
+ * @brief Envía una instrucción sin esperar la respuesta.
+ */
+void as608_start(as608_t *s, const uint8_t *params, size_t len) {
+    as608_drain(s);
+    s->cancelado = false;
+    s->en_curso = true;
+    s->asincrona.activa = true;
+    s->asincrona.instruccion = params[0];
+    s->asincrona.n = 0;
+    s->asincrona.inicio = time_us_64();
+    s->asincrona.limite = make_timeout_time_ms(as608_policy(params[0])->limite_ms);
+    as608_send_packet(s, AS608_PID_COMMAND, params, len);
+}
+
+/**
+ * @brief Recoge los bytes disponibles de la respuesta de la instrucción asíncrona, sin bloquear.
+ */
+uint8_t as608_poll(as608_t *s, uint8_t *resp, size_t max) {
+    if (!s->asincrona.activa) {
+        return AS608_ERROR_COM;
+    }
+    uint8_t *p = s->asincrona.paquete;
+    bool invalido = false;
+    while (!s->cancelado && uart_is_readable(s->config.uart)) {
+        uint8_t byte = uart_getc(s->config.uart);
+        // Sincronizar con el encabezado 0xEF 0x01
+        if ((s->asincrona.n == 0 && byte != 0xEF) || (s->asincrona.n == 1 && byte != 0x01)) {
+            s->asincrona.n = (byte == 0xEF);
+            p[0] = byte;
+            continue;
+        }
+        p[s->asincrona.n++] = byte;
+        if (s->asincrona.n < 9) {
+            continue;
+        }
+        size_t length = (p[7] << 8) | p[8];
+        if (length < 3 || 9 + length > sizeof(s->asincrona.paquete)) {
+            invalido = true;
+            break;
+        }
+        if (s->asincrona.n < 9 + length) {
+            continue;
+        }
+        uint16_t checksum = 0;
+        for (size_t i = 6; i < 7 + length; i++) {
+            checksum += p[i];
+        }
+        s->asincrona.activa = s->en_curso = false;
+        if (p[6] != AS608_PID_ACK || ((p[7 + length] << 8) | p[8 + length]) != checksum) {
+            if (p[6] == AS608_PID_ACK) {
+                metricas_contar(MET_AS608_CHECKSUM);
+            }
+            metricas_contar(MET_AS608_SIN_RESPUESTA);
+            metricas_codigo(s->asincrona.instruccion, AS608_ERROR_COM);
+            return AS608_ERROR_COM;
+        }
+        latencia_registrar(latencia_etapa_as608(s->asincrona.instruccion),
+                           (uint32_t)(time_us_64() - s->asincrona.inicio));
+        for (size_t i = 0; resp && i < max && i + 3 < length; i++) {
+            resp[i] = p[10 + i];
+        }
+        metricas_codigo(s->asincrona.instruccion, p[9]);
+        return p[9];
+    }
+    if (s->cancelado || invalido || time_reached(s->asincrona.limite)) {
+        // Cancelada, paquete inválido o sin respuesta: la respuesta tardía se descarta en el próximo envío
+        s->asincrona.activa = s->en_curso = false;
+        if (!s->cancelado) {
+            metricas_contar(MET_AS608_SIN_RESPUESTA);
+        }
+        metricas_codigo(s->asincrona.instruccion, s->cancelado ? AS608_CANCELADO : AS608_ERROR_COM);
+        return s->cancelado ? AS608_CANCELADO : AS608_ERROR_COM;
+    }
+    return AS608_EN_CURSO;
+}
+
+/**
+ * @brief Índice (0-3) de una longitud de paquete válida, o -1.
+ */
+static int as608_indice_tamano(uint16_t bytes) {
+    for (int i = 0; i < AS608_TAMANOS_PAQUETE; i++) {
+        if (bytes == (32u << i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Acumula una transferencia de datos en los contadores de la longitud de paquete actual.
+ */
+static void as608_contar_transferencia(as608_t *s, size_t bytes, uint32_t paquetes, uint64_t us) {
+    int i = as608_indice_tamano(s->tam_paquete);
+    if (i < 0) {
+        return;
+    }
+    s->transferencias[i].bytes += bytes;
+    s->transferencias[i].paquetes += paquetes;
+    s->transferencias[i].transferencias++;
+    s->transferencias[i].us += us;
+}
+
+/**
+ * @brief Carga una plantilla de la base de datos en un buffer del sensor (LoadChar).
+ * 
+ * @param slot Buffer destino (1 o 2).
+ * @param id Posición de la plantilla.
+ * @return Código de confirmación.
+ */
+uint8_t as608_load_model(as608_t *s, uint8_t slot, uint16_t id) {
+    uint8_t params[] = {0x07, slot, (id >> 8) & 0xFF, id & 0xFF};
+    return as608_command(s, params, sizeof(params), NULL, 0);
+}
+
+/**
+ * @brief Compara las plantillas de CharBuffer1 y CharBuffer2 (Match).
+ * 
+ * @param score Puntaje de coincidencia (puede ser NULL).
+ * @return Código de confirmación.
+ */
+uint8_t as608_match(as608_t *s, uint16_t *score) {
+    uint8_t params[] = {0x03};
+    uint8_t resp[2] = {0};
+    uint8_t codigo = as608_command(s, params, sizeof(params), resp, sizeof(resp));
+    if (score) {
+        *score = codigo == AS608_OK ? (resp[0] << 8) | resp[1] : 0;
+    }
+    return codigo;
 }
 
+/**
+ * @brief Descarga al microcontrolador la plantilla de un buffer del sensor (UpChar).
+ * 
+ * @param slot Buffer origen (1 o 2).
+ * @param data Buffer destino.
+ * @param max Tamaño de data.
+ * @param len Bytes recibidos.
+ * @return Código de confirmación.
+ */
+uint8_t as608_upload_model(as608_t *s, uint8_t slot, uint8_t *data, size_t max, size_t *len) {
+    uint8_t params[] = {0x08, slot};
+    uint8_t pid;
+
+    uint32_t paquetes = 0;
+
+    *len = 0;
+    uint64_t inicio = time_us_64();
+    uint8_t status = as608_command(s, params, sizeof(params), NULL, 0);
+    if (status != 0) {
+        return status;
+    }
+    // La plantilla llega en paquetes de datos consecutivos; el último tiene PID 0x08. Cada
+    // paquete se lee directamente a continuación del anterior, sin buffer intermedio.
+    do {
+        int n = as608_read_packet(s, &pid, data + *len, max - *len, as608_policy(0x08)->limite_ms);
+        if (n < 0) {
+            return AS608_ERROR_COM;
+        }
+        *len += n;
+        paquetes++;
+    } while (pid == AS608_PID_DATA);
+    if (pid != AS608_PID_END) {
+        return AS608_ERROR_COM;
+    }
+    as608_contar_transferencia(s, *len, paquetes, time_us_64() - inicio);
+    return 0;
+}
+
+/**
+ * @brief Envía una plantilla al buffer del sensor (DownChar).
+ * 
+ * @param slot Buffer destino (1 o 2).
+ * @param data Plantilla.
+ * @param len Longitud de la plantilla.
+ * @return Código de confirmación.
+ */
+uint8_t as608_download_model(as608_t *s, uint8_t slot, const uint8_t *data, size_t len) {
+    uint8_t params[] = {0x09, slot};
+
+    uint32_t paquetes = 0;
+
+    uint64_t inicio = time_us_64();
+    uint8_t status = as608_command(s, params, sizeof(params), NULL, 0);
+    if (status != 0) {
+        return status;
+    }
+    // El módulo descarta paquetes más largos que su longitud configurada
+    for (size_t sent = 0; sent < len; sent += s->tam_paquete) {
+        size_t chunk = len - sent < s->tam_paquete ? len - sent : s->tam_paquete;
+        uint8_t pid = (sent + chunk < len) ? AS608_PID_DATA : AS608_PID_END;
+        as608_send_packet(s, pid, data + sent, chunk);
+        paquetes++;
+    }
+    uart_tx_wait_blocking(s->config.uart);
+    as608_contar_transferencia(s, len, paquetes, time_us_64() - inicio);
+    return 0;
+}
+
+/**
+ * @brief Lee una página de la tabla de índices de la base de datos (ReadConList).
+ * 
+ * @param page Página de la tabla (0 a 3, 256 posiciones cada una).
+ * @param table Bitmap de 32 bytes con las posiciones ocupadas.
+ * @return Código de confirmación.
+ */
+uint8_t as608_read_index_table(as608_t *s, uint8_t page, uint8_t table[32]) {
+    uint8_t params[] = {0x1F, page};
+    return as608_command(s, params, sizeof(params), table, 32);
+}
+
+/**
+ * @brief Lee los parámetros del sistema (ReadSysPara).
+ * 
+ * @param sistema Parámetros leídos (puede ser NULL).
+ * @return Código de confirmación.
+ */
+uint8_t as608_read_sys_params(as608_t *s, as608_sistema_t *sistema) {
+    uint8_t params[] = {0x0F};
+    uint8_t r[16];
+    uint8_t codigo = as608_command(s, params, sizeof(params), r, sizeof(r));
+    if (codigo != AS608_OK) {
+        return codigo;
+    }
+    uint16_t n = (r[12] << 8) | r[13];
+    if (n < AS608_TAMANOS_PAQUETE) {
+        s->tam_paquete = 32u << n;
+    }
+    if (sistema) {
+        sistema->estado = (r[0] << 8) | r[1];
+        sistema->id_sistema = (r[2] << 8) | r[3];
+        sistema->capacidad = (r[4] << 8) | r[5];
+        sistema->seguridad = (r[6] << 8) | r[7];
+        sistema->direccion = ((uint32_t)r[8] << 24) | ((uint32_t)r[9] << 16) | (r[10] << 8) | r[11];
+        sistema->tam_paquete = s->tam_paquete;
+        sistema->baudios = 9600u * ((r[14] << 8) | r[15]);
+    }
+    return AS608_OK;
+}
+
+/**
+ * @brief Cambia la longitud de los paquetes de datos (SetSysPara, parámetro 6).
+ * 
+ * @param bytes 32, 64, 128 o 256.
+ * @return Código de confirmación.
+ */
+uint8_t as608_set_packet_size(as608_t *s, uint16_t bytes) {
+    int n = as608_indice_tamano(bytes);
+    if (n < 0) {
+        return AS608_REGISTRO_INVALIDO;
+    }
+    uint8_t params[] = {0x0E, 6, (uint8_t)n};
+    uint8_t codigo = as608_command(s, params, sizeof(params), NULL, 0);
+    if (codigo == AS608_OK) {
+        s->tam_paquete = bytes;
+    }
+    return codigo;
+}
+
+uint16_t as608_packet_size(const as608_t *s) {
+    return s->tam_paquete;
+}
+
+const as608_transferencia_t *as608_transfer_stats(const as608_t *s, uint16_t bytes) {
+    int i = as608_indice_tamano(bytes);
+    return i < 0 ? NULL : &s->transferencias[i];
+}
 
+uint32_t as608_desbordes(as608_t *s) {
+    uart_hw_t *hw = uart_get_hw(s->config.uart);
+    if (hw->rsr & UART_UARTRSR_OE_BITS) {
+        hw->rsr = 0;    ///< Escribir en UARTECR borra los indicadores de error
+        s->desbordes++;
+        metricas_contar(MET_AS608_DESBORDES);
+    }
+    return s->desbordes;
+}
+
+/**
+ * @brief Identificación automática en una sola transacción (Identify).
+ */
+static uint8_t as608_identify_auto(as608_t *s, uint16_t *page_id, uint16_t *score, const as608_politica_t *pol) {
+    uint8_t params[] = {0x11};
+    uint8_t resp[4] = {0};
+    uint8_t codigo = as608_command_policy(s, params, sizeof(params), resp, sizeof(resp), pol);
+    if (page_id) {
+        *page_id = (resp[0] << 8) | resp[1];
+    }
+    if (score) {
+        *score = (resp[2] << 8) | resp[3];
+    }
+    return codigo;
+}
+
+/**
+ * @brief Verifica si el módulo soporta Identify y elige el camino de verificación.
+ */
+bool as608_probe_identify(as608_t *s) {
+    // Un solo intento: sin dedo la respuesta "sin dedo" ya confirma el soporte
+    as608_politica_t sonda = *as608_policy(0x11);
+    sonda.reintentos = 0;
+    uint64_t inicio = time_us_64();
+    uint8_t codigo = as608_identify_auto(s, NULL, NULL, &sonda);
+    s->identify_soportado = (codigo != AS608_ERROR_PAQUETE && codigo != AS608_ERROR_COM);
+    printf("AS608 uart%u: Identify %s (codigo %02X, %lu us)\n", uart_get_index(s->config.uart),
+           s->identify_soportado ? "soportado" : "no soportado",
+           codigo, (unsigned long)(time_us_64() - inicio));
+    return s->identify_soportado;
+}
+
+/**
+ * @brief Captura, extrae y busca una huella por el camino elegido en el arranque.
+ */
+uint8_t as608_identify(as608_t *s, uint16_t *page_id, uint16_t *score) {
+    if (s->identify_soportado) {
+        uint8_t codigo = as608_identify_auto(s, page_id, score, as608_policy(0x11));
+        if (codigo != AS608_ERROR_PAQUETE) {
+            return codigo;
+        }
+        // El módulo dejó de aceptar la instrucción (p. ej. se reemplazó): se usan las tres etapas
+        s->identify_soportado = false;
+    }
+    uint8_t codigo = as608_get_image(s);
+    if (codigo != AS608_OK) {
+        return codigo;
+    }
+    codigo = as608_image_to_template(s, 1);
+    if (codigo != AS608_OK) {
+        return codigo;
+    }
+    return as608_search(s, page_id, score);
+}
+
+/**
+ * @brief Enciende el sensor si estaba apagado y espera su arranque.
+ */
+static void as608_power_on(as608_t *s) {
+    if (s->encendido || s->config.alimentacion < 0) {
+        return;
+    }
+    gpio_put(s->config.alimentacion, AS608_POWER_ON);
+    gpio_set_function(s->config.tx, GPIO_FUNC_UART);
+    gpio_set_function(s->config.rx, GPIO_FUNC_UART);
+    sleep_ms(AS608_ARRANQUE_MS);
+    s->encendido = true;
+    as608_drain(s);  // Byte de arranque (0x55) que envía el módulo
+}
+
+/**
+ * @brief Apaga el sensor.
+ */
+void as608_sleep(as608_t *s) {
+    if (!s->encendido || s->config.alimentacion < 0) {
+        return;
+    }
+    // TX en alto alimentaría el módulo apagado a través de su entrada: se deja como entrada
+    gpio_set_function(s->config.tx, GPIO_FUNC_SIO);
+    gpio_set_dir(s->config.tx, GPIO_IN);
+    gpio_set_function(s->config.rx, GPIO_FUNC_SIO);
+    gpio_set_dir(s->config.rx, GPIO_IN);
+    gpio_put(s->config.alimentacion, !AS608_POWER_ON);
+    s->encendido = false;
+}
+
+/**
+ * @brief Configura la línea de toque y el corte de alimentación.
+ */
+static void as608_touch_init(as608_t *s) {
+    if (s->config.toque >= 0) {
+        gpio_init(s->config.toque);
+        gpio_set_dir(s->config.toque, GPIO_IN);
+        gpio_pull_down(s->config.toque);  // Sin dedo la salida del módulo queda en alta impedancia
+        gpio_set_irq_enabled(s->config.toque, GPIO_IRQ_EDGE_RISE, true);
+    }
+    if (s->config.alimentacion >= 0) {
+        gpio_init(s->config.alimentacion);
+        gpio_set_dir(s->config.alimentacion, GPIO_OUT);
+        gpio_put(s->config.alimentacion, AS608_POWER_ON);
+    }
+}
+
+/**
+ * @brief Flanco de la línea de toque: anota el instante en el lector y despierta al núcleo que
+ * espera en as608_wait_touch (que vuelve a mirar su propia línea).
+ */
+void EN_RAM(as608_touch_irq)(as608_t *s, uint32_t events) {
+    if (events & GPIO_IRQ_EDGE_RISE) {
+        metricas_contar(MET_TOQUE_FLANCOS);
+        s->toque_inicio = time_us_32();
+        s->toque_abierto = true;
+        __sev();
+    }
+}
+
+/**
+ * @brief Cierra la latencia LAT_TOQUE del lector, si hubo un flanco desde el último toque estable.
+ */
+void as608_touch_stable(as608_t *s) {
+    if (s->toque_abierto) {
+        s->toque_abierto = false;
+        latencia_registrar(LAT_TOQUE, time_us_32() - s->toque_inicio);
+    }
+}
+
+/**
+ * @brief Espera un dedo apoyado de forma estable.
+ */
+bool as608_wait_touch(as608_t *s, uint32_t timeout_ms) {
+    if (s->config.toque < 0) {
+        sleep_ms(AS608_SIN_TOQUE_MS);
+        as608_power_on(s);
+        return true;
+    }
+    absolute_time_t limite = make_timeout_time_ms(timeout_ms);
+    while (!time_reached(limite)) {
+        if (!gpio_get(s->config.toque)) {
+            // El flanco hace __sev(), así que un toque entre la lectura y la espera no se pierde
+            best_effort_wfe_or_timeout(limite);
+            continue;
+        }
+        // Un contacto parcial hace rebotar la línea: se exige que se mantenga alta
+        absolute_time_t estable = make_timeout_time_ms(AS608_TOQUE_ESTABLE_MS);
+        bool apoyado = true;
+        while (apoyado && !time_reached(estable)) {
+            sleep_ms(5);
+            apoyado = gpio_get(s->config.toque);
+        }
+        if (apoyado) {
+            as608_power_on(s);
+            as608_touch_stable(s);
+            return true;
+        }
+    }
+    metricas_contar(MET_TOQUE_PLAZOS);
+    return false;
+}
+
+/**
+ * @brief Espera a que se retire el dedo.
+ */
+bool as608_wait_release(as608_t *s, uint32_t timeout_ms) {
+    if (s->config.toque < 0) {
+        return true;
+    }
+    absolute_time_t limite = make_timeout_time_ms(timeout_ms);
+    while (gpio_get(s->config.toque) && !time_reached(limite)) {
+        sleep_ms(20);
+    }
+    return !gpio_get(s->config.toque);
+}
+
+// Paquete crudo más largo: cabecera (9), 256 bytes de datos y checksum (2)
+#define AS608_PAQUETE_CRUDO (9 + 256 + 2)
+
+// UpImage es bloqueante, así que los buffers se comparten entre instancias
+static uint8_t imagen_crudo[2][AS608_PAQUETE_CRUDO];  ///< Destino alterno del DMA
+static uint8_t imagen_pixeles[2 * 256];               ///< Bloque desempaquetado
+
+/**
+ * @brief Programa el canal DMA para copiar n bytes del UART a destino.
+ */
+static void as608_dma_armar(as608_t *s, int canal, uint8_t *destino, size_t n) {
+    dma_channel_config cfg = dma_channel_get_default_config(canal);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&cfg, false);
+    channel_config_set_write_increment(&cfg, true);
+    channel_config_set_dreq(&cfg, uart_get_dreq(s->config.uart, false));
+    dma_channel_configure(canal, &cfg, destino, &uart_get_hw(s->config.uart)->dr, n, true);
+}
+
+/**
+ * @brief Espera a que el paquete crudo en curso esté completo.
+ */
+static bool as608_imagen_esperar(as608_t *s, int canal, uint8_t *destino, size_t n, uint32_t timeout_ms) {
+    absolute_time_t limite = make_timeout_time_ms(timeout_ms);
+    if (canal < 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (!as608_read_byte(s, &destino[i], limite)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    while (dma_channel_is_busy(canal)) {
+        if (time_reached(limite) || s->cancelado) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Sube la imagen del sensor por bloques con doble buffer.
+ */
+uint8_t as608_upload_image(as608_t *s, as608_imagen_cb_t cb, void *ctx, as608_imagen_stats_t *stats) {
+    uint8_t params[] = {0x0A};
+    size_t datos = s->tam_paquete;
+    size_t n = 9 + datos + 2;
+    uint32_t desplazamiento = 0;
+    uint32_t paquetes = 0;
+    int actual = 0;
+
+    uint64_t inicio = time_us_64();
+    uint8_t codigo = as608_command(s, params, sizeof(params), NULL, 0);
+    if (codigo != AS608_OK) {
+        return codigo;
+    }
+    // Todos los paquetes de la imagen tienen la longitud configurada (36864 es múltiplo de 256)
+    int canal = dma_claim_unused_channel(false);
+    if (canal >= 0) {
+        as608_dma_armar(s, canal, imagen_crudo[0], n);
+    }
+    s->en_curso = true;
+    while (true) {
+        uint8_t *p = imagen_crudo[actual];
+        if (!as608_imagen_esperar(s, canal, p, n, as608_policy(0x0A)->limite_ms)) {
+            codigo = s->cancelado ? AS608_CANCELADO : AS608_ERROR_COM;
+            break;
+        }
+        bool ultimo = (p[6] == AS608_PID_END);
+        // El módulo no espera: el otro buffer se arma antes de procesar este
+        if (!ultimo && canal >= 0) {
+            as608_dma_armar(s, canal, imagen_crudo[actual ^ 1], n);
+        }
+        uint16_t longitud = (p[7] << 8) | p[8];
+        uint16_t checksum = p[6] + p[7] + p[8];
+        for (size_t i = 0; i < datos; i++) {
+            checksum += p[9 + i];
+        }
+        if (p[0] != 0xEF || p[1] != 0x01 || longitud != datos + 2 ||
+            (p[6] != AS608_PID_DATA && !ultimo) || ((p[9 + datos] << 8) | p[10 + datos]) != checksum) {
+            printf("UpImage: paquete %lu invalido\n", (unsigned long)paquetes);
+            codigo = AS608_ERROR_COM;
+            break;
+        }
+        // Dos píxeles por byte, el de la izquierda en el nibble alto; 0-15 se escala a 0-255
+        for (size_t i = 0; i < datos; i++) {
+            imagen_pixeles[2 * i] = (p[9 + i] >> 4) * 17;
+            imagen_pixeles[2 * i + 1] = (p[9 + i] & 0x0F) * 17;
+        }
+        if (cb) {
+            cb(imagen_pixeles, 2 * datos, desplazamiento, ctx);
+        }
+        desplazamiento += 2 * datos;
+        paquetes++;
+        if (ultimo) {
+            break;
+        }
+        actual ^= 1;
+    }
+    s->en_curso = false;
+    if (canal >= 0) {
+        dma_channel_abort(canal);
+        dma_channel_unclaim(canal);
+    }
+    if (codigo != AS608_OK) {
+        as608_drain(s);
+    }
+    if (stats) {
+        stats->bytes = desplazamiento / 2;
+        stats->paquetes = paquetes;
+        stats->us = (uint32_t)(time_us_64() - inicio);
+        stats->ram = 2 * n + 2 * datos;
+        stats->dma = canal >= 0;
+    }
+    return codigo;
+}
+
+/**
+ * @brief Prepara un lote vacío sobre un arreglo de operaciones.
+ */
+void as608_lote_iniciar(as608_lote_t *lote, as608_operacion_t *ops, uint16_t max) {
+    lote->ops = ops;
+    lote->max = max;
+    lote->cantidad = 0;
+}
+
+/**
+ * @brief Encola el borrado de un tramo de posiciones.
+ */
+bool as608_lote_borrar(as608_lote_t *lote, uint16_t id, uint16_t cantidad) {
+    if (lote->cantidad >= lote->max || cantidad == 0) {
+        return false;
+    }
+    as608_operacion_t *op = &lote->ops[lote->cantidad++];
+    op->instruccion = 0x0C;
+    op->posicion = id;
+    op->cantidad = cantidad;
+    op->plantilla = NULL;
+    op->longitud = 0;
+    return true;
+}
+
+/**
+ * @brief Encola el almacenamiento de una plantilla en una posición.
+ */
+bool as608_lote_guardar(as608_lote_t *lote, uint16_t id, const uint8_t *plantilla, uint16_t longitud) {
+    if (lote->cantidad >= lote->max) {
+        return false;
+    }
+    as608_operacion_t *op = &lote->ops[lote->cantidad++];
+    op->instruccion = 0x06;
+    op->posicion = id;
+    op->cantidad = 1;
+    op->plantilla = plantilla;
+    op->longitud = longitud;
+    return true;
+}
+
+/**
+ * @brief Ordena por posición los borrados ops[desde..hasta) (inserción: las rachas son cortas y
+ * suelen venir casi ordenadas).
+ */
+static void as608_lote_ordenar(as608_operacion_t *ops, uint16_t desde, uint16_t hasta) {
+    for (uint16_t i = desde + 1; i < hasta; i++) {
+        as608_operacion_t op = ops[i];
+        uint16_t j = i;
+        while (j > desde && ops[j - 1].posicion > op.posicion) {
+            ops[j] = ops[j - 1];
+            j--;
+        }
+        ops[j] = op;
+    }
+}
+
+/**
+ * @brief Ejecuta el lote en orden y se detiene en la primera operación que falla.
+ */
+uint8_t as608_lote_ejecutar(as608_t *s, as608_lote_t *lote, as608_lote_resultado_t *resultado) {
+    as608_lote_resultado_t r = {0};
+    uint16_t i = 0;
+
+    r.codigo = AS608_OK;
+    while (i < lote->cantidad && r.codigo == AS608_OK) {
+        as608_operacion_t *op = &lote->ops[i];
+        if (op->instruccion == 0x06) {
+            if (op->plantilla) {
+                r.codigo = as608_download_model(s, 1, op->plantilla, op->longitud);
+                r.instrucciones++;
+            }
+            if (r.codigo == AS608_OK) {
+                r.codigo = as608_store_model(s, op->posicion);
+                r.instrucciones++;
+            }
+            if (r.codigo == AS608_OK) {
+                i++;
+            }
+            continue;
+        }
+        // Racha de borrados: se ordena y cada tramo contiguo va en un solo DeletChar
+        uint16_t fin = i;
+        while (fin < lote->cantidad && lote->ops[fin].instruccion == 0x0C) {
+            fin++;
+        }
+        as608_lote_ordenar(lote->ops, i, fin);
+        while (i < fin && r.codigo == AS608_OK) {
+            uint16_t tramo = i + 1;
+            uint32_t desde = lote->ops[i].posicion;
+            uint32_t hasta = desde + lote->ops[i].cantidad;
+            while (tramo < fin && lote->ops[tramo].posicion <= hasta) {
+                uint32_t fin_op = (uint32_t)lote->ops[tramo].posicion + lote->ops[tramo].cantidad;
+                hasta = fin_op > hasta ? fin_op : hasta;
+                tramo++;
+            }
+            r.codigo = as608_delete_range(s, desde, hasta - desde);
+            r.instrucciones++;
+            if (r.codigo == AS608_OK) {
+                i = tramo;
+            }
+        }
+    }
+    r.hechas = i;
+    r.fallida = i;
+    lote->cantidad = 0;
+    if (resultado) {
+        *resultado = r;
+    }
+    return r.codigo;
+}
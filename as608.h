@@ -1,6 +1,12 @@
 /**
  * @file as608.h
  * @brief Declaraciones de funciones para el funcionamiento del lector AS608 con la Raspberry Pi Pico.
+ *
+ * Cada lector es una instancia as608_t con su UART, sus pines y todo el estado del driver
+ * (instrucción en curso, respuesta asíncrona, longitud de paquete, contadores), así que se pueden
+ * conectar varios módulos a la vez, uno por UART. Las instrucciones bloqueantes ocupan al núcleo
+ * hasta la respuesta; las asíncronas (as608_start/as608_poll) de lectores distintos avanzan en
+ * paralelo desde el mismo bucle.
  */
 
 #ifndef AS608_H
@@ -9,11 +15,36 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include "hardware/uart.h"
+#include "pico/time.h"
+
+/**
+ * @brief Conexión de un lector.
+ */
+typedef struct {
+    uart_inst_t *uart;
+    uint8_t tx;            ///< GPIO de TX del UART (RX del módulo)
+    uint8_t rx;            ///< GPIO de RX del UART (TX del módulo)
+    uint32_t baudios;
+    int8_t toque;          ///< GPIO de la línea de toque (WAK), o -1 si no está conectada
+    int8_t alimentacion;   ///< GPIO del corte de alimentación, o -1 si el módulo está siempre encendido
+} as608_config_t;
+
+/**
+ * @brief Instancia del driver (definida más abajo). La memoria la pone el llamador.
+ */
+typedef struct as608 as608_t;
 
 /**
  * @brief Inicializa el sensor de huellas AS608.
+ *
+ * No inicializa stdio ni espera el arranque del módulo: la aplicación llama a stdio_init_all y
+ * hace la espera una sola vez para todos los lectores.
+ *
+ * @param s Instancia a inicializar.
+ * @param config UART y pines del lector (p. ej. AS608_CONFIG_PUERTA).
  */
-void as608_init(void);
+void as608_init(as608_t *s, const as608_config_t *config);
 
 /**
  * @brief Envía un comando al sensor de huellas AS608.
@@ -21,7 +52,7 @@ void as608_init(void);
  * @param command Comando a enviar.
  * @param len Longitud del comando.
  */
-void as608_send_command(const uint8_t *command, size_t len);
+void as608_send_command(as608_t *s, const uint8_t *command, size_t len);
 
 /**
  * @brief Lee una respuesta del sensor de huellas AS608 con un temporizador de espera.
@@ -30,14 +61,14 @@ void as608_send_command(const uint8_t *command, size_t len);
  * @param len Longitud esperada de la respuesta.
  * @return uint8_t Código de confirmación en la respuesta del sensor.
  */
-uint8_t as608_read_response(uint8_t *response, size_t len);
+uint8_t as608_read_response(as608_t *s, uint8_t *response, size_t len);
 
 /**
  * @brief Captura una imagen de huella dactilar del sensor AS608.
  * 
  * @return uint8_t Código de confirmación en la respuesta del sensor.
  */
-uint8_t as608_get_image(void);
+uint8_t as608_get_image(as608_t *s);
 
 /**
  * @brief Convierte una imagen capturada en una plantilla y la almacena en el buffer especificado.
@@ -45,14 +76,14 @@ uint8_t as608_get_image(void);
  * @param slot Buffer donde almacenar la plantilla (1 o 2).
  * @return uint8_t Código de confirmación en la respuesta del sensor.
  */
-uint8_t as608_image_to_template(uint8_t slot);
+uint8_t as608_image_to_template(as608_t *s, uint8_t slot);
 
 /**
  * @brief Crea un modelo a partir de las dos plantillas almacenadas en los buffers.
  * 
  * @return uint8_t Código de confirmación en la respuesta del sensor.
  */
-uint8_t as608_create_model(void);
+uint8_t as608_create_model(as608_t *s);
 
 /**
  * @brief Almacena una plantilla en la posición especificada.
@@ -60,14 +91,40 @@ uint8_t as608_create_model(void);
  * @param id ID donde almacenar la plantilla.
  * @return uint8_t Código de confirmación en la respuesta del sensor.
  */
-uint8_t as608_store_model(uint16_t id);
+uint8_t as608_store_model(as608_t *s, uint16_t id);
 
 /**
  * @brief Busca una huella en la base de datos.
  * 
  * @return uint8_t Código de confirmación en la respuesta del sensor.
  */
-uint8_t as608_search_model(void);
+uint8_t as608_search_model(as608_t *s);
+
+/**
+ * @brief Busca una huella en la base de datos y devuelve la posición y el puntaje.
+ * 
+ * @param page_id Posición de la huella encontrada (puede ser NULL).
+ * @param score Puntaje de coincidencia (puede ser NULL).
+ * @return uint8_t Código de confirmación en la respuesta del sensor.
+ */
+uint8_t as608_search(as608_t *s, uint16_t *page_id, uint16_t *score);
+
+#define AS608_BUSQUEDA_POSICIONES 100 ///< Posiciones que recorre Search hasta as608_set_search_count
+
+/**
+ * @brief Fija cuántas posiciones, desde la 0, recorre Search (as608_search y la búsqueda
+ * asíncrona de la captura anticipada). Identify recorre siempre toda la biblioteca.
+ * 
+ * @param cantidad Posiciones a recorrer (al menos 1).
+ */
+void as608_set_search_count(as608_t *s, uint16_t cantidad);
+
+/**
+ * @brief Posiciones que recorre Search.
+ * 
+ * @return uint16_t Cantidad fijada con as608_set_search_count.
+ */
+uint16_t as608_search_count(const as608_t *s);
 
 /**
  * @brief Elimina una huella de la base de datos.
@@ -75,14 +132,475 @@ uint8_t as608_search_model(void);
  * @param id ID de la huella a eliminar.
  * @return uint8_t Código de confirmación en la respuesta del sensor.
  */
-uint8_t as608_delete_model(uint16_t id);
+uint8_t as608_delete_model(as608_t *s, uint16_t id);
+
+/**
+ * @brief Elimina un tramo de posiciones contiguas con una sola instrucción DeletChar.
+ * 
+ * @param id Primera posición.
+ * @param cantidad Posiciones a borrar.
+ * @return uint8_t Código de confirmación en la respuesta del sensor.
+ */
+uint8_t as608_delete_range(as608_t *s, uint16_t id, uint16_t cantidad);
 
 /**
  * @brief Elimina todas las huellas dactilares de la base de datos.
  * 
  * @return uint8_t Código de confirmación en la respuesta del sensor.
  */
-uint8_t as608_empty_database(void);
+uint8_t as608_empty_database(as608_t *s);
+
+/**
+ * @brief Operación de un lote.
+ */
+typedef struct {
+    uint8_t instruccion;        ///< 0x06 (Store) o 0x0C (DeletChar)
+    uint16_t posicion;          ///< Posición (primera del tramo en un borrado)
+    uint16_t cantidad;          ///< Posiciones del tramo (borrado)
+    const uint8_t *plantilla;   ///< Plantilla a bajar antes del Store (NULL = la de CharBuffer1)
+    uint16_t longitud;          ///< Bytes de la plantilla
+} as608_operacion_t;
+
+/**
+ * @brief Lote de altas y bajas que se ejecuta como una sola transacción. La memoria de las
+ * operaciones la pone quien arma el lote.
+ */
+typedef struct {
+    as608_operacion_t *ops;
+    uint16_t max;
+    uint16_t cantidad;
+} as608_lote_t;
+
+/**
+ * @brief Resultado agregado de un lote.
+ */
+typedef struct {
+    uint16_t hechas;        ///< Operaciones del lote completadas
+    uint16_t instrucciones; ///< Instrucciones enviadas al sensor (tras agrupar los borrados)
+    uint16_t fallida;       ///< Índice de la operación que falló (== hechas si hubo error)
+    uint8_t codigo;         ///< AS608_OK o el código de la operación que falló
+} as608_lote_resultado_t;
+
+/**
+ * @brief Prepara un lote vacío sobre un arreglo de operaciones.
+ */
+void as608_lote_iniciar(as608_lote_t *lote, as608_operacion_t *ops, uint16_t max);
+
+/**
+ * @brief Encola el borrado de un tramo de posiciones.
+ * 
+ * @return bool false si el lote está lleno.
+ */
+bool as608_lote_borrar(as608_lote_t *lote, uint16_t id, uint16_t cantidad);
+
+/**
+ * @brief Encola el almacenamiento de una plantilla en una posición.
+ * 
+ * @param plantilla Plantilla a bajar a CharBuffer1 (DownChar) antes del Store, o NULL para
+ * almacenar el contenido actual de CharBuffer1. Debe seguir válida hasta ejecutar el lote.
+ * @return bool false si el lote está lleno.
+ */
+bool as608_lote_guardar(as608_lote_t *lote, uint16_t id, const uint8_t *plantilla, uint16_t longitud);
+
+/**
+ * @brief Ejecuta el lote en orden y se detiene en la primera operación que falla.
+ * 
+ * Cada racha de borrados consecutivos se ordena y los tramos contiguos o superpuestos se envían
+ * como un único DeletChar, así que borrar las huellas de varios usuarios cuesta una instrucción por
+ * tramo y no una por posición. Vacía el lote.
+ * 
+ * @param lote Lote a ejecutar.
+ * @param resultado Resumen (puede ser NULL).
+ * @return uint8_t AS608_OK o el código de la operación que falló.
+ */
+uint8_t as608_lote_ejecutar(as608_t *s, as608_lote_t *lote, as608_lote_resultado_t *resultado);
+
+#define AS608_PID_COMMAND 0x01  ///< Paquete de comando
+#define AS608_PID_DATA    0x02  ///< Paquete de datos (hay más paquetes después)
+#define AS608_PID_ACK     0x07  ///< Paquete de respuesta
+#define AS608_PID_END     0x08  ///< Último paquete de datos
+
+#define AS608_TEMPLATE_SIZE 512 ///< Bytes de una plantilla (UpChar/DownChar)
+#define AS608_DATA_PACKET   128 ///< Longitud por defecto de los paquetes de datos
+#define AS608_TAMANOS_PAQUETE 4  ///< Longitudes configurables: 32, 64, 128 y 256 bytes
+#define AS608_ERROR_COM     0xFF ///< Error de comunicación (tiempo agotado o checksum inválido)
+
+// Códigos de confirmación usados por el flujo de verificación
+#define AS608_OK             0x00 ///< Operación exitosa
+#define AS608_ERROR_PAQUETE  0x01 ///< Error de paquete o instrucción no soportada por el módulo
+#define AS608_SIN_DEDO       0x02 ///< No hay dedo sobre el sensor
+#define AS608_FALLO_CAPTURA  0x03 ///< Falló la captura de la imagen
+#define AS608_IMAGEN_MALA    0x06 ///< Imagen demasiado desordenada para extraer la plantilla
+#define AS608_POCOS_RASGOS   0x07 ///< Imagen con muy pocos puntos característicos
+#define AS608_NO_COINCIDE    0x08 ///< Las plantillas de los dos CharBuffer no coinciden
+#define AS608_NO_ENCONTRADA  0x09 ///< La huella no está en la base de datos
+#define AS608_SIN_COMBINAR   0x0A ///< RegModel no pudo combinar las dos plantillas
+#define AS608_SIN_IMAGEN     0x15 ///< No hay imagen válida en el buffer
+#define AS608_REGISTRO_INVALIDO 0x1A ///< Parámetro del sistema o valor inválido
+#define AS608_EN_CURSO       0xFC ///< La instrucción asíncrona aún no respondió (código local)
+#define AS608_CANCELADO      0xFE ///< Instrucción abandonada con as608_cancel (código local)
+
+/**
+ * @brief Plazos y reintentos de una instrucción (tabla en as608.c).
+ */
+typedef struct {
+    uint8_t instruccion;
+    uint16_t esperado_ms;          ///< Latencia típica del módulo
+    uint16_t limite_ms;            ///< Plazo duro de cada intento
+    uint8_t reintentos;            ///< Reintentos tras error de comunicación (o código transitorio)
+    uint16_t espera_ms;            ///< Pausa antes del primer reintento; se duplica en cada uno
+    bool reintentar_transitorios;  ///< Repetir también ante códigos transitorios (instrucciones de captura)
+} as608_politica_t;
+
+/**
+ * @brief Devuelve la política de una instrucción (o la política por defecto).
+ *
+ * @param instruccion Código de instrucción.
+ * @return const as608_politica_t* Política aplicada.
+ */
+const as608_politica_t *as608_policy(uint8_t instruccion);
+
+/**
+ * @brief Indica si un código de confirmación es transitorio: sin dedo, captura fallida, imagen
+ * desordenada o con pocos rasgos, o error de comunicación. Los demás (no encontrada, posición
+ * inválida, error de flash, ...) son definitivos y no se reintentan.
+ *
+ * @param codigo Código de confirmación.
+ * @return true si repetir la operación puede dar otro resultado.
+ */
+bool as608_is_transient(uint8_t codigo);
+
+/**
+ * @brief Abandona la instrucción en curso, que devuelve AS608_CANCELADO.
+ *
+ * Se puede llamar desde una interrupción. Si no hay ninguna instrucción en curso no tiene
+ * efecto. La respuesta tardía del módulo se descarta antes de la instrucción siguiente.
+ */
+void as608_cancel(as608_t *s);
+
+/**
+ * @brief Envía un paquete con el identificador y los datos indicados, calculando el checksum.
+ * 
+ * @param pid Identificador del paquete (AS608_PID_*).
+ * @param data Contenido del paquete (instrucción y parámetros, o datos).
+ * @param len Longitud del contenido.
+ */
+void as608_send_packet(as608_t *s, uint8_t pid, const uint8_t *data, size_t len);
+
+/**
+ * @brief Lee un paquete completo del sensor sin pausas entre bytes y verifica el checksum.
+ * 
+ * @param pid Identificador del paquete recibido.
+ * @param data Buffer donde se copia el contenido.
+ * @param max Tamaño del buffer.
+ * @param timeout_ms Tiempo máximo de espera del paquete.
+ * @return int Longitud del contenido, o -1 si hubo error.
+ */
+int as608_read_packet(as608_t *s, uint8_t *pid, uint8_t *data, size_t max, uint32_t timeout_ms);
+
+/**
+ * @brief Envía una instrucción y espera el paquete de respuesta.
+ * 
+ * El plazo y los reintentos salen de la política de la instrucción (as608_policy).
+ * 
+ * @param params Instrucción seguida de sus parámetros.
+ * @param len Longitud de params.
+ * @param resp Buffer para los datos de la respuesta después del código de confirmación (puede ser NULL).
+ * @param max Tamaño de resp.
+ * @return uint8_t Código de confirmación, AS608_ERROR_COM o AS608_CANCELADO.
+ */
+uint8_t as608_command(as608_t *s, const uint8_t *params, size_t len, uint8_t *resp, size_t max);
+
+/**
+ * @brief Envía una instrucción sin esperar la respuesta; se recoge con as608_poll.
+ *
+ * No se reintenta. Mientras esté en curso no se deben enviar instrucciones bloqueantes al mismo
+ * lector (la primera que se envíe descarta la respuesta pendiente); los demás lectores quedan
+ * libres. as608_cancel la abandona.
+ *
+ * @param params Instrucción seguida de sus parámetros.
+ * @param len Longitud de params.
+ */
+void as608_start(as608_t *s, const uint8_t *params, size_t len);
+
+/**
+ * @brief Lee sin bloquear los bytes recibidos de la instrucción iniciada con as608_start.
+ *
+ * @param resp Buffer para los datos de la respuesta después del código de confirmación (puede ser NULL).
+ * @param max Tamaño de resp.
+ * @return uint8_t AS608_EN_CURSO mientras falte la respuesta; luego el código de confirmación,
+ * AS608_ERROR_COM (plazo de la política vencido o paquete inválido) o AS608_CANCELADO.
+ */
+uint8_t as608_poll(as608_t *s, uint8_t *resp, size_t max);
+
+/**
+ * @brief Carga una plantilla de la base de datos en un buffer del sensor (LoadChar).
+ * 
+ * @param slot Buffer destino (1 o 2).
+ * @param id Posición de la plantilla.
+ * @return uint8_t Código de confirmación.
+ */
+uint8_t as608_load_model(as608_t *s, uint8_t slot, uint16_t id);
+
+/**
+ * @brief Compara las plantillas de CharBuffer1 y CharBuffer2 (Match).
+ * 
+ * @param score Puntaje de coincidencia (puede ser NULL; 0 si no coinciden).
+ * @return uint8_t Código de confirmación (AS608_OK, o AS608_NO_COINCIDE si no son del mismo dedo).
+ */
+uint8_t as608_match(as608_t *s, uint16_t *score);
+
+/**
+ * @brief Descarga al microcontrolador la plantilla de un buffer del sensor (UpChar).
+ * 
+ * @param slot Buffer origen (1 o 2).
+ * @param data Buffer destino.
+ * @param max Tamaño de data.
+ * @param len Bytes recibidos.
+ * @return uint8_t Código de confirmación.
+ */
+uint8_t as608_upload_model(as608_t *s, uint8_t slot, uint8_t *data, size_t max, size_t *len);
+
+/**
+ * @brief Envía una plantilla al buffer del sensor (DownChar).
+ * 
+ * @param slot Buffer destino (1 o 2).
+ * @param data Plantilla.
+ * @param len Longitud de la plantilla.
+ * @return uint8_t Código de confirmación.
+ */
+uint8_t as608_download_model(as608_t *s, uint8_t slot, const uint8_t *data, size_t len);
+
+/**
+ * @brief Lee una página de la tabla de índices de la base de datos (ReadConList).
+ * 
+ * @param page Página de la tabla (0 a 3, 256 posiciones cada una).
+ * @param table Bitmap de 32 bytes con las posiciones ocupadas.
+ * @return uint8_t Código de confirmación.
+ */
+uint8_t as608_read_index_table(as608_t *s, uint8_t page, uint8_t table[32]);
+
+/**
+ * @brief Parámetros del sistema del módulo (ReadSysPara).
+ */
+typedef struct {
+    uint16_t estado;       ///< Registro de estado
+    uint16_t id_sistema;   ///< Código de identificación del sistema
+    uint16_t capacidad;    ///< Posiciones de la biblioteca
+    uint16_t seguridad;    ///< Nivel de seguridad (1-5)
+    uint32_t direccion;    ///< Dirección del módulo
+    uint16_t tam_paquete;  ///< Longitud de los paquetes de datos en bytes
+    uint32_t baudios;      ///< Velocidad del UART
+} as608_sistema_t;
+
+/**
+ * @brief Contadores de las transferencias de datos (UpChar/DownChar) hechas con una longitud de paquete.
+ */
+typedef struct {
+    uint32_t bytes;        ///< Bytes de datos transferidos
+    uint32_t paquetes;     ///< Paquetes de datos
+    uint32_t transferencias;
+    uint64_t us;           ///< Tiempo total desde la instrucción hasta el último paquete
+} as608_transferencia_t;
+
+/**
+ * @brief Estado de un lector. Se accede solo a través de las funciones del driver, salvo config.
+ */
+struct as608 {
+    as608_config_t config;
+    uint64_t inicio_comando;   ///< Instante de envío de la instrucción en curso
+    uint8_t instruccion;       ///< Instrucción en curso, para su histograma de latencia
+    bool identify_soportado;
+    volatile bool en_curso;    ///< Hay una instrucción esperando respuesta
+    volatile bool cancelado;   ///< as608_cancel() pidió abandonar la instrucción en curso
+    bool encendido;            ///< Estado del corte de alimentación del sensor
+    volatile uint32_t toque_inicio; ///< Instante (time_us_32) del último flanco de la línea de toque
+    volatile bool toque_abierto;    ///< Hay un flanco sin su toque estable (latencia LAT_TOQUE)
+    uint16_t tam_paquete;      ///< Longitud de paquete configurada en el módulo
+    uint16_t busqueda_cantidad; ///< Posiciones que recorre Search
+    as608_transferencia_t transferencias[AS608_TAMANOS_PAQUETE];
+    uint32_t desbordes;        ///< Veces que se encontró desbordado el FIFO de recepción del UART
+    struct {
+        bool activa;
+        uint8_t instruccion;
+        uint8_t paquete[9 + 64 + 2];  ///< Encabezado, confirmación y datos, checksum
+        size_t n;
+        uint64_t inicio;
+        absolute_time_t limite;
+    } asincrona;               ///< Instrucción de as608_start cuya respuesta arma as608_poll
+};
+
+/**
+ * @brief Lee los parámetros del sistema (ReadSysPara, 0x0F).
+ *
+ * También actualiza la longitud de paquete que usa el driver para DownChar, así que conviene
+ * llamarla al arrancar.
+ *
+ * @param sistema Parámetros leídos (puede ser NULL).
+ * @return uint8_t Código de confirmación.
+ */
+uint8_t as608_read_sys_params(as608_t *s, as608_sistema_t *sistema);
+
+/**
+ * @brief Cambia la longitud de los paquetes de datos del módulo (SetSysPara, 0x0E, parámetro 6).
+ *
+ * El módulo guarda el valor en su flash, así que se conserva al apagarlo.
+ *
+ * @param bytes 32, 64, 128 o 256.
+ * @return uint8_t Código de confirmación (AS608_REGISTRO_INVALIDO si la longitud no es válida).
+ */
+uint8_t as608_set_packet_size(as608_t *s, uint16_t bytes);
+
+/**
+ * @brief Longitud de paquete de datos en uso.
+ */
+uint16_t as608_packet_size(const as608_t *s);
+
+/**
+ * @brief Contadores de transferencia de una longitud de paquete.
+ *
+ * @param bytes 32, 64, 128 o 256.
+ * @return const as608_transferencia_t* Contadores, o NULL si la longitud no es válida.
+ */
+const as608_transferencia_t *as608_transfer_stats(const as608_t *s, uint16_t bytes);
+
+/**
+ * @brief Cuenta de desbordamientos del FIFO de recepción del UART (bytes del sensor perdidos
+ * porque el ciclo principal no leyó a tiempo). Se revisa antes de cada instrucción y al consultarla.
+ *
+ * @return uint32_t Desbordamientos desde el arranque.
+ */
+uint32_t as608_desbordes(as608_t *s);
+
+#define AS608_IMAGEN_ANCHO 256  ///< Píxeles por fila de la imagen del sensor
+#define AS608_IMAGEN_ALTO  288  ///< Filas de la imagen del sensor
+#define AS608_IMAGEN_BYTES (AS608_IMAGEN_ANCHO * AS608_IMAGEN_ALTO / 2) ///< 4 bits por píxel en UpImage
+
+/**
+ * @brief Recibe un bloque de píxeles de UpImage ya desempaquetados (8 bits por píxel, fila por fila).
+ *
+ * @param pixeles Píxeles del bloque; el buffer se reutiliza al volver.
+ * @param n Cantidad de píxeles (dos por byte de cada paquete de datos).
+ * @param desplazamiento Índice del primer píxel del bloque en la imagen.
+ * @param ctx Contexto del llamador.
+ */
+typedef void (*as608_imagen_cb_t)(const uint8_t *pixeles, size_t n, uint32_t desplazamiento, void *ctx);
+
+/**
+ * @brief Resultado de una subida de imagen.
+ */
+typedef struct {
+    uint32_t bytes;     ///< Bytes de imagen recibidos (4 bits por píxel)
+    uint32_t paquetes;  ///< Paquetes de datos
+    uint32_t us;        ///< Desde la instrucción hasta el último paquete
+    uint16_t ram;       ///< Bytes de buffer usados: dos paquetes crudos y un bloque de píxeles
+    bool dma;           ///< false si no había canal DMA libre y se leyó por sondeo
+} as608_imagen_stats_t;
+
+/**
+ * @brief Sube la imagen del buffer del sensor (UpImage, 0x0A) por bloques.
+ *
+ * Un canal DMA copia cada paquete del UART a uno de dos buffers; mientras llega el siguiente, el
+ * paquete completo se verifica, se desempaqueta a 8 bits por píxel y se entrega a cb. La imagen
+ * nunca está entera en RAM. Requiere una captura previa (as608_get_image).
+ *
+ * @param cb Destino de cada bloque (p. ej. el enlace USB).
+ * @param ctx Contexto para cb.
+ * @param stats Bytes, tiempo y RAM usados (puede ser NULL).
+ * @return uint8_t Código de confirmación, AS608_ERROR_COM o AS608_CANCELADO.
+ */
+uint8_t as608_upload_image(as608_t *s, as608_imagen_cb_t cb, void *ctx, as608_imagen_stats_t *stats);
+
+/**
+ * @brief Verifica si el módulo soporta la identificación automática (Identify, 0x11).
+ *
+ * Se llama una vez al arrancar, sin dedo sobre el sensor: un módulo que soporta la instrucción
+ * responde "sin dedo" (o el resultado de la búsqueda) y uno que no la soporta responde
+ * AS608_ERROR_PAQUETE. Define el camino que usa as608_identify.
+ *
+ * @return true si se usará el comando único.
+ */
+bool as608_probe_identify(as608_t *s);
+
+/**
+ * @brief Captura, extrae y busca una huella en toda la base de datos.
+ *
+ * Con Identify el módulo hace las tres etapas internamente y devuelve un solo paquete; si no
+ * está soportado se usa GenImg + Img2Tz(1) + Search. El código de confirmación es el de la
+ * etapa que falló (AS608_SIN_DEDO, AS608_IMAGEN_MALA, AS608_NO_ENCONTRADA, ...).
+ *
+ * @param page_id Posición de la huella encontrada (puede ser NULL).
+ * @param score Puntaje de coincidencia (puede ser NULL).
+ * @return uint8_t Código de confirmación.
+ */
+uint8_t as608_identify(as608_t *s, uint16_t *page_id, uint16_t *score);
+
+// Salida de toque (TOUCH/WAK) del módulo: sube a nivel alto cuando hay un dedo sobre el sensor.
+// Su circuito se alimenta aparte (Touch VCC 3,3 V), así que funciona con el sensor apagado.
+#ifndef AS608_TOUCH_PIN
+#define AS608_TOUCH_PIN 20        ///< GPIO conectado a WAK (-1 si el módulo no lo tiene)
+#endif
+#define AS608_TOQUE_ESTABLE_MS 30 ///< Contacto continuo exigido antes de capturar (descarta roces)
+#define AS608_TOQUE_ESPERA_MS 10000 ///< Espera máxima del dedo en cada intento de captura
+#define AS608_RETIRO_ESPERA_MS 5000 ///< Espera máxima a que se retire el dedo
+#define AS608_SIN_TOQUE_MS 2500   ///< Pausa fija antes de capturar cuando no hay línea de toque
+
+// Corte opcional de la alimentación del sensor (transistor o load switch en VCC). Definir
+// AS608_POWER_PIN para que el sensor quede apagado en reposo y se encienda al tocarlo.
+#ifndef AS608_POWER_PIN
+#define AS608_POWER_PIN -1        ///< GPIO del corte de alimentación (-1 si no hay)
+#endif
+#ifndef AS608_POWER_ON
+#define AS608_POWER_ON 1          ///< Nivel del pin que enciende el sensor
+#endif
+#define AS608_ARRANQUE_MS 200     ///< Tiempo de arranque del sensor tras encenderlo
+
+/// Lector de la puerta: uart1 en GP8 (TX) y GP9 (RX), el cableado original de la placa
+#define AS608_CONFIG_PUERTA {uart1, 8, 9, 57600, AS608_TOUCH_PIN, AS608_POWER_PIN}
+
+/**
+ * @brief Atiende el flanco de la línea de toque.
+ *
+ * as608_init habilita la interrupción de la línea de toque (config.toque) sin registrar un
+ * callback propio: el callback GPIO de la aplicación (el del teclado) debe derivar aquí los
+ * flancos de la línea de cada lector, con la instancia dueña de esa línea.
+ *
+ * @param s Lector cuya línea de toque (config.toque) produjo el flanco.
+ * @param events Eventos del flanco (GPIO_IRQ_EDGE_*).
+ */
+void as608_touch_irq(as608_t *s, uint32_t events);
+
+/**
+ * @brief Registra en LAT_TOQUE el tiempo desde el último flanco de toque del lector, si no se
+ * registró ya. Lo llaman as608_wait_touch y anticipo al confirmar un dedo estable.
+ */
+void as608_touch_stable(as608_t *s);
+
+/**
+ * @brief Espera un dedo apoyado de forma estable sobre el sensor.
+ *
+ * El núcleo duerme hasta el flanco de la línea de toque; después exige AS608_TOQUE_ESTABLE_MS de
+ * contacto continuo y enciende el sensor si estaba apagado, de modo que la captura puede empezar
+ * al volver. Sin línea de toque equivale a la pausa fija AS608_SIN_TOQUE_MS.
+ *
+ * @param timeout_ms Espera máxima.
+ * @return true si hay un dedo apoyado (o no hay línea de toque); false si venció el plazo.
+ */
+bool as608_wait_touch(as608_t *s, uint32_t timeout_ms);
+
+/**
+ * @brief Espera a que se retire el dedo del sensor (inmediato sin línea de toque).
+ *
+ * @param timeout_ms Espera máxima.
+ * @return true si no hay dedo apoyado.
+ */
+bool as608_wait_release(as608_t *s, uint32_t timeout_ms);
+
+/**
+ * @brief Apaga el sensor hasta la próxima instrucción o el próximo toque (sin efecto si el lector
+ * no tiene corte de alimentación).
+ */
+void as608_sleep(as608_t *s);
 
 #endif // AS608_H
 
@@ -0,0 +1,211 @@
+/**
+ * @file auditoria.c
+ * @brief Bitácora de accesos de solo anexado en una región reservada de la flash.
+ *
+ * El registro con secuencia s vive siempre en la ranura (s % AUD_CAPACIDAD) de la región,
+ * por lo que ubicar cualquier evento, incluido el recorrido inverso, es O(1).
+ * Se usan dos páginas en RAM: mientras una se llena, la otra (ya completa) espera a que
+ * auditoria_servicio() la escriba fuera del camino de apertura. Al terminar cada acceso,
+ * auditoria_flush() programa además la página a medio llenar, así que un corte de energía
+ * no se lleva los intentos fallidos ni el bloqueo que lo precedieron.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "auditoria.h"
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+#define AUD_OFFSET (PICO_FLASH_SIZE_BYTES - AUDITORIA_SECTORES * FLASH_SECTOR_SIZE)
+#define AUD_REG_POR_PAGINA (FLASH_PAGE_SIZE / sizeof(auditoria_registro_t))
+#define AUD_PAGINAS_POR_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define AUD_PAGINAS (AUDITORIA_SECTORES * AUD_PAGINAS_POR_SECTOR)
+#define AUD_CAPACIDAD (AUD_PAGINAS * AUD_REG_POR_PAGINA)
+#define AUD_VACIO 0xFFFFFFFFu
+
+static_assert(sizeof(auditoria_registro_t) == 16, "El registro de auditoria debe medir 16 bytes");
+
+static const auditoria_registro_t *const flash_reg =
+    (const auditoria_registro_t *)(XIP_BASE + AUD_OFFSET);
+
+static auditoria_registro_t pagina[2][AUD_REG_POR_PAGINA]; ///< Página activa y página llena pendiente
+static uint8_t activa = 0;              ///< Índice de la página en llenado
+static uint32_t num_activa = 0;         ///< Número de página (en la región) de la página activa
+static bool llena_pendiente = false;    ///< Hay una página completa sin escribir
+static uint32_t num_llena = 0;          ///< Número de página de la página pendiente
+static int32_t sector_borrado = -1;     ///< Último sector borrado por el cabezal de escritura
+static uint32_t proxima = 0;            ///< Secuencia del próximo evento
+static uint32_t volcada = 0;            ///< Secuencia hasta la que la flash está al día
+
+/**
+ * @brief CRC-8 (polinomio 0x07) de un bloque.
+ */
+static uint8_t crc8(const uint8_t *datos, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= datos[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool registro_valido(const auditoria_registro_t *reg) {
+    return reg->secuencia != AUD_VACIO &&
+           reg->crc == crc8((const uint8_t *)reg, sizeof(*reg) - 1);
+}
+
+/**
+ * @brief Escribe una página de la RAM en la región, borrando el sector si es nuevo.
+ */
+static void programar_pagina(uint32_t num, const auditoria_registro_t *datos) {
+    int32_t sector = num / AUD_PAGINAS_POR_SECTOR;
+    uint32_t ints = save_and_disable_interrupts();
+    if (sector != sector_borrado) {
+        flash_range_erase(AUD_OFFSET + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+        sector_borrado = sector;
+    }
+    // Reprogramar bytes ya escritos con el mismo valor no altera la flash, así que una
+    // página parcial puede volver a programarse cuando se completa.
+    flash_range_program(AUD_OFFSET + num * FLASH_PAGE_SIZE, (const uint8_t *)datos, FLASH_PAGE_SIZE);
+    restore_interrupts(ints);
+}
+
+
+/**
+ * @brief Localiza el cabezal de escritura recorriendo la región reservada.
+ */
+void auditoria_init(void) {
+    uint32_t max = AUD_VACIO;
+    for (uint32_t i = 0; i < AUD_CAPACIDAD; i++) {
+        const auditoria_registro_t *reg = &flash_reg[i];
+        if (registro_valido(reg) && (max == AUD_VACIO || reg->secuencia > max)) {
+            max = reg->secuencia;
+        }
+    }
+    proxima = (max == AUD_VACIO) ? 0 : max + 1;
+    volcada = proxima;
+
+    uint32_t ranura = proxima % AUD_CAPACIDAD;
+    uint32_t pos = ranura % AUD_REG_POR_PAGINA;
+    activa = 0;
+    llena_pendiente = false;
+    num_activa = ranura / AUD_REG_POR_PAGINA;
+    memset(pagina, 0xFF, sizeof(pagina));
+    memcpy(pagina[activa], &flash_reg[ranura - pos], pos * sizeof(auditoria_registro_t));
+    // Si el cabezal no está al inicio de un sector, ese sector ya fue borrado al empezarlo
+    sector_borrado = (ranura % (AUD_PAGINAS_POR_SECTOR * AUD_REG_POR_PAGINA)) ? (int32_t)(num_activa / AUD_PAGINAS_POR_SECTOR) : -1;
+
+    printf("Auditoria: %lu eventos, proxima secuencia %lu\n",
+           (unsigned long)(proxima < AUD_CAPACIDAD ? proxima : AUD_CAPACIDAD), (unsigned long)proxima);
+}
+
+/**
+ * @brief Agrega un evento al buffer en RAM. Escribe en flash sólo si la página se llena.
+ */
+void auditoria_registrar(uint16_t usuario, auditoria_metodo_t metodo, auditoria_resultado_t resultado,
+                         uint8_t codigo, uint16_t puntaje) {
+    uint32_t pos = (proxima % AUD_CAPACIDAD) % AUD_REG_POR_PAGINA;
+    auditoria_registro_t *reg = &pagina[activa][pos];
+
+    reg->secuencia = proxima++;
+    reg->marca_ms = to_ms_since_boot(get_absolute_time());
+    reg->puntaje = puntaje;
+    reg->usuario = usuario & 0xFF;
+    reg->usuario_alto = usuario >> 8;
+    reg->metodo = metodo;
+    reg->resultado = resultado;
+    reg->codigo = codigo;
+    reg->crc = crc8((const uint8_t *)reg, sizeof(*reg) - 1);
+
+    if (pos == AUD_REG_POR_PAGINA - 1) {
+        // Sólo se bloquea aquí si la página anterior aún no se ha escrito
+        auditoria_servicio();
+        llena_pendiente = true;
+        num_llena = num_activa;
+        activa ^= 1;
+        num_activa = (num_activa + 1) % AUD_PAGINAS;
+        memset(pagina[activa], 0xFF, sizeof(pagina[activa]));
+    }
+}
+
+/**
+ * @brief Escribe en flash la página completa pendiente, si la hay.
+ */
+void auditoria_servicio(void) {
+    if (llena_pendiente) {
+        programar_pagina(num_llena, pagina[activa ^ 1]);
+        llena_pendiente = false;
+    }
+}
+
+/**
+ * @brief Escribe en flash los eventos pendientes aunque la página no esté llena.
+ */
+void auditoria_flush(void) {
+    auditoria_servicio();
+    if (proxima != volcada && (proxima % AUD_CAPACIDAD) % AUD_REG_POR_PAGINA != 0) {
+        programar_pagina(num_activa, pagina[activa]);
+    }
+    volcada = proxima;
+}
+
+/**
+ * @brief Lee el evento con la secuencia indicada desde RAM o flash.
+ */
+static bool leer(uint32_t secuencia, auditoria_registro_t *reg) {
+    uint32_t ranura = secuencia % AUD_CAPACIDAD;
+    uint32_t num = ranura / AUD_REG_POR_PAGINA;
+    uint32_t pos = ranura % AUD_REG_POR_PAGINA;
+
+    if (num == num_activa) {
+        *reg = pagina[activa][pos];
+    } else if (llena_pendiente && num == num_llena) {
+        *reg = pagina[activa ^ 1][pos];
+    } else {
+        *reg = flash_reg[ranura];
+    }
+    return registro_valido(reg) && reg->secuencia == secuencia;
+}
+
+/**
+ * @brief Inicializa un iterador en el evento más reciente.
+ */
+void auditoria_iter_init(auditoria_iter_t *it) {
+    it->siguiente = proxima - 1;
+    it->restantes = proxima < AUD_CAPACIDAD ? proxima : AUD_CAPACIDAD;
+}
+
+/**
+ * @brief Devuelve el evento anterior al último leído.
+ */
+bool auditoria_anterior(auditoria_iter_t *it, auditoria_registro_t *reg) {
+    if (it->restantes == 0) {
+        return false;
+    }
+    it->restantes--;
+    if (!leer(it->siguiente--, reg)) {
+        // Se llegó a un sector ya reciclado: no hay eventos más antiguos
+        it->restantes = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Imprime por USB los eventos más recientes.
+ */
+void auditoria_volcar(uint32_t max) {
+    auditoria_iter_t it;
+    auditoria_registro_t reg;
+
+    auditoria_iter_init(&it);
+    while (max-- && auditoria_anterior(&it, &reg)) {
+        printf("AUD %lu t=%lu usr=%u met=%u res=%u cod=%02X pts=%u\n",
+               (unsigned long)reg.secuencia, (unsigned long)reg.marca_ms, AUDITORIA_USUARIO(&reg),
+               reg.metodo, reg.resultado, reg.codigo, reg.puntaje);
+    }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file auditoria.h
+ * @brief Bitácora de accesos de solo anexado en una región reservada de la flash.
+ *
+ * Cada evento se guarda como un registro binario de 16 bytes. Los registros se acumulan
+ * en RAM y se escriben una página (256 bytes) a la vez; cuando el cabezal de escritura
+ * entra a un sector nuevo se borra ese sector, descartando los eventos más antiguos.
+ */
+
+#ifndef AUDITORIA_H
+#define AUDITORIA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifndef AUDITORIA_SECTORES
+#define AUDITORIA_SECTORES 16 ///< Sectores de 4 KiB reservados al final de la flash
+#endif
+
+/**
+ * @brief Método de acceso u operación registrada.
+ */
+typedef enum {
+    AUD_METODO_PIN = 1,     ///< Verificación de contraseña
+    AUD_METODO_HUELLA = 2,  ///< Verificación de huella
+    AUD_METODO_REGISTRO = 3,///< Registro de una huella nueva
+    AUD_METODO_BORRADO = 4, ///< Borrado de una huella
+    AUD_METODO_VACIADO = 5, ///< Vaciado de la base de datos del lector
+    AUD_METODO_GESTION = 6  ///< Apertura de una sesión de gestión por USB (gestion.h)
+} auditoria_metodo_t;
+
+/**
+ * @brief Resultado de la operación registrada.
+ */
+typedef enum {
+    AUD_RESULTADO_OK = 0,     ///< Operación exitosa / acceso concedido
+    AUD_RESULTADO_FALLO = 1,  ///< Intento fallido
+    AUD_RESULTADO_BLOQUEO = 2 ///< Se alcanzó el máximo de intentos
+} auditoria_resultado_t;
+
+/**
+ * @brief Registro binario de un evento (16 bytes, 16 registros por página de flash).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t secuencia;  ///< Número de secuencia global (0xFFFFFFFF = vacío)
+    uint32_t marca_ms;   ///< Milisegundos desde el arranque
+    uint16_t puntaje;    ///< Puntaje de coincidencia del sensor (0 si no aplica)
+    uint8_t usuario;     ///< Número de usuario, byte bajo
+    uint8_t metodo;      ///< auditoria_metodo_t
+    uint8_t resultado;   ///< auditoria_resultado_t
+    uint8_t codigo;      ///< Código de confirmación del sensor
+    uint8_t usuario_alto; ///< Byte alto del número de usuario (0xFF en registros anteriores = 0)
+    uint8_t crc;         ///< CRC-8 de los 15 bytes anteriores
+} auditoria_registro_t;
+
+/**
+ * @brief Número de usuario de un registro.
+ */
+#define AUDITORIA_USUARIO(reg) ((reg)->usuario_alto == 0xFF ? (reg)->usuario : ((reg)->usuario_alto << 8) | (reg)->usuario)
+
+/**
+ * @brief Iterador en orden inverso (del evento más reciente al más antiguo).
+ */
+typedef struct {
+    uint32_t siguiente; ///< Secuencia del próximo registro a devolver
+    uint32_t restantes; ///< Registros que quedan por recorrer
+} auditoria_iter_t;
+
+/**
+ * @brief Localiza el cabezal de escritura recorriendo la región reservada.
+ */
+void auditoria_init(void);
+
+/**
+ * @brief Agrega un evento al buffer en RAM. Escribe en flash sólo si la página se llena.
+ *
+ * @param usuario Número de usuario (0 si no aplica).
+ * @param metodo Método de acceso.
+ * @param resultado Resultado de la operación.
+ * @param codigo Código de confirmación del sensor.
+ * @param puntaje Puntaje de coincidencia del sensor.
+ */
+void auditoria_registrar(uint16_t usuario, auditoria_metodo_t metodo, auditoria_resultado_t resultado,
+                         uint8_t codigo, uint16_t puntaje);
+
+/**
+ * @brief Escribe en flash la página completa pendiente, si la hay.
+ *
+ * Debe llamarse fuera del camino de apertura (p. ej. al volver al menú).
+ */
+void auditoria_servicio(void);
+
+/**
+ * @brief Escribe en flash los eventos pendientes aunque la página no esté llena.
+ *
+ * Se llama al terminar cada acceso (también tras un PIN incorrecto o un bloqueo) y antes del
+ * reposo. Sin eventos nuevos desde la última llamada no escribe nada.
+ */
+void auditoria_flush(void);
+
+/**
+ * @brief Inicializa un iterador en el evento más reciente.
+ */
+void auditoria_iter_init(auditoria_iter_t *it);
+
+/**
+ * @brief Devuelve el evento anterior al último leído.
+ *
+ * @param it Iterador.
+ * @param reg Registro donde se copia el evento.
+ * @return true si se obtuvo un evento, false si no hay más.
+ */
+bool auditoria_anterior(auditoria_iter_t *it, auditoria_registro_t *reg);
+
+/**
+ * @brief Imprime por USB los eventos más recientes.
+ *
+ * @param max Número máximo de eventos a imprimir.
+ */
+void auditoria_volcar(uint32_t max);
+
+#endif // AUDITORIA_H
@@ -0,0 +1,57 @@
+/**
+ * @file biblioteca.c
+ * @brief Bajas en bloque en la biblioteca del lector que mantienen al día el directorio de
+ * usuarios.
+ */
+
+#include <stdio.h>
+#include "biblioteca.h"
+#include "usuarios.h"
+
+static as608_operacion_t operaciones[USUARIOS_POSICIONES]; ///< Una por posición en el peor caso
+
+/**
+ * @brief Quita a sus dueños las posiciones de las operaciones ya hechas.
+ */
+static void liberar(const as608_operacion_t *ops, uint16_t hechas) {
+    for (uint16_t k = 0; k < hechas; k++) {
+        for (uint32_t p = ops[k].posicion; p < (uint32_t)ops[k].posicion + ops[k].cantidad; p++) {
+            usuarios_liberar_posicion(p);
+        }
+    }
+}
+
+uint8_t biblioteca_borrar_usuarios(as608_t *s, uint16_t desde, uint16_t hasta, as608_lote_resultado_t *resultado) {
+    as608_lote_t lote;
+    as608_lote_resultado_t r;
+
+    as608_lote_iniciar(&lote, operaciones, USUARIOS_POSICIONES);
+    for (uint16_t i = 0; i < usuarios_cantidad(); i++) {
+        const usuario_t *u = usuarios_en(i);
+        if (u->id < desde || u->id > hasta) {
+            continue;
+        }
+        for (uint8_t d = 0; d < u->dedos; d++) {
+            as608_lote_borrar(&lote, u->posiciones[d], 1);
+        }
+    }
+    uint16_t encoladas = lote.cantidad;
+    uint8_t codigo = as608_lote_ejecutar(s, &lote, &r);
+    liberar(operaciones, r.hechas);
+    printf("Biblioteca: usuarios %u-%u, %u de %u posiciones en %u instrucciones (0x%02X)\n", desde, hasta,
+           r.hechas, encoladas, r.instrucciones, codigo);
+    if (resultado) {
+        *resultado = r;
+    }
+    return codigo;
+}
+
+uint8_t biblioteca_borrar_posiciones(as608_t *s, uint16_t desde, uint16_t cantidad) {
+    uint8_t codigo = as608_delete_range(s, desde, cantidad);
+
+    if (codigo == AS608_OK) {
+        as608_operacion_t tramo = {0x0C, desde, cantidad, NULL, 0};
+        liberar(&tramo, 1);
+    }
+    return codigo;
+}
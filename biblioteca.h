@@ -0,0 +1,38 @@
+/**
+ * @file biblioteca.h
+ * @brief Bajas en bloque en la biblioteca del lector que mantienen al día el directorio de
+ * usuarios.
+ *
+ * Las posiciones se borran con un lote del driver (as608_lote_t): las contiguas van en un solo
+ * DeletChar. Solo se liberan en el directorio las posiciones que el lector confirmó; los cambios
+ * quedan en RAM hasta usuarios_guardar.
+ */
+
+#ifndef BIBLIOTECA_H
+#define BIBLIOTECA_H
+
+#include <stdint.h>
+#include "as608.h"
+
+/**
+ * @brief Borra del lector todas las huellas de los usuarios con número entre desde y hasta.
+ *
+ * @param s Lector cuya biblioteca describe el directorio.
+ * @param desde Primer número de usuario.
+ * @param hasta Último número de usuario (igual a desde para un solo usuario).
+ * @param resultado Resumen del lote (puede ser NULL).
+ * @return uint8_t AS608_OK o el código de la primera operación que falló.
+ */
+uint8_t biblioteca_borrar_usuarios(as608_t *s, uint16_t desde, uint16_t hasta, as608_lote_resultado_t *resultado);
+
+/**
+ * @brief Borra un tramo de posiciones del lector con un solo DeletChar y las quita a sus dueños.
+ *
+ * @param s Lector cuya biblioteca describe el directorio.
+ * @param desde Primera posición.
+ * @param cantidad Posiciones a borrar.
+ * @return uint8_t Código de confirmación del sensor.
+ */
+uint8_t biblioteca_borrar_posiciones(as608_t *s, uint16_t desde, uint16_t cantidad);
+
+#endif // BIBLIOTECA_H
@@ -0,0 +1,138 @@
+/**
+ * @file calidad.c
+ * @brief Estimación de la calidad de una captura de huella en punto fijo.
+ */
+
+#include <string.h>
+#include "calidad.h"
+#include "ram.h"
+
+/// Cuadrados de -15..15 (diferencias entre niveles de 4 bits) y de 0..15 (niveles)
+static const uint8_t DATOS_EN_RAM("calidad") cuadrados[31] = {
+    225, 196, 169, 144, 121, 100, 81, 64, 49, 36, 25, 16, 9, 4, 1,
+    0, 1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121, 144, 169, 196, 225
+};
+#define CUADRADO(d) cuadrados[(d) + 15]
+
+/**
+ * @brief Raíz cuadrada entera (por bits, sin división).
+ */
+static uint32_t EN_RAM(raiz)(uint32_t v) {
+    uint32_t r = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+void calidad_iniciar(calidad_t *c) {
+    memset(c, 0, sizeof(*c));
+}
+
+/**
+ * @brief Cierra una banda de 16 filas: clasifica sus bloques y acumula los de huella.
+ */
+static void EN_RAM(cerrar_banda)(calidad_t *c, unsigned int by) {
+    for (unsigned int bx = 0; bx < CALIDAD_BLOQUES_X; bx++) {
+        // Varianza x256 de los 256 píxeles del bloque
+        uint32_t varianza = c->suma2[bx] - ((c->suma[bx] * c->suma[bx]) >> 8);
+        if (varianza >= CALIDAD_VARIANZA_HUELLA) {
+            // Momentos escalados para que (Gxx + Gyy)^2 << 8 quepa en 32 bits
+            int32_t a = c->gxx[bx] >> 6;
+            int32_t b = c->gyy[bx] >> 6;
+            int32_t g = c->gxy[bx] / 64;
+            uint32_t den = (uint32_t)((a + b) * (a + b));
+            uint32_t coherencia = 0;
+            if (den) {
+                uint32_t num = (uint32_t)((a - b) * (a - b)) + 4u * (uint32_t)(g * g);
+                coherencia = raiz(((num << 8) / den) << 8);  // x256
+            }
+            c->bloques_huella++;
+            c->suma_desviacion += raiz(varianza);
+            c->suma_coherencia += coherencia > 256 ? 256 : coherencia;
+            c->suma_bx += bx;
+            c->suma_by += by;
+        }
+        c->suma[bx] = c->suma2[bx] = c->gxx[bx] = c->gyy[bx] = 0;
+        c->gxy[bx] = 0;
+    }
+}
+
+void EN_RAM(calidad_bloque)(const uint8_t *pixeles, size_t n, uint32_t desplazamiento, void *ctx) {
+    calidad_t *c = ctx;
+    unsigned int x = desplazamiento % CALIDAD_ANCHO;
+    unsigned int y = desplazamiento / CALIDAD_ANCHO;
+
+    for (size_t i = 0; i < n && y < CALIDAD_ALTO; i++) {
+        int v = pixeles[i] >> 4;
+        int gx = x ? v - c->izquierda : 0;
+        int gy = y ? v - c->previa[x] : 0;
+        unsigned int bx = x / CALIDAD_BLOQUE;
+
+        c->suma[bx] += v;
+        c->suma2[bx] += CUADRADO(v);
+        c->gxx[bx] += CUADRADO(gx);
+        c->gyy[bx] += CUADRADO(gy);
+        c->gxy[bx] += gx * gy;
+        c->izquierda = v;
+        c->previa[x] = v;
+        if (++x == CALIDAD_ANCHO) {
+            x = 0;
+            if (y % CALIDAD_BLOQUE == CALIDAD_BLOQUE - 1) {
+                cerrar_banda(c, y / CALIDAD_BLOQUE);
+            }
+            y++;
+        }
+    }
+    c->pixeles = y * CALIDAD_ANCHO + x;
+}
+
+void calidad_resultado(const calidad_t *c, calidad_resultado_t *r) {
+    uint32_t bloques = c->bloques_huella;
+
+    memset(r, 0, sizeof(*r));
+    r->cobertura = bloques * 100 / (CALIDAD_BLOQUES_X * CALIDAD_BLOQUES_Y);
+    if (bloques == 0) {
+        r->veredicto = CALIDAD_POCO_CONTACTO;
+        return;
+    }
+    // Desviación típica x16 sobre la máxima posible (7,5 niveles) y coherencia x256
+    uint32_t contraste = (c->suma_desviacion / bloques) * 100 / 120;
+    r->contraste = contraste > 100 ? 100 : contraste;
+    r->coherencia = (c->suma_coherencia / bloques) * 100 / 256;
+    // Centroide en medios bloques respecto del centro, en % del semieje
+    int32_t cx = (int32_t)((200 * c->suma_bx + 100 * bloques) / bloques) - 100 * CALIDAD_BLOQUES_X;
+    int32_t cy = (int32_t)((200 * c->suma_by + 100 * bloques) / bloques) - 100 * CALIDAD_BLOQUES_Y;
+    r->centro_x = cx / CALIDAD_BLOQUES_X;
+    r->centro_y = cy / CALIDAD_BLOQUES_Y;
+
+    if (r->cobertura < CALIDAD_MIN_COBERTURA || r->contraste < CALIDAD_MIN_CONTRASTE) {
+        r->veredicto = CALIDAD_POCO_CONTACTO;
+    } else if (r->centro_x > CALIDAD_MAX_DESCENTRADO || r->centro_x < -CALIDAD_MAX_DESCENTRADO ||
+               r->centro_y > CALIDAD_MAX_DESCENTRADO || r->centro_y < -CALIDAD_MAX_DESCENTRADO) {
+        r->veredicto = CALIDAD_DESCENTRADA;
+    } else if (r->coherencia < CALIDAD_MIN_COHERENCIA) {
+        r->veredicto = CALIDAD_BORROSA;
+    } else {
+        r->veredicto = CALIDAD_OK;
+    }
+}
+
+const char *calidad_mensaje(calidad_veredicto_t veredicto) {
+    switch (veredicto) {
+        case CALIDAD_POCO_CONTACTO: return "Presione mas    fuerte el dedo.";
+        case CALIDAD_DESCENTRADA:   return "Centre el dedo  en el lector.";
+        case CALIDAD_BORROSA:       return "Huella borrosa. Limpie el dedo.";
+        default:                    return "Huella correcta";
+    }
+}
@@ -0,0 +1,103 @@
+/**
+ * @file calidad.h
+ * @brief Estimación de la calidad de una captura de huella en punto fijo, sobre la imagen que
+ * llega por bloques desde UpImage.
+ *
+ * La imagen se divide en bloques de 16x16 píxeles. De cada bloque se acumulan la suma y la suma
+ * de cuadrados de los píxeles (contraste) y los momentos del gradiente Gxx, Gyy y Gxy (orientación
+ * de las crestas). Un bloque con varianza suficiente tiene huella; sobre esos bloques se calculan
+ * el contraste medio, la cobertura, el centroide y la coherencia de la orientación
+ * sqrt((Gxx - Gyy)^2 + 4 Gxy^2) / (Gxx + Gyy). Solo se guarda la fila anterior y una banda de
+ * acumuladores (unos 600 bytes), así que se evalúa mientras la imagen llega.
+ */
+
+#ifndef CALIDAD_H
+#define CALIDAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define CALIDAD_ANCHO 256                            ///< Píxeles por fila (AS608_IMAGEN_ANCHO)
+#define CALIDAD_ALTO 288                             ///< Filas (AS608_IMAGEN_ALTO)
+#define CALIDAD_BLOQUE 16                            ///< Lado de un bloque en píxeles
+#define CALIDAD_BLOQUES_X (CALIDAD_ANCHO / CALIDAD_BLOQUE)
+#define CALIDAD_BLOQUES_Y (CALIDAD_ALTO / CALIDAD_BLOQUE)
+
+#define CALIDAD_VARIANZA_HUELLA 1024 ///< Varianza mínima (x256, niveles de 4 bits) de un bloque con huella
+#define CALIDAD_MIN_COBERTURA 25     ///< % mínimo de bloques con huella
+#define CALIDAD_MIN_CONTRASTE 30     ///< Contraste medio mínimo (0-100)
+#define CALIDAD_MIN_COHERENCIA 40    ///< Coherencia media mínima (0-100)
+#define CALIDAD_MAX_DESCENTRADO 35   ///< Desplazamiento máximo del centroide (% del semieje)
+
+#define CALIDAD_RECHAZADA 0xFD ///< Código local: captura descartada antes de extraer rasgos
+
+/**
+ * @brief Diagnóstico de una captura.
+ */
+typedef enum {
+    CALIDAD_OK,
+    CALIDAD_POCO_CONTACTO, ///< Poca superficie o poco contraste: presionar más fuerte
+    CALIDAD_DESCENTRADA,   ///< La huella está lejos del centro del sensor
+    CALIDAD_BORROSA        ///< Crestas sin orientación definida (dedo sucio, mojado o movido)
+} calidad_veredicto_t;
+
+/**
+ * @brief Puntajes de una captura.
+ */
+typedef struct {
+    uint8_t contraste;   ///< 0-100: desviación típica media de los bloques con huella
+    uint8_t cobertura;   ///< 0-100: porcentaje de bloques con huella
+    uint8_t coherencia;  ///< 0-100: coherencia media de la orientación de las crestas
+    int8_t centro_x;     ///< Desplazamiento horizontal del centroide, % del semiancho (+ = derecha)
+    int8_t centro_y;     ///< Desplazamiento vertical del centroide, % del semialto (+ = abajo)
+    calidad_veredicto_t veredicto;
+} calidad_resultado_t;
+
+/**
+ * @brief Estado de la evaluación en curso.
+ */
+typedef struct {
+    uint8_t previa[CALIDAD_ANCHO];  ///< Fila anterior (niveles de 4 bits)
+    uint8_t izquierda;              ///< Píxel anterior de la fila actual
+    uint32_t suma[CALIDAD_BLOQUES_X];
+    uint32_t suma2[CALIDAD_BLOQUES_X];
+    uint32_t gxx[CALIDAD_BLOQUES_X];
+    uint32_t gyy[CALIDAD_BLOQUES_X];
+    int32_t gxy[CALIDAD_BLOQUES_X];
+    uint32_t pixeles;               ///< Píxeles procesados
+    uint16_t bloques_huella;
+    uint32_t suma_desviacion;       ///< Desviación típica x16 de los bloques con huella
+    uint32_t suma_coherencia;       ///< Coherencia x256 de los bloques con huella
+    uint32_t suma_bx, suma_by;      ///< Para el centroide de los bloques con huella
+} calidad_t;
+
+/**
+ * @brief Prepara una evaluación.
+ */
+void calidad_iniciar(calidad_t *c);
+
+/**
+ * @brief Procesa un bloque de píxeles consecutivos. Tiene la firma de as608_imagen_cb_t.
+ *
+ * @param pixeles Píxeles de 8 bits (se usan los 4 bits altos).
+ * @param n Cantidad de píxeles.
+ * @param desplazamiento Índice del primer píxel en la imagen; los bloques deben llegar en orden.
+ * @param ctx calidad_t de la evaluación.
+ */
+void calidad_bloque(const uint8_t *pixeles, size_t n, uint32_t desplazamiento, void *ctx);
+
+/**
+ * @brief Calcula los puntajes y el veredicto de la imagen procesada.
+ *
+ * @param c Evaluación con la imagen completa.
+ * @param r Resultado.
+ */
+void calidad_resultado(const calidad_t *c, calidad_resultado_t *r);
+
+/**
+ * @brief Indicación para el usuario (LCD de 16x2) según el veredicto.
+ */
+const char *calidad_mensaje(calidad_veredicto_t veredicto);
+
+#endif // CALIDAD_H
@@ -7,6 +7,7 @@
 
 #include "pico/stdlib.h"
 #include "cerradura.h"
+#include "metricas.h"
 
 
 // Definir el pin GPIO donde está conectado el relé
@@ -23,6 +24,7 @@ void rele_init(){
 // Enciende el rele
 void encender_rele() {
     gpio_put(RELE_PIN, 0);  // Establecer el pin en bajo (0V)
+    metricas_contar(MET_RELE_APERTURAS);
 
 }
 
@@ -0,0 +1,190 @@
+/**
+ * @file clave.c
+ * @brief Verificación de contraseñas (PIN) almacenadas como hash SHA-256 con sal.
+ */
+
+#include <string.h>
+#include "clave.h"
+#include "pico/stdlib.h"
+#include "hardware/timer.h"
+#include "ram.h"
+
+static const uint32_t DATOS_EN_RAM("sha256") K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * @brief Procesa un bloque de 64 bytes y actualiza el estado.
+ */
+static void EN_RAM(sha256_bloque)(uint32_t estado[8], const uint8_t bloque[64]) {
+    uint32_t w[16];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)bloque[4 * i] << 24) | ((uint32_t)bloque[4 * i + 1] << 16) |
+               ((uint32_t)bloque[4 * i + 2] << 8) | (uint32_t)bloque[4 * i + 3];
+    }
+
+    uint32_t a = estado[0], b = estado[1], c = estado[2], d = estado[3];
+    uint32_t e = estado[4], f = estado[5], g = estado[6], h = estado[7];
+
+    // Se usa una ventana circular de 16 palabras en lugar de W[64] para ahorrar pila
+    for (int i = 0; i < 64; i++) {
+        if (i >= 16) {
+            uint32_t w15 = w[(i - 15) & 15];
+            uint32_t w2 = w[(i - 2) & 15];
+            uint32_t s0 = ROTR(w15, 7) ^ ROTR(w15, 18) ^ (w15 >> 3);
+            uint32_t s1 = ROTR(w2, 17) ^ ROTR(w2, 19) ^ (w2 >> 10);
+            w[i & 15] += s0 + w[(i - 7) & 15] + s1;
+        }
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i & 15];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    estado[0] += a; estado[1] += b; estado[2] += c; estado[3] += d;
+    estado[4] += e; estado[5] += f; estado[6] += g; estado[7] += h;
+}
+
+/**
+ * @brief Calcula el SHA-256 de un bloque de datos.
+ */
+void clave_sha256(const uint8_t *datos, size_t len, uint8_t salida[CLAVE_HASH_BYTES]) {
+    uint32_t estado[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    uint8_t bloque[64];
+    size_t resto = len;
+
+    while (resto >= 64) {
+        sha256_bloque(estado, datos);
+        datos += 64;
+        resto -= 64;
+    }
+
+    // Relleno: 0x80, ceros y longitud en bits (big endian) al final del último bloque
+    memset(bloque, 0, sizeof(bloque));
+    memcpy(bloque, datos, resto);
+    bloque[resto] = 0x80;
+    if (resto >= 56) {
+        sha256_bloque(estado, bloque);
+        memset(bloque, 0, sizeof(bloque));
+    }
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        bloque[63 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    sha256_bloque(estado, bloque);
+
+    for (int i = 0; i < 8; i++) {
+        salida[4 * i] = estado[i] >> 24;
+        salida[4 * i + 1] = estado[i] >> 16;
+        salida[4 * i + 2] = estado[i] >> 8;
+        salida[4 * i + 3] = estado[i];
+    }
+}
+
+/**
+ * @brief Calcula el hash iterado de un PIN con su sal.
+ */
+void clave_hash(const uint8_t *sal, const uint8_t *pin, uint8_t salida[CLAVE_HASH_BYTES]) {
+    uint8_t buf[CLAVE_HASH_BYTES + CLAVE_SAL_BYTES];
+
+    memcpy(buf, sal, CLAVE_SAL_BYTES);
+    memcpy(buf + CLAVE_SAL_BYTES, pin, CLAVE_LONGITUD);
+    clave_sha256(buf, CLAVE_SAL_BYTES + CLAVE_LONGITUD, salida);
+
+    memcpy(buf + CLAVE_HASH_BYTES, sal, CLAVE_SAL_BYTES);
+    for (int i = 1; i < CLAVE_ITERACIONES; i++) {
+        memcpy(buf, salida, CLAVE_HASH_BYTES);
+        clave_sha256(buf, sizeof(buf), salida);
+    }
+    memset(buf, 0, sizeof(buf));
+}
+
+/**
+ * @brief Crea un registro de contraseña a partir de un PIN y una sal.
+ */
+void clave_crear(clave_registro_t *reg, const uint8_t *sal, const uint8_t *pin) {
+    memcpy(reg->sal, sal, CLAVE_SAL_BYTES);
+    clave_hash(reg->sal, pin, reg->hash);
+}
+
+/**
+ * @brief Compara dos buffers en tiempo constante.
+ */
+bool clave_comparar(const uint8_t *a, const uint8_t *b, size_t len) {
+    volatile uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+/**
+ * @brief Verifica un PIN contra un registro almacenado.
+ */
+bool clave_verificar(const clave_registro_t *reg, const uint8_t *pin) {
+    uint8_t hash[CLAVE_HASH_BYTES];
+    clave_hash(reg->sal, pin, hash);
+    bool ok = clave_comparar(hash, reg->hash, CLAVE_HASH_BYTES);
+    memset(hash, 0, sizeof(hash));
+    return ok;
+}
+
+/**
+ * @brief Calcula HMAC-SHA256 con una llave de CLAVE_HASH_BYTES.
+ */
+void clave_hmac(const uint8_t *llave, const uint8_t *datos, size_t len, uint8_t salida[CLAVE_HASH_BYTES]) {
+    uint8_t buf[64 + CLAVE_HMAC_MAX_DATOS];
+
+    if (len > CLAVE_HMAC_MAX_DATOS) {
+        len = CLAVE_HMAC_MAX_DATOS;
+    }
+    // Interno: SHA256((llave ^ ipad) || datos); la llave se rellena con ceros hasta el bloque
+    memset(buf, 0x36, 64);
+    for (int i = 0; i < CLAVE_HASH_BYTES; i++) {
+        buf[i] ^= llave[i];
+    }
+    memcpy(buf + 64, datos, len);
+    clave_sha256(buf, 64 + len, salida);
+
+    // Externo: SHA256((llave ^ opad) || interno)
+    memset(buf, 0x5C, 64);
+    for (int i = 0; i < CLAVE_HASH_BYTES; i++) {
+        buf[i] ^= llave[i];
+    }
+    memcpy(buf + 64, salida, CLAVE_HASH_BYTES);
+    clave_sha256(buf, 64 + CLAVE_HASH_BYTES, salida);
+    memset(buf, 0, sizeof(buf));
+}
+
+/**
+ * @brief Mide el tiempo promedio de clave_hash.
+ */
+uint32_t clave_benchmark(uint32_t rondas) {
+    static const uint8_t sal[CLAVE_SAL_BYTES] = {0};
+    uint8_t pin[CLAVE_LONGITUD] = {1, 2, 3, 4};
+    uint8_t hash[CLAVE_HASH_BYTES];
+
+    if (rondas == 0) {
+        return 0;
+    }
+    uint64_t inicio = time_us_64();
+    for (uint32_t i = 0; i < rondas; i++) {
+        pin[0] = i % 10;
+        clave_hash(sal, pin, hash);
+    }
+    uint32_t promedio = (uint32_t)((time_us_64() - inicio) / rondas);
+    printf("clave_hash: %u iteraciones, %lu us por verificacion\n", CLAVE_ITERACIONES, (unsigned long)promedio);
+    return promedio;
+}
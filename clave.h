@@ -0,0 +1,98 @@
+/**
+ * @file clave.h
+ * @brief Verificación de contraseñas (PIN) almacenadas como hash SHA-256 con sal.
+ *
+ * Las contraseñas nunca se guardan en texto plano: cada usuario tiene un registro con
+ * una sal aleatoria y el hash iterado de (sal || PIN). La comparación del hash se hace
+ * en tiempo constante para no filtrar por temporización cuántos bytes coinciden.
+ */
+
+#ifndef CLAVE_H
+#define CLAVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define CLAVE_LONGITUD   4   ///< Número de dígitos del PIN
+#define CLAVE_SAL_BYTES  16  ///< Longitud de la sal de cada usuario
+#define CLAVE_HASH_BYTES 32  ///< Longitud del hash (SHA-256)
+
+#ifndef CLAVE_ITERACIONES
+#define CLAVE_ITERACIONES 32 ///< Rondas de SHA-256 por verificación (mantener la latencia en pocos ms)
+#endif
+
+/**
+ * @brief Registro de contraseña de un usuario: sal y hash de longitud fija.
+ */
+typedef struct {
+    uint8_t sal[CLAVE_SAL_BYTES];
+    uint8_t hash[CLAVE_HASH_BYTES];
+} clave_registro_t;
+
+/**
+ * @brief Calcula el SHA-256 de un bloque de datos.
+ *
+ * @param datos Datos de entrada.
+ * @param len Longitud de los datos.
+ * @param salida Buffer de 32 bytes donde se escribe el resumen.
+ */
+void clave_sha256(const uint8_t *datos, size_t len, uint8_t salida[CLAVE_HASH_BYTES]);
+
+/**
+ * @brief Calcula el hash iterado de un PIN con su sal.
+ *
+ * h0 = SHA256(sal || pin), h(i+1) = SHA256(h(i) || sal), CLAVE_ITERACIONES rondas en total.
+ *
+ * @param sal Sal del usuario (CLAVE_SAL_BYTES).
+ * @param pin Dígitos del PIN en el orden en que se teclean (CLAVE_LONGITUD).
+ * @param salida Buffer de 32 bytes donde se escribe el hash.
+ */
+void clave_hash(const uint8_t *sal, const uint8_t *pin, uint8_t salida[CLAVE_HASH_BYTES]);
+
+/**
+ * @brief Crea un registro de contraseña a partir de un PIN y una sal.
+ *
+ * @param reg Registro a llenar.
+ * @param sal Sal a usar (CLAVE_SAL_BYTES).
+ * @param pin Dígitos del PIN (CLAVE_LONGITUD).
+ */
+void clave_crear(clave_registro_t *reg, const uint8_t *sal, const uint8_t *pin);
+
+/**
+ * @brief Compara dos buffers en tiempo constante.
+ *
+ * @return true si son iguales.
+ */
+bool clave_comparar(const uint8_t *a, const uint8_t *b, size_t len);
+
+/**
+ * @brief Verifica un PIN contra un registro almacenado.
+ *
+ * @param reg Registro del usuario.
+ * @param pin Dígitos del PIN ingresado (CLAVE_LONGITUD).
+ * @return true si el PIN es correcto.
+ */
+bool clave_verificar(const clave_registro_t *reg, const uint8_t *pin);
+
+#define CLAVE_HMAC_MAX_DATOS 64 ///< Mensaje más largo que acepta clave_hmac
+
+/**
+ * @brief Calcula HMAC-SHA256 (RFC 2104) con una llave de CLAVE_HASH_BYTES.
+ *
+ * @param llave Llave (p. ej. el hash almacenado de un usuario).
+ * @param datos Mensaje, de hasta CLAVE_HMAC_MAX_DATOS bytes.
+ * @param len Longitud del mensaje.
+ * @param salida Buffer de 32 bytes donde se escribe el código.
+ */
+void clave_hmac(const uint8_t *llave, const uint8_t *datos, size_t len, uint8_t salida[CLAVE_HASH_BYTES]);
+
+/**
+ * @brief Mide el tiempo promedio de clave_hash.
+ *
+ * @param rondas Número de hashes a calcular.
+ * @return uint32_t Microsegundos promedio por verificación.
+ */
+uint32_t clave_benchmark(uint32_t rondas);
+
+#endif // CLAVE_H
@@ -0,0 +1,260 @@
+/**
+ * @file compactacion.c
+ * @brief Compactación de la biblioteca del lector con diario en la flash.
+ *
+ * Orden de escritura, que es lo que hace reanudable la operación:
+ *   1. diario con el plan (origen → destino) y fase COPIANDO
+ *   2. LoadChar(origen) + Store(destino) de cada movida; los destinos estaban libres
+ *   3. directorio con las posiciones nuevas (usuarios_guardar, atómico)
+ *   4. fase BORRANDO y DeletChar de cada origen
+ *   5. fase TERMINADA
+ * La fase vive en la última página del sector del diario y avanza bajando bits, sin borrarlo.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "compactacion.h"
+#include "usuarios.h"
+#include "as608.h"
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+#define COMPACTACION_MAGIA 0x31504D43u ///< "CMP1"
+#define COMPACTACION_MAX (USUARIOS_POSICIONES / 2) ///< Cada movida baja una huella a la mitad inferior
+
+#define DIARIO_OFFSET (usuarios_flash_inicio() - FLASH_SECTOR_SIZE)
+#define FASE_OFFSET (DIARIO_OFFSET + FLASH_SECTOR_SIZE - FLASH_PAGE_SIZE)
+#define FASE_COPIANDO  0xFFFFFFFFu ///< El directorio puede tener todavía las posiciones viejas
+#define FASE_BORRANDO  0xFFFF0000u ///< Directorio guardado; faltan borrar los orígenes
+#define FASE_TERMINADA 0x00000000u
+
+typedef struct {
+    uint16_t origen;
+    uint16_t destino;
+} movida_t;
+
+typedef struct {
+    uint32_t magia;
+    uint32_t suma;
+    uint16_t cantidad;
+    uint16_t reservado;
+    movida_t movidas[COMPACTACION_MAX];
+} diario_t;
+
+static union {
+    diario_t d;
+    uint8_t bytes[(sizeof(diario_t) + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1)];
+} diario;
+
+static uint8_t ocupadas[USUARIOS_PAGINAS * 32]; ///< Tabla de índices del lector, una página tras otra
+
+static const diario_t *pendiente;  ///< Diario de la flash sin terminar, o NULL
+static uint32_t pendiente_fase;    ///< Fase de la flash al leer el diario
+static bool pendiente_leido = false;
+
+static size_t bytes_diario(uint16_t cantidad) {
+    return offsetof(diario_t, movidas) + (size_t)cantidad * sizeof(movida_t);
+}
+
+static uint32_t suma_diario(const diario_t *d) {
+    const uint8_t *p = (const uint8_t *)&d->cantidad;
+    size_t n = bytes_diario(d->cantidad) - offsetof(diario_t, cantidad);
+    uint32_t suma = COMPACTACION_MAGIA;
+    for (size_t i = 0; i < n; i++) {
+        suma = (suma << 5) + suma + p[i];
+    }
+    return suma;
+}
+
+static bool ocupada(uint16_t posicion) {
+    return ocupadas[posicion >> 3] & (1 << (posicion & 7));
+}
+
+/**
+ * @brief Vuelve a leer de la flash si hay un diario pendiente. Solo hace falta tras escribir el
+ * diario o su fase: compactacion_reservada se consulta por cada posición y usa este resultado.
+ */
+static void leer_pendiente(void) {
+    const diario_t *d = (const diario_t *)(XIP_BASE + DIARIO_OFFSET);
+
+    pendiente = NULL;
+    pendiente_leido = true;
+    pendiente_fase = *(const uint32_t *)(XIP_BASE + FASE_OFFSET);
+    // La fase primero: tras cualquier compactación la magia sigue válida y la suma es lo caro
+    if (pendiente_fase != FASE_COPIANDO && pendiente_fase != FASE_BORRANDO) {
+        return;
+    }
+    if (d->magia != COMPACTACION_MAGIA || d->cantidad == 0 || d->cantidad > COMPACTACION_MAX ||
+        d->suma != suma_diario(d)) {
+        return;
+    }
+    pendiente = d;
+}
+
+/**
+ * @brief Escribe el plan en el diario; la fase queda en COPIANDO (borrada).
+ */
+static void escribir_diario(void) {
+    size_t bytes = (bytes_diario(diario.d.cantidad) + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+
+    diario.d.magia = COMPACTACION_MAGIA;
+    diario.d.suma = suma_diario(&diario.d);
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(DIARIO_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(DIARIO_OFFSET, diario.bytes, bytes);
+    restore_interrupts(ints);
+    leer_pendiente();
+}
+
+/**
+ * @brief Avanza la fase del diario (solo baja bits: no hace falta borrar el sector).
+ */
+static void marcar_fase(uint32_t fase) {
+    uint8_t pagina[FLASH_PAGE_SIZE];
+
+    memset(pagina, 0xFF, sizeof(pagina));
+    memcpy(pagina, &fase, sizeof(fase));
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_program(FASE_OFFSET, pagina, sizeof(pagina));
+    restore_interrupts(ints);
+    leer_pendiente();
+}
+
+/**
+ * @brief Arma el plan: la huella con dueño más alta va a la posición libre más baja.
+ *
+ * Una posición es destino válido solo si está vacía en el lector y sin dueño en el directorio,
+ * así ninguna copia pisa una plantilla (tampoco las huérfanas, que ASIGNAR puede reclamar).
+ */
+static uint16_t planificar(uint16_t *huerfanas) {
+    uint16_t n = 0;
+    uint16_t libre = 0;
+    uint16_t alta = USUARIOS_POSICIONES;
+
+    *huerfanas = 0;
+    for (uint16_t p = 0; p < USUARIOS_POSICIONES; p++) {
+        if (ocupada(p) && usuarios_duenio(p) == 0) {
+            (*huerfanas)++;
+        }
+    }
+    while (true) {
+        while (libre < alta && (ocupada(libre) || usuarios_duenio(libre) != 0)) {
+            libre++;
+        }
+        while (alta > libre && !(ocupada(alta - 1) && usuarios_duenio(alta - 1) != 0)) {
+            alta--;
+        }
+        if (libre >= alta) {
+            return n;
+        }
+        alta--;
+        diario.d.movidas[n].origen = alta;
+        diario.d.movidas[n].destino = libre;
+        n++;
+        libre++;
+    }
+}
+
+/**
+ * @brief Copia cada huella a su destino. Si una copia falla se borran los destinos ya escritos,
+ * para que ninguna copia sin dueño le gane una búsqueda al original, y se cierra el diario.
+ */
+static uint8_t copiar(as608_t *s) {
+    for (uint16_t k = 0; k < diario.d.cantidad; k++) {
+        const movida_t *m = &diario.d.movidas[k];
+        uint8_t codigo = as608_load_model(s, 1, m->origen);
+        if (codigo == AS608_OK) {
+            codigo = as608_store_model(s, m->destino);
+        }
+        if (codigo != AS608_OK) {
+            printf("Compactacion: copia %u -> %u fallo (0x%02X), se deshace\n", m->origen, m->destino, codigo);
+            for (uint16_t j = 0; j <= k; j++) {
+                as608_delete_model(s, diario.d.movidas[j].destino);
+            }
+            marcar_fase(FASE_TERMINADA);
+            return codigo;
+        }
+    }
+    return AS608_OK;
+}
+
+/**
+ * @brief Lleva a término el plan de diario.d desde la fase indicada.
+ */
+static uint8_t completar(as608_t *s, uint32_t fase) {
+    uint8_t codigo = AS608_OK;
+
+    if (fase == FASE_COPIANDO) {
+        // Si el directorio ya tiene las posiciones nuevas, el corte fue entre guardarlo y anotar la
+        // fase: las copias están hechas
+        if (usuarios_duenio(diario.d.movidas[0].destino) == 0) {
+            codigo = copiar(s);
+            if (codigo != AS608_OK) {
+                return codigo;
+            }
+            for (uint16_t k = 0; k < diario.d.cantidad; k++) {
+                usuarios_mover_dedo(diario.d.movidas[k].origen, diario.d.movidas[k].destino);
+            }
+            usuarios_guardar();
+        }
+        marcar_fase(FASE_BORRANDO);
+    }
+    for (uint16_t k = 0; k < diario.d.cantidad && codigo == AS608_OK; k++) {
+        codigo = as608_delete_model(s, diario.d.movidas[k].origen);
+    }
+    if (codigo == AS608_OK) {
+        marcar_fase(FASE_TERMINADA);
+    }
+    return codigo;
+}
+
+bool compactacion_reservada(uint16_t posicion) {
+    if (!pendiente_leido) {
+        leer_pendiente();
+    }
+    for (uint16_t k = 0; pendiente != NULL && k < pendiente->cantidad; k++) {
+        if (pendiente->movidas[k].origen == posicion || pendiente->movidas[k].destino == posicion) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t compactacion_reanudar(as608_t *s) {
+    leer_pendiente();
+    const diario_t *d = pendiente;
+    uint32_t fase = pendiente_fase;
+
+    if (d == NULL) {
+        return AS608_OK;
+    }
+    printf("Compactacion: se reanuda (%u movidas, fase %s)\n", d->cantidad,
+           fase == FASE_COPIANDO ? "copia" : "borrado");
+    memcpy(diario.bytes, d, bytes_diario(d->cantidad));
+    return completar(s, fase);
+}
+
+uint8_t compactacion_ejecutar(as608_t *s, compactacion_resultado_t *resultado) {
+    compactacion_resultado_t r = {0};
+
+    uint8_t codigo = compactacion_reanudar(s);
+    for (uint8_t k = 0; k < USUARIOS_PAGINAS && codigo == AS608_OK; k++) {
+        codigo = as608_read_index_table(s, k, &ocupadas[k * 32]);
+    }
+    if (codigo == AS608_OK) {
+        diario.d.cantidad = r.movidas = planificar(&r.huerfanas);
+        if (r.movidas > 0) {
+            escribir_diario();
+            codigo = completar(s, FASE_COPIANDO);
+        }
+    }
+    r.limite = usuarios_limite();
+    printf("Compactacion: 0x%02X, %u movidas, %u huerfanas, limite %u\n", codigo, r.movidas, r.huerfanas,
+           r.limite);
+    if (resultado) {
+        *resultado = r;
+    }
+    return codigo;
+}
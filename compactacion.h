@@ -0,0 +1,65 @@
+/**
+ * @file compactacion.h
+ * @brief Compactación de la biblioteca del lector: las huellas con dueño pasan a las posiciones
+ * libres más bajas, para que la búsqueda por rango (as608_set_search_count) recorra el menor
+ * tramo posible.
+ *
+ * Tras muchos registros y borrados las posiciones ocupadas quedan dispersas. Con la tabla de
+ * índices (ReadConList) se planifica mover la huella con dueño más alta a la posición libre más
+ * baja, hasta que no quede ninguna libre por debajo de una ocupada. Cada huella se copia dentro del
+ * módulo (LoadChar + Store) sin pisar posiciones ocupadas; los orígenes se borran recién después de
+ * guardar el directorio con las posiciones nuevas, que es atómico (usuarios_guardar).
+ *
+ * El plan y la fase se anotan antes en un diario, en el sector de la flash inmediatamente anterior
+ * al directorio. Si la alimentación se corta a mitad, compactacion_reanudar() termina el trabajo al
+ * arrancar: repetir una copia es inocuo porque su origen sigue intacto hasta el final.
+ */
+
+#ifndef COMPACTACION_H
+#define COMPACTACION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "as608.h"
+
+/**
+ * @brief Resumen de una compactación.
+ */
+typedef struct {
+    uint16_t movidas;    ///< Huellas que cambiaron de posición
+    uint16_t huerfanas;  ///< Posiciones ocupadas en el lector sin dueño (no se mueven)
+    uint16_t limite;     ///< usuarios_limite() al terminar
+} compactacion_resultado_t;
+
+/**
+ * @brief Compacta la biblioteca del lector y actualiza el directorio de usuarios.
+ *
+ * @param s Lector cuya biblioteca describe el directorio.
+ * @param resultado Resumen (puede ser NULL).
+ * @return uint8_t AS608_OK, o el código de la instrucción que falló. Si falla una copia se
+ * deshacen las ya hechas; si falla un borrado el diario queda pendiente y se reintenta.
+ */
+uint8_t compactacion_ejecutar(as608_t *s, compactacion_resultado_t *resultado);
+
+/**
+ * @brief Completa una compactación interrumpida por un corte de alimentación. Se llama al arrancar,
+ * después de usuarios_init.
+ *
+ * @param s Lector cuya biblioteca describe el directorio.
+ * @return uint8_t AS608_OK si no había nada pendiente o se completó; si no, el código del sensor.
+ */
+uint8_t compactacion_reanudar(as608_t *s);
+
+/**
+ * @brief Indica si una posición pertenece al diario de una compactación pendiente.
+ *
+ * Mientras el diario no llega a TERMINADA, sus orígenes (sin dueño en el directorio pero todavía
+ * por borrar) y sus destinos no se pueden asignar: el borrado o la copia pendiente pisaría la
+ * huella nueva. usuarios_posicion_libre y usuarios_agregar_dedo las saltean. El estado del
+ * diario se lee de la flash solo cuando cambia (al escribirlo, al avanzar la fase y al reanudar).
+ *
+ * @param posicion Posición del lector.
+ */
+bool compactacion_reservada(uint16_t posicion);
+
+#endif // COMPACTACION_H
@@ -0,0 +1,747 @@
+/**
+ * @file gestion.c
+ * @brief Protocolo binario de gestión sobre el enlace USB CDC (stdio).
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "gestion.h"
+#include "as608.h"
+#include "auditoria.h"
+#include "latencia.h"
+#include "perfilador.h"
+#include "metricas.h"
+#include "reloj.h"
+#include "usuarios.h"
+#include "compactacion.h"
+#include "biblioteca.h"
+#include "clave.h"
+#include "pico/stdlib.h"
+#include "pico/rand.h"
+
+#define GESTION_TIMEOUT_MS 500 ///< Una trama incompleta se descarta tras este silencio
+#define GESTION_RETO_BYTES 16
+
+typedef enum {
+    ESPERA_SOF1,
+    ESPERA_SOF2,
+    ESPERA_CMD,
+    ESPERA_LEN_L,
+    ESPERA_LEN_H,
+    ESPERA_DATOS,
+    ESPERA_CRC_L,
+    ESPERA_CRC_H
+} gestion_estado_t;
+
+static gestion_estado_t estado = ESPERA_SOF1;
+static uint8_t cmd;
+static uint16_t longitud;
+static uint16_t recibidos;
+static uint16_t crc_rx;
+static uint8_t datos[GESTION_MAX_DATOS];
+static absolute_time_t ultimo_byte;
+static as608_t *lector; ///< Lector cuya biblioteca describe el directorio
+
+static uint8_t reto[GESTION_RETO_BYTES];
+static bool reto_vigente = false;   ///< Un reto sirve para una sola prueba
+static bool sesion = false;
+static absolute_time_t sesion_vence;
+static uint32_t fallos = 0;         ///< Pruebas incorrectas seguidas
+static absolute_time_t bloqueo_hasta;
+
+/**
+ * @brief Actualiza un CRC-16/CCITT-FALSE con un byte.
+ */
+static uint16_t crc16(uint16_t crc, uint8_t byte) {
+    crc ^= (uint16_t)byte << 8;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+/**
+ * @brief Envía una trama por USB sin traducción de fin de línea.
+ */
+static void enviar_trama(uint8_t comando, const uint8_t *payload, uint16_t len) {
+    uint8_t cab[] = {comando, len & 0xFF, len >> 8};
+    uint16_t crc = 0xFFFF;
+
+    putchar_raw(GESTION_SOF1);
+    putchar_raw(GESTION_SOF2);
+    for (size_t i = 0; i < sizeof(cab); i++) {
+        crc = crc16(crc, cab[i]);
+        putchar_raw(cab[i]);
+    }
+    for (uint16_t i = 0; i < len; i++) {
+        crc = crc16(crc, payload[i]);
+        putchar_raw(payload[i]);
+    }
+    putchar_raw(crc & 0xFF);
+    putchar_raw(crc >> 8);
+    stdio_flush();
+}
+
+static_assert(15 + 20 * PERF_REGIONES <= GESTION_MAX_RESPUESTA, "La respuesta de PERFIL no cabe");
+static_assert(3 + 32 * USUARIOS_PAGINAS <= GESTION_MAX_RESPUESTA, "La respuesta de LISTAR no cabe");
+
+/**
+ * @brief Envía la respuesta al comando en curso: estado y datos. Una respuesta que no cabe es un
+ * error del firmware: se informa GESTION_ERR_RESPUESTA en lugar de truncarla.
+ */
+static void responder(uint8_t estado_cmd, const uint8_t *extra, uint16_t len) {
+    static uint8_t resp[1 + GESTION_MAX_RESPUESTA];
+
+    if (len > GESTION_MAX_RESPUESTA) {
+        printf("Gestion: respuesta de %u bytes al comando %02X, maximo %u\n", len, cmd, GESTION_MAX_RESPUESTA);
+        estado_cmd = GESTION_ERR_RESPUESTA;
+        len = 0;
+    }
+    resp[0] = estado_cmd;
+    if (len) {
+        memcpy(&resp[1], extra, len);
+    }
+    enviar_trama(cmd | GESTION_RESPUESTA, resp, len + 1);
+}
+
+static void cmd_listar(void) {
+    uint8_t extra[3 + 32 * USUARIOS_PAGINAS];
+    uint16_t n = usuarios_cantidad();
+
+    // Una trama por usuario: el directorio no cabe en una sola respuesta
+    for (uint16_t i = 0; i < n; i++) {
+        const usuario_t *u = usuarios_en(i);
+        uint8_t *p = datos;
+        *p++ = u->id & 0xFF;
+        *p++ = u->id >> 8;
+        *p++ = u->dedos;
+        for (uint8_t d = 0; d < u->dedos; d++) {
+            *p++ = u->posiciones[d] & 0xFF;
+            *p++ = u->posiciones[d] >> 8;
+        }
+        enviar_trama(GESTION_USUARIO, datos, p - datos);
+    }
+    // Todas las páginas de la tabla de índices que cubren posiciones del directorio
+    memset(extra, 0, sizeof(extra));
+    extra[0] = AS608_OK;
+    for (uint8_t k = 0; k < USUARIOS_PAGINAS && extra[0] == AS608_OK; k++) {
+        extra[0] = as608_read_index_table(lector, k, &extra[3 + 32 * k]);
+    }
+    extra[1] = n & 0xFF;
+    extra[2] = n >> 8;
+    responder(GESTION_OK, extra, sizeof(extra));
+}
+
+static void cmd_agregar(void) {
+    clave_registro_t clave;
+
+    if (longitud != 2 + CLAVE_SAL_BYTES + CLAVE_HASH_BYTES) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    memcpy(clave.sal, &datos[2], CLAVE_SAL_BYTES);
+    memcpy(clave.hash, &datos[2 + CLAVE_SAL_BYTES], CLAVE_HASH_BYTES);
+    responder(usuarios_definir(datos[0] | (datos[1] << 8), &clave) ? GESTION_OK : GESTION_ERR_PARAMETROS,
+              NULL, 0);
+}
+
+static void cmd_borrar(void) {
+    uint8_t codigo = 0;
+    uint16_t borrados = 0;
+
+    if (longitud != 3 && longitud != 5) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    uint16_t desde = datos[0] | (datos[1] << 8);
+    uint16_t hasta = longitud == 5 ? (datos[2] | (datos[3] << 8)) : desde;
+    bool huellas = datos[longitud - 1];
+    // El administrador no se borra: sin él no se podría volver a abrir una sesión
+    if (hasta < desde || (longitud == 3 && usuarios_buscar(desde) == NULL) ||
+        (desde <= GESTION_ADMIN && hasta >= GESTION_ADMIN)) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    // Las huellas de todo el tramo se borran en un solo lote; los usuarios se quitan solo si el
+    // lector las borró todas
+    if (huellas) {
+        codigo = biblioteca_borrar_usuarios(lector, desde, hasta, NULL);
+    }
+    for (uint16_t i = usuarios_cantidad(); codigo == 0 && i > 0; i--) {
+        uint16_t id = usuarios_en(i - 1)->id;
+        if (id >= desde && id <= hasta) {
+            usuarios_borrar(id);
+            borrados++;
+        }
+    }
+    uint8_t extra[] = {codigo, borrados & 0xFF, borrados >> 8};
+    responder(codigo == 0 ? GESTION_OK : GESTION_ERR_SENSOR, extra, sizeof(extra));
+}
+
+static void cmd_borrar_posiciones(void) {
+    if (longitud != 4) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    uint8_t codigo = biblioteca_borrar_posiciones(lector, datos[0] | (datos[1] << 8),
+                                                  datos[2] | (datos[3] << 8));
+    responder(codigo == 0 ? GESTION_OK : GESTION_ERR_SENSOR, &codigo, 1);
+}
+
+static void cmd_asignar(void) {
+    if (longitud != 4 || !usuarios_agregar_dedo(datos[0] | (datos[1] << 8), datos[2] | (datos[3] << 8))) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    responder(GESTION_OK, NULL, 0);
+}
+
+static void cmd_compactar(void) {
+    compactacion_resultado_t r;
+    uint8_t codigo = compactacion_ejecutar(lector, &r);
+    uint8_t extra[] = {codigo, r.movidas & 0xFF, r.movidas >> 8, r.huerfanas & 0xFF, r.huerfanas >> 8,
+                       r.limite & 0xFF, r.limite >> 8};
+
+    as608_set_search_count(lector, r.limite);
+    responder(codigo == 0 ? GESTION_OK : GESTION_ERR_SENSOR, extra, sizeof(extra));
+}
+
+static void cmd_exportar(void) {
+    uint8_t tabla[32];
+    uint16_t cantidad = 0;
+    uint8_t pagina_tabla = 0xFF;
+    uint8_t codigo = 0;
+
+    if (longitud != 4) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    uint16_t desde = datos[0] | (datos[1] << 8);
+    uint16_t hasta = datos[2] | (datos[3] << 8);
+
+    for (uint32_t id = desde; id <= hasta && codigo == 0; id++) {
+        // La tabla de índices se lee una vez por cada bloque de 256 posiciones
+        if ((id >> 8) != pagina_tabla) {
+            pagina_tabla = id >> 8;
+            codigo = as608_read_index_table(lector, pagina_tabla, tabla);
+            if (codigo != 0) {
+                break;
+            }
+        }
+        if (!(tabla[(id & 0xFF) >> 3] & (1 << (id & 7)))) {
+            continue;
+        }
+        size_t len = 0;
+        datos[0] = id & 0xFF;
+        datos[1] = id >> 8;
+        codigo = as608_load_model(lector, 1, id);
+        if (codigo == 0) {
+            codigo = as608_upload_model(lector, 1, &datos[2], GESTION_MAX_DATOS - 2, &len);
+        }
+        if (codigo == 0) {
+            enviar_trama(GESTION_PLANTILLA, datos, len + 2);
+            cantidad++;
+        }
+    }
+    uint8_t extra[] = {cantidad & 0xFF, cantidad >> 8};
+    responder(codigo == 0 ? GESTION_OK : GESTION_ERR_SENSOR, extra, sizeof(extra));
+}
+
+static void cmd_importar(void) {
+    if (longitud <= 2) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    uint16_t id = datos[0] | (datos[1] << 8);
+    uint8_t codigo = as608_download_model(lector, 1, &datos[2], longitud - 2);
+    if (codigo == 0) {
+        codigo = as608_store_model(lector, id);
+    }
+    responder(codigo == 0 ? GESTION_OK : GESTION_ERR_SENSOR, &codigo, 1);
+}
+
+static void cmd_auditoria(void) {
+    auditoria_iter_t it;
+    auditoria_registro_t reg;
+    uint16_t cantidad = 0;
+    uint16_t max = (longitud == 2) ? (datos[0] | (datos[1] << 8)) : 0xFFFF;
+
+    auditoria_iter_init(&it);
+    while (cantidad < max && auditoria_anterior(&it, &reg)) {
+        enviar_trama(GESTION_EVENTO, (const uint8_t *)&reg, sizeof(reg));
+        cantidad++;
+    }
+    uint8_t extra[] = {cantidad & 0xFF, cantidad >> 8};
+    responder(GESTION_OK, extra, sizeof(extra));
+}
+
+static uint8_t *poner32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        *p++ = (v >> (8 * i)) & 0xFF;
+    }
+    return p;
+}
+
+static void cmd_latencias(void) {
+    uint16_t cantidad = 0;
+    bool reiniciar = (longitud == 1 && datos[0]);
+
+    // Se reutiliza el buffer de recepción: 22 bytes de cabecera + 3 por cubeta caben en GESTION_MAX_DATOS
+    for (int e = 0; e < LAT_ETAPAS; e++) {
+        const latencia_histograma_t *h = latencia_histograma(e);
+        uint8_t *p = datos;
+        if (h->total == 0) {
+            continue;
+        }
+        *p++ = e;
+        p = poner32(p, h->total);
+        p = poner32(p, h->min);
+        p = poner32(p, h->max);
+        p = poner32(p, (uint32_t)h->suma);
+        p = poner32(p, (uint32_t)(h->suma >> 32));
+        for (int c = 0; c < LATENCIA_CUBETAS; c++) {
+            if (h->cubetas[c]) {
+                uint16_t n = h->cubetas[c] > 0xFFFF ? 0xFFFF : h->cubetas[c];
+                *p++ = c;
+                *p++ = n & 0xFF;
+                *p++ = n >> 8;
+            }
+        }
+        enviar_trama(GESTION_HISTOGRAMA, datos, p - datos);
+        cantidad++;
+    }
+    if (reiniciar) {
+        latencia_reiniciar();
+    }
+    uint8_t extra[] = {cantidad & 0xFF, cantidad >> 8};
+    responder(GESTION_OK, extra, sizeof(extra));
+}
+
+static void cmd_perfil(void) {
+    uint8_t accion = longitud >= 1 ? datos[0] : GESTION_PERFIL_LEER;
+    uint8_t extra[15 + 20 * PERF_REGIONES];
+    uint8_t *p = datos;
+    uint32_t muestras, perdidas;
+
+    if (accion > GESTION_PERFIL_DETENER) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    if (accion == GESTION_PERFIL_INICIAR) {
+        perfilador_reiniciar_regiones();
+    }
+    if (accion != GESTION_PERFIL_LEER) {
+        perfilador_muestrear(accion == GESTION_PERFIL_INICIAR);
+    }
+
+    // Pares {pc, lr, cuenta} de 12 bytes en el buffer de recepción, 50 por trama
+    const perfilador_muestra_t *tabla = perfilador_tabla();
+    for (int i = 0; i < PERFILADOR_ENTRADAS; i++) {
+        if (tabla[i].cuenta == 0) {
+            continue;
+        }
+        p = poner32(p, tabla[i].pc);
+        p = poner32(p, tabla[i].lr);
+        p = poner32(p, tabla[i].cuenta);
+        if (p - datos > GESTION_MAX_DATOS - 12) {
+            enviar_trama(GESTION_MUESTRAS, datos, p - datos);
+            p = datos;
+        }
+    }
+    if (p != datos) {
+        enviar_trama(GESTION_MUESTRAS, datos, p - datos);
+    }
+
+    perfilador_totales(&muestras, &perdidas);
+    p = extra;
+    *p++ = perfilador_muestreando();
+    *p++ = PERFILADOR_HZ & 0xFF;
+    *p++ = PERFILADOR_HZ >> 8;
+    p = poner32(p, reloj_khz());
+    p = poner32(p, muestras);
+    p = poner32(p, perdidas);
+    for (int r = 0; r < PERF_REGIONES; r++) {
+        const perfilador_contador_t *c = perfilador_region(r);
+        p = poner32(p, c->cuenta);
+        p = poner32(p, c->min);
+        p = poner32(p, c->max);
+        p = poner32(p, (uint32_t)c->total);
+        p = poner32(p, (uint32_t)(c->total >> 32));
+    }
+    responder(GESTION_OK, extra, p - extra);
+}
+
+static void cmd_paquete(void) {
+    uint8_t codigo = 0;
+    uint8_t tabla[32];
+
+    if (longitud != 3) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    uint16_t tam = datos[0] | (datos[1] << 8);
+    uint8_t repeticiones = datos[2];
+
+    if (tam != 0) {
+        codigo = as608_set_packet_size(lector, tam);
+    }
+    if (codigo == 0 && repeticiones > 0) {
+        // Primera posición ocupada de las 256 primeras
+        codigo = as608_read_index_table(lector, 0, tabla);
+        int id = -1;
+        for (int i = 0; i < 256 && codigo == 0 && id < 0; i++) {
+            if (tabla[i >> 3] & (1 << (i & 7))) {
+                id = i;
+            }
+        }
+        if (codigo == 0) {
+            codigo = (id < 0) ? AS608_SIN_IMAGEN : as608_load_model(lector, 1, id);
+        }
+        // La plantilla va y vuelve por el buffer de recepción (DownChar al CharBuffer2)
+        for (uint8_t r = 0; r < repeticiones && codigo == 0; r++) {
+            size_t len = 0;
+            codigo = as608_upload_model(lector, 1, datos, GESTION_MAX_DATOS, &len);
+            if (codigo == 0) {
+                codigo = as608_download_model(lector, 2, datos, len);
+            }
+        }
+    }
+    uint8_t extra[3 + 12 * AS608_TAMANOS_PAQUETE];
+    uint16_t actual = as608_packet_size(lector);
+    uint8_t *p = extra;
+    *p++ = codigo;
+    *p++ = actual & 0xFF;
+    *p++ = actual >> 8;
+    for (int i = 0; i < AS608_TAMANOS_PAQUETE; i++) {
+        const as608_transferencia_t *t = as608_transfer_stats(lector, 32u << i);
+        p = poner32(p, t->bytes);
+        p = poner32(p, t->transferencias);
+        p = poner32(p, t->us > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)t->us);
+    }
+    responder(codigo == 0 ? GESTION_OK : GESTION_ERR_SENSOR, extra, sizeof(extra));
+}
+
+/**
+ * @brief Reenvía por USB un bloque de píxeles de UpImage en cuanto se desempaqueta.
+ */
+static void enviar_pixeles(const uint8_t *pixeles, size_t n, uint32_t desplazamiento, void *ctx) {
+    (void)ctx;
+    poner32(datos, desplazamiento);
+    memcpy(&datos[4], pixeles, n);
+    enviar_trama(GESTION_PIXELES, datos, n + 4);
+}
+
+static void cmd_imagen(void) {
+    as608_imagen_stats_t stats = {0};
+
+    // La imagen es la de la captura que se hace aquí: el dedo debe estar sobre el sensor
+    uint8_t codigo = as608_get_image(lector);
+    if (codigo == 0) {
+        codigo = as608_upload_image(lector, enviar_pixeles, NULL, &stats);
+    }
+    uint8_t extra[16];
+    uint8_t *p = extra;
+    *p++ = codigo;
+    p = poner32(p, stats.bytes);
+    p = poner32(p, stats.paquetes);
+    p = poner32(p, stats.us);
+    *p++ = stats.ram & 0xFF;
+    *p++ = stats.ram >> 8;
+    *p++ = stats.dma;
+    responder(codigo == 0 ? GESTION_OK : GESTION_ERR_SENSOR, extra, p - extra);
+}
+
+static void cmd_metricas(void) {
+    bool reiniciar = (longitud == 1 && datos[0]);
+    uint16_t pares = 0;
+    uint8_t *p = datos;
+
+    // Pares {celda, valor} de 6 bytes en el buffer de recepción, 100 por trama
+    for (uint16_t i = 0; i < METRICAS_CELDAS; i++) {
+        uint32_t v = metricas_valor(i);
+        if (v == 0) {
+            continue;
+        }
+        *p++ = i & 0xFF;
+        *p++ = i >> 8;
+        p = poner32(p, v);
+        pares++;
+        if (p - datos > GESTION_MAX_DATOS - 6) {
+            enviar_trama(GESTION_CELDAS, datos, p - datos);
+            p = datos;
+        }
+    }
+    if (p != datos) {
+        enviar_trama(GESTION_CELDAS, datos, p - datos);
+    }
+
+    uint8_t extra[10];
+    p = poner32(extra, metricas_segundos());
+    *p++ = MET_CONTADORES;
+    *p++ = MET_GRUPOS;
+    *p++ = MET_CODIGOS;
+    *p++ = MET_INTENTOS;
+    *p++ = pares & 0xFF;
+    *p++ = pares >> 8;
+    if (reiniciar) {
+        metricas_reiniciar();
+    }
+    responder(GESTION_OK, extra, sizeof(extra));
+}
+
+/**
+ * @brief Plazo de bloqueo de RETO tras los fallos acumulados (0 si todavía no corresponde).
+ */
+static uint32_t plazo_bloqueo(void) {
+    if (fallos < GESTION_INTENTOS) {
+        return 0;
+    }
+    uint32_t n = fallos - GESTION_INTENTOS;
+    return GESTION_BLOQUEO_MS << (n > 6 ? 6 : n);
+}
+
+static void cmd_reto(void) {
+    const usuario_t *admin = usuarios_buscar(GESTION_ADMIN);
+    uint8_t extra[2 + CLAVE_SAL_BYTES + GESTION_RETO_BYTES];
+
+    if (!time_reached(bloqueo_hasta)) {
+        uint8_t resto[4];
+        poner32(resto, (uint32_t)(absolute_time_diff_us(get_absolute_time(), bloqueo_hasta) / 1000));
+        responder(GESTION_ERR_BLOQUEO, resto, sizeof(resto));
+        return;
+    }
+    if (admin == NULL) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    for (int i = 0; i < GESTION_RETO_BYTES; i += 8) {
+        uint64_t r = get_rand_64();
+        memcpy(&reto[i], &r, 8);
+    }
+    reto_vigente = true;
+    sesion = false; // Pedir un reto cierra la sesión anterior
+    extra[0] = GESTION_ADMIN & 0xFF;
+    extra[1] = GESTION_ADMIN >> 8;
+    memcpy(&extra[2], admin->clave.sal, CLAVE_SAL_BYTES);
+    memcpy(&extra[2 + CLAVE_SAL_BYTES], reto, GESTION_RETO_BYTES);
+    responder(GESTION_OK, extra, sizeof(extra));
+}
+
+static void cmd_sesion(void) {
+    const usuario_t *admin = usuarios_buscar(GESTION_ADMIN);
+    uint8_t esperada[CLAVE_HASH_BYTES];
+
+    if (longitud == 0) {
+        sesion = false;
+        responder(GESTION_OK, NULL, 0);
+        return;
+    }
+    if (longitud != CLAVE_HASH_BYTES || !reto_vigente || admin == NULL) {
+        responder(GESTION_ERR_PARAMETROS, NULL, 0);
+        return;
+    }
+    reto_vigente = false;
+    clave_hmac(admin->clave.hash, reto, sizeof(reto), esperada);
+    sesion = clave_comparar(esperada, datos, CLAVE_HASH_BYTES);
+    memset(esperada, 0, sizeof(esperada));
+    if (sesion) {
+        fallos = 0;
+        sesion_vence = make_timeout_time_ms(GESTION_SESION_MS);
+    } else {
+        fallos++;
+        bloqueo_hasta = make_timeout_time_ms(plazo_bloqueo());
+    }
+    auditoria_registrar(GESTION_ADMIN, AUD_METODO_GESTION,
+                        sesion ? AUD_RESULTADO_OK
+                               : (fallos >= GESTION_INTENTOS ? AUD_RESULTADO_BLOQUEO : AUD_RESULTADO_FALLO),
+                        0, 0);
+    auditoria_flush(); // El conteo de fallos debe sobrevivir a un reinicio
+    responder(sesion ? GESTION_OK : GESTION_ERR_SESION, NULL, 0);
+}
+
+/**
+ * @brief Indica si el comando recibido se acepta sin sesión (consultas que no cambian nada).
+ */
+static bool sin_sesion(void) {
+    switch (cmd) {
+        case GESTION_PING:
+        case GESTION_LISTAR:
+        case GESTION_RETO:
+        case GESTION_SESION:
+            return true;
+        case GESTION_LATENCIAS:
+        case GESTION_METRICAS:
+            return !(longitud == 1 && datos[0]);
+        case GESTION_PERFIL:
+            return longitud == 0 || datos[0] == GESTION_PERFIL_LEER;
+        case GESTION_AGREGAR:
+            // Primer aprovisionamiento: el directorio todavía no tiene administrador
+            return longitud >= 2 && (datos[0] | (datos[1] << 8)) == GESTION_ADMIN &&
+                   usuarios_buscar(GESTION_ADMIN) == NULL;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Ejecuta el comando de la trama recibida.
+ */
+static void ejecutar(void) {
+    if (sesion && time_reached(sesion_vence)) {
+        sesion = false;
+    }
+    if (!sesion && !sin_sesion()) {
+        responder(GESTION_ERR_SESION, NULL, 0);
+        return;
+    }
+    if (sesion) {
+        sesion_vence = make_timeout_time_ms(GESTION_SESION_MS);
+    }
+
+    switch (cmd) {
+        case GESTION_PING: {
+            uint8_t extra[] = {GESTION_VERSION, USUARIOS_MAX & 0xFF, USUARIOS_MAX >> 8, USUARIOS_DEDOS_MAX};
+            responder(GESTION_OK, extra, sizeof(extra));
+            break;
+        }
+        case GESTION_LISTAR:
+            cmd_listar();
+            break;
+        case GESTION_AGREGAR:
+            cmd_agregar();
+            break;
+        case GESTION_BORRAR:
+            cmd_borrar();
+            break;
+        case GESTION_EXPORTAR:
+            cmd_exportar();
+            break;
+        case GESTION_IMPORTAR:
+            cmd_importar();
+            break;
+        case GESTION_AUDITORIA:
+            cmd_auditoria();
+            break;
+        case GESTION_GUARDAR:
+            usuarios_guardar();
+            responder(GESTION_OK, NULL, 0);
+            break;
+        case GESTION_LATENCIAS:
+            cmd_latencias();
+            break;
+        case GESTION_PAQUETE:
+            cmd_paquete();
+            break;
+        case GESTION_IMAGEN:
+            cmd_imagen();
+            break;
+        case GESTION_ASIGNAR:
+            cmd_asignar();
+            break;
+        case GESTION_COMPACTAR:
+            cmd_compactar();
+            break;
+        case GESTION_BORRAR_POSICIONES:
+            cmd_borrar_posiciones();
+            break;
+        case GESTION_PERFIL:
+            cmd_perfil();
+            break;
+        case GESTION_METRICAS:
+            cmd_metricas();
+            break;
+        case GESTION_RETO:
+            cmd_reto();
+            break;
+        case GESTION_SESION:
+            cmd_sesion();
+            break;
+        default:
+            responder(GESTION_ERR_COMANDO, NULL, 0);
+            break;
+    }
+}
+
+/**
+ * @brief Fija el lector y rehace desde la bitácora el conteo de pruebas incorrectas.
+ */
+void gestion_init(as608_t *s) {
+    auditoria_iter_t it;
+    auditoria_registro_t reg;
+
+    lector = s;
+    // Los fallos seguidos desde la última sesión abierta siguen bloqueando tras un reinicio
+    fallos = 0;
+    auditoria_iter_init(&it);
+    while (auditoria_anterior(&it, &reg)) {
+        if (reg.metodo != AUD_METODO_GESTION) {
+            continue;
+        }
+        if (reg.resultado == AUD_RESULTADO_OK) {
+            break;
+        }
+        fallos++;
+    }
+    bloqueo_hasta = make_timeout_time_ms(plazo_bloqueo());
+}
+
+bool gestion_procesar(uint8_t byte) {
+    if (estado != ESPERA_SOF1 && time_reached(ultimo_byte)) {
+        estado = ESPERA_SOF1;
+    }
+    ultimo_byte = make_timeout_time_ms(GESTION_TIMEOUT_MS);
+
+    switch (estado) {
+        case ESPERA_SOF1:
+            if (byte != GESTION_SOF1) {
+                return false;
+            }
+            estado = ESPERA_SOF2;
+            break;
+        case ESPERA_SOF2:
+            estado = (byte == GESTION_SOF2) ? ESPERA_CMD : ESPERA_SOF1;
+            break;
+        case ESPERA_CMD:
+            cmd = byte;
+            crc_rx = crc16(0xFFFF, byte);
+            estado = ESPERA_LEN_L;
+            break;
+        case ESPERA_LEN_L:
+            longitud = byte;
+            crc_rx = crc16(crc_rx, byte);
+            estado = ESPERA_LEN_H;
+            break;
+        case ESPERA_LEN_H:
+            longitud |= byte << 8;
+            crc_rx = crc16(crc_rx, byte);
+            recibidos = 0;
+            if (longitud > GESTION_MAX_DATOS) {
+                estado = ESPERA_SOF1;
+            } else {
+                estado = longitud ? ESPERA_DATOS : ESPERA_CRC_L;
+            }
+            break;
+        case ESPERA_DATOS:
+            datos[recibidos++] = byte;
+            crc_rx = crc16(crc_rx, byte);
+            if (recibidos == longitud) {
+                estado = ESPERA_CRC_L;
+            }
+            break;
+        case ESPERA_CRC_L:
+            crc_rx ^= byte;
+            estado = ESPERA_CRC_H;
+            break;
+        case ESPERA_CRC_H:
+            crc_rx ^= byte << 8;
+            estado = ESPERA_SOF1;
+            if (crc_rx == 0) {
+                ejecutar();
+            } else {
+                printf("Gestion: trama con CRC invalido\n");
+            }
+            break;
+    }
+    return true;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file gestion.h
+ * @brief Protocolo binario de gestión sobre el enlace USB CDC (stdio) para el aprovisionamiento
+ * de usuarios, contraseñas y plantillas de huella en bloque.
+ *
+ * Trama: 0xA5 0x5A | comando | longitud (2 bytes, little endian) | datos | CRC-16 (little endian)
+ *
+ * El CRC es CRC-16/CCITT-FALSE sobre comando, longitud y datos. Cada comando se responde con
+ * una trama cuyo comando es (comando | 0x80) y cuyo primer byte de datos es el estado
+ * (GESTION_OK o GESTION_ERR_*). Las exportaciones envían antes de la respuesta final una trama
+ * por elemento (GESTION_PLANTILLA o GESTION_EVENTO). Los bytes fuera de una trama (p. ej. texto
+ * de printf) se ignoran en ambos extremos.
+ *
+ * | Comando            | Datos de la petición          | Datos de la respuesta                         |
+ * |--------------------|-------------------------------|-----------------------------------------------|
+ * | GESTION_PING       | -                             | estado, versión, USUARIOS_MAX (2), USUARIOS_DEDOS_MAX |
+ * | GESTION_LISTAR     | -                             | GESTION_USUARIO*, luego estado, código sensor, cantidad (2), bitmap de las posiciones (32 bytes por cada una de las USUARIOS_PAGINAS páginas) |
+ * | GESTION_AGREGAR    | id (2), sal (16), hash (32)   | estado                                        |
+ * | GESTION_BORRAR     | id (2), [hasta (2)], borrar huellas (0/1) | estado, código sensor, borrados (2) |
+ * | GESTION_EXPORTAR   | desde (2), hasta (2)          | GESTION_PLANTILLA*, luego estado, cantidad (2) |
+ * | GESTION_IMPORTAR   | id (2), plantilla             | estado, código sensor                         |
+ * | GESTION_AUDITORIA  | máximo (2)                    | GESTION_EVENTO*, luego estado, cantidad (2)   |
+ * | GESTION_GUARDAR    | -                             | estado                                        |
+ * | GESTION_LATENCIAS  | reiniciar (0/1, opcional)     | GESTION_HISTOGRAMA*, luego estado, cantidad (2) |
+ * | GESTION_PAQUETE    | longitud (2, 0 = no cambiar), repeticiones (1) | estado, código sensor, longitud (2), {bytes (4), transferencias (4), us (4)}*4 |
+ * | GESTION_IMAGEN     | -                             | GESTION_PIXELES*, luego estado, código sensor, bytes (4), paquetes (4), us (4), RAM (2), DMA (1) |
+ * | GESTION_ASIGNAR    | id (2), posición (2)          | estado                                        |
+ * | GESTION_COMPACTAR  | -                             | estado, código sensor, movidas (2), huérfanas (2), límite (2) |
+ * | GESTION_BORRAR_POSICIONES | desde (2), cantidad (2) | estado, código sensor                         |
+ * | GESTION_PERFIL     | acción (opcional, 0 = leer)   | GESTION_MUESTRAS*, luego estado, muestreando, Hz (2), kHz (4), muestras (4), perdidas (4), {cuenta (4), mín (4), máx (4), total (8)} por región |
+ * | GESTION_METRICAS   | reiniciar (0/1, opcional)     | GESTION_CELDAS*, luego estado, segundos (4), contadores, grupos, códigos, intentos, pares (2) |
+ * | GESTION_RETO       | -                             | estado, id del administrador (2), sal (16), reto (16) |
+ * | GESTION_SESION     | prueba (32), o nada para cerrar | estado                                      |
+ *
+ * Sesión: solo PING, LISTAR, RETO, SESION y la lectura de LATENCIAS, PERFIL y METRICAS (sin
+ * reiniciar ni cambiar el muestreo) se aceptan sin sesión; el resto responde GESTION_ERR_SESION.
+ * Para abrirla el PC pide un RETO aleatorio de un solo uso y envía en SESION la prueba
+ * HMAC-SHA256(hash, reto), donde hash = clave_hash(sal, PIN) del usuario GESTION_ADMIN; así el
+ * PIN no viaja por el enlace. La sesión vence tras GESTION_SESION_MS sin comandos. Cada prueba
+ * incorrecta queda en la bitácora (AUD_METODO_GESTION) y, desde la GESTION_INTENTOS-ésima
+ * seguida, RETO responde GESTION_ERR_BLOQUEO con los ms que faltan (4) durante un plazo que se
+ * duplica con cada fallo; el conteo se rehace desde la bitácora al arrancar, así que reiniciar
+ * el equipo no lo borra. Mientras el directorio no tenga administrador se acepta sin sesión un
+ * AGREGAR de GESTION_ADMIN (primer aprovisionamiento), y BORRAR nunca quita al administrador.
+ *
+ * Los números de usuario van de 1 a USUARIOS_ID_MAX. AGREGAR crea el usuario o cambia su
+ * contraseña; ASIGNAR le agrega una posición del lector ya ocupada (p. ej. tras IMPORTAR); BORRAR
+ * quita del directorio al usuario id, o a todos los usuarios entre id y hasta, y si se pide borra sus
+ * huellas del lector en un solo lote (biblioteca.h). BORRAR_POSICIONES borra un tramo de la
+ * biblioteca con un solo DeletChar y lo quita a sus dueños. COMPACTAR mueve las huellas
+ * con dueño a las posiciones más bajas (compactacion.h); límite es la cantidad de posiciones que
+ * recorre la búsqueda después.
+ *
+ * Cada trama GESTION_HISTOGRAMA lleva una etapa de latencia.h: etapa, total (4), mínimo (4),
+ * máximo (4), suma (8) y los pares {cubeta, cuenta (2, saturada)} de las cubetas no vacías,
+ * todo en little endian y en microsegundos.
+ *
+ * GESTION_PAQUETE cambia la longitud de los paquetes de datos del lector y, con repeticiones > 0,
+ * sube y vuelve a bajar esa cantidad de veces la primera plantilla de la biblioteca (UpChar y
+ * DownChar al CharBuffer2). La respuesta trae los contadores acumulados de 32, 64, 128 y 256
+ * bytes, de los que sale el rendimiento de cada longitud.
+ *
+ * GESTION_IMAGEN captura (el dedo debe estar apoyado) y sube la imagen de 256x288 del lector. Cada
+ * paquete del sensor se reenvía desempaquetado como una trama GESTION_PIXELES en cuanto llega; la
+ * respuesta informa los bytes recibidos, el tiempo y los bytes de RAM de buffer usados.
+ *
+ * GESTION_PERFIL lee el perfilador (perfilador.h) y, según la acción, empieza o detiene el
+ * muestreo. Las tramas GESTION_MUESTRAS llevan los pares {pc, lr} anotados hasta el momento; las
+ * regiones van en la respuesta, en ciclos de clk_sys y en el orden de perfilador_region_t.
+ *
+ * GESTION_METRICAS exporta el registro de metricas.h: solo las celdas distintas de cero, como
+ * pares {celda (2), valor (4)} en tramas GESTION_CELDAS. La respuesta trae los segundos desde el
+ * último reinicio (para calcular tasas) y las dimensiones de la tabla, con las que el PC ubica cada
+ * celda; con reiniciar = 1 las celdas vuelven a cero después de la lectura.
+ */
+
+#ifndef GESTION_H
+#define GESTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "as608.h"
+
+#define GESTION_SOF1 0xA5
+#define GESTION_SOF2 0x5A
+#define GESTION_VERSION 3
+#define GESTION_MAX_DATOS 600 ///< Suficiente para id + plantilla de 512 bytes
+#define GESTION_MAX_RESPUESTA 128 ///< Datos de una respuesta sin el estado (la de PERFIL es la más larga)
+
+// Comandos
+#define GESTION_PING      0x01
+#define GESTION_LISTAR    0x02
+#define GESTION_AGREGAR   0x03
+#define GESTION_BORRAR    0x04
+#define GESTION_EXPORTAR  0x05
+#define GESTION_IMPORTAR  0x06
+#define GESTION_AUDITORIA 0x07
+#define GESTION_GUARDAR   0x08
+#define GESTION_LATENCIAS 0x09
+#define GESTION_PAQUETE   0x0A
+#define GESTION_IMAGEN    0x0B
+#define GESTION_ASIGNAR   0x0C
+#define GESTION_COMPACTAR 0x0D
+#define GESTION_BORRAR_POSICIONES 0x0E
+#define GESTION_PERFIL    0x0F
+#define GESTION_PLANTILLA 0x10 ///< Trama de datos: id (2), plantilla
+#define GESTION_EVENTO    0x11 ///< Trama de datos: registro de auditoría (16)
+#define GESTION_HISTOGRAMA 0x12 ///< Trama de datos: histograma de latencia de una etapa
+#define GESTION_PIXELES   0x13 ///< Trama de datos: desplazamiento (4), píxeles de 8 bits
+#define GESTION_USUARIO   0x14 ///< Trama de datos: id (2), dedos, posiciones (2)*dedos
+#define GESTION_MUESTRAS  0x15 ///< Trama de datos: {pc (4), lr (4), cuenta (4)}* del perfilador
+#define GESTION_METRICAS  0x16 ///< Comando (los de 0x01-0x0F se agotaron)
+#define GESTION_CELDAS    0x17 ///< Trama de datos: {celda (2), valor (4)}* de metricas.h
+#define GESTION_RETO      0x18
+#define GESTION_SESION    0x19
+#define GESTION_RESPUESTA 0x80
+
+// Estados
+#define GESTION_OK             0x00
+#define GESTION_ERR_PARAMETROS 0x01
+#define GESTION_ERR_SENSOR     0x02
+#define GESTION_ERR_COMANDO    0x03
+#define GESTION_ERR_SESION     0x04 ///< El comando necesita una sesión abierta, o la prueba es incorrecta
+#define GESTION_ERR_BLOQUEO    0x05 ///< Demasiadas pruebas incorrectas; sigue ms restantes (4)
+#define GESTION_ERR_RESPUESTA  0x06 ///< La respuesta no cabe en GESTION_MAX_RESPUESTA (error del firmware)
+
+#ifndef GESTION_ADMIN
+#define GESTION_ADMIN 1 ///< Usuario cuyo PIN abre la sesión de gestión
+#endif
+#define GESTION_SESION_MS 120000 ///< Inactividad tras la que se cierra la sesión
+#define GESTION_INTENTOS 3       ///< Pruebas incorrectas seguidas antes de bloquear RETO
+#define GESTION_BLOQUEO_MS 30000 ///< Primer plazo de bloqueo; se duplica con cada fallo (hasta 64 veces)
+
+// Acciones de GESTION_PERFIL
+#define GESTION_PERFIL_LEER     0x00
+#define GESTION_PERFIL_INICIAR  0x01 ///< Vacía la tabla y las regiones y empieza a muestrear
+#define GESTION_PERFIL_DETENER  0x02
+
+/**
+ * @brief Fija el lector sobre el que operan los comandos (el de la biblioteca del directorio).
+ *
+ * Se llama después de auditoria_init y usuarios_init: el bloqueo de RETO se rehace con las
+ * pruebas incorrectas que la bitácora registra desde la última sesión abierta.
+ *
+ * @param s Lector ya inicializado.
+ */
+void gestion_init(as608_t *s);
+
+/**
+ * @brief Alimenta el analizador de tramas con un byte recibido por USB.
+ *
+ * Cuando se completa una trama válida se ejecuta el comando y se envía la respuesta.
+ *
+ * @param byte Byte recibido.
+ * @return true si el byte pertenece a una trama, false si llegó fuera de una trama.
+ */
+bool gestion_procesar(uint8_t byte);
+
+#endif // GESTION_H
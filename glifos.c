@@ -0,0 +1,158 @@
+/**
+ * @file glifos.c
+ * @brief Glifos propios del LCD con las ranuras de CGRAM manejadas como una caché LRU.
+ */
+
+#include "glifos.h"
+#include "lcd_i2c_16x2.h"
+#include "pantalla.h"
+
+// Filas de arriba abajo, 5 bits cada una
+static const uint8_t patrones[GLIFO_CANTIDAD][8] = {
+    [GLIFO_CANDADO] = {0x0E, 0x11, 0x11, 0x1F, 0x1B, 0x1B, 0x1F, 0x00},
+    [GLIFO_ABIERTO] = {0x0E, 0x10, 0x10, 0x1F, 0x1B, 0x1B, 0x1F, 0x00},
+    [GLIFO_HUELLA]  = {0x0E, 0x11, 0x15, 0x15, 0x15, 0x11, 0x0A, 0x00},
+    [GLIFO_VISTO]   = {0x00, 0x01, 0x03, 0x16, 0x1C, 0x08, 0x00, 0x00},
+    [GLIFO_CRUZ]    = {0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x00, 0x00},
+    [GLIFO_BARRA_1] = {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10},
+    [GLIFO_BARRA_2] = {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+    [GLIFO_BARRA_3] = {0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C},
+    [GLIFO_BARRA_4] = {0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E},
+};
+
+static uint8_t ranura_de[GLIFO_CANTIDAD];   ///< Ranura + 1 de cada glifo, 0 si no está cargado
+static uint8_t ocupante[GLIFOS_RANURAS];    ///< Glifo + 1 de cada ranura, 0 si está libre
+static uint32_t ultimo_uso[GLIFOS_RANURAS];
+static uint32_t reloj;                      ///< Cuenta de pedidos, para el orden LRU
+static uint8_t en_pantalla;                 ///< Ranuras dibujadas en la pantalla actual
+static uint32_t pantalla;                   ///< pantalla_borrados() al que corresponde en_pantalla
+static uint32_t aciertos, cargas;
+
+/**
+ * @brief Olvida las ranuras dibujadas si la pantalla se borró.
+ */
+static void revisar_pantalla(void) {
+    if (pantalla_borrados() != pantalla) {
+        pantalla = pantalla_borrados();
+        en_pantalla = 0;
+    }
+}
+
+/**
+ * @brief Ranura a reemplazar: una libre, o la de uso más antiguo fuera de pantalla, o la de uso
+ * más antiguo si todas están a la vista.
+ */
+static uint8_t victima(void) {
+    int elegida = -1;
+
+    for (uint8_t r = 0; r < GLIFOS_RANURAS; r++) {
+        if (!ocupante[r]) {
+            return r;
+        }
+        if (!(en_pantalla & (1u << r)) && (elegida < 0 || ultimo_uso[r] < ultimo_uso[elegida])) {
+            elegida = r;
+        }
+    }
+    if (elegida >= 0) {
+        return elegida;
+    }
+    elegida = 0;
+    for (uint8_t r = 1; r < GLIFOS_RANURAS; r++) {
+        if (ultimo_uso[r] < ultimo_uso[elegida]) {
+            elegida = r;
+        }
+    }
+    return elegida;
+}
+
+uint8_t glifos_codigo(glifo_t glifo) {
+    revisar_pantalla();
+    reloj++;
+    if (ranura_de[glifo]) {
+        uint8_t r = ranura_de[glifo] - 1;
+        ultimo_uso[r] = reloj;
+        en_pantalla |= 1u << r;
+        aciertos++;
+        return r;
+    }
+    uint8_t r = victima();
+    if (ocupante[r]) {
+        ranura_de[ocupante[r] - 1] = 0;
+    }
+    lcd_cgram(r, patrones[glifo]);
+    ocupante[r] = glifo + 1;
+    ranura_de[glifo] = r + 1;
+    ultimo_uso[r] = reloj;
+    en_pantalla |= 1u << r;
+    cargas++;
+    return r;
+}
+
+const uint8_t *glifos_patron(glifo_t glifo) {
+    return patrones[glifo];
+}
+
+void glifos_dibujar(uint8_t linea, uint8_t columna, glifo_t glifo) {
+    pantalla_glifo(linea, columna, glifo);
+}
+
+void glifos_barra_iniciar(glifos_barra_t *b, uint8_t linea, uint8_t columna, uint8_t ancho) {
+    b->linea = linea;
+    b->columna = columna;
+    b->ancho = ancho;
+    b->llenas = -1;
+}
+
+/**
+ * @brief Escribe la celda i de la barra con 'llenas' columnas de píxeles.
+ */
+static void dibujar_celda(const glifos_barra_t *b, uint8_t i, int16_t llenas) {
+    int16_t n = llenas - 5 * i;
+
+    if (n <= 0) {
+        pantalla_caracter(b->linea, b->columna + i, ' ');
+    } else if (n >= 5) {
+        pantalla_caracter(b->linea, b->columna + i, (char)GLIFO_LLENO);
+    } else {
+        glifos_dibujar(b->linea, b->columna + i, GLIFO_BARRA_1 + n - 1);
+    }
+}
+
+uint8_t glifos_barra(glifos_barra_t *b, uint32_t valor, uint32_t maximo) {
+    int16_t total = 5 * b->ancho;
+    int16_t llenas = (maximo == 0 || valor >= maximo) ? total : (int16_t)((uint64_t)valor * total / maximo);
+    uint8_t escritos = 0;
+
+    revisar_pantalla();
+    if (b->llenas < 0 || b->pantalla != pantalla) {
+        for (uint8_t i = 0; i < b->ancho; i++) {
+            dibujar_celda(b, i, llenas);
+        }
+        escritos = b->ancho;
+    } else if (llenas != b->llenas) {
+        // Solo cambian las celdas entre el borde viejo y el nuevo
+        int16_t desde = (llenas < b->llenas ? llenas : b->llenas) / 5;
+        int16_t hasta = (llenas > b->llenas ? llenas : b->llenas) / 5;
+        for (int16_t i = desde; i <= hasta && i < b->ancho; i++) {
+            int16_t antes = b->llenas - 5 * i, ahora = llenas - 5 * i;
+            antes = antes < 0 ? 0 : antes > 5 ? 5 : antes;
+            ahora = ahora < 0 ? 0 : ahora > 5 ? 5 : ahora;
+            if (antes != ahora) {
+                dibujar_celda(b, i, llenas);
+                escritos++;
+            }
+        }
+    }
+    b->llenas = llenas;
+    b->pantalla = pantalla;
+    return escritos;
+}
+
+void glifos_estadisticas(uint32_t *aciertos_, uint32_t *cargas_) {
+    if (aciertos_) {
+        *aciertos_ = aciertos;
+    }
+    if (cargas_) {
+        *cargas_ = cargas;
+    }
+}
@@ -0,0 +1,112 @@
+/**
+ * @file glifos.h
+ * @brief Glifos propios del LCD (íconos y barra de progreso) con las 8 ranuras de CGRAM manejadas
+ * como una caché LRU.
+ *
+ * El HD44780 solo tiene 8 caracteres programables y el catálogo tiene más glifos. Cada glifo se
+ * carga en CGRAM la primera vez que se dibuja y queda ahí entre pantallas; al faltar lugar se
+ * reemplaza el usado hace más tiempo, prefiriendo los que no están en la pantalla actual (cargar
+ * una ranura cambia en el acto todos los caracteres que la muestran). Así una barra de progreso
+ * animada cuesta un carácter por cuadro y cargar un glifo (9 bytes por I2C) solo ocurre al fallar
+ * la caché.
+ *
+ * El dibujo pasa por pantalla.h: la caché solo la usa el respaldo del LCD; el panel gráfico dibuja
+ * los mismos patrones directamente.
+ */
+
+#ifndef GLIFOS_H
+#define GLIFOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GLIFOS_RANURAS 8      ///< Caracteres programables del HD44780
+#define GLIFO_LLENO    0xFF   ///< Bloque lleno de la ROM del HD44780 (no ocupa CGRAM)
+
+/**
+ * @brief Glifos del catálogo.
+ */
+typedef enum {
+    GLIFO_CANDADO,   ///< Candado cerrado
+    GLIFO_ABIERTO,   ///< Candado abierto
+    GLIFO_HUELLA,
+    GLIFO_VISTO,     ///< Operación correcta
+    GLIFO_CRUZ,      ///< Operación fallida
+    GLIFO_BARRA_1,   ///< Celda de barra con 1 de 5 columnas llenas
+    GLIFO_BARRA_2,
+    GLIFO_BARRA_3,
+    GLIFO_BARRA_4,
+    GLIFO_CANTIDAD
+} glifo_t;
+
+/**
+ * @brief Barra de progreso horizontal de 5 pasos por celda.
+ */
+typedef struct {
+    uint8_t linea;
+    uint8_t columna;
+    uint8_t ancho;      ///< Celdas
+    int16_t llenas;     ///< Columnas de píxeles dibujadas, -1 si no se dibujó en esta pantalla
+    uint32_t pantalla;  ///< pantalla_borrados() del último dibujo
+} glifos_barra_t;
+
+/**
+ * @brief Código de carácter (ranura de CGRAM) de un glifo, cargándolo si no estaba. La ranura
+ * queda marcada como visible hasta el próximo borrado de pantalla.
+ *
+ * Tras una carga el contador de direcciones del LCD queda en CGRAM: hay que ubicar el cursor antes
+ * de escribir.
+ *
+ * @param glifo Glifo del catálogo.
+ * @return uint8_t Código 0 a 7 para lcd_char.
+ */
+uint8_t glifos_codigo(glifo_t glifo);
+
+/**
+ * @brief Filas del glifo de arriba abajo, 5 bits cada una (bit 4 a la izquierda).
+ *
+ * @param glifo Glifo del catálogo.
+ * @return const uint8_t* 8 filas.
+ */
+const uint8_t *glifos_patron(glifo_t glifo);
+
+/**
+ * @brief Dibuja un glifo en una posición de la pantalla actual.
+ *
+ * @param linea Línea (0 o 1).
+ * @param columna Columna (0 a 15).
+ * @param glifo Glifo del catálogo.
+ */
+void glifos_dibujar(uint8_t linea, uint8_t columna, glifo_t glifo);
+
+/**
+ * @brief Prepara una barra vacía; no dibuja nada hasta glifos_barra.
+ *
+ * @param b Barra.
+ * @param linea Línea (0 o 1).
+ * @param columna Primera celda.
+ * @param ancho Celdas (la barra tiene 5 * ancho pasos).
+ */
+void glifos_barra_iniciar(glifos_barra_t *b, uint8_t linea, uint8_t columna, uint8_t ancho);
+
+/**
+ * @brief Actualiza la barra escribiendo solo las celdas que cambiaron.
+ *
+ * Si la pantalla se borró desde el último dibujo se redibuja entera.
+ *
+ * @param b Barra.
+ * @param valor Avance.
+ * @param maximo Avance total (la barra queda llena con valor >= maximo).
+ * @return uint8_t Celdas escritas (una por cuadro mientras avanza de a un paso).
+ */
+uint8_t glifos_barra(glifos_barra_t *b, uint32_t valor, uint32_t maximo);
+
+/**
+ * @brief Aciertos y cargas de la caché desde el arranque.
+ *
+ * @param aciertos Glifos pedidos que ya estaban en CGRAM (puede ser NULL).
+ * @param cargas Glifos cargados en CGRAM (puede ser NULL).
+ */
+void glifos_estadisticas(uint32_t *aciertos, uint32_t *cargas);
+
+#endif // GLIFOS_H
@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""Genera la tabla de contraseñas con sal (tablaClaves) usada en main.c.
+
+Uso: clave_tabla.py 1234 4321 0000 ...
+
+Cada PIN recibe una sal aleatoria nueva; el hash sigue el mismo esquema que
+clave_hash() en clave.c: h0 = SHA256(sal || pin), h(i+1) = SHA256(h(i) || sal).
+"""
+
+import hashlib
+import os
+import sys
+
+ITERACIONES = 32  # Debe coincidir con CLAVE_ITERACIONES
+SAL_BYTES = 16
+
+
+def clave_hash(sal, pin):
+    h = hashlib.sha256(sal + pin).digest()
+    for _ in range(1, ITERACIONES):
+        h = hashlib.sha256(h + sal).digest()
+    return h
+
+
+def hex_c(datos):
+    return ", ".join("0x%02X" % b for b in datos)
+
+
+def main(pines):
+    for n, texto in enumerate(pines, start=1):
+        pin = bytes(int(c) for c in texto)
+        sal = os.urandom(SAL_BYTES)
+        h = clave_hash(sal, pin)
+        print("    { // User %d" % n)
+        print("        {%s}," % hex_c(sal))
+        print("        {%s}" % hex_c(h))
+        print("    },")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+    main(sys.argv[1:])
@@ -0,0 +1,432 @@
+#!/usr/bin/env python3
+"""Cliente del protocolo de gestión por USB (ver gestion.h).
+
+Ejemplos:
+  gestion.py --puerto /dev/ttyACM0 listar
+  gestion.py --puerto /dev/ttyACM0 agregar 3 2580
+  gestion.py --puerto /dev/ttyACM0 borrar 3 --huella
+  gestion.py --puerto /dev/ttyACM0 borrar 100 --hasta 150 --huella
+  gestion.py --puerto /dev/ttyACM0 borrar-posiciones 40 20
+  gestion.py --puerto /dev/ttyACM0 asignar 1042 17      (posición del lector del usuario)
+  gestion.py --puerto /dev/ttyACM0 compactar
+  gestion.py --puerto /dev/ttyACM0 exportar respaldo/ --desde 0 --hasta 299
+  gestion.py --puerto /dev/ttyACM0 importar respaldo/
+  gestion.py --puerto /dev/ttyACM0 lote usuarios.csv     (líneas "id,pin")
+  gestion.py --puerto /dev/ttyACM0 auditoria --max 50
+  gestion.py --puerto /dev/ttyACM0 latencias --csv latencias.csv --reiniciar
+  gestion.py --puerto /dev/ttyACM0 paquete --barrido --repeticiones 5
+  gestion.py --puerto /dev/ttyACM0 imagen huella.pgm     (con el dedo sobre el lector)
+  gestion.py --puerto /dev/ttyACM0 perfil --iniciar
+  gestion.py --puerto /dev/ttyACM0 perfil --elf build/as608_fingerprint.elf --plegado perfil.txt
+  gestion.py --puerto /dev/ttyACM0 metricas --jsonl metricas.jsonl --reiniciar
+
+Los cambios de usuarios quedan en RAM del dispositivo hasta que se envía
+GUARDAR; agregar/borrar/asignar/lote lo hacen al final de la operación.
+
+Todo lo que no sea listar o leer latencias, perfil o métricas necesita una
+sesión: se abre sola con el PIN del administrador (usuario 1), que se pide por
+teclado o se pasa con --admin-pin. El PIN no viaja; se responde al reto del
+equipo con HMAC-SHA256(clave_hash(sal, PIN), reto).
+"""
+
+import argparse
+import getpass
+import hashlib
+import hmac
+import json
+import math
+import os
+import struct
+import sys
+import time
+
+import serial  # pyserial
+
+import protocolo as p
+from clave_tabla import SAL_BYTES, clave_hash
+from simbolos import Simbolos
+
+
+class Cliente:
+    def __init__(self, puerto, admin_pin=None, timeout=10.0):
+        self.ser = serial.Serial(puerto, 115200, timeout=0.05)
+        self.timeout = timeout
+        self.dec = p.Decodificador()
+        self.pendientes = []
+        self.admin_pin = admin_pin
+
+    def _trama(self):
+        limite = time.monotonic() + self.timeout
+        while not self.pendientes:
+            if time.monotonic() > limite:
+                raise TimeoutError("sin respuesta del dispositivo")
+            self.pendientes += self.dec.alimentar(self.ser.read(4096))
+        return self.pendientes.pop(0)
+
+    def pedir(self, cmd, datos=b"", datos_cb=None, reintentar=True):
+        """Envía un comando; las tramas de datos se pasan a datos_cb. Devuelve la respuesta."""
+        self.ser.write(p.codificar(cmd, datos))
+        while True:
+            c, cuerpo = self._trama()
+            if c == cmd | p.RESPUESTA:
+                # Sin sesión (o vencida): se abre y se repite el comando una vez
+                if cuerpo[0] == p.ERR_SESION and cmd not in (p.RETO, p.SESION) and reintentar:
+                    self.abrir_sesion()
+                    return self.pedir(cmd, datos, datos_cb, reintentar=False)
+                if cuerpo[0] != p.OK:
+                    raise RuntimeError("comando %02X: estado %02X %s" % (cmd, cuerpo[0], cuerpo[1:].hex()))
+                return cuerpo[1:]
+            if datos_cb:
+                datos_cb(c, cuerpo)
+
+    def abrir_sesion(self):
+        """Responde al reto del equipo con el PIN del administrador."""
+        try:
+            r = self.pedir(p.RETO)
+        except RuntimeError as e:
+            raise RuntimeError("no se pudo pedir el reto (%s): estado 05 = bloqueado tras %d PIN "
+                               "incorrectos, 01 = el directorio no tiene administrador" % (e, p.SESION_INTENTOS))
+        admin, sal, reto = struct.unpack_from("<H", r)[0], r[2:2 + SAL_BYTES], r[2 + SAL_BYTES:]
+        if self.admin_pin is None:
+            self.admin_pin = getpass.getpass("PIN del administrador (usuario %d): " % admin)
+        llave = clave_hash(sal, bytes(int(c) for c in self.admin_pin))
+        self.pedir(p.SESION, hmac.new(llave, reto, hashlib.sha256).digest())
+
+    def agregar(self, usuario, pin):
+        sal = os.urandom(SAL_BYTES)
+        digitos = bytes(int(c) for c in pin)
+        self.pedir(p.AGREGAR, struct.pack("<H", usuario) + sal + clave_hash(sal, digitos))
+
+
+def cmd_listar(cli, args):
+    def mostrar(cmd, cuerpo):
+        if cmd == p.USUARIO:
+            usuario, dedos = struct.unpack_from("<HB", cuerpo)
+            posiciones = struct.unpack_from("<%dH" % dedos, cuerpo, 3)
+            print("usuario %d: huellas %s" % (usuario, ", ".join(map(str, posiciones)) or "-"))
+
+    r = cli.pedir(p.LISTAR, datos_cb=mostrar)
+    codigo, n = r[0], struct.unpack_from("<H", r, 1)[0]
+    print("%d usuarios" % n)
+    mapa = r[3:]
+    if not mapa or len(mapa) % 32:
+        raise RuntimeError("respuesta de LISTAR con un bitmap de %d bytes (se esperan paginas de 32)" % len(mapa))
+    if codigo != 0:
+        print("sensor: codigo %02X al leer la tabla de indices" % codigo)
+    ocupadas = [i for i in range(len(mapa) * 8) if mapa[i >> 3] & (1 << (i & 7))]
+    print("plantillas: %s" % (", ".join(map(str, ocupadas)) or "ninguna"))
+
+
+def cmd_agregar(cli, args):
+    cli.agregar(args.usuario, args.pin)
+    cli.pedir(p.GUARDAR)
+
+
+def cmd_borrar(cli, args):
+    huella = 1 if args.huella else 0
+    if args.hasta is None:
+        datos = struct.pack("<HB", args.usuario, huella)
+    else:
+        datos = struct.pack("<HHB", args.usuario, args.hasta, huella)
+    r = cli.pedir(p.BORRAR, datos)
+    print("%d usuarios borrados" % struct.unpack_from("<H", r, 1)[0])
+    cli.pedir(p.GUARDAR)
+
+
+def cmd_borrar_posiciones(cli, args):
+    cli.pedir(p.BORRAR_POSICIONES, struct.pack("<HH", args.desde, args.cantidad))
+    cli.pedir(p.GUARDAR)
+
+
+def cmd_asignar(cli, args):
+    cli.pedir(p.ASIGNAR, struct.pack("<HH", args.usuario, args.posicion))
+    cli.pedir(p.GUARDAR)
+
+
+def cmd_compactar(cli, args):
+    codigo, movidas, huerfanas, limite = struct.unpack("<BHHH", cli.pedir(p.COMPACTAR))
+    print("%d huellas movidas, %d plantillas sin dueño; la búsqueda recorre %d posiciones" % (
+        movidas, huerfanas, limite))
+
+
+def cmd_lote(cli, args):
+    with open(args.archivo) as f:
+        for linea in f:
+            linea = linea.strip()
+            if not linea or linea.startswith("#"):
+                continue
+            usuario, pin = linea.split(",")
+            cli.agregar(int(usuario), pin.strip())
+            print("usuario %s agregado" % usuario)
+    cli.pedir(p.GUARDAR)
+
+
+def cmd_exportar(cli, args):
+    os.makedirs(args.directorio, exist_ok=True)
+
+    def guardar(cmd, cuerpo):
+        if cmd == p.PLANTILLA:
+            (i,) = struct.unpack_from("<H", cuerpo)
+            with open(os.path.join(args.directorio, "%04d.tpl" % i), "wb") as f:
+                f.write(cuerpo[2:])
+
+    r = cli.pedir(p.EXPORTAR, struct.pack("<HH", args.desde, args.hasta), guardar)
+    print("%d plantillas exportadas" % struct.unpack("<H", r)[0])
+
+
+def cmd_importar(cli, args):
+    n = 0
+    for nombre in sorted(os.listdir(args.directorio)):
+        if not nombre.endswith(".tpl"):
+            continue
+        with open(os.path.join(args.directorio, nombre), "rb") as f:
+            datos = f.read()
+        cli.pedir(p.IMPORTAR, struct.pack("<H", int(nombre[:-4])) + datos)
+        n += 1
+    print("%d plantillas importadas" % n)
+
+
+def cmd_auditoria(cli, args):
+    def mostrar(cmd, cuerpo):
+        if cmd == p.EVENTO:
+            seq, ms, pts, usr, met, res, cod, alto, _ = struct.unpack(p.EVENTO_FMT, cuerpo)
+            print("%6d %10.3fs usuario=%d %-8s %-7s codigo=%02X puntaje=%d" % (
+                seq, ms / 1000.0, p.evento_usuario(usr, alto), p.METODOS.get(met, met), p.RESULTADOS.get(res, res), cod, pts))
+
+    cli.pedir(p.AUDITORIA, struct.pack("<H", args.max), mostrar)
+
+
+def percentil(cubetas, total, fraccion):
+    """Límite inferior de la cubeta que contiene el percentil (como latencia_percentil)."""
+    objetivo = max(1, math.ceil(total * fraccion))
+    acumulado = 0
+    for c, n in cubetas:
+        acumulado += n
+        if acumulado >= objetivo:
+            return p.cubeta_valor(c)
+    return p.cubeta_valor(cubetas[-1][0]) if cubetas else 0
+
+
+def cmd_latencias(cli, args):
+    filas = []
+
+    def mostrar(cmd, cuerpo):
+        if cmd != p.HISTOGRAMA:
+            return
+        cab = struct.calcsize(p.HISTOGRAMA_FMT)
+        etapa, total, minimo, maximo, suma = struct.unpack(p.HISTOGRAMA_FMT, cuerpo[:cab])
+        cubetas = [struct.unpack("<BH", cuerpo[i:i + 3]) for i in range(cab, len(cuerpo), 3)]
+        nombre = p.ETAPAS[etapa] if etapa < len(p.ETAPAS) else str(etapa)
+        pct = [max(minimo, percentil(cubetas, total, f)) for f in (0.5, 0.9, 0.99)]
+        print("%-12s n=%-6d min=%9.3f p50=%9.3f p90=%9.3f p99=%9.3f max=%9.3f media=%9.3f ms" % (
+            nombre, total, minimo / 1000.0, pct[0] / 1000.0, pct[1] / 1000.0, pct[2] / 1000.0,
+            maximo / 1000.0, suma / total / 1000.0))
+        filas.extend((nombre, p.cubeta_valor(c), n) for c, n in cubetas)
+
+    cli.pedir(p.LATENCIAS, bytes([1 if args.reiniciar else 0]), mostrar)
+    if args.csv:
+        with open(args.csv, "w") as f:
+            f.write("etapa,desde_us,cuenta\n")
+            for fila in filas:
+                f.write("%s,%d,%d\n" % fila)
+
+
+def cmd_paquete(cli, args):
+    def pedir(tam, repeticiones):
+        r = struct.unpack(p.PAQUETE_FMT, cli.pedir(p.PAQUETE, struct.pack("<HB", tam, repeticiones)))
+        return r[1], r[2:]
+
+    # Los contadores del dispositivo son acumulados: se informa la diferencia con los iniciales
+    original, antes = pedir(0, 0)
+    for tam in (p.TAMANOS_PAQUETE if args.barrido else [args.tam or 0]):
+        actual, despues = pedir(tam, args.repeticiones)
+    if args.barrido:
+        actual, _ = pedir(original, 0)
+    print("longitud actual: %d bytes" % actual)
+    for i, tam in enumerate(p.TAMANOS_PAQUETE):
+        octetos, transferencias, us = (despues[3 * i + k] - antes[3 * i + k] for k in range(3))
+        if transferencias:
+            print("%3d bytes: %4d transferencias, %7d bytes en %9.3f ms -> %6.0f B/s" % (
+                tam, transferencias, octetos, us / 1000.0, octetos * 1e6 / us))
+
+
+def cmd_imagen(cli, args):
+    pixeles = bytearray(p.IMAGEN_ANCHO * p.IMAGEN_ALTO)
+
+    def guardar(cmd, cuerpo):
+        if cmd == p.PIXELES:
+            desde = struct.unpack("<I", cuerpo[:4])[0]
+            pixeles[desde:desde + len(cuerpo) - 4] = cuerpo[4:]
+
+    r = cli.pedir(p.IMAGEN, b"", guardar)
+    _, octetos, paquetes, us, ram, dma = struct.unpack(p.IMAGEN_FMT, r)
+    with open(args.archivo, "wb") as f:
+        f.write(b"P5 %d %d 255\n" % (p.IMAGEN_ANCHO, p.IMAGEN_ALTO))
+        f.write(pixeles)
+    print("%d bytes en %d paquetes, %.3f s -> %.0f B/s; buffers %d bytes (%s)" % (
+        octetos, paquetes, us / 1e6, octetos * 1e6 / us, ram, "DMA" if dma else "sondeo"))
+
+
+def cmd_perfil(cli, args):
+    pares = []
+
+    def guardar(cmd, cuerpo):
+        if cmd == p.MUESTRAS:
+            pares.extend(struct.iter_unpack(p.MUESTRA_FMT, cuerpo))
+
+    accion = p.PERFIL_INICIAR if args.iniciar else p.PERFIL_DETENER if args.detener else p.PERFIL_LEER
+    r = cli.pedir(p.PERFIL, bytes([accion]), guardar)
+    activo, hz, khz, muestras, perdidas = struct.unpack_from(p.PERFIL_FMT, r)
+    desp = struct.calcsize(p.PERFIL_FMT)
+    print("clk_sys %d kHz; muestreo %s a %d Hz: %d muestras, %d perdidas" % (
+        khz, "activo" if activo else "detenido", hz, muestras, perdidas))
+    for nombre in p.REGIONES:
+        if desp + struct.calcsize(p.REGION_FMT) > len(r):
+            raise RuntimeError("respuesta de PERFIL de %d bytes: falta la region %s" % (len(r), nombre))
+        cuenta, minimo, maximo, total = struct.unpack_from(p.REGION_FMT, r, desp)
+        desp += struct.calcsize(p.REGION_FMT)
+        if cuenta:
+            print("%-9s n=%-6d min=%10d media=%10d max=%10d ciclos" % (nombre, cuenta, minimo, total // cuenta,
+                                                                      maximo))
+
+    # Muestras por función (PC) y pilas de dos niveles llamador;función para un flame graph; el LR
+    # de una función que ya llamó a otra apunta dentro de ella misma, y el de una excepción es EXC_RETURN
+    sim = Simbolos(args.elf, args.nm) if args.elf else None
+    nombre = sim.nombre if sim else (lambda d: "0x%08x" % d)
+    funciones = {}
+    plegadas = {}
+    for pc, lr, cuenta in pares:
+        f = nombre(pc)
+        llamador = nombre(lr) if lr < 0xFFFFFFF0 else None
+        pila = f if llamador in (None, f) else llamador + ";" + f
+        funciones[f] = funciones.get(f, 0) + cuenta
+        plegadas[pila] = plegadas.get(pila, 0) + cuenta
+    total = sum(funciones.values())
+    for f, cuenta in sorted(funciones.items(), key=lambda x: -x[1])[:args.max]:
+        print("%6.2f%% %7d  %s" % (100.0 * cuenta / total, cuenta, f))
+    if args.plegado:
+        with open(args.plegado, "w") as arch:
+            for pila, cuenta in sorted(plegadas.items()):
+                arch.write("%s %d\n" % (pila, cuenta))
+
+
+def cmd_metricas(cli, args):
+    celdas = {}
+
+    def guardar(cmd, cuerpo):
+        if cmd == p.CELDAS:
+            celdas.update(struct.iter_unpack(p.CELDA_FMT, cuerpo))
+
+    r = cli.pedir(p.METRICAS, bytes([1 if args.reiniciar else 0]), guardar)
+    segundos, contadores, grupos, codigos, intentos, pares = struct.unpack(p.METRICAS_FMT, r)
+    if pares != len(celdas):
+        print("aviso: %d pares anunciados, %d recibidos" % (pares, len(celdas)), file=sys.stderr)
+    horas = max(segundos, 1) / 3600.0
+    print("%d s desde el último reinicio" % segundos)
+
+    instantanea = {"hora": time.time(), "segundos": segundos, "contadores": {}, "codigos": {}, "intentos": {}}
+    for i in range(contadores):
+        v = celdas.get(i, 0)
+        nombre = p.CONTADORES[i] if i < len(p.CONTADORES) else "contador %d" % i
+        instantanea["contadores"][nombre] = v
+        if v:
+            print("%-19s %8d  %8.1f/h" % (nombre, v, v / horas))
+
+    # Códigos por grupo: el porcentaje distinto de 0x00 delata un sensor sucio o gastado
+    for g in range(grupos):
+        base = contadores + g * codigos
+        cubetas = {c: celdas[base + c] for c in range(codigos) if celdas.get(base + c)}
+        if not cubetas:
+            continue
+        nombre = p.GRUPOS[g] if g < len(p.GRUPOS) else "grupo %d" % g
+        etiquetas = {c: ("%02X" % c) if c < 0x20 else p.CODIGOS_LOCALES[c - 0x20] for c in cubetas}
+        total = sum(cubetas.values())
+        print("%-9s n=%-6d no OK=%5.1f%%  %s" % (nombre, total, 100.0 * (total - cubetas.get(0, 0)) / total,
+                                                 " ".join("%s:%d" % (etiquetas[c], n) for c, n in cubetas.items())))
+        instantanea["codigos"][nombre] = {etiquetas[c]: n for c, n in cubetas.items()}
+
+    base = contadores + grupos * codigos
+    aperturas = {n: celdas.get(base + n, 0) for n in range(intentos)}
+    abiertas = sum(aperturas[n] for n in range(1, intentos))
+    if abiertas or aperturas[0]:
+        media = sum(n * aperturas[n] for n in range(1, intentos)) / abiertas if abiertas else 0.0
+        print("aperturas con huella: %d (intentos: %s; media %.2f), %d bloqueos" % (
+            abiertas, " ".join("%d:%d" % (n, aperturas[n]) for n in range(1, intentos)), media, aperturas[0]))
+    instantanea["intentos"] = {str(n): v for n, v in aperturas.items()}
+
+    if args.jsonl:
+        # Una línea por lectura, para seguir la tendencia entre lecturas periódicas
+        with open(args.jsonl, "a") as f:
+            f.write(json.dumps(instantanea, sort_keys=True) + "\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--puerto", required=True)
+    ap.add_argument("--admin-pin", help="PIN del administrador para abrir la sesión (si no, se pregunta)")
+    sub = ap.add_subparsers(dest="comando", required=True)
+    sub.add_parser("listar").set_defaults(f=cmd_listar)
+    s = sub.add_parser("agregar")
+    s.add_argument("usuario", type=int)
+    s.add_argument("pin")
+    s.set_defaults(f=cmd_agregar)
+    s = sub.add_parser("borrar")
+    s.add_argument("usuario", type=int)
+    s.add_argument("--hasta", type=int, help="borrar todos los usuarios entre usuario y hasta")
+    s.add_argument("--huella", action="store_true", help="borrar también las plantillas del lector")
+    s.set_defaults(f=cmd_borrar)
+    s = sub.add_parser("borrar-posiciones", help="borrar un tramo de la biblioteca del lector")
+    s.add_argument("desde", type=int)
+    s.add_argument("cantidad", type=int)
+    s.set_defaults(f=cmd_borrar_posiciones)
+    s = sub.add_parser("asignar", help="asociar una plantilla ya guardada en el lector a un usuario")
+    s.add_argument("usuario", type=int)
+    s.add_argument("posicion", type=int)
+    s.set_defaults(f=cmd_asignar)
+    s = sub.add_parser("compactar", help="mover las huellas a las posiciones más bajas del lector")
+    s.set_defaults(f=cmd_compactar)
+    s = sub.add_parser("lote")
+    s.add_argument("archivo")
+    s.set_defaults(f=cmd_lote)
+    s = sub.add_parser("exportar")
+    s.add_argument("directorio")
+    s.add_argument("--desde", type=int, default=0)
+    s.add_argument("--hasta", type=int, default=299)
+    s.set_defaults(f=cmd_exportar)
+    s = sub.add_parser("importar")
+    s.add_argument("directorio")
+    s.set_defaults(f=cmd_importar)
+    s = sub.add_parser("auditoria")
+    s.add_argument("--max", type=int, default=64)
+    s.set_defaults(f=cmd_auditoria)
+    s = sub.add_parser("latencias")
+    s.add_argument("--csv", help="guardar las cubetas de cada etapa")
+    s.add_argument("--reiniciar", action="store_true", help="borrar los histogramas después de leerlos")
+    s.set_defaults(f=cmd_latencias)
+    s = sub.add_parser("paquete", help="longitud de los paquetes de datos del lector y su rendimiento")
+    s.add_argument("--tam", type=int, choices=p.TAMANOS_PAQUETE, help="cambiar la longitud")
+    s.add_argument("--barrido", action="store_true", help="medir las cuatro longitudes y restaurar la actual")
+    s.add_argument("--repeticiones", type=int, default=0, help="idas y vueltas de una plantilla a medir")
+    s.set_defaults(f=cmd_paquete)
+    s = sub.add_parser("imagen", help="capturar y descargar la imagen del lector (PGM)")
+    s.add_argument("archivo")
+    s.set_defaults(f=cmd_imagen)
+    s = sub.add_parser("perfil", help="muestras del perfilador por función y ciclos de cada región")
+    s.add_argument("--iniciar", action="store_true", help="vaciar la tabla y las regiones y empezar a muestrear")
+    s.add_argument("--detener", action="store_true", help="detener el muestreo; la tabla se conserva")
+    s.add_argument("--elf", help="ELF del firmware para traducir los PC a funciones")
+    s.add_argument("--nm", default="arm-none-eabi-nm")
+    s.add_argument("--plegado", help="guardar pilas plegadas (flamegraph.pl, speedscope)")
+    s.add_argument("--max", type=int, default=20, help="funciones a mostrar")
+    s.set_defaults(f=cmd_perfil)
+    s = sub.add_parser("metricas", help="contadores de operación, códigos del lector e intentos por apertura")
+    s.add_argument("--reiniciar", action="store_true", help="poner las métricas en cero después de leerlas")
+    s.add_argument("--jsonl", help="agregar la lectura como una línea JSON al archivo")
+    s.set_defaults(f=cmd_metricas)
+    args = ap.parse_args()
+
+    args.f(Cliente(args.puerto, args.admin_pin), args)
+
+
+if __name__ == "__main__":
+    main()
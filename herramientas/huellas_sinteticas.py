@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Genera las capturas de referencia de sim/capturas para calidad_banco.
+
+Uso: huellas_sinteticas.py [directorio]   (sim/capturas por defecto)
+
+Cada imagen es una huella sintética de 256x288 con el mismo formato que guarda
+`gestion.py imagen`: niveles de 4 bits del AS608 escalados a 0-255 (x17), fondo
+blanco fuera del contacto y crestas oscuras dentro. Los parámetros de cada caso
+están elegidos para caer a un lado claro de los umbrales de calidad.h; la
+generación es determinista (semilla fija) para que las imágenes y sus puntajes
+no cambien entre ejecuciones.
+"""
+
+import math
+import os
+import random
+import sys
+
+ANCHO, ALTO = 256, 288
+
+
+def huella(centro=(0.0, 0.0), semiejes=(100, 125), periodo=9.0, amplitud=6.5, ruido=0.6,
+           crestas=True, semilla=1):
+    """Niveles de 4 bits (0-15) de una huella en espiral sobre una elipse de contacto.
+
+    centro: desplazamiento del centro de la elipse en píxeles (x, y).
+    amplitud: semiamplitud de las crestas en niveles; ruido: desviación del ruido en niveles.
+    crestas=False reemplaza las crestas por manchas sin orientación (dedo sucio o movido).
+    """
+    rnd = random.Random(semilla)
+    cx, cy = ANCHO / 2 + centro[0], ALTO / 2 + centro[1]
+    rx, ry = semiejes
+    # Manchas: ruido de baja resolución interpolado, sin dirección preferida
+    grano = 3
+    manchas = [[rnd.uniform(-1, 1) for _ in range(ANCHO // grano + 2)] for _ in range(ALTO // grano + 2)]
+    pixeles = bytearray(ANCHO * ALTO)
+    for y in range(ALTO):
+        for x in range(ANCHO):
+            dx, dy = x - cx, y - cy
+            d = (dx / rx) ** 2 + (dy / ry) ** 2
+            if d >= 1.0:
+                v = 15.0
+            else:
+                if crestas:
+                    # Lazo: anillos elípticos con una torsión que varía la orientación por bloque
+                    r = math.hypot(dx, dy * 0.8) + 6.0 * math.sin(math.atan2(dy, dx) * 2)
+                    onda = math.sin(2 * math.pi * r / periodo)
+                else:
+                    gx, gy = x / grano, y / grano
+                    ix, iy = int(gx), int(gy)
+                    fx, fy = gx - ix, gy - iy
+                    onda = (manchas[iy][ix] * (1 - fx) * (1 - fy) + manchas[iy][ix + 1] * fx * (1 - fy) +
+                            manchas[iy + 1][ix] * (1 - fx) * fy + manchas[iy + 1][ix + 1] * fx * fy) * 1.6
+                # El borde del contacto se aclara: menos presión
+                borde = min(1.0, (1.0 - d) * 4)
+                v = 15 - borde * (7.5 - amplitud * onda) + rnd.gauss(0, ruido)
+            pixeles[y * ANCHO + x] = max(0, min(15, int(round(v)))) * 17
+    return pixeles
+
+
+# nombre: (veredicto esperado, parámetros)
+CASOS = {
+    "buena": ("ok", dict(semilla=1)),
+    "buena_ruidosa": ("ok", dict(centro=(12, -10), ruido=1.4, semilla=2)),
+    "poco_contacto": ("poco_contacto", dict(semiejes=(45, 55), semilla=3)),
+    # Toda la superficie con huella pero crestas tenues: rechazada por contraste, no por cobertura
+    "poca_presion": ("poco_contacto", dict(amplitud=3.0, ruido=0.3, semilla=4)),
+    "descentrada": ("descentrada", dict(centro=(85, 95), semiejes=(110, 130), semilla=5)),
+    "borrosa": ("borrosa", dict(crestas=False, ruido=0.8, semilla=6)),
+}
+
+
+def main(directorio):
+    os.makedirs(directorio, exist_ok=True)
+    with open(os.path.join(directorio, "veredictos.txt"), "w") as lista:
+        lista.write("# imagen veredicto (generadas con herramientas/huellas_sinteticas.py)\n")
+        for nombre, (veredicto, parametros) in CASOS.items():
+            with open(os.path.join(directorio, nombre + ".pgm"), "wb") as f:
+                f.write(b"P5 %d %d 255\n" % (ANCHO, ALTO))
+                f.write(huella(**parametros))
+            lista.write("%s.pgm %s\n" % (nombre, veredicto))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(__file__), "..", "sim", "capturas"))
@@ -0,0 +1,151 @@
+"""Codificación de tramas del protocolo de gestión (ver gestion.h)."""
+
+import struct
+
+SOF = b"\xA5\x5A"
+MAX_DATOS = 600
+
+PING = 0x01
+LISTAR = 0x02
+AGREGAR = 0x03
+BORRAR = 0x04
+EXPORTAR = 0x05
+IMPORTAR = 0x06
+AUDITORIA = 0x07
+GUARDAR = 0x08
+LATENCIAS = 0x09
+PAQUETE = 0x0A
+IMAGEN = 0x0B
+ASIGNAR = 0x0C
+COMPACTAR = 0x0D
+BORRAR_POSICIONES = 0x0E
+PERFIL = 0x0F
+PLANTILLA = 0x10
+EVENTO = 0x11
+HISTOGRAMA = 0x12
+PIXELES = 0x13
+USUARIO = 0x14
+MUESTRAS = 0x15
+METRICAS = 0x16
+CELDAS = 0x17
+RETO = 0x18
+SESION = 0x19
+RESPUESTA = 0x80
+
+OK = 0x00
+ERR_PARAMETROS = 0x01
+ERR_SENSOR = 0x02
+ERR_COMANDO = 0x03
+ERR_SESION = 0x04
+ERR_BLOQUEO = 0x05
+ERR_RESPUESTA = 0x06
+SESION_INTENTOS = 3  # GESTION_INTENTOS
+
+# Registro de auditoría (auditoria_registro_t, 16 bytes little endian); el número de usuario son
+# los bytes 8 (bajo) y 14 (alto, 0xFF en registros anteriores a los números de varios dígitos)
+EVENTO_FMT = "<IIHBBBBBB"
+METODOS = {1: "PIN", 2: "HUELLA", 3: "REGISTRO", 4: "BORRADO", 5: "VACIADO", 6: "GESTION"}
+RESULTADOS = {0: "OK", 1: "FALLO", 2: "BLOQUEO"}
+
+# Histogramas de latencia (latencia.h): cabecera y pares {cubeta, cuenta}
+HISTOGRAMA_FMT = "<BIIIQ"
+ETAPAS = ["tecla>decod", "tecla>lcd", "lcd", "genimg", "img2tz", "regmodel", "store", "search",
+          "delete", "empty", "identify", "as608", "dedo>rele", "registro", "toque",
+          "despertar", "reloj", "isr pit", "irq systick", "irq gpio", "irq pwm"]
+LATENCIA_SUB_BITS = 3
+
+# Respuesta de PAQUETE: código del sensor, longitud actual y contadores de 32/64/128/256 bytes
+PAQUETE_FMT = "<BH" + "III" * 4
+TAMANOS_PAQUETE = (32, 64, 128, 256)
+
+# Perfilador (perfilador.h): acciones de PERFIL, pares {pc, lr, cuenta} de MUESTRAS y respuesta:
+# muestreando, Hz, kHz, muestras, perdidas y {cuenta, mín, máx, total} en ciclos por región
+PERFIL_LEER = 0
+PERFIL_INICIAR = 1
+PERFIL_DETENER = 2
+MUESTRA_FMT = "<III"
+PERFIL_FMT = "<BHIII"
+REGION_FMT = "<IIIQ"
+REGIONES = ["as608", "pantalla", "tecla"]
+
+# Métricas (metricas.h): pares {celda, valor} de CELDAS y respuesta: segundos, contadores, grupos,
+# códigos por grupo, cubetas de intentos y pares enviados. Los grupos son las etapas del lector en
+# ETAPAS; las cubetas de un grupo son los códigos 0x00-0x1F y luego "otro", "com" y "cancelado"
+CELDA_FMT = "<HI"
+METRICAS_FMT = "<IBBBBH"
+CONTADORES = ["as608 reintentos", "as608 sin respuesta", "as608 checksum", "as608 desbordes",
+              "toque plazos", "toque flancos", "teclado flancos", "teclas", "teclas invalidas",
+              "lcd redibujos", "lcd errores i2c", "rele aperturas", "pin rechazados",
+              "huellas rechazadas", "bloqueos"]
+GRUPOS = ETAPAS[3:12]
+CODIGOS_LOCALES = ["otro", "com", "cancelado"]
+
+# Imagen del lector (UpImage) y respuesta de IMAGEN: código, bytes, paquetes, us, RAM, DMA
+IMAGEN_ANCHO = 256
+IMAGEN_ALTO = 288
+IMAGEN_FMT = "<BIIIHB"
+
+
+def evento_usuario(bajo, alto):
+    """Número de usuario de un registro de auditoría (AUDITORIA_USUARIO)."""
+    return bajo | ((0 if alto == 0xFF else alto) << 8)
+
+
+def cubeta_valor(c):
+    """Límite inferior en microsegundos de una cubeta (latencia_cubeta_valor)."""
+    lineal = 2 << LATENCIA_SUB_BITS
+    if c < lineal:
+        return c
+    k = c - lineal
+    exp = (k >> LATENCIA_SUB_BITS) + LATENCIA_SUB_BITS + 1
+    sub = k & ((1 << LATENCIA_SUB_BITS) - 1)
+    return ((1 << LATENCIA_SUB_BITS) | sub) << (exp - LATENCIA_SUB_BITS)
+
+
+def crc16(datos, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE."""
+    for b in datos:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def codificar(cmd, datos=b""):
+    cuerpo = struct.pack("<BH", cmd, len(datos)) + bytes(datos)
+    return SOF + cuerpo + struct.pack("<H", crc16(cuerpo))
+
+
+class Decodificador:
+    """Extrae tramas válidas de un flujo de bytes; descarta texto y tramas corruptas."""
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def alimentar(self, datos):
+        self.buf += datos
+        tramas = []
+        while True:
+            i = self.buf.find(SOF)
+            if i < 0:
+                # Conservar un posible primer byte de SOF al final
+                del self.buf[:-1 if self.buf[-1:] == SOF[:1] else len(self.buf)]
+                return tramas
+            del self.buf[:i]
+            if len(self.buf) < 5:
+                return tramas
+            cmd, longitud = struct.unpack_from("<BH", self.buf, 2)
+            if longitud > MAX_DATOS:
+                del self.buf[:1]
+                continue
+            total = 5 + longitud + 2
+            if len(self.buf) < total:
+                return tramas
+            cuerpo = bytes(self.buf[2:5 + longitud])
+            (crc,) = struct.unpack_from("<H", self.buf, 5 + longitud)
+            if crc == crc16(cuerpo):
+                tramas.append((cmd, cuerpo[3:]))
+                del self.buf[:total]
+            else:
+                del self.buf[:1]
@@ -0,0 +1,33 @@
+"""Traducción de direcciones del firmware a funciones con la tabla de símbolos del ELF.
+
+Las funciones marcadas con EN_RAM (ram.h) tienen en el ELF su dirección de ejecución en SRAM,
+que es la que muestrea el perfilador.
+"""
+
+import bisect
+import subprocess
+
+
+class Simbolos:
+    def __init__(self, elf, nm="arm-none-eabi-nm"):
+        salida = subprocess.run([nm, "-n", "-S", "--defined-only", elf], check=True, capture_output=True,
+                                text=True).stdout
+        self.inicios = []
+        self.fines = []
+        self.nombres = []
+        for linea in salida.splitlines():
+            # dirección, tamaño, tipo y nombre; los símbolos sin tamaño (etiquetas) no sirven
+            campos = linea.split(None, 3)
+            if len(campos) != 4 or campos[2] not in "tTwW":
+                continue
+            inicio = int(campos[0], 16) & ~1
+            self.inicios.append(inicio)
+            self.fines.append(inicio + int(campos[1], 16))
+            self.nombres.append(campos[3])
+
+    def nombre(self, direccion):
+        """Función que contiene la dirección, o la dirección en hexadecimal si no hay ninguna."""
+        i = bisect.bisect_right(self.inicios, direccion) - 1
+        if i >= 0 and direccion < self.fines[i]:
+            return self.nombres[i]
+        return "0x%08x" % direccion
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Dispositivo simulado para probar el protocolo de gestión en Linux.
+
+Abre una pseudo-terminal y responde como el firmware (gestion.c), con usuarios y
+plantillas en memoria. Entre tramas escribe texto como lo haría printf para
+ejercitar la resincronización del cliente.
+
+Uso: simulador.py            -> imprime la ruta del puerto, p. ej. /dev/pts/5
+     gestion.py --puerto /dev/pts/5 listar
+"""
+
+import os
+import pty
+import struct
+import sys
+import tty
+
+import protocolo as p
+
+USUARIOS_MAX = 300
+DEDOS_MAX = 3
+CAPACIDAD = 300
+PAGINAS = (CAPACIDAD + 255) // 256  # Páginas de ReadConList que cubren las posiciones (USUARIOS_PAGINAS)
+TAM_PLANTILLA = 512
+
+
+class Dispositivo:
+    def __init__(self):
+        # Número de usuario -> [clave, posiciones]; de fábrica, 1 a 9 con la posición de su número
+        self.usuarios = {i: [None, [i]] for i in range(1, 10)}
+        self.plantillas = {}
+        self.eventos = []
+        self.guardados = 0
+
+    def ejecutar(self, cmd, datos):
+        """Devuelve la lista de tramas (cmd, datos) a enviar."""
+        resp = cmd | p.RESPUESTA
+        if cmd == p.PING:
+            return [(resp, bytes([p.OK, 2]) + struct.pack("<HB", USUARIOS_MAX, DEDOS_MAX))]
+        if cmd == p.LISTAR:
+            mapa = bytearray(32 * PAGINAS)
+            for i in self.plantillas:
+                mapa[i >> 3] |= 1 << (i & 7)
+            salida = []
+            for i in sorted(self.usuarios):
+                posiciones = self.usuarios[i][1]
+                salida.append((p.USUARIO, struct.pack("<HB%dH" % len(posiciones), i, len(posiciones),
+                                                      *posiciones)))
+            cuerpo = bytes([p.OK, 0]) + struct.pack("<H", len(self.usuarios)) + mapa
+            return salida + [(resp, cuerpo)]
+        if cmd == p.AGREGAR:
+            if len(datos) != 50:
+                return [(resp, bytes([p.ERR_PARAMETROS]))]
+            (i,) = struct.unpack_from("<H", datos)
+            if not 1 <= i <= 9999 or (i not in self.usuarios and len(self.usuarios) >= USUARIOS_MAX):
+                return [(resp, bytes([p.ERR_PARAMETROS]))]
+            self.usuarios.setdefault(i, [None, []])[0] = bytes(datos[2:])
+            return [(resp, bytes([p.OK]))]
+        if cmd == p.BORRAR:
+            if len(datos) not in (3, 5):
+                return [(resp, bytes([p.ERR_PARAMETROS]))]
+            (desde,) = struct.unpack_from("<H", datos)
+            hasta = struct.unpack_from("<H", datos, 2)[0] if len(datos) == 5 else desde
+            if hasta < desde or (len(datos) == 3 and desde not in self.usuarios):
+                return [(resp, bytes([p.ERR_PARAMETROS]))]
+            borrados = [u for u in self.usuarios if desde <= u <= hasta]
+            for u in borrados:
+                _, posiciones = self.usuarios.pop(u)
+                if datos[-1]:
+                    for i in posiciones:
+                        self.plantillas.pop(i, None)
+            return [(resp, bytes([p.OK, 0]) + struct.pack("<H", len(borrados)))]
+        if cmd == p.BORRAR_POSICIONES:
+            if len(datos) != 4:
+                return [(resp, bytes([p.ERR_PARAMETROS]))]
+            desde, cantidad = struct.unpack("<HH", datos)
+            if desde + cantidad > CAPACIDAD:
+                return [(resp, bytes([p.ERR_SENSOR, 0x10]))]
+            for i in range(desde, desde + cantidad):
+                self.plantillas.pop(i, None)
+            for _, posiciones in self.usuarios.values():
+                posiciones[:] = [i for i in posiciones if not desde <= i < desde + cantidad]
+            return [(resp, bytes([p.OK, 0]))]
+        if cmd == p.ASIGNAR:
+            if len(datos) != 4:
+                return [(resp, bytes([p.ERR_PARAMETROS]))]
+            usuario, posicion = struct.unpack("<HH", datos)
+            ocupadas = [i for _, posiciones in self.usuarios.values() for i in posiciones]
+            if (usuario not in self.usuarios or posicion >= CAPACIDAD or posicion in ocupadas or
+                    len(self.usuarios[usuario][1]) >= DEDOS_MAX):
+                return [(resp, bytes([p.ERR_PARAMETROS]))]
+            self.usuarios[usuario][1].append(posicion)
+            return [(resp, bytes([p.OK]))]
+        if cmd == p.EXPORTAR:
+            if len(datos) != 4:
+                return [(resp, bytes([p.ERR_PARAMETROS]))]
+            desde, hasta = struct.unpack("<HH", datos)
+            salida = []
+            for i in sorted(self.plantillas):
+                if desde <= i <= hasta:
+                    salida.append((p.PLANTILLA, struct.pack("<H", i) + self.plantillas[i]))
+            return salida + [(resp, bytes([p.OK]) + struct.pack("<H", len(salida)))]
+        if cmd == p.IMPORTAR:
+            if len(datos) <= 2:
+                return [(resp, bytes([p.ERR_PARAMETROS]))]
+            (i,) = struct.unpack_from("<H", datos)
+            if i >= CAPACIDAD:
+                return [(resp, bytes([p.ERR_SENSOR, 0x0B]))]
+            self.plantillas[i] = bytes(datos[2:])
+            return [(resp, bytes([p.OK, 0]))]
+        if cmd == p.AUDITORIA:
+            maximo = struct.unpack("<H", datos)[0] if len(datos) == 2 else 0xFFFF
+            salida = [(p.EVENTO, e) for e in reversed(self.eventos)][:maximo]
+            return salida + [(resp, bytes([p.OK]) + struct.pack("<H", len(salida)))]
+        if cmd == p.GUARDAR:
+            self.guardados += 1
+            return [(resp, bytes([p.OK]))]
+        if cmd == p.COMPACTAR:
+            duenio = {i: u for u, (_, posiciones) in self.usuarios.items() for i in posiciones}
+            libres = [i for i in range(CAPACIDAD) if i not in self.plantillas and i not in duenio]
+            altas = sorted((i for i in self.plantillas if i in duenio), reverse=True)
+            movidas = 0
+            for origen, destino in zip(altas, libres):
+                if destino > origen:
+                    break
+                self.plantillas[destino] = self.plantillas.pop(origen)
+                posiciones = self.usuarios[duenio[origen]][1]
+                posiciones[posiciones.index(origen)] = destino
+                duenio[destino] = duenio.pop(origen)
+                movidas += 1
+            huerfanas = sum(1 for i in self.plantillas if i not in duenio)
+            limite = max((i + 1 for _, posiciones in self.usuarios.values() for i in posiciones), default=0)
+            return [(resp, bytes([p.OK, 0]) + struct.pack("<HHH", movidas, huerfanas, limite))]
+        return [(resp, bytes([p.ERR_COMANDO]))]
+
+    def registrar_evento(self, usuario, metodo, resultado):
+        seq = len(self.eventos)
+        sin_crc = struct.pack("<IIHBBBBB", seq, seq * 1000, 0, usuario & 0xFF, metodo, resultado, 0,
+                              usuario >> 8)
+        self.eventos.append(sin_crc + b"\x00")
+
+
+def main():
+    maestro, esclavo = pty.openpty()
+    tty.setraw(esclavo)
+    print(os.ttyname(esclavo), flush=True)
+
+    disp = Dispositivo()
+    disp.registrar_evento(1, 1, 0)
+    disp.registrar_evento(1, 2, 0)
+    disp.registrar_evento(1042, 1, 1)
+    dec = p.Decodificador()
+    while True:
+        try:
+            datos = os.read(maestro, 4096)
+        except OSError:
+            break
+        for cmd, cuerpo in dec.alimentar(datos):
+            salida = bytearray(b"Enviando comando: EF 01 FF FF FF FF\r\n")
+            for c, d in disp.ejecutar(cmd, cuerpo):
+                salida += p.codificar(c, d)
+            os.write(maestro, bytes(salida))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
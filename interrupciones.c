@@ -0,0 +1,155 @@
+/**
+ * @file interrupciones.c
+ * @brief Mapa de prioridades de las interrupciones, presupuestos y detección de inversiones.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/exception.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+#include "interrupciones.h"
+#include "latencia.h"
+#include "ram.h"
+
+#define SIN_IRQ (-1)  ///< La fuente es una excepción del núcleo, no una IRQ del NVIC
+
+typedef struct {
+    const char *nombre;
+    int irq;                  ///< Número de IRQ, o SIN_IRQ para el SysTick
+    uint8_t prioridad;
+    uint32_t latencia_us;     ///< Presupuesto de latencia (0 si no se mide)
+    uint32_t ejecucion_us;    ///< Presupuesto de ejecución
+    latencia_etapa_t latencia; ///< Histograma de la latencia, o LAT_ETAPAS
+    latencia_etapa_t ejecucion; ///< Histograma de la ejecución
+} interrupciones_mapa_t;
+
+static const interrupciones_mapa_t mapa[IRQ_FUENTES] = {
+    [IRQ_SYSTICK] = {"systick", SIN_IRQ, IRQ_PRIORIDAD_SYSTICK, 0, 10, LAT_ETAPAS, LAT_IRQ_SYSTICK},
+    [IRQ_GPIO] = {"gpio", IO_IRQ_BANK0, IRQ_PRIORIDAD_GPIO, 0, 20, LAT_ETAPAS, LAT_IRQ_GPIO},
+    [IRQ_PWM] = {"pwm", PWM_IRQ_WRAP, IRQ_PRIORIDAD_PWM, 100, 10, LAT_ISR_PIT, LAT_IRQ_PWM},
+};
+
+static interrupciones_contador_t contadores[IRQ_FUENTES] = {
+    [IRQ_SYSTICK] = {.culpable = -1}, [IRQ_GPIO] = {.culpable = -1}, [IRQ_PWM] = {.culpable = -1},
+};
+static uint32_t fifo_us = 0;
+
+static unsigned int prioridad_actual(interrupciones_fuente_t f) {
+    return mapa[f].irq == SIN_IRQ ? exception_get_priority(SYSTICK_EXCEPTION) : irq_get_priority(mapa[f].irq);
+}
+
+void interrupciones_init(uint32_t uart_baudios) {
+    uint32_t suma = 0;
+
+    for (int f = 0; f < IRQ_FUENTES; f++) {
+        if (mapa[f].irq == SIN_IRQ) {
+            exception_set_priority(SYSTICK_EXCEPTION, mapa[f].prioridad);
+        } else {
+            irq_set_priority(mapa[f].irq, mapa[f].prioridad);
+        }
+        suma += mapa[f].ejecucion_us;
+    }
+    irq_set_priority(USBCTRL_IRQ, IRQ_PRIORIDAD_USB);
+
+    // Todas las rutinas pueden caer en la misma pausa del sondeo: se deja un margen de 4 veces
+    fifo_us = INTERRUPCIONES_FIFO_UART * 10u * 1000000u / uart_baudios;
+    if (suma * 4 > fifo_us) {
+        printf("IRQ: presupuestos de ejecucion (%lu us) cerca del llenado del FIFO del UART (%lu us)\n",
+               (unsigned long)suma, (unsigned long)fifo_us);
+    }
+}
+
+#ifdef MEDIR_IRQ
+static volatile uint32_t entrada_us[IRQ_FUENTES];
+static volatile uint32_t salida_us[IRQ_FUENTES];
+static volatile bool en_curso[IRQ_FUENTES];
+
+uint32_t EN_RAM(interrupciones_entrar)(interrupciones_fuente_t fuente, uint32_t latencia_us) {
+    uint32_t ahora = time_us_32();
+    interrupciones_contador_t *c = &contadores[fuente];
+
+    if (latencia_us != INTERRUPCIONES_SIN_LATENCIA && mapa[fuente].latencia_us &&
+        latencia_us > mapa[fuente].latencia_us) {
+        // Rutina que ya terminó y corría cuando llegó el evento; una que sigue en curso fue
+        // desalojada por esta, así que no la demoró
+        uint32_t evento = ahora - latencia_us;
+        int culpable = -1;
+        for (int g = 0; g < IRQ_FUENTES; g++) {
+            if (g != (int)fuente && !en_curso[g] &&
+                evento - entrada_us[g] <= salida_us[g] - entrada_us[g]) {
+                culpable = g;
+            }
+        }
+        c->excesos++;
+        c->culpable = culpable;
+        if (culpable < 0) {
+            c->bloqueos++;
+        } else if (mapa[culpable].prioridad >= mapa[fuente].prioridad) {
+            c->inversiones++;
+        }
+    }
+    entrada_us[fuente] = ahora;
+    en_curso[fuente] = true;
+    return ahora;
+}
+
+void EN_RAM(interrupciones_salir)(interrupciones_fuente_t fuente, uint32_t entrada) {
+    uint32_t us = time_us_32() - entrada;
+    salida_us[fuente] = entrada + us;
+    en_curso[fuente] = false;
+    latencia_registrar(mapa[fuente].ejecucion, us);
+    if (us > mapa[fuente].ejecucion_us) {
+        contadores[fuente].excesos++;
+    }
+}
+#endif
+
+void EN_RAM(interrupciones_inesperada)(interrupciones_fuente_t fuente) {
+    contadores[fuente].inesperadas++;
+}
+
+const interrupciones_contador_t *interrupciones_contador(interrupciones_fuente_t fuente) {
+    return &contadores[fuente];
+}
+
+/**
+ * @brief Imprime el máximo y el p99 de un histograma, o "-" si está vacío.
+ */
+static void imprimir_medida(latencia_etapa_t etapa) {
+    if (etapa == LAT_ETAPAS || latencia_histograma(etapa)->total == 0) {
+        printf("%15s", "-");
+        return;
+    }
+    printf("%7lu %7lu", (unsigned long)latencia_histograma(etapa)->max,
+           (unsigned long)latencia_percentil(etapa, 990));
+}
+
+void interrupciones_volcar(void) {
+    printf("IRQ fuente   prio presup lat/ejec   lat max/p99    ejec max/p99 excesos invers bloqueos inesp\n");
+    for (int f = 0; f < IRQ_FUENTES; f++) {
+        const interrupciones_contador_t *c = &contadores[f];
+        unsigned int prioridad = prioridad_actual(f);
+        printf("IRQ %-8s 0x%02X ", mapa[f].nombre, prioridad);
+        if (mapa[f].latencia_us) {
+            printf("%6lu", (unsigned long)mapa[f].latencia_us);
+        } else {
+            printf("%6s", "-");
+        }
+        printf("/%-6lu", (unsigned long)mapa[f].ejecucion_us);
+        imprimir_medida(mapa[f].latencia);
+        printf(" ");
+        imprimir_medida(mapa[f].ejecucion);
+        printf(" %7lu %6lu %8lu %5lu", (unsigned long)c->excesos, (unsigned long)c->inversiones,
+               (unsigned long)c->bloqueos, (unsigned long)c->inesperadas);
+        if (c->culpable >= 0) {
+            printf(" (demorada por %s)", mapa[c->culpable].nombre);
+        }
+        if (prioridad != mapa[f].prioridad) {
+            printf(" (mapa: 0x%02X)", mapa[f].prioridad);
+        }
+        printf("\n");
+    }
+    printf("IRQ usb      0x%02X (sin medir); FIFO del UART en %lu us\n", irq_get_priority(USBCTRL_IRQ),
+           (unsigned long)fifo_us);
+}
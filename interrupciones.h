@@ -0,0 +1,116 @@
+/**
+ * @file interrupciones.h
+ * @brief Mapa de prioridades de las interrupciones y medición de su latencia y ejecución.
+ *
+ * El NVIC del Cortex-M0+ tiene 4 niveles (0x00 el más urgente). Mapa de prioridades:
+ *
+ * | Fuente        | Prioridad | Presupuesto (us)      | Motivo                                           |
+ * |---------------|-----------|-----------------------|--------------------------------------------------|
+ * | SysTick       | 0x00      | ejecución 10          | El perfilador muestrea dentro de las demás       |
+ * | IO_IRQ_BANK0  | 0x40      | ejecución 20          | Lee las columnas antes de que el PIT cambie de fila |
+ * | PWM_IRQ_WRAP  | 0x80      | latencia 100, ej. 10  | Barrido de filas cada 2 ms y antirrebote         |
+ * | USBCTRL_IRQ   | 0xC0      | -                     | CDC: el host reintenta, no se pierden datos      |
+ * | UART del AS608| sondeo/DMA| -                     | FIFO de 32 bytes: 5,5 ms a 57600 baudios         |
+ *
+ * La recepción del AS608 no usa interrupciones: el ciclo principal lee el FIFO por sondeo (o por
+ * DMA en UpImage) y se desborda solo si deja de leer más de lo que tarda en llenarse. Las rutinas
+ * de interrupción suman a esa pausa, así que la suma de sus presupuestos de ejecución debe quedar
+ * muy por debajo del tiempo de llenado; interrupciones_init lo comprueba con la tasa del lector.
+ * Si la recepción pasara a una IRQ del UART, iría en 0x00 junto al SysTick.
+ *
+ * Con -DMEDIR_IRQ cada rutina marca su entrada y su salida con time_us_32: la ejecución va a los
+ * histogramas de latencia.h ("irq systick", "irq gpio", "irq pwm"), de donde salen el máximo y el
+ * p99. Cuando una latencia medida (la del PIT, con el contador del PWM) supera su presupuesto se
+ * busca qué rutina corría en el instante del vencimiento: si es una de prioridad igual o menor, se
+ * cuenta una inversión de prioridad; si no corría ninguna, la demora vino de una sección crítica.
+ */
+
+#ifndef INTERRUPCIONES_H
+#define INTERRUPCIONES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define IRQ_PRIORIDAD_SYSTICK 0x00
+#define IRQ_PRIORIDAD_GPIO    0x40
+#define IRQ_PRIORIDAD_PWM     0x80
+#define IRQ_PRIORIDAD_USB     0xC0
+
+#define INTERRUPCIONES_SIN_LATENCIA UINT32_MAX ///< La fuente no da el instante del evento
+#define INTERRUPCIONES_FIFO_UART 32            ///< Bytes del FIFO de recepción del PL011
+
+/**
+ * @brief Rutinas de interrupción medidas.
+ */
+typedef enum {
+    IRQ_SYSTICK,  ///< perfilador_anotar
+    IRQ_GPIO,     ///< keyboardCallback (teclado y línea de toque)
+    IRQ_PWM,      ///< pwmIRQ
+    IRQ_FUENTES
+} interrupciones_fuente_t;
+
+/**
+ * @brief Contadores de una rutina.
+ */
+typedef struct {
+    uint32_t excesos;     ///< Latencias o ejecuciones por encima del presupuesto
+    uint32_t inversiones; ///< Latencias excedidas mientras corría una rutina de prioridad igual o menor
+    uint32_t bloqueos;    ///< Latencias excedidas sin ninguna rutina en curso (sección crítica)
+    uint32_t inesperadas; ///< Interrupciones sin causa conocida, reconocidas y descartadas
+    int8_t culpable;      ///< Última rutina que la demoró, o -1
+} interrupciones_contador_t;
+
+/**
+ * @brief Aplica el mapa de prioridades a las IRQ de la tabla y comprueba que la suma de los
+ * presupuestos de ejecución cabe en el tiempo de llenado del FIFO del UART.
+ *
+ * @param uart_baudios Tasa del UART que se lee por sondeo (el lector).
+ */
+void interrupciones_init(uint32_t uart_baudios);
+
+#ifdef MEDIR_IRQ
+/**
+ * @brief Marca la entrada a una rutina y revisa su latencia.
+ *
+ * @param fuente Rutina que entra.
+ * @param latencia_us Demora desde el evento, o INTERRUPCIONES_SIN_LATENCIA.
+ * @return uint32_t Instante de entrada, que se pasa a interrupciones_salir.
+ */
+uint32_t interrupciones_entrar(interrupciones_fuente_t fuente, uint32_t latencia_us);
+
+/**
+ * @brief Marca la salida de una rutina y registra su ejecución.
+ *
+ * @param fuente Rutina que sale.
+ * @param entrada Valor devuelto por interrupciones_entrar.
+ */
+void interrupciones_salir(interrupciones_fuente_t fuente, uint32_t entrada);
+#else
+static inline uint32_t interrupciones_entrar(interrupciones_fuente_t fuente, uint32_t latencia_us) {
+    (void)fuente;
+    (void)latencia_us;
+    return 0;
+}
+
+static inline void interrupciones_salir(interrupciones_fuente_t fuente, uint32_t entrada) {
+    (void)fuente;
+    (void)entrada;
+}
+#endif
+
+/**
+ * @brief Cuenta una interrupción sin causa conocida (sin imprimir: se llama desde la rutina).
+ */
+void interrupciones_inesperada(interrupciones_fuente_t fuente);
+
+/**
+ * @brief Contadores de una rutina.
+ */
+const interrupciones_contador_t *interrupciones_contador(interrupciones_fuente_t fuente);
+
+/**
+ * @brief Imprime por stdio el mapa de prioridades aplicado, los presupuestos y los contadores.
+ */
+void interrupciones_volcar(void);
+
+#endif // INTERRUPCIONES_H
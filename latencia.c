@@ -0,0 +1,153 @@
+/**
+ * @file latencia.c
+ * @brief Histogramas de latencia por etapa.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "latencia.h"
+#include "hardware/timer.h"
+#include "ram.h"
+
+static latencia_histograma_t histogramas[LAT_ETAPAS];
+
+// Inicio de cada etapa abierta. Se guardan los 32 bits bajos de time_us_64(): la escritura es
+// atómica desde la IRQ del teclado y las diferencias son válidas hasta 71 minutos.
+static volatile uint32_t inicio[LAT_ETAPAS];
+static volatile bool abierta[LAT_ETAPAS];
+
+static const char *const nombres[LAT_ETAPAS] = {
+    [LAT_TECLA_DECODIFICAR] = "tecla>decod",
+    [LAT_TECLA_PANTALLA] = "tecla>lcd",
+    [LAT_LCD_REDIBUJO] = "lcd",
+    [LAT_AS608_GENIMG] = "genimg",
+    [LAT_AS608_IMG2TZ] = "img2tz",
+    [LAT_AS608_REGMODEL] = "regmodel",
+    [LAT_AS608_STORE] = "store",
+    [LAT_AS608_SEARCH] = "search",
+    [LAT_AS608_DELETE] = "delete",
+    [LAT_AS608_EMPTY] = "empty",
+    [LAT_AS608_IDENTIFY] = "identify",
+    [LAT_AS608_OTRO] = "as608",
+    [LAT_DEDO_RELE] = "dedo>rele",
+    [LAT_REGISTRO] = "registro",
+    [LAT_TOQUE] = "toque",
+    [LAT_DESPERTAR] = "despertar",
+    [LAT_RELOJ] = "reloj",
+    [LAT_ISR_PIT] = "isr pit",
+    [LAT_IRQ_SYSTICK] = "irq systick",
+    [LAT_IRQ_GPIO] = "irq gpio",
+    [LAT_IRQ_PWM] = "irq pwm",
+};
+
+/**
+ * @brief Cubeta de un valor: lineal hasta LATENCIA_LINEAL y luego 2^SUB_BITS por potencia de 2.
+ */
+static uint8_t EN_RAM(cubeta)(uint32_t us) {
+    if (us < LATENCIA_LINEAL) {
+        return us;
+    }
+    uint32_t exp = 31 - __builtin_clz(us);
+    uint32_t sub = (us >> (exp - LATENCIA_SUB_BITS)) & ((1u << LATENCIA_SUB_BITS) - 1);
+    return LATENCIA_LINEAL + ((exp - LATENCIA_SUB_BITS - 1) << LATENCIA_SUB_BITS) + sub;
+}
+
+uint32_t latencia_cubeta_valor(uint8_t c) {
+    if (c < LATENCIA_LINEAL) {
+        return c;
+    }
+    uint32_t k = c - LATENCIA_LINEAL;
+    uint32_t exp = (k >> LATENCIA_SUB_BITS) + LATENCIA_SUB_BITS + 1;
+    uint32_t sub = k & ((1u << LATENCIA_SUB_BITS) - 1);
+    return ((1u << LATENCIA_SUB_BITS) | sub) << (exp - LATENCIA_SUB_BITS);
+}
+
+void EN_RAM(latencia_registrar)(latencia_etapa_t etapa, uint32_t us) {
+    latencia_histograma_t *h = &histogramas[etapa];
+
+    if (us > LATENCIA_MAX_US) {
+        us = LATENCIA_MAX_US;
+    }
+    if (h->total == 0 || us < h->min) {
+        h->min = us;
+    }
+    if (us > h->max) {
+        h->max = us;
+    }
+    h->total++;
+    h->suma += us;
+    h->cubetas[cubeta(us)]++;
+}
+
+void EN_RAM(latencia_abrir)(latencia_etapa_t etapa) {
+    inicio[etapa] = time_us_32();
+    abierta[etapa] = true;
+}
+
+void EN_RAM(latencia_cerrar)(latencia_etapa_t etapa) {
+    if (!abierta[etapa]) {
+        return;
+    }
+    uint32_t t0 = inicio[etapa];
+    abierta[etapa] = false;
+    latencia_registrar(etapa, time_us_32() - t0);
+}
+
+latencia_etapa_t latencia_etapa_as608(uint8_t instruccion) {
+    switch (instruccion) {
+        case 0x01: return LAT_AS608_GENIMG;
+        case 0x02: return LAT_AS608_IMG2TZ;
+        case 0x05: return LAT_AS608_REGMODEL;
+        case 0x06: return LAT_AS608_STORE;
+        case 0x04: return LAT_AS608_SEARCH;
+        case 0x0C: return LAT_AS608_DELETE;
+        case 0x0D: return LAT_AS608_EMPTY;
+        case 0x11: return LAT_AS608_IDENTIFY;
+        default:   return LAT_AS608_OTRO;
+    }
+}
+
+const latencia_histograma_t *latencia_histograma(latencia_etapa_t etapa) {
+    return &histogramas[etapa];
+}
+
+const char *latencia_nombre(latencia_etapa_t etapa) {
+    return nombres[etapa];
+}
+
+uint32_t latencia_percentil(latencia_etapa_t etapa, uint16_t milesimas) {
+    const latencia_histograma_t *h = &histogramas[etapa];
+    // Posición (1..total) de la muestra del percentil, redondeando hacia arriba
+    uint32_t objetivo = (uint32_t)(((uint64_t)h->total * milesimas + 999) / 1000);
+    uint32_t acumulado = 0;
+
+    if (objetivo == 0) {
+        objetivo = 1;
+    }
+    for (int c = 0; c < LATENCIA_CUBETAS; c++) {
+        acumulado += h->cubetas[c];
+        if (acumulado >= objetivo) {
+            uint32_t valor = latencia_cubeta_valor(c);
+            return valor < h->min ? h->min : valor;
+        }
+    }
+    return h->max;
+}
+
+void latencia_reiniciar(void) {
+    memset(histogramas, 0, sizeof(histogramas));
+}
+
+void latencia_volcar(void) {
+    printf("LAT etapa            n      min      p50      p90      p99      max    media (us)\n");
+    for (int e = 0; e < LAT_ETAPAS; e++) {
+        const latencia_histograma_t *h = &histogramas[e];
+        if (h->total == 0) {
+            continue;
+        }
+        printf("LAT %-11s %6lu %8lu %8lu %8lu %8lu %8lu %8lu\n", nombres[e], (unsigned long)h->total,
+               (unsigned long)h->min, (unsigned long)latencia_percentil(e, 500),
+               (unsigned long)latencia_percentil(e, 900), (unsigned long)latencia_percentil(e, 990),
+               (unsigned long)h->max, (unsigned long)(h->suma / h->total));
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * @file latencia.h
+ * @brief Medición de latencias por etapa con histogramas logarítmicos (estilo HDR).
+ *
+ * Cada etapa (teclado, LCD, comandos del AS608, apertura) acumula sus muestras en microsegundos,
+ * tomadas con time_us_64(), en un histograma de cubetas log-lineales: valores 0-15 exactos y, a
+ * partir de ahí, 8 cubetas por potencia de 2 (error relativo máximo de 12,5 %). Los histogramas
+ * se consultan por USB con la tecla 'T' (texto) o con el comando GESTION_LATENCIAS.
+ */
+
+#ifndef LATENCIA_H
+#define LATENCIA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LATENCIA_SUB_BITS 3                          ///< Bits de subcubeta por potencia de 2
+#define LATENCIA_LINEAL (2u << LATENCIA_SUB_BITS)    ///< Valores registrados sin redondeo (0-15 us)
+#define LATENCIA_MAX_US ((1u << 27) - 1)             ///< Mayor valor representable (~134 s)
+#define LATENCIA_CUBETAS 200                         ///< Cubetas necesarias hasta LATENCIA_MAX_US
+
+/**
+ * @brief Etapas medidas.
+ */
+typedef enum {
+    LAT_TECLA_DECODIFICAR, ///< IRQ del teclado -> tecla decodificada en el ciclo principal
+    LAT_TECLA_PANTALLA,    ///< IRQ del teclado -> LCD redibujado
+    LAT_LCD_REDIBUJO,      ///< Duración de pantalla_texto (2x16 completo, con cualquier respaldo)
+    LAT_AS608_GENIMG,      ///< Ida y vuelta de cada instrucción del AS608
+    LAT_AS608_IMG2TZ,
+    LAT_AS608_REGMODEL,
+    LAT_AS608_STORE,
+    LAT_AS608_SEARCH,
+    LAT_AS608_DELETE,
+    LAT_AS608_EMPTY,
+    LAT_AS608_IDENTIFY,
+    LAT_AS608_OTRO,
+    LAT_DEDO_RELE,         ///< Inicio de la captura que abre -> relé activado
+    LAT_REGISTRO,          ///< Inicio del registro de huella -> modelo almacenado
+    LAT_TOQUE,             ///< Flanco de la línea de toque -> dedo estable y sensor listo
+    LAT_DESPERTAR,         ///< Flanco que despierta del reposo -> teclado, relojes y pantalla restituidos
+    LAT_RELOJ,             ///< Cambio de perfil de reloj: tensión, PLL y divisores de los periféricos
+    LAT_ISR_PIT,           ///< Vencimiento del PIT de filas -> entrada a pwmIRQ (resolución de 1 us)
+    LAT_IRQ_SYSTICK,       ///< Ejecución de cada rutina de interrupción (solo con -DMEDIR_IRQ)
+    LAT_IRQ_GPIO,
+    LAT_IRQ_PWM,
+    LAT_ETAPAS
+} latencia_etapa_t;
+
+/**
+ * @brief Histograma de una etapa.
+ */
+typedef struct {
+    uint32_t total;                      ///< Número de muestras
+    uint32_t min;                        ///< Menor muestra (us)
+    uint32_t max;                        ///< Mayor muestra (us)
+    uint64_t suma;                       ///< Suma de las muestras (us)
+    uint32_t cubetas[LATENCIA_CUBETAS];
+} latencia_histograma_t;
+
+/**
+ * @brief Agrega una muestra al histograma de una etapa.
+ *
+ * @param etapa Etapa medida.
+ * @param us Duración en microsegundos (se satura en LATENCIA_MAX_US).
+ */
+void latencia_registrar(latencia_etapa_t etapa, uint32_t us);
+
+/**
+ * @brief Marca el inicio de una etapa. Se puede llamar desde una interrupción.
+ */
+void latencia_abrir(latencia_etapa_t etapa);
+
+/**
+ * @brief Registra el tiempo transcurrido desde latencia_abrir, si la etapa estaba abierta.
+ */
+void latencia_cerrar(latencia_etapa_t etapa);
+
+/**
+ * @brief Etapa correspondiente a una instrucción del AS608.
+ */
+latencia_etapa_t latencia_etapa_as608(uint8_t instruccion);
+
+/**
+ * @brief Histograma de una etapa (solo lectura).
+ */
+const latencia_histograma_t *latencia_histograma(latencia_etapa_t etapa);
+
+/**
+ * @brief Nombre corto de una etapa.
+ */
+const char *latencia_nombre(latencia_etapa_t etapa);
+
+/**
+ * @brief Límite inferior en microsegundos de una cubeta.
+ */
+uint32_t latencia_cubeta_valor(uint8_t cubeta);
+
+/**
+ * @brief Percentil de una etapa.
+ *
+ * @param etapa Etapa.
+ * @param milesimas Percentil en milésimas (500 = mediana, 990 = p99).
+ * @return Límite inferior de la cubeta que contiene el percentil, en microsegundos.
+ */
+uint32_t latencia_percentil(latencia_etapa_t etapa, uint16_t milesimas);
+
+/**
+ * @brief Borra todos los histogramas.
+ */
+void latencia_reiniciar(void);
+
+/**
+ * @brief Imprime por USB un resumen (n, mínimo, p50, p90, p99, máximo y media) de cada etapa.
+ */
+void latencia_volcar(void);
+
+#endif // LATENCIA_H
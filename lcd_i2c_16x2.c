@@ -21,6 +21,7 @@
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "pico/binary_info.h"
+#include "metricas.h"
 
 
 // commands
@@ -56,9 +57,14 @@ const int LCD_BACKLIGHT = 0x08;
 
 const int LCD_ENABLE_BIT = 0x04;
 
+#define LCD_I2C_HZ (100 * 1000)
+
 // By default these LCD display drivers are on bus address 0x27
 static int addr = 0x27;
 
+// Luz de fondo: se manda en cada byte, así que apagada vale 0 en vez de LCD_BACKLIGHT
+static uint8_t luz = 0x08;
+
 // Modes for lcd_send_byte
 #define LCD_CHARACTER  1
 #define LCD_COMMAND    0
@@ -69,7 +75,10 @@ static int addr = 0x27;
 /* Quick helper function for single byte transfers */
 void i2c_write_byte(uint8_t val) {
 #ifdef i2c_default
-    i2c_write_blocking(i2c_default, addr, &val, 1, false);
+    // Sin ACK del puente (cable suelto, ruido) el byte se pierde y la pantalla queda corrupta
+    if (i2c_write_blocking(i2c_default, addr, &val, 1, false) < 0) {
+        metricas_contar(MET_LCD_ERRORES_I2C);
+    }
 #endif
 }
 
@@ -86,8 +95,8 @@ void lcd_toggle_enable(uint8_t val) {
 
 // The display is sent a byte as two separate nibble transfers
 void lcd_send_byte(uint8_t val, int mode) {
-    uint8_t high = mode | (val & 0xF0) | LCD_BACKLIGHT;
-    uint8_t low = mode | ((val << 4) & 0xF0) | LCD_BACKLIGHT;
+    uint8_t high = mode | (val & 0xF0) | luz;
+    uint8_t low = mode | ((val << 4) & 0xF0) | luz;
 
     i2c_write_byte(high);
     lcd_toggle_enable(high);
@@ -105,10 +114,29 @@ void lcd_set_cursor(int line, int position) {
     lcd_send_byte(val, LCD_COMMAND);
 }
 
-static void inline lcd_char(char val) {
+void lcd_char(char val) {
     lcd_send_byte(val, LCD_CHARACTER);
 }
 
+// Cada carácter de CGRAM ocupa 8 bytes a partir de ranura * 8
+void lcd_cgram(uint8_t ranura, const uint8_t patron[8]) {
+    lcd_send_byte(LCD_SETCGRAMADDR | ((ranura & 0x07) << 3), LCD_COMMAND);
+    for (int i = 0; i < 8; i++) {
+        lcd_send_byte(patron[i] & 0x1F, LCD_CHARACTER);
+    }
+}
+
+void lcd_luz(bool encendida) {
+    luz = encendida ? LCD_BACKLIGHT : 0;
+    i2c_write_byte(luz);
+}
+
+void lcd_baudios(void) {
+#ifdef i2c_default
+    i2c_set_baudrate(i2c_default, LCD_I2C_HZ);
+#endif
+}
+
 void lcd_string(const char *s) {
     while (*s) {
         lcd_char(*s++);
@@ -135,7 +163,7 @@ void initVar(char message[32], bool linea) {
         const uint SDA_PIN = 0;
         const uint SCL_PIN = 1;
 
-        i2c_init(i2c_default, 100 * 1000);
+        i2c_init(i2c_default, LCD_I2C_HZ);
         gpio_set_function(SDA_PIN, GPIO_FUNC_I2C);
         gpio_set_function(SCL_PIN, GPIO_FUNC_I2C);
         gpio_pull_up(SDA_PIN);
@@ -145,13 +173,16 @@ void initVar(char message[32], bool linea) {
 
         lcd_init();
         lcd_clear();
+        // Después del fin de la cadena van espacios: un 0 mostraría el glifo de la ranura 0
+        bool fin = false;
         for (int n = 0; n < 32; n++) {
+            fin = fin || message[n] == '\0';
             if (n < 16) {
                 lcd_set_cursor(0, n);
-                lcd_char(message[n]);
+                lcd_char(fin ? ' ' : message[n]);
             } else {
                 lcd_set_cursor(1, n - 16);
-                lcd_char(message[n]);
+                lcd_char(fin ? ' ' : message[n]);
             }
         }
     #endif
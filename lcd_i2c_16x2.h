@@ -70,11 +70,36 @@ void lcd_set_cursor(int line, int position);
 /**
  * @brief Función para enviar un caracter al display LCD.
  *
- * Esta función envía un caracter al display LCD.
+ * Esta función envía un caracter al display LCD. Los códigos 0 a 7 muestran los glifos de CGRAM.
  *
  * @param val Caracter a enviar.
  */
-static void inline lcd_char(char val);
+void lcd_char(char val);
+
+/**
+ * @brief Función para cargar un glifo en la CGRAM del display LCD.
+ *
+ * Los caracteres en pantalla que usan la ranura cambian en cuanto se carga. Deja el contador de
+ * direcciones en CGRAM: hay que llamar a lcd_set_cursor antes de volver a escribir texto.
+ *
+ * @param ranura Ranura de CGRAM (0 a 7).
+ * @param patron Filas del glifo de arriba abajo, 5 bits cada una.
+ */
+void lcd_cgram(uint8_t ranura, const uint8_t patron[8]);
+
+/**
+ * @brief Función para encender o apagar la luz de fondo del display LCD.
+ *
+ * El contenido se conserva; los bytes siguientes mantienen el estado elegido.
+ *
+ * @param encendida Verdadero para encender la luz.
+ */
+void lcd_luz(bool encendida);
+
+/**
+ * @brief Función para reprogramar el divisor del I2C tras un cambio de clk_peri.
+ */
+void lcd_baudios(void);
 
 /**
  * @brief Función para enviar una cadena de caracteres al display LCD.
@@ -8,24 +8,39 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/timer.h"
 #include "hardware/pwm.h"
 #include "hardware/irq.h"
 #include "hardware/gpio.h"
 #include "hardware/sync.h"
+#include "hardware/clocks.h"
 #include "as608.h"
-#include "lcd_i2c_16x2.h"
+#include "pantalla.h"
 #include "cerradura.h"
-// Definiciones de UART
-#define UART_ID uart1
-#define BAUD_RATE 57600  // Asegúrate de usar la tasa de baudios correcta para el AS608
+#include "clave.h"
+#include "auditoria.h"
+#include "usuarios.h"
+#include "gestion.h"
+#include "latencia.h"
+#include "calidad.h"
+#include "registro.h"
+#include "anticipo.h"
+#include "compactacion.h"
+#include "biblioteca.h"
+#include "glifos.h"
+#include "reposo.h"
+#include "reloj.h"
+#include "perfilador.h"
+#include "interrupciones.h"
+#include "metricas.h"
+#include "ram.h"
 
-// Pines del UART
-#define UART_TX_PIN 8
-#define UART_RX_PIN 9
+as608_t lector;       ///< Lector de huellas de la puerta
+anticipo_t anticipo;  ///< Captura anticipada sobre el lector durante el ingreso (B)
 
-char mensaje[32] = "                                ";
+char mensaje[40] = "                                ";
 
 volatile bool Inicio=true;
 volatile bool opciones=true;
@@ -33,7 +48,8 @@ volatile bool EtapaLector=false;
 volatile uint8_t tarea=0;
 volatile uint8_t rep=0;
 volatile uint8_t mala=1;
-volatile uint8_t UbicacionLector=0;
+volatile uint16_t UsuarioActual=0; ///< Número del usuario seleccionado
+volatile uint16_t UsuarioHasta=0;  ///< Último usuario de un borrado por rango (C)
 
 typedef union {
     uint8_t W;
@@ -46,28 +62,23 @@ typedef union {
 
 volatile myFlags_t gFlags; ///< Flags globales para control de eventos
 
-uint8_t vecPSWD[] = {
-    0x4, 0x3, 0x2, 0x1,   // User 1 con contraseña 1234
-    0x1, 0x2, 0x3, 0x4,   // User 2 con contraseña 4321
-    0x0, 0x0, 0x0, 0x0,   // User 3 con contraseña 0000
-    0x1, 0x1, 0x1, 0x1,   // User 4 con contraseña 1111
-    0x2, 0x2, 0x2, 0x2,   // User 5 con contraseña 2222
-    0x3, 0x3, 0x3, 0x3,   // User 6 con contraseña 3333
-    0x4, 0x4, 0x4, 0x4,   // User 7 con contraseña 4444
-    0x5, 0x5, 0x5, 0x5,   // User 8 con contraseña 5555
-    0x6, 0x6, 0x6, 0x6    // User 9 con contraseña 6666
-};
-
 uint8_t vecIDs[4] = {0x0A, 0x0B, 0x0C, 0x0D}; ///< Vectores de comandos permitidos
 
 uint8_t hKeys[1] = {0xFF}; ///< Historial de teclas ingresadas en el teclado
 
-uint8_t IDlector[10] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09}; ///< IDs válidos para el lector
+uint16_t IdIngresado = 0; ///< Número de usuario que se está tecleando
+uint16_t IdDesde = 0;     ///< Primer usuario de un rango en el borrado (C), 0 si no hay rango
+
+#define TECLA_BORRAR    0x0E ///< '*': borra el número de usuario tecleado
+#define TECLA_CONFIRMAR 0x0F ///< '#': confirma el número de usuario
+#define TECLA_RANGO     0x0A ///< 'A' en el borrado: el número tecleado es el primero de un rango
 
-uint8_t InPasswords[4] = {0xFF, 0xFF, 0xFF, 0xFF}; ///< Contraseña ingresada por el usuario
+uint8_t InPasswords[CLAVE_LONGITUD] = {0xFF, 0xFF, 0xFF, 0xFF}; ///< Contraseña ingresada por el usuario
 
 volatile uint8_t key_cnt = 0; ///< Contador de veces que se ha presionado un teclado
 
+#define PIT_TICK_KHZ 1000 ///< Cuenta de los PIT: 1 MHz con clk_sys entre 48 y 200 MHz (divisor < 256)
+
 volatile uint8_t gSeqCnt = 0; ///< Contador de secuencia
 volatile bool gDZero = false; ///< Debouncer del teclado
 
@@ -92,17 +103,15 @@ void insertKey(uint8_t key) {
 /**
  * @brief Inserta una tecla en el historial de contraseñas ingresadas por el usuario.
  * 
+ * Los dígitos se guardan en el orden en que se teclean y no se imprimen.
+ * 
  * @param key Tecla a insertar como parte de la contraseña
+ * @param pos Posición del dígito dentro de la contraseña
  */
-void insertPswd(uint8_t key) {
-    for (int i = 2; i >= 0; i--) {
-        InPasswords[i + 1] = InPasswords[i];
+void insertPswd(uint8_t key, uint8_t pos) {
+    if (pos < CLAVE_LONGITUD) {
+        InPasswords[pos] = key;
     }
-    InPasswords[0] = key;
-    printf("Key[0]: %x\n", InPasswords[0]);
-    printf("Key[1]: %x\n", InPasswords[1]);
-    printf("Key[2]: %x\n", InPasswords[2]);
-    printf("Key[3]: %x\n", InPasswords[3]);
 }
 
 /**
@@ -113,6 +122,8 @@ void insertPswd(uint8_t key) {
  */
 uint8_t keyDecode(uint32_t keyc) {
     uint8_t keyd = 0xFF;
+    uint32_t ciclos = perfilador_entrar();
+    latencia_cerrar(LAT_TECLA_DECODIFICAR);
     switch (keyc) {
         case 0x88:
             keyd = 0x01;
@@ -163,6 +174,8 @@ uint8_t keyDecode(uint32_t keyc) {
             keyd = 0x0D;
             break;
     }
+    metricas_contar(keyd == 0xFF ? MET_TECLAS_INVALIDAS : MET_TECLAS);
+    perfilador_salir(PERF_TECLA, ciclos);
     return keyd;
 }
 
@@ -186,60 +199,70 @@ int8_t checkID(uint8_t *vecID, uint8_t *ID) {
 }
 
 /**
- * @brief Verifica el ID del lector de huella ingresado con los IDs válidos del lector.
+ * @brief Busca el número de usuario ingresado en el directorio de usuarios.
  * 
- * @param IDlector Vector de IDs válidos del lector
- * @param ID ID del lector ingresado para verificar
- * @return int8_t Índice del ID válido encontrado, o -1 si no se encontró.
+ * @param id Número de usuario ingresado
+ * @return const usuario_t* Registro del usuario, o NULL si no existe.
  */
-int8_t checkIDlector(uint8_t *IDlector, uint8_t *ID) {
-    for (int i = 0; i < 8; i++) {
-        printf("ID Valido[%d]: %x\n", i, IDlector[i]);
-        printf("Tecla ingresada: %x\n", ID[0]);
-
-        if (IDlector[i] == ID[0]) {
-            return i + 1;
-        }
-    }
-    return -1;
+const usuario_t *checkIDlector(uint16_t id) {
+    printf("Usuario ingresado: %u\n", id);
+    return usuarios_buscar(id);
 }
 
 /**
  * @brief Verifica la contraseña ingresada con las contraseñas almacenadas.
  * 
- * @param vecPSWD Vector de contraseñas almacenadas
+ * Calcula el hash con sal de la contraseña ingresada y lo compara en tiempo constante
+ * con el registro del usuario en la tabla de usuarios.
+ * 
  * @param PSWD Contraseña ingresada para verificar
- * @param i Posición de la contraseña a usar
- * @return int8_t Índice de la contraseña válida encontrada, o -1 si no se encontró.
+ * @param id Número del usuario
+ * @return int8_t 0 si la contraseña es correcta, o -1 si no.
  */
-int8_t checkPSW2(uint8_t *vecPSWD, uint8_t *PSWD, uint8_t i) {
-    bool flag = true;
-    for (int j = 0; j < 4; j++) {
-        printf("%X,%X\n", vecPSWD[4 * i + j], PSWD[j]);
-
-        if (vecPSWD[4 * i + j] != PSWD[j]) {
-            flag = false;
-            break;
-        }
+int8_t checkPSW2(const uint8_t *PSWD, uint16_t id) {
+    const usuario_t *usuario = usuarios_buscar(id);
+    if (usuario == NULL) {
+        return -1;
     }
-    if (flag == true){
-        return i;
+    reloj_impulsar();
+    bool correcta = clave_verificar(&usuario->clave, PSWD);
+    reloj_soltar();
+    if (correcta) {
+        return 0;
     }
     else{
         return -1;
-    }       
-    
+    }
 }
 
 /**
- * @brief Callback del teclado matricial
+ * @brief Callback del teclado matricial (único callback GPIO; también recibe la línea de toque del AS608)
  * 
  * @param num Número del GPIO
  * @param mask Máscara del GPIO
  */
-void keyboardCallback(uint8_t num, uint32_t mask) {
+void EN_RAM(keyboardCallback)(uint num, uint32_t mask) {
+    uint32_t entrada = interrupciones_entrar(IRQ_GPIO, INTERRUPCIONES_SIN_LATENCIA);
+    if ((int)num == lector.config.toque) {
+        as608_touch_irq(&lector, mask);
+        reposo_despertar();
+        gpio_acknowledge_irq(num, mask);
+        interrupciones_salir(IRQ_GPIO, entrada);
+        return;
+    }
+    metricas_contar(MET_TECLADO_FLANCOS);
+    if (reposo_dormido()) {
+        // Con todas las filas activas no se sabe qué tecla fue: solo despierta. Si sigue
+        // presionada, la secuencia de filas la registra en cuanto se reanuda.
+        reposo_despertar();
+        gpio_acknowledge_irq(num, mask);
+        interrupciones_salir(IRQ_GPIO, entrada);
+        return;
+    }
     gKeyCap = gpio_get_all();
     gFlags.B.keyFlag = true;
+    latencia_abrir(LAT_TECLA_DECODIFICAR);
+    latencia_abrir(LAT_TECLA_PANTALLA);
     pwm_set_enabled(0, false);   ///< Congela la secuencia de filas
     pwm_set_enabled(1, true);    ///< Activa la secuencia de columnas
     gpio_set_irq_enabled(14, GPIO_IRQ_EDGE_RISE, false);  
@@ -247,26 +270,150 @@ void keyboardCallback(uint8_t num, uint32_t mask) {
     gpio_set_irq_enabled(16, GPIO_IRQ_EDGE_RISE, false);  
     gpio_set_irq_enabled(17, GPIO_IRQ_EDGE_RISE, false);
     gpio_acknowledge_irq(num, mask);   ///< Reconoce la interrupción del GPIO
+    interrupciones_salir(IRQ_GPIO, entrada);
 }
 
 /**
  * @brief Manejador de interrupciones de PWM
+ *
+ * Atiende cada rebanada pendiente por separado: si las dos vencen juntas no queda ninguna sin
+ * reconocer. Una rebanada ajena se reconoce y se cuenta, sin imprimir desde la interrupción.
  */
-void pwmIRQ(void) {
-    switch (pwm_get_irq_status_mask()) {
-        case 0x01UL:    ///< PWM slice 0 ISR utilizado como PIT para generar secuencia de filas
-            gSeqCnt = (gSeqCnt + 1) % 4;
-            gpio_put_masked(0x00003C00, 0x00000001 << (gSeqCnt + 10));
-            pwm_clear_irq(0);   ///< Reconoce la interrupción del PWM en la rebanada 0
-            break;
-        case 0x02UL:    ///< PWM slice 1 ISR utilizado como PIT para implementar el debounce
-            gFlags.B.keyDbnc = true;
-            pwm_clear_irq(1);   ///< Reconoce la interrupción del PWM en la rebanada 1
-            break;
-        default:
-            printf("Ocurrió algo inesperado en la IRQ de PWM\n");
-            break;
+void EN_RAM(pwmIRQ)(void) {
+    uint32_t estado = pwm_get_irq_status_mask();
+    // En modo de fase correcta el contador sube desde 0 tras el vencimiento: son los tics (1 us)
+    // entre el vencimiento y la entrada a la rutina
+    uint32_t retardo = (estado & 0x01UL) ? pwm_get_counter(0) * 1000u / PIT_TICK_KHZ : INTERRUPCIONES_SIN_LATENCIA;
+    uint32_t entrada = interrupciones_entrar(IRQ_PWM, retardo);
+
+    if (estado & 0x01UL) {  ///< PWM slice 0 ISR utilizado como PIT para generar secuencia de filas
+        latencia_registrar(LAT_ISR_PIT, retardo);
+        gSeqCnt = (gSeqCnt + 1) % 4;
+        gpio_put_masked(0x00003C00, 0x00000001 << (gSeqCnt + 10));
+        pwm_clear_irq(0);   ///< Reconoce la interrupción del PWM en la rebanada 0
+    }
+    if (estado & 0x02UL) {  ///< PWM slice 1 ISR utilizado como PIT para implementar el debounce
+        gFlags.B.keyDbnc = true;
+        pwm_clear_irq(1);   ///< Reconoce la interrupción del PWM en la rebanada 1
+    }
+    if (estado & ~0x03UL) {
+        for (uint slice = 2; slice < 8; slice++) {
+            if (estado & (1u << slice)) {
+                pwm_clear_irq(slice);
+            }
+        }
+        interrupciones_inesperada(IRQ_PWM);
+    }
+    interrupciones_salir(IRQ_PWM, entrada);
+}
+
+/**
+ * @brief Captura una imagen en el lector y, si se compila con CALIDAD_PREVIA, la evalúa antes de
+ * extraer rasgos.
+ *
+ * La evaluación sube la imagen por UpImage (unos 6,6 s a 57600 baudios, menos con paquetes de
+ * 256 bytes y más baudios) y la procesa mientras llega, así que es opcional.
+ *
+ * @param veredicto Diagnóstico de la captura (CALIDAD_OK si no se evalúa).
+ * @return uint8_t Código de GenImg, o CALIDAD_RECHAZADA si la imagen no sirve.
+ */
+#ifdef CALIDAD_PREVIA
+static glifos_barra_t barra_imagen; ///< Avance de UpImage en la línea inferior
+
+/**
+ * @brief Evalúa un bloque de la imagen y avanza la barra del LCD.
+ *
+ * La barra solo reescribe la celda que cambió, así que cada paquete cuesta a lo sumo un carácter
+ * por I2C.
+ */
+static void bloqueImagen(const uint8_t *pixeles, size_t n, uint32_t desplazamiento, void *ctx) {
+    calidad_bloque(pixeles, n, desplazamiento, ctx);
+    glifos_barra(&barra_imagen, desplazamiento + n, AS608_IMAGEN_ANCHO * AS608_IMAGEN_ALTO);
+}
+#endif
+
+uint8_t capturarHuella(calidad_veredicto_t *veredicto) {
+    uint8_t codigo = as608_get_image(&lector);
+    *veredicto = CALIDAD_OK;
+#ifdef CALIDAD_PREVIA
+    if (codigo == AS608_OK) {
+        static calidad_t evaluacion;
+        calidad_resultado_t resultado;
+        calidad_iniciar(&evaluacion);
+        strcpy(mensaje, "Analizando      huella");
+        pantalla_texto(mensaje);
+        glifos_barra_iniciar(&barra_imagen, 1, 0, 16);
+        // La evaluación corre con cada paquete de UpImage; clk_peri no cambia con el impulso
+        reloj_impulsar();
+        uint8_t subida = as608_upload_image(&lector, bloqueImagen, &evaluacion, NULL);
+        if (subida == AS608_OK) {
+            calidad_resultado(&evaluacion, &resultado);
+        }
+        reloj_soltar();
+        if (subida == AS608_OK) {
+            printf("Calidad: contraste %u, cobertura %u, coherencia %u, centro (%d, %d)\n",
+                   resultado.contraste, resultado.cobertura, resultado.coherencia,
+                   resultado.centro_x, resultado.centro_y);
+            *veredicto = resultado.veredicto;
+            if (resultado.veredicto != CALIDAD_OK) {
+                codigo = CALIDAD_RECHAZADA;
+            }
+        }
+    }
+#endif
+    return codigo;
+}
+
+/**
+ * @brief Muestra la indicación de una captura rechazada y espera a que se retire el dedo. No cuenta
+ * como intento fallido.
+ *
+ * @param veredicto Diagnóstico de la captura.
+ */
+void avisarCalidad(calidad_veredicto_t veredicto) {
+    printf("Captura rechazada por calidad\n");
+    strcpy(mensaje, calidad_mensaje(veredicto));
+    pantalla_texto(mensaje);
+    as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
+}
+
+/**
+ * @brief Espera el dedo y lo busca en la base de datos del lector.
+ *
+ * @param idHuella Posición de la huella encontrada.
+ * @param puntaje Puntaje de coincidencia.
+ * @param veredicto Diagnóstico de la captura (solo con CALIDAD_PREVIA).
+ * @return uint8_t Código de la captura, extracción o búsqueda, o CALIDAD_RECHAZADA.
+ */
+uint8_t verificarHuella(uint16_t *idHuella, uint16_t *puntaje, calidad_veredicto_t *veredicto) {
+    as608_wait_touch(&lector, AS608_TOQUE_ESPERA_MS);
+    printf("Capturando imagen...\n");
+    latencia_abrir(LAT_DEDO_RELE);
+#ifdef CALIDAD_PREVIA
+    // La imagen se evalúa antes de extraer rasgos, así que no se usa Identify
+    uint8_t codigo = capturarHuella(veredicto);
+    if (codigo == AS608_OK) {
+        codigo = as608_image_to_template(&lector, 1);
+    }
+    if (codigo == AS608_OK) {
+        codigo = as608_search(&lector, idHuella, puntaje);
     }
+    return codigo;
+#else
+    *veredicto = CALIDAD_OK;
+    // Captura, extracción y búsqueda: un solo comando si el módulo soporta Identify
+    return as608_identify(&lector, idHuella, puntaje);
+#endif
+}
+
+/**
+ * @brief Muestra un texto en el LCD (indicaciones del registro de huellas).
+ *
+ * @param texto Hasta 32 caracteres.
+ */
+void avisarLCD(const char *texto) {
+    strcpy(mensaje, texto);
+    pantalla_texto(mensaje);
 }
 
 /**
@@ -277,11 +424,11 @@ void pwmIRQ(void) {
  * @param enable Habilita el PWM
  */
 void initPWMasPIT(uint8_t slice, uint16_t milis, bool enable) {
-    assert(milis <= 262);   ///< El PWM puede manejar períodos de interrupción mayores a 262 milisegundos
-    float prescaler = (float)SYS_CLK_KHZ / 500;
-    assert(prescaler < 256); ///< La parte entera del divisor de reloj puede ser mayor que 255 
-    uint32_t wrap = 500000 * milis / 2000;
-    assert(wrap < ((1UL << 17) - 1));
+    assert(milis <= 131);   ///< Con la cuenta a 1 MHz el wrap de 16 bits alcanza para 131 milisegundos
+    float prescaler = (float)clock_get_hz(clk_sys) / (PIT_TICK_KHZ * 1000);
+    assert(prescaler < 256); ///< La parte entera del divisor de reloj no puede ser mayor que 255
+    uint32_t wrap = PIT_TICK_KHZ * milis / 2;
+    assert(wrap < (1UL << 16));
     pwm_config cfg = pwm_get_default_config();
     pwm_config_set_phase_correct(&cfg, true);
     pwm_config_set_clkdiv(&cfg, prescaler);
@@ -292,6 +439,17 @@ void initPWMasPIT(uint8_t slice, uint16_t milis, bool enable) {
     pwm_init(slice, &cfg, enable);
 }
 
+/**
+ * @brief Reprograma el divisor de los PIT tras un cambio de clk_sys, para que la secuencia de
+ * filas y el antirrebote mantengan su periodo.
+ */
+void ajustarPIT(void *ctx) {
+    (void)ctx;
+    float prescaler = (float)clock_get_hz(clk_sys) / (PIT_TICK_KHZ * 1000);
+    pwm_set_clkdiv(0, prescaler);
+    pwm_set_clkdiv(1, prescaler);
+}
+
 /**
  * @brief Inicializa el teclado matricial 4x4 utilizando GPIOs 2 a 9
  */
@@ -318,6 +476,25 @@ void initMatrixKeyboard4x4(void) {
     gpio_set_irq_enabled_with_callback(17, GPIO_IRQ_EDGE_RISE, true, keyboardCallback);
 }
 
+/**
+ * @brief Prepara el teclado para el reposo o lo restituye al despertar.
+ *
+ * En reposo no hay secuencia de filas: las cuatro quedan activas para que cualquier tecla suba
+ * su columna y despierte por flanco.
+ *
+ * @param reposo Verdadero al entrar en reposo, falso al salir.
+ */
+void tecladoReposo(bool reposo) {
+    if (reposo) {
+        pwm_set_enabled(0, false);
+        pwm_set_enabled(1, false);
+        gpio_put_masked(0x00003C00, 0x00003C00);
+    } else {
+        gpio_put_masked(0x00003C00, 0);
+        pwm_set_enabled(0, true);
+    }
+}
+
 /**
  * @brief Programa principal.
  * En el ciclo principal se desarrolla toda la implementación de la Caja Fuerte +.
@@ -326,8 +503,32 @@ void initMatrixKeyboard4x4(void) {
  * de interrupciones y se hizo en este mismo archivo.
  */
 int main() {
-    as608_init();
+    as608_config_t config_lector = AS608_CONFIG_PUERTA;
+    stdio_init_all();
+    perfilador_init();
+    as608_init(&lector, &config_lector);
+    sleep_ms(5000);  // Arranque del módulo tras encender la placa (una vez para todos los lectores)
+    anticipo_init(&anticipo, &lector);
+    as608_probe_identify(&lector);
+    // La longitud de paquete de datos se guarda en el módulo; el driver la necesita para DownChar
+    as608_sistema_t sistema;
+    if (as608_read_sys_params(&lector, &sistema) == AS608_OK) {
+        printf("AS608: %u posiciones, paquetes de %u bytes, %lu baudios\n", sistema.capacidad,
+               sistema.tam_paquete, (unsigned long)sistema.baudios);
+    }
+    as608_sleep(&lector);
     rele_init();
+    auditoria_init();
+    usuarios_init();
+    // Una compactación cortada por falta de alimentación se termina antes de usar el lector
+    compactacion_reanudar(&lector);
+    gestion_init(&lector);
+    pantalla_init();
+#ifdef CLAVE_BENCHMARK
+    reloj_impulsar();
+    clave_benchmark(CLAVE_BENCHMARK);
+    reloj_soltar();
+#endif
     //sleep_ms(1000);
     printf("COMIENZOOOOOOOOOOOOO");
     printf("\n");
@@ -335,29 +536,44 @@ int main() {
     uint8_t sync_byte = 0xAA;
     uint8_t RXbuye[1];
     // Enviar comando de sincronización al módulo AS608
-    uart_putc(UART_ID, sync_byte);
+    uart_putc(lector.config.uart, sync_byte);
     // Enviar comando al módulo AS608
     printf("Enviando comando: ");
     for (size_t i = 0; i < sizeof(sync_byte); i++) {
         printf("%02X ", sync_byte);
     }
     printf("\n");
-    if (uart_is_readable(UART_ID)) {
-        RXbuye[0] = uart_getc(UART_ID);
+    if (uart_is_readable(lector.config.uart)) {
+        RXbuye[0] = uart_getc(lector.config.uart);
     }
     printf("Respuesta recibida: ");
     printf("%02X ", RXbuye[0]);
     printf("\n");
     //lcd_clear();
     strcpy(mensaje, "A:Reg B:Ing   C:Borr D:Vac");
-    initVar(mensaje,true);
+    pantalla_texto(mensaje);
     initPWMasPIT(0,2,true);
     initPWMasPIT(1,100,false);
     irq_set_exclusive_handler(PWM_IRQ_WRAP,pwmIRQ);
-    irq_set_priority(PWM_IRQ_WRAP, 0xC0);
     initMatrixKeyboard4x4();
+    interrupciones_init(lector.config.baudios);  ///< Mapa de prioridades (interrupciones.h)
+    // Desde aquí el gobernador baja el reloj mientras se espera y lo sube para el cálculo
+    reloj_registrar(ajustarPIT, NULL);
+    reloj_init();
+    reloj_base(RELOJ_BAJO);
+    uint32_t despertar = 0x0003C000;    ///< Columnas del teclado
+    if (lector.config.toque >= 0) {
+        despertar |= 1u << lector.config.toque;
+    }
+    reposo_init(despertar);
     // Inicia el Bucle infinito de funcionamiento de la Caja fuerte
     while(1){
+        // Teclas en curso, etapa del lector o captura anticipada armada cuentan como actividad
+        bool actividad = gFlags.W || EtapaLector;
+#ifdef CAPTURA_ANTICIPADA
+        anticipo_avanzar(&anticipo);
+        actividad = actividad || anticipo_estado(&anticipo) != ANTICIPO_INACTIVO;
+#endif
         // Funcionamiento del teclado matricial
         while(gFlags.W && !EtapaLector){
             if(gFlags.B.keyFlag){
@@ -366,29 +582,29 @@ int main() {
                
                     uint32_t KeyData = (gKeyCap>>10) & 0x000000FF;
                     uint8_t keyd = keyDecode(KeyData);
-                    printf("%X,%X\n",KeyData,keyd);
                     if(keyd!=0xFF){
-                        insertPswd(keyd);
+                        insertPswd(keyd,key_cnt);
                     }
                     key_cnt++;
-                    if(key_cnt==4){
+                    if(key_cnt==CLAVE_LONGITUD){
                         // Implementa la función diseñada y compara la contraseña ingresada con la de
                         // la base de datos.
-                        int8_t idxPW = checkPSW2(vecPSWD,&InPasswords[0],UbicacionLector-1);
-                        printf("Key[0]: %x\n",InPasswords[0]);
-                        printf("Key[1]: %x\n",InPasswords[1]);
-                        printf("Key[2]: %x\n",InPasswords[2]);
-                        printf("Key[3]: %x\n",InPasswords[3]);
+                        int8_t idxPW = checkPSW2(&InPasswords[0],UsuarioActual);
+                        memset(InPasswords,0xFF,sizeof(InPasswords));
+                        auditoria_registrar(UsuarioActual, AUD_METODO_PIN,
+                                            idxPW==-1 ? AUD_RESULTADO_FALLO : AUD_RESULTADO_OK, 0, 0);
                         if(idxPW==-1){
+                            metricas_contar(MET_PIN_RECHAZADOS);
                             printf("Contrasena incorrecta %x\n");
                             strcpy(mensaje, "ERROR: Intente de Nuevo");
-                            initVar(mensaje,true);
+                            pantalla_texto(mensaje);
+                            auditoria_flush();
                         }
                         else {
                         
                             printf("Acceso consedido: %x\n");
                             strcpy(mensaje, "CONTRASENA CORRECTA  ");
-                            initVar(mensaje,true);
+                            pantalla_texto(mensaje);
                             sleep_ms(2500);
                             PasswordAcept = true;
                             EtapaLector=true;
@@ -396,43 +612,102 @@ int main() {
                         key_cnt=0; 
                         }
                 }
-                // Aqui es la parte donde se escribe el ID en el que se desea registrar, ingresar o borrar
+                // Aqui es la parte donde se escribe el número de usuario a registrar, ingresar o borrar:
+                // hasta USUARIOS_ID_DIGITOS dígitos, '*' borra y '#' confirma
                 if(opciones && !Inicio ){
                 
                     uint32_t KeyData = (gKeyCap>>10) & 0x000000FF;
                     uint8_t keyd = keyDecode(KeyData);
                     printf("%X,%X\n",KeyData,keyd);
-                    if(keyd!=0xFF){
-                        insertKey(keyd);
+                    if(keyd<=9 && key_cnt<USUARIOS_ID_DIGITOS){
+                        IdIngresado = IdIngresado*10 + keyd;
+                        key_cnt++;
+                        if(IdDesde){
+                            sprintf(mensaje, "De %-4u a %-6u* borra # sigue", IdDesde, IdIngresado);
+                        }
+                        else{
+                            sprintf(mensaje, "Usuario #: %-5u* borra # sigue", IdIngresado);
+                        }
+                        pantalla_texto(mensaje);
                     }
-                    key_cnt++;
-                    if(key_cnt==1){
-                        int8_t idxID = checkIDlector(IDlector,&hKeys[0]);
-                        if (idxID == 1 || idxID == 2 || idxID == 3 || idxID == 4 || idxID == 5 || idxID == 6 || idxID == 7 || idxID == 8 || idxID == 9){
-                            strcpy(mensaje, ("Seleccionaste Usuario # : %x\n",hKeys[0]));
-                            initVar(mensaje,true);
-                            printf("Seleccionaste Huella : %x\n",hKeys[0]);
+                    else if(keyd==TECLA_BORRAR){
+                        IdIngresado=0;
+                        IdDesde=0;
+                        key_cnt=0;
+                        strcpy(mensaje, "Usuario #:      * borra # sigue");
+                        pantalla_texto(mensaje);
+                    }
+                    else if(keyd==TECLA_RANGO && tarea==3 && key_cnt>0 && !IdDesde){
+                        // Borrado de un bloque de usuarios: se teclea el primero, 'A' y el último
+                        IdDesde=IdIngresado;
+                        IdIngresado=0;
+                        key_cnt=0;
+                        sprintf(mensaje, "De %-4u a       * borra # sigue", IdDesde);
+                        pantalla_texto(mensaje);
+                    }
+                    else if(keyd==TECLA_CONFIRMAR && key_cnt>0 && IdDesde){
+                        if (IdIngresado < IdDesde){
+                            printf("Rango invalido %u-%u\n", IdDesde, IdIngresado);
+                            strcpy(mensaje, "Rango invalido. * borra");
+                            pantalla_texto(mensaje);
+                        }
+                        else {
+                            sprintf(mensaje, "Seleccionaste   %u a %u", IdDesde, IdIngresado);
+                            pantalla_texto(mensaje);
+                            printf("Seleccionaste usuarios %u a %u\n", IdDesde, IdIngresado);
                             sleep_ms(2500);
                             opciones=false;
-                            UbicacionLector=idxID;  
+                            UsuarioActual=IdDesde;
+                            UsuarioHasta=IdIngresado;
+                            EtapaLector=true;
+                            IdDesde=0;
+                        }
+                        IdIngresado=0;
+                        key_cnt=0;
+                    }
+                    else if(keyd==TECLA_CONFIRMAR && key_cnt>0){
+                        const usuario_t *usuario = checkIDlector(IdIngresado);
+                        if (usuario == NULL){
+                            printf("No existe el usuario %u, vuelve a hacerlo\n", IdIngresado);
+                            sprintf(mensaje, "Usuario %-5u   no existe.", IdIngresado);
+                            pantalla_texto(mensaje);
+                        }
+                        else if (tarea==1 && (usuario->dedos>=USUARIOS_DEDOS_MAX ||
+                                              usuarios_posicion_libre()==USUARIOS_SIN_POSICION)){
+                            printf("Usuario %u sin lugar para otra huella\n", IdIngresado);
+                            strcpy(mensaje, "Sin lugar para  otra huella.");
+                            pantalla_texto(mensaje);
+                        }
+                        else {
+                            sprintf(mensaje, "Seleccionaste   Usuario # : %u", IdIngresado);
+                            pantalla_texto(mensaje);
+                            printf("Seleccionaste Usuario : %u\n",IdIngresado);
+                            sleep_ms(2500);
+                            opciones=false;
+                            UsuarioActual=IdIngresado;
+                            UsuarioHasta=IdIngresado;
                             if(tarea==2){
+                                // La búsqueda solo recorre hasta la última posición con dueño
+                                as608_set_search_count(&lector, usuarios_limite());
+#ifdef CAPTURA_ANTICIPADA
+                                // El sensor empieza a capturar mientras se escribe la contraseña
+                                anticipo_armar(&anticipo);
+#endif
                                 printf("Escribe la contraseña\n");
                                 strcpy(mensaje, "ESCRIBA SU    CONTRASENA");
-                                initVar(mensaje,true);
+                                pantalla_texto(mensaje);
                             }
                             else{
                                 EtapaLector=true;
                                 printf("VAS AL LECTOR\n");
                                 strcpy(mensaje, "PASAS A LECTURA DE HUELLA");
-                                initVar(mensaje,true);
+                                pantalla_texto(mensaje);
                                 sleep_ms(2500);
                             }
                         }
-                        else{
-                            printf("No Seleccionas huella valida, vuelve a hacerlo\n"); 
-                        }
+                        IdIngresado=0;
                         key_cnt=0;
-                        }
+                    }
                 }
                 // Primera parte del código, donde seleccionada en el teclado el modo de operación
                 if(Inicio ){
@@ -452,17 +727,17 @@ int main() {
                             Inicio=false;
                             tarea=1;
                             //lcd_clear();
-                            strcpy(mensaje, "Reg: ID huella 1-9");
-                            initVar(mensaje,true);
-                            printf("Selecciona una Huella 1-9");
+                            strcpy(mensaje, "Reg: Indique    Usuario y #");
+                            pantalla_texto(mensaje);
+                            printf("Selecciona un usuario");
                         }
                         else if(idxID==1){
                             printf("Oprimiste B Escribe la contraseña %x\n",hKeys[0]);
                             Inicio=false;
                             //opciones=false;
                             tarea=2;
-                            strcpy(mensaje, "Ing: Indique     # Usuario ");
-                            initVar(mensaje,true);
+                            strcpy(mensaje, "Ing: Indique    Usuario y #");
+                            pantalla_texto(mensaje);
                             
                             
                         }
@@ -470,9 +745,9 @@ int main() {
                             printf("Oprimiste C BORRA UNA HUELLA %x\n",hKeys[0]);
                             Inicio=false; 
                             tarea=3;
-                            strcpy(mensaje, "Borr: Indique Borrar 1-9");
-                            initVar(mensaje,true);
-                            printf("Selecciona una Huella 1-9");
+                            strcpy(mensaje, "Borr: Usuario y #  A: hasta otro");
+                            pantalla_texto(mensaje);
+                            printf("Selecciona un usuario");
                         }
                         else if(idxID==3){
                             printf("Oprimiste D, BORRADO BASE DE DATOS %x\n",hKeys[0]);
@@ -481,17 +756,17 @@ int main() {
                             tarea=4;
                             EtapaLector=true;
                             strcpy(mensaje, "Vac: Vaciar Base de datos");
-                            initVar(mensaje,true);
+                            pantalla_texto(mensaje);
                             
                         }
                         else {
                         
                             printf("No presionaste una tecla valida\n"); 
                             strcpy(mensaje, "ERROR: TECLA INVALIDA REPEAT");
-                            initVar(mensaje,true);
+                            pantalla_texto(mensaje);
                             sleep_ms(2000);
                             strcpy(mensaje, "A:Reg B:Ing   C:Borr D:Vac");
-                            initVar(mensaje,true);
+                            pantalla_texto(mensaje);
                         }
                         key_cnt=0;
                     }
@@ -528,50 +803,87 @@ int main() {
             printf("Entrooooooooooooooooooooo\n");
             // Parte donde se registra una nueva huella en la memoria del lector
             if (tarea==1){
+                latencia_abrir(LAT_REGISTRO);
+                // La huella nueva va a la primera posición del lector sin dueño
+                uint16_t posicion = usuarios_posicion_libre();
+#ifdef REGISTRO_CAPTURAS
+                // Se toman REGISTRO_CAPTURAS capturas y se combina el par que mejor coincide
+                registro_resultado_t registro;
+                uint8_t codigo = registro_mejor_de(&lector, posicion, REGISTRO_CAPTURAS, REGISTRO_VERIFICAR,
+                                                   avisarLCD, &registro);
+                if (codigo == AS608_OK) {
+                    printf("Modelo almacenado (par %u-%u de %u capturas, puntaje %u).\n", registro.par[0] + 1,
+                           registro.par[1] + 1, registro.capturas, registro.puntaje_par);
+                    latencia_cerrar(LAT_REGISTRO);
+                    usuarios_agregar_dedo(UsuarioActual, posicion);
+                    usuarios_guardar();
+                    auditoria_registrar(UsuarioActual, AUD_METODO_REGISTRO, AUD_RESULTADO_OK, codigo,
+                                        registro.puntaje_par);
+                    strcpy(mensaje, "Huella Guardada. Quite el dedo.");
+                    pantalla_texto(mensaje);
+                    glifos_dibujar(1, 15, GLIFO_VISTO);
+                    sleep_ms(4000);
+                    mala=0;
+                } else {
+                    printf("Error en el registro (0x%02X).\n", codigo);
+                    auditoria_registrar(UsuarioActual, AUD_METODO_REGISTRO, AUD_RESULTADO_FALLO, codigo,
+                                        registro.puntaje_par);
+                }
+                rep=3;
+#else
                 strcpy(mensaje, "Ponga la huella de su dedo.");
-                initVar(mensaje,true);
-                // Esperar un poco antes de enviar el siguiente comando
-                sleep_ms(2500);
+                pantalla_texto(mensaje);
+                glifos_dibujar(1, 15, GLIFO_HUELLA);
                 // Se establece un limite de 3 intentos para registro de huella, sino no la guarda
 
                 while(rep!= 3){      
+                    // La captura empieza en cuanto el dedo queda apoyado (línea de toque del sensor)
+                    as608_wait_touch(&lector, AS608_TOQUE_ESPERA_MS);
                     printf("Capturando imagen\n");
-                    
-                    if (as608_get_image() == 0) {
+                    calidad_veredicto_t veredicto;
+                    uint8_t captura = capturarHuella(&veredicto);
+                    if (captura == 0) {
                         printf("Imagen capturada\n");
 
                         printf("Convirtiendo imagen a plantilla\n");
-                        if (as608_image_to_template(1) == 0) {
+                        if (as608_image_to_template(&lector, 1) == 0) {
                             printf("Imagen convertida a plantilla\n");
                             
                             printf("Retire y vuelva a poner la huella de nuevo\n");
                             strcpy(mensaje, "Retire y vuelvala a poner.");
-                            initVar(mensaje,true);
-                            sleep_ms(2500);
-                            if (as608_get_image() == 0) {
+                            pantalla_texto(mensaje);
+                            as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
+                            as608_wait_touch(&lector, AS608_TOQUE_ESPERA_MS);
+                            captura = capturarHuella(&veredicto);
+                            if (captura == 0) {
                                 printf("Imagen capturada\n");
 
                                 printf("Convirtiendo imagen a plantilla\n");
-                                if (as608_image_to_template(2) == 0) {
+                                if (as608_image_to_template(&lector, 2) == 0) {
                                     printf("Imagen convertida a plantilla\n");
 
                                     printf("Creando modelo...\n");
-                                    if (as608_create_model() == 0) {
+                                    if (as608_create_model(&lector) == 0) {
                                         printf("Modelo creado.\n");
 
                                         printf("Almacenando modelo...\n");
-                                        if (as608_store_model(UbicacionLector) == 0) {
+                                        if (as608_store_model(&lector, posicion) == 0) {
                                             printf("Modelo almacenado, ya puede retirar la huella.\n");
+                                            latencia_cerrar(LAT_REGISTRO);
+                                            usuarios_agregar_dedo(UsuarioActual, posicion);
+                                            usuarios_guardar();
+                                            auditoria_registrar(UsuarioActual, AUD_METODO_REGISTRO, AUD_RESULTADO_OK, 0, 0);
                                             strcpy(mensaje, "Huella Guardada. Quite el dedo.");
-                                            initVar(mensaje,true);
+                                            pantalla_texto(mensaje);
+                                            glifos_dibujar(1, 15, GLIFO_VISTO);
                                             sleep_ms(4000);
                                             rep=3;
                                             mala=0;
                                         } else {
                                             printf("Error al almacenar el modelo.\n");
                                             strcpy(mensaje, "Error. Retire y vuelva a ponerla.");
-                                            initVar(mensaje,true);
-                                            sleep_ms(2500);
+                                            pantalla_texto(mensaje);
+                                            as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
                                             rep++;
 
                                         }
@@ -579,47 +891,55 @@ int main() {
                                         printf("Error al crear el modelo.\n");
                                         printf("Retire y vuelva a poner la huella de nuevo\n");
                                         strcpy(mensaje, "Error. Retire y vuelva a ponerla.");
-                                        initVar(mensaje,true);
-                                        sleep_ms(2500);
+                                        pantalla_texto(mensaje);
+                                        as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
                                         rep++;
                                     }
                                 } else {
                                     printf("Error al convertir la imagen a plantilla (Intento 2).\n");
                                     printf("Retire y vuelva a poner la huella de nuevo\n");
                                     strcpy(mensaje, "Error. Retire y vuelva a ponerla.");
-                                    initVar(mensaje,true);
-                                    sleep_ms(2500);
+                                    pantalla_texto(mensaje);
+                                    as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
                                     rep++;
                                 }
+                            } else if (captura == CALIDAD_RECHAZADA) {
+                                avisarCalidad(veredicto);
                             } else {
                                 printf("Error al capturar la imagen (Intento 2).\n");
                                 printf("Retire y vuelva a poner la huella de nuevo\n");
                                 strcpy(mensaje, "Error. Retire y vuelva a ponerla.");
-                                initVar(mensaje,true);
-                                sleep_ms(2500);
+                                pantalla_texto(mensaje);
+                                as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
                                 rep++;
                             }
                         } else {
                             printf("Error al convertir la imagen a plantilla (Intento 1).\n");
                             printf("Retire y vuelva a poner la huella de nuevo\n");
                             strcpy(mensaje, "Error. Retire y vuelva a ponerla.");
-                            initVar(mensaje,true);
-                            sleep_ms(2500);
+                            pantalla_texto(mensaje);
+                            as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
                             rep++;
                         }
+                    } else if (captura == CALIDAD_RECHAZADA) {
+                        avisarCalidad(veredicto);
                     } else {
                         printf("Error al capturar la imagen (Intento 1).\n");
                         printf("Retire y vuelva a poner la huella de nuevo\n");
                         strcpy(mensaje, "Error. Retire y vuelva a ponerla.");
-                        initVar(mensaje,true);
-                        sleep_ms(2500);
+                        pantalla_texto(mensaje);
+                        as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
                         rep++;
                     }
 
                 }
+#endif
                 if (mala==1){
+                    metricas_contar(MET_BLOQUEOS);
+                    auditoria_registrar(UsuarioActual, AUD_METODO_REGISTRO, AUD_RESULTADO_BLOQUEO, 0, 0);
+                    auditoria_flush();
                     strcpy(mensaje, "ALcanzaste max intentos. Bloqueo.");
-                    initVar(mensaje,true);
+                    pantalla_texto(mensaje);
                 }
 
             
@@ -628,111 +948,208 @@ int main() {
             // Si esta en la base de datos, abre la caja fuerte
             if (tarea==2){
                 strcpy(mensaje, "Ponga la huella de su dedo.");
-                initVar(mensaje,true);
-                // Esperar un poco antes de enviar el siguiente comando
-                sleep_ms(2500);
+                pantalla_texto(mensaje);
+                glifos_dibujar(1, 15, GLIFO_HUELLA);
                 while(rep!= 3){    
-                    printf("Capturando imagen...\n");
-                    if (as608_get_image() == 0) {
-                        printf("Imagen capturada.\n");
-
-                        printf("Convirtiendo imagen a plantilla...\n");
-                        if (as608_image_to_template(1) == 0) {
-                            printf("Imagen convertida a plantilla.\n");
-
-                            printf("Buscando modelo...\n");
-                            if (as608_search_model() == 0) {
-                                printf("Modelo encontrado.\n");
-                                encender_rele();
-                                // Aqui se implementa función de apertura de caja fuerte
-                                strcpy(mensaje, "Acceso            Concedido");
-                                initVar(mensaje,true);
-                                sleep_ms(4000);
-                                apagar_rele();
-                                mala=0;
-                                rep=3;
-                            } else {
-                                printf("Error al buscar el modelo.\n");
-                                printf("Retire y vuelva a poner la huella de nuevo\n");
-                                strcpy(mensaje, "Huella Incorrecta, Vuelva e intente.");
-                                initVar(mensaje,true);
+                    uint16_t idHuella = 0, puntaje = 0;
+                    calidad_veredicto_t veredicto;
+#ifdef CAPTURA_ANTICIPADA
+                    // Primer intento: la captura que empezó mientras se escribía la contraseña
+                    uint8_t codigo = anticipo_esperar(&anticipo, &idHuella, &puntaje, AS608_TOQUE_ESPERA_MS);
+                    if (codigo == AS608_EN_CURSO) {
+                        codigo = verificarHuella(&idHuella, &puntaje, &veredicto);
+                    }
+#else
+                    uint8_t codigo = verificarHuella(&idHuella, &puntaje, &veredicto);
+#endif
+                    if (codigo == AS608_OK && usuarios_duenio(idHuella) != UsuarioActual) {
+                        // La huella está en el lector pero pertenece a otro usuario
+                        printf("La posicion %u no es del usuario %u\n", idHuella, UsuarioActual);
+                        codigo = AS608_NO_ENCONTRADA;
+                    }
+                    if (codigo == AS608_OK || codigo == AS608_NO_ENCONTRADA) {
+                        auditoria_registrar(UsuarioActual, AUD_METODO_HUELLA,
+                                            codigo == AS608_OK ? AUD_RESULTADO_OK : AUD_RESULTADO_FALLO,
+                                            codigo, puntaje);
+                    }
+                    if (codigo == AS608_OK) {
+                        printf("Modelo encontrado.\n");
+                        metricas_intentos(rep + 1);
+                        encender_rele();
+                        latencia_cerrar(LAT_DEDO_RELE);
+                        // Aqui se implementa función de apertura de caja fuerte
+                        strcpy(mensaje, "Acceso            Concedido");
+                        pantalla_texto(mensaje);
+                        glifos_dibujar(1, 15, GLIFO_ABIERTO);
+                        sleep_ms(4000);
+                        apagar_rele();
+                        mala=0;
+                        rep=3;
+                    } else if (codigo == AS608_NO_ENCONTRADA) {
+                        metricas_contar(MET_HUELLAS_RECHAZADAS);
+                        printf("Error al buscar el modelo.\n");
+                        printf("Retire y vuelva a poner la huella de nuevo\n");
+                        strcpy(mensaje, "Huella Incorrecta, Vuelva e intente.");
+                        pantalla_texto(mensaje);
 
-                                sleep_ms(2500);
-                                rep++;
-                            }
-                        } else {
-                            printf("Error al convertir la imagen a plantilla.\n");
-                            printf("Retire y vuelva a poner la huella de nuevo\n");
-                            strcpy(mensaje, "Error. Retire y vuelva a ponerla.");
-                            initVar(mensaje,true);
-                            sleep_ms(2500);
-                            rep++;
-                        }
+                        as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
+                        rep++;
+#ifdef CALIDAD_PREVIA
+                    } else if (codigo == CALIDAD_RECHAZADA) {
+                        avisarCalidad(veredicto);
+#endif
+                    } else if (codigo == AS608_IMAGEN_MALA || codigo == AS608_POCOS_RASGOS || codigo == AS608_SIN_IMAGEN) {
+                        printf("Error al convertir la imagen a plantilla.\n");
+                        printf("Retire y vuelva a poner la huella de nuevo\n");
+                        strcpy(mensaje, "Error. Retire y vuelva a ponerla.");
+                        pantalla_texto(mensaje);
+                        as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
+                        rep++;
                     } else {
                         printf("Error al capturar la imagen.\n");
                         printf("Retire y vuelva a poner la huella de nuevo\n");
                         strcpy(mensaje, "Error. Retire y vuelva a ponerla.");
-                        initVar(mensaje,true);
-                        sleep_ms(2500);
+                        pantalla_texto(mensaje);
+                        as608_wait_release(&lector, AS608_RETIRO_ESPERA_MS);
                         rep++;
                     }
                 }
                 if (mala==1){
+                    metricas_contar(MET_BLOQUEOS);
+                    metricas_intentos(0);
+                    auditoria_registrar(UsuarioActual, AUD_METODO_HUELLA, AUD_RESULTADO_BLOQUEO, 0, 0);
+                    auditoria_flush();
                     strcpy(mensaje, "ALcanzaste max intentos. Bloqueo.");
-                    initVar(mensaje,true);
+                    pantalla_texto(mensaje);
                 }
             }
             //Función que borra de la memoria una huella en especifico
             if (tarea==3){
                 sleep_ms(2500);
-                printf("Eliminando modelo...\n");
-                if (as608_delete_model(UbicacionLector) == 0) {
+                printf("Eliminando modelos...\n");
+                // Las huellas de todos los usuarios elegidos se borran en un solo lote; el
+                // directorio solo libera las posiciones que el lector borró
+                uint8_t codigo = biblioteca_borrar_usuarios(&lector, UsuarioActual, UsuarioHasta, NULL);
+                usuarios_guardar();
+                for (uint16_t i = 0; i < usuarios_cantidad(); i++) {
+                    uint16_t id = usuarios_en(i)->id;
+                    if (id >= UsuarioActual && id <= UsuarioHasta) {
+                        auditoria_registrar(id, AUD_METODO_BORRADO,
+                                            codigo == 0 ? AUD_RESULTADO_OK : AUD_RESULTADO_FALLO, codigo, 0);
+                    }
+                }
+                if (codigo == 0) {
                     printf("Modelo eliminado.\n");
                     strcpy(mensaje, "Modelo           eliminado.");
-                    initVar(mensaje,true);
+                    pantalla_texto(mensaje);
+                    glifos_dibujar(1, 15, GLIFO_VISTO);
                     sleep_ms(4000);
                 } else {
                     printf("Error al eliminar el modelo.\n");
                     strcpy(mensaje, "Error al eliminar    el modelo.");
-                    initVar(mensaje,true);
+                    pantalla_texto(mensaje);
+                    glifos_dibujar(1, 15, GLIFO_CRUZ);
                 }
             }
             // función que borra toda la base de datos
             if (tarea==4){
                 sleep_ms(2500);
                 printf("Vaciando base de datos...\n");
-                if (as608_empty_database() == 0) {
+                uint8_t codigo = as608_empty_database(&lector);
+                auditoria_registrar(0, AUD_METODO_VACIADO,
+                                    codigo == 0 ? AUD_RESULTADO_OK : AUD_RESULTADO_FALLO, codigo, 0);
+                if (codigo == 0) {
+                    usuarios_vaciar_dedos();
+                    usuarios_guardar();
                     printf("Base de datos vaciada.\n");
                     strcpy(mensaje, "Base de datos      vaciada.");
-                    initVar(mensaje,true);
+                    pantalla_texto(mensaje);
+                    glifos_dibujar(1, 15, GLIFO_VISTO);
                     sleep_ms(4000);
                     
                 } else {
                     printf("Error al vaciar la base de datos.\n");
                     strcpy(mensaje, "Error al vaciar base de datos.");
-                    initVar(mensaje,true);
+                    pantalla_texto(mensaje);
+                    glifos_dibujar(1, 15, GLIFO_CRUZ);
 
                 }
             }
+            // El sensor queda apagado (si hay corte de alimentación) hasta el próximo toque
+            as608_sleep(&lector);
             // Se reinician todas las banderas para que el programa vuelva a ejecutarse ciclicamente
             Inicio=true;
             opciones=true;
             EtapaLector=false;
             printf("as608_get_image: %s\n", EtapaLector ? "true" : "false");
+#ifdef CAPTURA_ANTICIPADA
+            anticipo_cancelar(&anticipo);
+#endif
             tarea=0;
             rep=0;
             mala=1;
-            UbicacionLector=0;
+            UsuarioActual=0;
+            UsuarioHasta=0;
+            // La bitácora se escribe aquí, con la cerradura ya cerrada, incluida la página a medio llenar
+            auditoria_flush();
             printf("LISTO PARA VOLVER A EMPEZAR\n");
             strcpy(mensaje, "CAJA FUERTE DISPONIBLE");
-            initVar(mensaje,true);
+            pantalla_texto(mensaje);
+            glifos_dibujar(1, 15, GLIFO_CANDADO);
             sleep_ms(2000);
             strcpy(mensaje, "A:Reg B:Ing   C:Borr D:Vac");
 
 
             
         }
-        //__wfi();
+        // Protocolo de gestión por USB; fuera de una trama 'L' vuelca la bitácora, 'T' las latencias,
+        // 'P' el perfilador y 'M' las métricas
+        int c;
+        while((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT){
+            actividad = true;
+            if(gestion_procesar((uint8_t)c)){
+                continue;
+            }
+            if(c=='L'){
+                auditoria_volcar(64);
+            } else if(c=='T'){
+                latencia_volcar();
+                uint32_t aciertos, cargas;
+                glifos_estadisticas(&aciertos, &cargas);
+                printf("Pantalla: %s\n", pantalla_nombre());
+                printf("Reloj: %lu kHz, %lu cambios\n", (unsigned long)reloj_khz(), (unsigned long)reloj_cambios());
+                printf("Glifos: %lu aciertos, %lu cargas en CGRAM\n", (unsigned long)aciertos, (unsigned long)cargas);
+                interrupciones_volcar();
+                printf("UART del lector: %lu desbordes del FIFO\n", (unsigned long)as608_desbordes(&lector));
+            } else if(c=='P'){
+                perfilador_volcar();
+            } else if(c=='M'){
+                metricas_volcar();
+            }
+        }
+        if(actividad){
+            reposo_actividad();
+        }
+        // Reposo tras REPOSO_SEGUNDOS sin actividad; sin USB reposo_entrar vuelve ya despierto
+        if(reposo_vencido()){
+            tecladoReposo(true);
+            auditoria_flush();
+            reposo_entrar();
+        }
+        if(reposo_dormido()){
+            if(reposo_despierta()){
+                tecladoReposo(false);
+                reposo_salir();
+            }
+            else{
+                // Con las interrupciones deshabilitadas un flanco entre la consulta y __wfi igual despierta
+                uint32_t estado = save_and_disable_interrupts();
+                if(!reposo_despierta()){
+                    __wfi();
+                }
+                restore_interrupts(estado);
+            }
+        }
         //printf("AFUERAAAAAAAAAAAAAAAA\n");
     }
     
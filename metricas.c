@@ -0,0 +1,142 @@
+/**
+ * @file metricas.c
+ * @brief Registro de métricas de operación en fragmentos por núcleo y contexto.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "as608.h"
+#include "metricas.h"
+#include "ram.h"
+
+#define METRICAS_FRAGMENTOS (METRICAS_NUCLEOS * 2) ///< Ciclo principal e interrupciones de cada núcleo
+
+static const char *const nombres[MET_CONTADORES] = {
+    [MET_AS608_REINTENTOS] = "as608 reintentos",
+    [MET_AS608_SIN_RESPUESTA] = "as608 sin respuesta",
+    [MET_AS608_CHECKSUM] = "as608 checksum",
+    [MET_AS608_DESBORDES] = "as608 desbordes",
+    [MET_TOQUE_PLAZOS] = "toque plazos",
+    [MET_TOQUE_FLANCOS] = "toque flancos",
+    [MET_TECLADO_FLANCOS] = "teclado flancos",
+    [MET_TECLAS] = "teclas",
+    [MET_TECLAS_INVALIDAS] = "teclas invalidas",
+    [MET_LCD_REDIBUJOS] = "lcd redibujos",
+    [MET_LCD_ERRORES_I2C] = "lcd errores i2c",
+    [MET_RELE_APERTURAS] = "rele aperturas",
+    [MET_PIN_RECHAZADOS] = "pin rechazados",
+    [MET_HUELLAS_RECHAZADAS] = "huellas rechazadas",
+    [MET_BLOQUEOS] = "bloqueos",
+};
+
+static volatile uint32_t fragmentos[METRICAS_FRAGMENTOS][METRICAS_CELDAS];
+static uint32_t base[METRICAS_CELDAS]; ///< Totales en el último reinicio
+static uint32_t reinicio_ms = 0;
+
+/**
+ * @brief Suma uno a una celda en el fragmento del núcleo y el contexto que llama.
+ */
+static void EN_RAM(sumar)(uint16_t celda) {
+    uint32_t f = get_core_num() * 2;
+    if (__get_current_exception()) {
+        // Una rutina de mayor prioridad del mismo núcleo podría contar la misma celda en medio
+        uint32_t estado = save_and_disable_interrupts();
+        fragmentos[f + 1][celda]++;
+        restore_interrupts(estado);
+    } else {
+        fragmentos[f][celda]++;
+    }
+}
+
+void EN_RAM(metricas_contar)(metricas_contador_t contador) {
+    sumar(contador);
+}
+
+void metricas_codigo(uint8_t instruccion, uint8_t codigo) {
+    uint16_t grupo = latencia_etapa_as608(instruccion) - LAT_AS608_GENIMG;
+    uint16_t c;
+    if (codigo == AS608_ERROR_COM) {
+        c = MET_CODIGO_COM;
+    } else if (codigo == AS608_CANCELADO) {
+        c = MET_CODIGO_CANCELADO;
+    } else {
+        c = codigo < MET_CODIGO_OTRO ? codigo : MET_CODIGO_OTRO;
+    }
+    sumar(MET_CELDA_CODIGOS + grupo * MET_CODIGOS + c);
+}
+
+void metricas_intentos(uint8_t intentos) {
+    sumar(MET_CELDA_INTENTOS + (intentos < MET_INTENTOS ? intentos : MET_INTENTOS - 1));
+}
+
+/**
+ * @brief Suma de los fragmentos de una celda (cada lectura de 32 bits es atómica).
+ */
+static uint32_t total(uint16_t celda) {
+    uint32_t suma = 0;
+    for (int f = 0; f < METRICAS_FRAGMENTOS; f++) {
+        suma += fragmentos[f][celda];
+    }
+    return suma;
+}
+
+uint32_t metricas_valor(uint16_t celda) {
+    return total(celda) - base[celda];
+}
+
+uint32_t metricas_segundos(void) {
+    return (to_ms_since_boot(get_absolute_time()) - reinicio_ms) / 1000;
+}
+
+void metricas_reiniciar(void) {
+    for (uint16_t i = 0; i < METRICAS_CELDAS; i++) {
+        base[i] = total(i);
+    }
+    reinicio_ms = to_ms_since_boot(get_absolute_time());
+}
+
+const char *metricas_nombre(metricas_contador_t contador) {
+    return nombres[contador];
+}
+
+void metricas_volcar(void) {
+    printf("MET %lu s\n", (unsigned long)metricas_segundos());
+    for (int i = 0; i < MET_CONTADORES; i++) {
+        uint32_t v = metricas_valor(i);
+        if (v) {
+            printf("MET %-19s %8lu\n", nombres[i], (unsigned long)v);
+        }
+    }
+    for (int g = 0; g < MET_GRUPOS; g++) {
+        bool vacio = true;
+        for (int c = 0; c < MET_CODIGOS; c++) {
+            uint32_t v = metricas_valor(MET_CELDA_CODIGOS + g * MET_CODIGOS + c);
+            if (v == 0) {
+                continue;
+            }
+            if (vacio) {
+                // Los grupos se llaman como las etapas de latencia.h
+                printf("MET codigos %-8s", latencia_nombre(LAT_AS608_GENIMG + g));
+                vacio = false;
+            }
+            if (c == MET_CODIGO_COM) {
+                printf(" com:%lu", (unsigned long)v);
+            } else if (c == MET_CODIGO_CANCELADO) {
+                printf(" cancelado:%lu", (unsigned long)v);
+            } else if (c == MET_CODIGO_OTRO) {
+                printf(" otro:%lu", (unsigned long)v);
+            } else {
+                printf(" %02X:%lu", c, (unsigned long)v);
+            }
+        }
+        if (!vacio) {
+            printf("\n");
+        }
+    }
+    printf("MET intentos por apertura:");
+    for (int n = 1; n < MET_INTENTOS; n++) {
+        printf(" %d:%lu", n, (unsigned long)metricas_valor(MET_CELDA_INTENTOS + n));
+    }
+    printf(" agotados:%lu\n", (unsigned long)metricas_valor(MET_CELDA_INTENTOS));
+}
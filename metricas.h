@@ -0,0 +1,118 @@
+/**
+ * @file metricas.h
+ * @brief Registro de métricas de operación: contadores fijos e histogramas de códigos y de intentos.
+ *
+ * Cubre el lector (reintentos, respuestas ausentes o inválidas, plazos de toque vencidos y el
+ * código de confirmación de cada instrucción), el teclado, la pantalla y el relé. Todas las
+ * métricas son celdas de 32 bits de una tabla fija, así que una instantánea es una lista de pares
+ * {celda, valor} y no hace falta reservar memoria:
+ *
+ * | Celdas                                    | Contenido                                       |
+ * |-------------------------------------------|-------------------------------------------------|
+ * | 0 .. MET_CONTADORES-1                     | Contadores de metricas_contador_t               |
+ * | MET_CELDA_CODIGOS + grupo*MET_CODIGOS + c | Códigos por grupo de instrucción (de latencia.h) |
+ * | MET_CELDA_INTENTOS + n                    | Aperturas con huella en n intentos (0: bloqueo) |
+ *
+ * La cubeta c de un código es el propio código hasta 0x1F; después vienen MET_CODIGO_OTRO,
+ * MET_CODIGO_COM (sin respuesta válida tras los reintentos) y MET_CODIGO_CANCELADO.
+ *
+ * El Cortex-M0+ no tiene LDREX/STREX, así que un incremento compartido necesitaría un spinlock.
+ * En su lugar cada núcleo tiene un fragmento para el ciclo principal y otro para las
+ * interrupciones: en el primero escribe solo ese núcleo fuera de las interrupciones, y en el
+ * segundo las rutinas de ese núcleo, con las interrupciones enmascaradas durante el incremento
+ * porque se anidan por prioridad. La lectura suma los fragmentos. Reiniciar no escribe en ellos:
+ * guarda los totales actuales como base y las lecturas siguientes los restan.
+ *
+ * Se consultan por USB con la tecla 'M' (texto) o con el comando GESTION_METRICAS; ver
+ * herramientas/gestion.py metricas.
+ */
+
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stdint.h>
+#include "latencia.h"
+
+#define METRICAS_NUCLEOS 2 ///< Núcleos del RP2040
+
+/**
+ * @brief Contadores.
+ */
+typedef enum {
+    MET_AS608_REINTENTOS,   ///< Reintentos de instrucciones del lector
+    MET_AS608_SIN_RESPUESTA, ///< Intentos sin respuesta válida (plazo vencido o paquete inválido)
+    MET_AS608_CHECKSUM,     ///< Paquetes del lector con checksum inválido
+    MET_AS608_DESBORDES,    ///< Desbordes del FIFO de recepción del UART del lector
+    MET_TOQUE_PLAZOS,       ///< Esperas del dedo vencidas (AS608_TOQUE_ESPERA_MS)
+    MET_TOQUE_FLANCOS,      ///< Flancos de la línea de toque
+    MET_TECLADO_FLANCOS,    ///< Interrupciones de las columnas del teclado
+    MET_TECLAS,             ///< Teclas decodificadas
+    MET_TECLAS_INVALIDAS,   ///< Capturas que no corresponden a una sola tecla
+    MET_LCD_REDIBUJOS,      ///< Llamadas a pantalla_texto
+    MET_LCD_ERRORES_I2C,    ///< Escrituras I2C al LCD sin ACK
+    MET_RELE_APERTURAS,     ///< Activaciones del relé
+    MET_PIN_RECHAZADOS,     ///< Contraseñas incorrectas
+    MET_HUELLAS_RECHAZADAS, ///< Huellas que no están en la biblioteca o son de otro usuario
+    MET_BLOQUEOS,           ///< Intentos de huella agotados (registro o apertura)
+    MET_CONTADORES
+} metricas_contador_t;
+
+#define MET_GRUPOS (LAT_AS608_OTRO - LAT_AS608_GENIMG + 1) ///< Grupos de instrucciones
+#define MET_CODIGO_OTRO 0x20      ///< Código de confirmación mayor que 0x1F
+#define MET_CODIGO_COM 0x21       ///< AS608_ERROR_COM
+#define MET_CODIGO_CANCELADO 0x22 ///< AS608_CANCELADO
+#define MET_CODIGOS 0x23          ///< Cubetas por grupo
+#define MET_INTENTOS 4            ///< Cubetas de intentos por apertura (0 a 3)
+
+#define MET_CELDA_CODIGOS MET_CONTADORES
+#define MET_CELDA_INTENTOS (MET_CELDA_CODIGOS + MET_GRUPOS * MET_CODIGOS)
+#define METRICAS_CELDAS (MET_CELDA_INTENTOS + MET_INTENTOS)
+
+/**
+ * @brief Suma uno a un contador. Se puede llamar desde cualquier núcleo y desde una interrupción.
+ */
+void metricas_contar(metricas_contador_t contador);
+
+/**
+ * @brief Cuenta el resultado final (tras los reintentos) de una instrucción del lector.
+ *
+ * @param instruccion Código de la instrucción.
+ * @param codigo Código de confirmación, AS608_ERROR_COM o AS608_CANCELADO.
+ */
+void metricas_codigo(uint8_t instruccion, uint8_t codigo);
+
+/**
+ * @brief Cuenta una apertura con huella.
+ *
+ * @param intentos Intentos de captura hasta la apertura (1 a 3), o 0 si se agotaron.
+ */
+void metricas_intentos(uint8_t intentos);
+
+/**
+ * @brief Valor de una celda desde el último reinicio.
+ *
+ * @param celda Índice entre 0 y METRICAS_CELDAS-1.
+ */
+uint32_t metricas_valor(uint16_t celda);
+
+/**
+ * @brief Segundos desde el último reinicio (o desde el arranque).
+ */
+uint32_t metricas_segundos(void);
+
+/**
+ * @brief Pone en cero todas las celdas.
+ */
+void metricas_reiniciar(void);
+
+/**
+ * @brief Nombre corto de un contador (como en herramientas/protocolo.py).
+ */
+const char *metricas_nombre(metricas_contador_t contador);
+
+/**
+ * @brief Imprime por stdio los contadores y las cubetas no vacías.
+ */
+void metricas_volcar(void);
+
+#endif // METRICAS_H
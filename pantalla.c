@@ -0,0 +1,106 @@
+/**
+ * @file pantalla.c
+ * @brief Despacho al respaldo de pantalla elegido y respaldo del LCD 16x2 por I2C.
+ */
+
+#include "pico/stdlib.h"
+#include "pantalla.h"
+#include "lcd_i2c_16x2.h"
+#include "latencia.h"
+#include "reloj.h"
+#include "perfilador.h"
+#include "metricas.h"
+
+#ifdef PANTALLA_SPI
+static const pantalla_backend_t *const respaldo = &pantalla_spi;
+#else
+static const pantalla_backend_t *const respaldo = &pantalla_lcd;
+#endif
+
+static uint32_t borrados = 0;
+
+// ---- LCD 16x2: initVar ya inicializa el bus y el controlador en cada mensaje ----
+
+static void lcd_reloj(void *ctx) {
+    (void)ctx;
+    lcd_baudios();
+}
+
+static void lcd_iniciar(void) {
+    reloj_registrar(lcd_reloj, NULL);
+}
+
+static void lcd_texto(const char *texto) {
+    initVar((char *)texto, true);
+}
+
+static void lcd_caracter(uint8_t linea, uint8_t columna, char c) {
+    lcd_set_cursor(linea, columna);
+    lcd_char(c);
+}
+
+static void lcd_glifo(uint8_t linea, uint8_t columna, glifo_t glifo) {
+    // La carga en CGRAM (si hace falta) va antes de ubicar el cursor
+    uint8_t codigo = glifos_codigo(glifo);
+    lcd_set_cursor(linea, columna);
+    lcd_char((char)codigo);
+}
+
+const pantalla_backend_t pantalla_lcd = {
+    .nombre = "lcd 16x2 i2c",
+    .iniciar = lcd_iniciar,
+    .texto = lcd_texto,
+    .caracter = lcd_caracter,
+    .glifo = lcd_glifo,
+    .volcar = NULL,
+    .encender = lcd_luz,
+};
+
+// ---- Despacho ----
+
+void pantalla_init(void) {
+    if (respaldo->iniciar) {
+        respaldo->iniciar();
+    }
+}
+
+const char *pantalla_nombre(void) {
+    return respaldo->nombre;
+}
+
+void pantalla_texto(const char *texto) {
+    uint64_t inicio = time_us_64();
+    uint32_t ciclos = perfilador_entrar();
+
+    borrados++;
+    metricas_contar(MET_LCD_REDIBUJOS);
+    respaldo->texto(texto);
+    if (respaldo->volcar) {
+        respaldo->volcar();
+    }
+    perfilador_salir(PERF_PANTALLA, ciclos);
+    latencia_registrar(LAT_LCD_REDIBUJO, (uint32_t)(time_us_64() - inicio));
+    latencia_cerrar(LAT_TECLA_PANTALLA);
+}
+
+void pantalla_caracter(uint8_t linea, uint8_t columna, char c) {
+    respaldo->caracter(linea, columna, c);
+    if (respaldo->volcar) {
+        respaldo->volcar();
+    }
+}
+
+void pantalla_glifo(uint8_t linea, uint8_t columna, glifo_t glifo) {
+    respaldo->glifo(linea, columna, glifo);
+    if (respaldo->volcar) {
+        respaldo->volcar();
+    }
+}
+
+void pantalla_encender(bool encendida) {
+    respaldo->encender(encendida);
+}
+
+uint32_t pantalla_borrados(void) {
+    return borrados;
+}
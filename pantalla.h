@@ -0,0 +1,93 @@
+/**
+ * @file pantalla.h
+ * @brief Pantalla de la caja: una grilla de 2 líneas de 16 celdas con texto y glifos, sobre el LCD
+ * 16x2 por I2C (por defecto) o sobre un panel gráfico por SPI (-DPANTALLA_SPI, ver pantalla_spi.h).
+ *
+ * La aplicación solo usa estas funciones; cada respaldo (pantalla_backend_t) decide cómo dibujar.
+ * El redibujo completo se mide en LAT_LCD_REDIBUJO con cualquiera de los dos, para comparar el
+ * tiempo por cuadro.
+ */
+
+#ifndef PANTALLA_H
+#define PANTALLA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "glifos.h"
+
+#define PANTALLA_LINEAS   2
+#define PANTALLA_COLUMNAS 16
+
+/**
+ * @brief Operaciones de un respaldo de pantalla.
+ */
+typedef struct {
+    const char *nombre;
+    void (*iniciar)(void);
+    /** Borra y escribe hasta 32 caracteres, 16 por línea. */
+    void (*texto)(const char *texto);
+    /** Escribe un carácter (GLIFO_LLENO es el bloque lleno) en una celda. */
+    void (*caracter)(uint8_t linea, uint8_t columna, char c);
+    /** Dibuja un glifo del catálogo en una celda. */
+    void (*glifo)(uint8_t linea, uint8_t columna, glifo_t glifo);
+    /** Envía al panel lo dibujado desde el último volcado (NULL si cada operación ya lo envía). */
+    void (*volcar)(void);
+    /** Enciende o apaga la imagen (o la luz de fondo) sin perder el contenido. */
+    void (*encender)(bool encendida);
+} pantalla_backend_t;
+
+extern const pantalla_backend_t pantalla_lcd;  ///< PCF8574 + HD44780 por I2C
+extern const pantalla_backend_t pantalla_spi;  ///< Panel gráfico SSD1306 por SPI (pantalla_spi.c)
+
+/**
+ * @brief Inicializa el respaldo elegido al compilar.
+ */
+void pantalla_init(void);
+
+/**
+ * @brief Nombre del respaldo en uso.
+ */
+const char *pantalla_nombre(void);
+
+/**
+ * @brief Borra la pantalla y muestra un mensaje.
+ *
+ * @param texto Hasta 32 caracteres; del 17 en adelante van a la segunda línea.
+ */
+void pantalla_texto(const char *texto);
+
+/**
+ * @brief Escribe un carácter en una celda.
+ *
+ * @param linea Línea (0 o 1).
+ * @param columna Columna (0 a 15).
+ * @param c Carácter, o GLIFO_LLENO.
+ */
+void pantalla_caracter(uint8_t linea, uint8_t columna, char c);
+
+/**
+ * @brief Dibuja un glifo en una celda.
+ *
+ * @param linea Línea (0 o 1).
+ * @param columna Columna (0 a 15).
+ * @param glifo Glifo del catálogo.
+ */
+void pantalla_glifo(uint8_t linea, uint8_t columna, glifo_t glifo);
+
+/**
+ * @brief Enciende o apaga la pantalla para el reposo; lo dibujado se conserva.
+ *
+ * @param encendida Verdadero para encender.
+ */
+void pantalla_encender(bool encendida);
+
+/**
+ * @brief Cuenta los borrados de pantalla.
+ *
+ * Cambia con cada pantalla_texto, así que sirve para saber si lo dibujado antes sigue a la vista.
+ *
+ * @return uint32_t Borrados desde el arranque.
+ */
+uint32_t pantalla_borrados(void);
+
+#endif // PANTALLA_H
@@ -0,0 +1,258 @@
+/**
+ * @file pantalla_spi.c
+ * @brief Panel SSD1306 de 128x64 por SPI con framebuffer en teselas, rectángulo sucio y volcado
+ * por DMA.
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "pantalla_spi.h"
+#include "reloj.h"
+
+#define PANEL_PAGINA_LINEA(l) (1 + 4 * (l)) ///< Cada línea de texto ocupa 2 páginas, centradas
+
+static uint8_t fb[PANEL_PAGINAS][PANEL_ANCHO]; ///< Mismo orden que la GDDRAM: bit 0 = fila de arriba
+static uint16_t sucias[PANEL_PAGINAS];        ///< Bit t: la tesela t de la página cambió
+static int canal = -1;                        ///< Canal DMA hacia el SPI (-1: escritura bloqueante)
+
+// Fuente de 5x7 del HD44780 (0x20 a 0x7E), una columna por byte, bit 0 arriba
+static const uint8_t fuente[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x32}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x08, 0x14, 0x54, 0x54, 0x3C},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+    {0x00, 0x7F, 0x10, 0x28, 0x44}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+    {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08},
+};
+
+// Encendido para 128x64 con la bomba de carga interna y direccionamiento horizontal
+static const uint8_t arranque[] = {
+    0xAE, 0xD5, 0x80, 0xA8, 0x3F, 0xD3, 0x00, 0x40, 0x8D, 0x14, 0x20, 0x00,
+    0xA1, 0xC8, 0xDA, 0x12, 0x81, 0xCF, 0xD9, 0xF1, 0xDB, 0x40, 0xA4, 0xA6, 0xAF,
+};
+
+/**
+ * @brief Espera a que termine el volcado anterior y a que el SPI quede libre (antes de mover DC).
+ */
+static void esperar(void) {
+    if (canal >= 0) {
+        while (dma_channel_is_busy(canal)) {
+            tight_loop_contents();
+        }
+    }
+    while (spi_is_busy(PANEL_SPI)) {
+        tight_loop_contents();
+    }
+}
+
+static void comandos(const uint8_t *c, size_t n) {
+    esperar();
+    gpio_put(PANEL_PIN_DC, 0);
+    spi_write_blocking(PANEL_SPI, c, n);
+    gpio_put(PANEL_PIN_DC, 1);
+}
+
+/**
+ * @brief Envía datos a la ventana actual; con DMA vuelve enseguida.
+ */
+static void datos(const uint8_t *d, size_t n) {
+    esperar();
+    if (canal < 0) {
+        spi_write_blocking(PANEL_SPI, d, n);
+        return;
+    }
+    dma_channel_config cfg = dma_channel_get_default_config(canal);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, spi_get_dreq(PANEL_SPI, true));
+    dma_channel_configure(canal, &cfg, &spi_get_hw(PANEL_SPI)->dr, d, n, true);
+}
+
+static void escribir_tesela(uint8_t pagina, uint8_t tx, const uint8_t bytes[PANEL_TESELA]) {
+    uint8_t *t = &fb[pagina][tx * PANEL_TESELA];
+    if (memcmp(t, bytes, PANEL_TESELA) != 0) {
+        memcpy(t, bytes, PANEL_TESELA);
+        sucias[pagina] |= 1u << tx;
+    }
+}
+
+/**
+ * @brief Dibuja una celda de 8x16 a partir de 5 columnas de 8 filas, duplicando cada fila.
+ */
+static void dibujar_celda(uint8_t linea, uint8_t columna, const uint8_t columnas[5]) {
+    uint8_t arriba[PANEL_TESELA] = {0}, abajo[PANEL_TESELA] = {0};
+
+    for (int c = 0; c < 5; c++) {
+        uint16_t doble = 0;
+        for (int f = 0; f < 8; f++) {
+            if (columnas[c] & (1u << f)) {
+                doble |= 3u << (2 * f);
+            }
+        }
+        arriba[1 + c] = doble & 0xFF;
+        abajo[1 + c] = doble >> 8;
+    }
+    escribir_tesela(PANEL_PAGINA_LINEA(linea), columna, arriba);
+    escribir_tesela(PANEL_PAGINA_LINEA(linea) + 1, columna, abajo);
+}
+
+static void spi_caracter(uint8_t linea, uint8_t columna, char c) {
+    static const uint8_t lleno[5] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint8_t u = (uint8_t)c;
+
+    if (u == GLIFO_LLENO) {
+        dibujar_celda(linea, columna, lleno);
+    } else {
+        dibujar_celda(linea, columna, fuente[(u >= 0x20 && u <= 0x7E) ? u - 0x20 : '?' - 0x20]);
+    }
+}
+
+static void spi_glifo(uint8_t linea, uint8_t columna, glifo_t glifo) {
+    const uint8_t *filas = glifos_patron(glifo);
+    uint8_t columnas[5] = {0};
+
+    for (int c = 0; c < 5; c++) {
+        for (int f = 0; f < 8; f++) {
+            if (filas[f] & (0x10 >> c)) {
+                columnas[c] |= 1u << f;
+            }
+        }
+    }
+    dibujar_celda(linea, columna, columnas);
+}
+
+static void spi_texto(const char *texto) {
+    bool fin = false;
+
+    for (int n = 0; n < PANTALLA_LINEAS * PANTALLA_COLUMNAS; n++) {
+        fin = fin || texto[n] == '\0';
+        spi_caracter(n / PANTALLA_COLUMNAS, n % PANTALLA_COLUMNAS, fin ? ' ' : texto[n]);
+    }
+}
+
+/**
+ * @brief Envía un rectángulo de teselas: páginas desde..hasta, teselas tx0..tx1.
+ *
+ * Si abarca todo el ancho las páginas son contiguas en el framebuffer y va en una sola
+ * transferencia; si no, una por página (la ventana del SSD1306 pasa sola a la página siguiente).
+ */
+static void volcar_rectangulo(int desde, int hasta, int tx0, int tx1) {
+    uint8_t ventana[] = {0x21, tx0 * PANEL_TESELA, tx1 * PANEL_TESELA + PANEL_TESELA - 1, 0x22, desde, hasta};
+
+    comandos(ventana, sizeof(ventana));
+    if (tx0 == 0 && tx1 == PANEL_TESELAS_X - 1) {
+        datos(&fb[desde][0], (size_t)(hasta - desde + 1) * PANEL_ANCHO);
+    } else {
+        for (int p = desde; p <= hasta; p++) {
+            datos(&fb[p][tx0 * PANEL_TESELA], (size_t)(tx1 - tx0 + 1) * PANEL_TESELA);
+        }
+    }
+}
+
+/**
+ * @brief Envía un rectángulo por cada tramo de páginas consecutivas con teselas cambiadas (una
+ * línea de texto es un tramo de 2 páginas).
+ *
+ * El último DMA queda en curso: si mientras tanto se dibuja algo, los bytes que lleguen más nuevos
+ * caen en su lugar y el próximo volcado los vuelve a enviar.
+ */
+static void spi_volcar(void) {
+    int p = 0;
+
+    while (p < PANEL_PAGINAS) {
+        if (!sucias[p]) {
+            p++;
+            continue;
+        }
+        int desde = p;
+        uint16_t columnas = 0;
+        while (p < PANEL_PAGINAS && sucias[p]) {
+            columnas |= sucias[p];
+            sucias[p++] = 0;
+        }
+        volcar_rectangulo(desde, p - 1, __builtin_ctz(columnas), 31 - __builtin_clz(columnas));
+    }
+}
+
+// El divisor solo se cambia con el bus quieto
+static void spi_reloj(void *ctx) {
+    (void)ctx;
+    esperar();
+    spi_set_baudrate(PANEL_SPI, PANEL_BAUDIOS);
+}
+
+static void spi_iniciar(void) {
+    spi_init(PANEL_SPI, PANEL_BAUDIOS);
+    spi_set_format(PANEL_SPI, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_set_function(PANEL_PIN_SCK, GPIO_FUNC_SPI);
+    gpio_set_function(PANEL_PIN_MOSI, GPIO_FUNC_SPI);
+    gpio_init(PANEL_PIN_DC);
+    gpio_set_dir(PANEL_PIN_DC, GPIO_OUT);
+    gpio_put(PANEL_PIN_DC, 1);
+    // El panel es el único en el bus: CS queda bajo
+    gpio_init(PANEL_PIN_CS);
+    gpio_set_dir(PANEL_PIN_CS, GPIO_OUT);
+    gpio_put(PANEL_PIN_CS, 0);
+    gpio_init(PANEL_PIN_RES);
+    gpio_set_dir(PANEL_PIN_RES, GPIO_OUT);
+    gpio_put(PANEL_PIN_RES, 0);
+    sleep_ms(1);
+    gpio_put(PANEL_PIN_RES, 1);
+    sleep_ms(1);
+
+    reloj_registrar(spi_reloj, NULL);
+    canal = dma_claim_unused_channel(false);
+    comandos(arranque, sizeof(arranque));
+    // La GDDRAM arranca con basura: el primer volcado la cubre entera
+    memset(fb, 0, sizeof(fb));
+    for (int p = 0; p < PANEL_PAGINAS; p++) {
+        sucias[p] = 0xFFFF;
+    }
+    spi_volcar();
+}
+
+// 0xAE apaga el panel (consumo de reposo) sin tocar la GDDRAM; 0xAF lo vuelve a mostrar
+static void spi_encender(bool encendida) {
+    uint8_t c = encendida ? 0xAF : 0xAE;
+    comandos(&c, 1);
+}
+
+const pantalla_backend_t pantalla_spi = {
+    .nombre = "ssd1306 128x64 spi",
+    .iniciar = spi_iniciar,
+    .texto = spi_texto,
+    .caracter = spi_caracter,
+    .glifo = spi_glifo,
+    .volcar = spi_volcar,
+    .encender = spi_encender,
+};
@@ -0,0 +1,43 @@
+/**
+ * @file pantalla_spi.h
+ * @brief Respaldo de pantalla para un panel OLED de 128x64 con controlador SSD1306 por SPI
+ * (compilar con -DPANTALLA_SPI).
+ *
+ * El panel muestra la misma grilla de 2x16 celdas que el LCD con celdas de 8x16 píxeles (la fuente
+ * de 5x7 del HD44780 al doble de alto). El cuadro vive en un framebuffer de 1 KiB dividido en
+ * teselas de 8x8 píxeles con el mismo orden que la GDDRAM del SSD1306 (páginas de 8 filas, un byte
+ * por columna). Solo se marcan las teselas cuyo contenido cambia, y el volcado envía el rectángulo
+ * que las encierra por DMA hacia el SPI sin esperar a que termine.
+ *
+ * Conexiones (SPI0):
+ *
+ * GPIO 2 -> SCK (D0)
+ * GPIO 3 -> MOSI (D1)
+ * GPIO 4 -> DC
+ * GPIO 5 -> CS
+ * GPIO 6 -> RES
+ */
+
+#ifndef PANTALLA_SPI_H
+#define PANTALLA_SPI_H
+
+#include "pantalla.h"
+
+#ifndef PANEL_SPI
+#define PANEL_SPI spi0
+#endif
+#ifndef PANEL_BAUDIOS
+#define PANEL_BAUDIOS (8 * 1000 * 1000)  ///< El SSD1306 admite hasta 10 MHz
+#endif
+#define PANEL_PIN_SCK 2
+#define PANEL_PIN_MOSI 3
+#define PANEL_PIN_DC 4
+#define PANEL_PIN_CS 5
+#define PANEL_PIN_RES 6
+
+#define PANEL_ANCHO    128
+#define PANEL_PAGINAS  8      ///< Páginas de 8 filas (64 filas)
+#define PANEL_TESELA   8      ///< Lado de la tesela en píxeles (una tesela = 8 bytes de una página)
+#define PANEL_TESELAS_X (PANEL_ANCHO / PANEL_TESELA)
+
+#endif // PANTALLA_SPI_H
@@ -0,0 +1,224 @@
+/**
+ * @file perfilador.c
+ * @brief Perfilador por muestreo con el SysTick y contadores de ciclos por región.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/exception.h"
+#include "hardware/sync.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/systick.h"
+#include "perfilador.h"
+#include "reloj.h"
+#include "interrupciones.h"
+#include "ram.h"
+
+#define RECARGA_MAX 0x00FFFFFFu ///< El SysTick es de 24 bits
+#define VOLCAR_PARES 16         ///< Pares que imprime perfilador_volcar
+
+static const char *const nombres[PERF_REGIONES] = {
+    [PERF_AS608] = "as608",
+    [PERF_PANTALLA] = "pantalla",
+    [PERF_TECLA] = "tecla",
+};
+
+static perfilador_muestra_t tabla[PERFILADOR_ENTRADAS];
+static perfilador_contador_t regiones[PERF_REGIONES];
+static volatile uint32_t ciclos_base = 0; ///< Ciclos hasta la última recarga del SysTick
+static volatile uint32_t recarga = RECARGA_MAX;
+static volatile bool muestreando = false;
+static volatile uint32_t muestras = 0;
+static volatile uint32_t perdidas = 0;
+
+/**
+ * @brief Suma una muestra al par {pc, lr}, o la cuenta como perdida si su zona de la tabla está llena.
+ */
+static void EN_RAM(anotar)(uint32_t pc, uint32_t lr) {
+    uint32_t h = ((pc >> 1) ^ (lr * 2654435761u)) & (PERFILADOR_ENTRADAS - 1);
+    for (uint32_t i = 0; i < PERFILADOR_SONDEO; i++) {
+        perfilador_muestra_t *e = &tabla[(h + i) & (PERFILADOR_ENTRADAS - 1)];
+        if (e->cuenta == 0) {
+            e->pc = pc;
+            e->lr = lr;
+        } else if (e->pc != pc || e->lr != lr) {
+            continue;
+        }
+        e->cuenta++;
+        muestras++;
+        return;
+    }
+    perdidas++;
+}
+
+/**
+ * @brief Interrupción del SysTick: cuenta el período y anota el par {pc, lr} interrumpido.
+ *
+ * No es estática porque la llama systick_entrada desde ensamblador.
+ *
+ * @param marco Registros apilados por la excepción (r0-r3, r12, lr, pc, xpsr), o NULL si no hay.
+ */
+void EN_RAM(perfilador_anotar)(const uint32_t *marco) {
+    uint32_t entrada = interrupciones_entrar(IRQ_SYSTICK, INTERRUPCIONES_SIN_LATENCIA);
+    ciclos_base += recarga + 1;
+    if (muestreando && marco) {
+        anotar(marco[6] & ~1u, marco[5] & ~1u);
+    }
+    interrupciones_salir(IRQ_SYSTICK, entrada);
+}
+
+#if defined(__arm__)
+/**
+ * @brief Entrada de la excepción: el marco está en la pila que indica el bit 2 de EXC_RETURN.
+ */
+static void __attribute__((naked)) EN_RAM(systick_entrada)(void) {
+    __asm volatile(
+        "movs r0, #4\n"
+        "mov r1, lr\n"
+        "tst r0, r1\n"
+        "beq 1f\n"
+        "mrs r0, psp\n"
+        "b 2f\n"
+        "1:\n"
+        "mrs r0, msp\n"
+        "2:\n"
+        "ldr r1, =perfilador_anotar\n"
+        "bx r1\n"
+        ".ltorg\n");
+}
+#else
+// Sin marco de excepción (simulación en el host): solo se cuentan los ciclos
+static void systick_entrada(void) {
+    perfilador_anotar(NULL);
+}
+#endif
+
+/**
+ * @brief Recarga el SysTick para el muestreo a PERFILADOR_HZ con el clk_sys actual, o con el
+ * máximo sin muestreo, sin perder los ciclos del período en curso.
+ */
+static void programar(void *ctx) {
+    (void)ctx;
+    uint32_t nueva = muestreando ? clock_get_hz(clk_sys) / PERFILADOR_HZ - 1 : RECARGA_MAX;
+    uint32_t estado = save_and_disable_interrupts();
+    ciclos_base += recarga - systick_hw->cvr;
+    if (scb_hw->icsr & M0PLUS_ICSR_PENDSTSET_BITS) {
+        ciclos_base += recarga + 1;
+        scb_hw->icsr = M0PLUS_ICSR_PENDSTCLR_BITS;
+    }
+    recarga = nueva;
+    systick_hw->rvr = nueva;
+    systick_hw->cvr = 0;
+    restore_interrupts(estado);
+}
+
+void perfilador_init(void) {
+    exception_set_exclusive_handler(SYSTICK_EXCEPTION, systick_entrada);
+    exception_set_priority(SYSTICK_EXCEPTION, IRQ_PRIORIDAD_SYSTICK);
+    systick_hw->rvr = recarga;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_TICKINT_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+    reloj_registrar(programar, NULL);
+}
+
+void perfilador_muestrear(bool activo) {
+    if (activo) {
+        muestreando = false;
+        memset(tabla, 0, sizeof(tabla));
+        muestras = 0;
+        perdidas = 0;
+    }
+    muestreando = activo;
+    programar(NULL);
+}
+
+bool perfilador_muestreando(void) {
+    return muestreando;
+}
+
+uint32_t EN_RAM(perfilador_ciclos)(void) {
+    uint32_t estado = save_and_disable_interrupts();
+    uint32_t cvr = systick_hw->cvr;
+    uint32_t base = ciclos_base;
+    // Si el contador dio la vuelta y la interrupción aún no corrió, se vuelve a leer ya recargado
+    if (scb_hw->icsr & M0PLUS_ICSR_PENDSTSET_BITS) {
+        cvr = systick_hw->cvr;
+        base += recarga + 1;
+    }
+    restore_interrupts(estado);
+    return base + (recarga - cvr);
+}
+
+void EN_RAM(perfilador_salir)(perfilador_region_t region, uint32_t inicio) {
+    uint32_t ciclos = perfilador_ciclos() - inicio;
+    perfilador_contador_t *c = &regiones[region];
+    if (c->cuenta == 0 || ciclos < c->min) {
+        c->min = ciclos;
+    }
+    if (ciclos > c->max) {
+        c->max = ciclos;
+    }
+    c->cuenta++;
+    c->total += ciclos;
+}
+
+const perfilador_muestra_t *perfilador_tabla(void) {
+    return tabla;
+}
+
+void perfilador_totales(uint32_t *muestras_out, uint32_t *perdidas_out) {
+    *muestras_out = muestras;
+    *perdidas_out = perdidas;
+}
+
+const perfilador_contador_t *perfilador_region(perfilador_region_t region) {
+    return &regiones[region];
+}
+
+void perfilador_reiniciar_regiones(void) {
+    memset(regiones, 0, sizeof(regiones));
+}
+
+const char *perfilador_nombre(perfilador_region_t region) {
+    return nombres[region];
+}
+
+void perfilador_volcar(void) {
+    uint32_t mhz = clock_get_hz(clk_sys) / MHZ;
+    printf("PERF region        n      min    media      max (ciclos; %lu MHz)\n", (unsigned long)mhz);
+    for (int r = 0; r < PERF_REGIONES; r++) {
+        const perfilador_contador_t *c = &regiones[r];
+        if (c->cuenta == 0) {
+            continue;
+        }
+        printf("PERF %-9s %6lu %8lu %8lu %8lu\n", nombres[r], (unsigned long)c->cuenta, (unsigned long)c->min,
+               (unsigned long)(c->total / c->cuenta), (unsigned long)c->max);
+    }
+    printf("PERF muestreo %s a %u Hz: %lu muestras, %lu perdidas\n", muestreando ? "activo" : "detenido",
+           PERFILADOR_HZ, (unsigned long)muestras, (unsigned long)perdidas);
+
+    // Los pares más frecuentes, sin ordenar la tabla: VOLCAR_PARES pasadas por el máximo restante
+    uint32_t tope = UINT32_MAX;
+    int ultimo = -1;
+    for (int n = 0; n < VOLCAR_PARES; n++) {
+        int mejor = -1;
+        for (int i = 0; i < PERFILADOR_ENTRADAS; i++) {
+            uint32_t k = tabla[i].cuenta;
+            if (k == 0 || k > tope || (k == tope && i <= ultimo)) {
+                continue;
+            }
+            if (mejor < 0 || k > tabla[mejor].cuenta) {
+                mejor = i;
+            }
+        }
+        if (mejor < 0) {
+            break;
+        }
+        printf("PERF pc %08lx lr %08lx %6lu\n", (unsigned long)tabla[mejor].pc, (unsigned long)tabla[mejor].lr,
+               (unsigned long)tabla[mejor].cuenta);
+        tope = tabla[mejor].cuenta;
+        ultimo = mejor;
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ * @file perfilador.h
+ * @brief Perfilador por muestreo y contadores de ciclos por región.
+ *
+ * El SysTick cuenta ciclos del procesador (clk_sys). Su interrupción, con la prioridad más alta,
+ * suma el período al contador de ciclos y, mientras el muestreo está activo, anota el PC
+ * interrumpido y el LR (el llamador, salvo en funciones que ya lo guardaron en la pila) en una
+ * tabla de pares {pc, lr} con su cuenta. Fuera del muestreo el SysTick da la vuelta con la recarga
+ * máxima (2^24 ciclos), así que solo despierta al procesador unas pocas veces por segundo.
+ *
+ * Las regiones (transacción con el lector, volcado de la pantalla, decodificación de una tecla)
+ * acumulan ciclos exactos entre perfilador_entrar y perfilador_salir. Los ciclos no dependen del
+ * perfil de reloj; el período de muestreo sí se recalcula en cada cambio para seguir en
+ * PERFILADOR_HZ.
+ *
+ * Los resultados se consultan por USB con la tecla 'P' (texto) o con el comando GESTION_PERFIL;
+ * herramientas/gestion.py perfil traduce los PC a funciones con la tabla de símbolos del ELF y
+ * escribe pilas plegadas para un flame graph.
+ */
+
+#ifndef PERFILADOR_H
+#define PERFILADOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef PERFILADOR_HZ
+#define PERFILADOR_HZ 1000       ///< Muestras por segundo mientras el muestreo está activo
+#endif
+#define PERFILADOR_ENTRADAS 512  ///< Pares {pc, lr} distintos (potencia de 2)
+#define PERFILADOR_SONDEO 8      ///< Posiciones probadas antes de dar una muestra por perdida
+
+/**
+ * @brief Regiones medidas en ciclos.
+ */
+typedef enum {
+    PERF_AS608,            ///< Instrucción al lector: envío, respuesta y reintentos
+    PERF_PANTALLA,         ///< pantalla_texto: escritura y volcado del respaldo
+    PERF_TECLA,            ///< keyDecode
+    PERF_REGIONES
+} perfilador_region_t;
+
+/**
+ * @brief Par de direcciones muestreado y sus apariciones.
+ */
+typedef struct {
+    uint32_t pc;     ///< PC interrumpido (sin el bit Thumb)
+    uint32_t lr;     ///< LR en el momento de la interrupción (sin el bit Thumb)
+    uint32_t cuenta; ///< 0 si la entrada está libre
+} perfilador_muestra_t;
+
+/**
+ * @brief Ciclos de una región.
+ */
+typedef struct {
+    uint32_t cuenta; ///< Pasadas por la región
+    uint32_t min;    ///< Menor duración (ciclos)
+    uint32_t max;    ///< Mayor duración (ciclos)
+    uint64_t total;  ///< Suma de las duraciones (ciclos)
+} perfilador_contador_t;
+
+/**
+ * @brief Instala la interrupción del SysTick, lo arranca sin muestreo y se registra en el
+ * gobernador de reloj.
+ */
+void perfilador_init(void);
+
+/**
+ * @brief Activa o detiene el muestreo; al activarlo se vacía la tabla de muestras.
+ *
+ * @param activo true para muestrear a PERFILADOR_HZ.
+ */
+void perfilador_muestrear(bool activo);
+
+/**
+ * @brief Indica si el muestreo está activo.
+ */
+bool perfilador_muestreando(void);
+
+/**
+ * @brief Ciclos de clk_sys desde perfilador_init (da la vuelta cada 2^32 ciclos). Se puede llamar
+ * desde una interrupción.
+ */
+uint32_t perfilador_ciclos(void);
+
+/**
+ * @brief Marca el comienzo de una región.
+ *
+ * @return uint32_t Ciclo de inicio, que se pasa a perfilador_salir.
+ */
+static inline uint32_t perfilador_entrar(void) {
+    return perfilador_ciclos();
+}
+
+/**
+ * @brief Acumula los ciclos transcurridos desde perfilador_entrar en una región.
+ *
+ * @param region Región medida.
+ * @param inicio Valor devuelto por perfilador_entrar.
+ */
+void perfilador_salir(perfilador_region_t region, uint32_t inicio);
+
+/**
+ * @brief Tabla de muestras (PERFILADOR_ENTRADAS entradas, las libres con cuenta 0).
+ */
+const perfilador_muestra_t *perfilador_tabla(void);
+
+/**
+ * @brief Totales del muestreo.
+ *
+ * @param muestras Muestras anotadas en la tabla.
+ * @param perdidas Muestras descartadas por tabla llena.
+ */
+void perfilador_totales(uint32_t *muestras, uint32_t *perdidas);
+
+/**
+ * @brief Ciclos acumulados de una región.
+ */
+const perfilador_contador_t *perfilador_region(perfilador_region_t region);
+
+/**
+ * @brief Pone en cero los contadores de las regiones.
+ */
+void perfilador_reiniciar_regiones(void);
+
+/**
+ * @brief Nombre corto de una región (como en herramientas/protocolo.py).
+ */
+const char *perfilador_nombre(perfilador_region_t region);
+
+/**
+ * @brief Imprime por stdio las regiones y los pares más frecuentes.
+ */
+void perfilador_volcar(void);
+
+#endif // PERFILADOR_H
@@ -0,0 +1,36 @@
+/**
+ * @file ram.h
+ * @brief Ubicación en SRAM de las rutinas de interrupción y de los caminos calientes.
+ *
+ * El firmware se ejecuta desde la flash QSPI a través de la caché XIP de 16 KiB; un fallo de
+ * caché cuesta varios microsegundos de lectura serie, y la interrupción de barrido del teclado
+ * (cada 2 ms) compite por la caché con el lector y la pantalla. Las funciones marcadas con EN_RAM
+ * (y las tablas con DATOS_EN_RAM) se copian a SRAM al arrancar, así que su latencia no depende de
+ * lo que haya en la caché.
+ *
+ * Con -DCODIGO_EN_FLASH las marcas no tienen efecto, para comparar la etapa 'isr pit' de
+ * latencia.h antes y después. Las funciones del SDK que usan las rutinas de interrupción
+ * (gpio_set_irq_enabled, el despachador de IRQ de GPIO) siguen en flash salvo en la variante
+ * copy_to_ram (-DCAJAFUERTE_COPY_TO_RAM=ON en CMake), que ejecuta todo el programa desde SRAM.
+ *
+ * Sin encabezados del SDK (banco de calidad en el PC) las marcas tampoco tienen efecto.
+ */
+
+#ifndef RAM_H
+#define RAM_H
+
+#if defined(__has_include)
+#if __has_include("pico/platform.h")
+#include "pico/platform.h"
+#endif
+#endif
+
+#if defined(CODIGO_EN_FLASH) || !defined(__not_in_flash_func)
+#define EN_RAM(funcion) funcion
+#define DATOS_EN_RAM(grupo)
+#else
+#define EN_RAM(funcion) __not_in_flash_func(funcion)
+#define DATOS_EN_RAM(grupo) __not_in_flash(grupo)
+#endif
+
+#endif // RAM_H
@@ -0,0 +1,164 @@
+/**
+ * @file registro.c
+ * @brief Registro de huellas eligiendo el mejor par entre N capturas.
+ *
+ * La captura i se extrae en CharBuffer2 y se compara contra cada captura anterior, que se devuelve
+ * a CharBuffer1 con DownChar; luego se sube a RAM con UpChar. Con N capturas son N(N-1)/2
+ * comparaciones; cada una cuesta un DownChar de 512 bytes (unos 100 ms a 57600 baudios) y un Match,
+ * y se hacen mientras el usuario retira el dedo.
+ */
+
+#include <stdio.h>
+#include "registro.h"
+#include "as608.h"
+
+static uint8_t plantillas[REGISTRO_MAX_CAPTURAS][AS608_TEMPLATE_SIZE];
+static size_t longitudes[REGISTRO_MAX_CAPTURAS];
+static uint16_t puntajes[REGISTRO_MAX_CAPTURAS][REGISTRO_MAX_CAPTURAS];
+static bool ultima_en_buffer2; ///< CharBuffer2 tiene la última captura aceptada (el último intento no falló)
+
+/**
+ * @brief Espera el dedo, captura y extrae la plantilla en el buffer indicado.
+ */
+static uint8_t capturar(as608_t *s, uint8_t slot) {
+    as608_wait_touch(s, AS608_TOQUE_ESPERA_MS);
+    uint8_t codigo = as608_get_image(s);
+    if (codigo == AS608_OK) {
+        codigo = as608_image_to_template(s, slot);
+    }
+    return codigo;
+}
+
+/**
+ * @brief Compara la plantilla de CharBuffer2 (captura i) con las capturas anteriores.
+ */
+static uint8_t comparar(as608_t *s, uint8_t i) {
+    for (uint8_t j = 0; j < i; j++) {
+        uint16_t puntaje = 0;
+        uint8_t codigo = as608_download_model(s, 1, plantillas[j], longitudes[j]);
+        if (codigo != AS608_OK) {
+            return codigo;
+        }
+        codigo = as608_match(s, &puntaje);
+        if (codigo != AS608_OK && codigo != AS608_NO_COINCIDE) {
+            return codigo;
+        }
+        puntajes[i][j] = puntajes[j][i] = puntaje;
+        printf("Registro: captura %u contra %u, puntaje %u\n", i + 1, j + 1, puntaje);
+    }
+    return AS608_OK;
+}
+
+/**
+ * @brief Toma las capturas pedidas, tolerando REGISTRO_INTENTOS_EXTRA capturas descartadas.
+ */
+static uint8_t tomar_capturas(as608_t *s, uint8_t capturas, registro_aviso_t avisar, registro_resultado_t *r) {
+    char texto[40];
+
+    while (r->capturas < capturas && r->fallidas <= REGISTRO_INTENTOS_EXTRA) {
+        snprintf(texto, sizeof(texto), "Ponga el dedo.  Captura %u de %u", r->capturas + 1, capturas);
+        avisar(texto);
+        uint8_t codigo = capturar(s, 2);
+        if (codigo == AS608_OK) {
+            codigo = comparar(s, r->capturas);
+        }
+        if (codigo == AS608_OK) {
+            codigo = as608_upload_model(s, 2, plantillas[r->capturas], AS608_TEMPLATE_SIZE,
+                                        &longitudes[r->capturas]);
+        }
+        // Un intento fallido pudo dejar en CharBuffer2 una extracción a medias
+        ultima_en_buffer2 = (codigo == AS608_OK);
+        if (codigo == AS608_OK) {
+            r->capturas++;
+        } else if (as608_is_transient(codigo)) {
+            printf("Registro: captura descartada (0x%02X)\n", codigo);
+            avisar("Captura mala.   Retire el dedo.");
+            r->fallidas++;
+        } else {
+            return codigo;
+        }
+        as608_wait_release(s, AS608_RETIRO_ESPERA_MS);
+    }
+    return r->capturas < 2 ? AS608_POCOS_RASGOS : AS608_OK;
+}
+
+/**
+ * @brief Elige el mejor par, lo combina con RegModel y lo almacena.
+ */
+static uint8_t combinar(as608_t *s, uint16_t posicion, registro_resultado_t *r) {
+    // Con empate gana el par más reciente: su segunda captura suele estar ya en CharBuffer2
+    for (uint8_t i = 1; i < r->capturas; i++) {
+        for (uint8_t j = 0; j < i; j++) {
+            if (puntajes[i][j] >= r->puntaje_par) {
+                r->puntaje_par = puntajes[i][j];
+                r->par[0] = j;
+                r->par[1] = i;
+            }
+        }
+    }
+    printf("Registro: par %u-%u, puntaje %u\n", r->par[0] + 1, r->par[1] + 1, r->puntaje_par);
+    if (r->puntaje_par < REGISTRO_PUNTAJE_MINIMO) {
+        return AS608_SIN_COMBINAR;
+    }
+    uint8_t codigo = as608_download_model(s, 1, plantillas[r->par[0]], longitudes[r->par[0]]);
+    if (codigo == AS608_OK && !(ultima_en_buffer2 && r->par[1] == r->capturas - 1)) {
+        codigo = as608_download_model(s, 2, plantillas[r->par[1]], longitudes[r->par[1]]);
+    }
+    if (codigo == AS608_OK) {
+        codigo = as608_create_model(s);
+    }
+    if (codigo == AS608_OK) {
+        codigo = as608_store_model(s, posicion);
+    }
+    return codigo;
+}
+
+/**
+ * @brief Compara el modelo guardado con una captura nueva; si no coincide lo borra.
+ */
+static uint8_t verificar_modelo(as608_t *s, uint16_t posicion, registro_aviso_t avisar,
+                                registro_resultado_t *r) {
+    uint8_t codigo;
+    uint8_t intentos = 0;
+
+    avisar("Verificando:    ponga el dedo.");
+    while ((codigo = capturar(s, 1)) != AS608_OK && as608_is_transient(codigo) &&
+           ++intentos <= REGISTRO_INTENTOS_EXTRA) {
+        avisar("Captura mala.   Retire el dedo.");
+        as608_wait_release(s, AS608_RETIRO_ESPERA_MS);
+    }
+    if (codigo == AS608_OK) {
+        codigo = as608_load_model(s, 2, posicion);
+    }
+    if (codigo == AS608_OK) {
+        codigo = as608_match(s, &r->puntaje_verificacion);
+    }
+    printf("Registro: verificación 0x%02X, puntaje %u\n", codigo, r->puntaje_verificacion);
+    if (codigo != AS608_OK) {
+        as608_delete_model(s, posicion);
+    }
+    return codigo;
+}
+
+uint8_t registro_mejor_de(as608_t *s, uint16_t posicion, uint8_t capturas, bool verificar,
+                          registro_aviso_t avisar, registro_resultado_t *resultado) {
+    registro_resultado_t r = {0};
+
+    ultima_en_buffer2 = false;
+    if (capturas < 2) {
+        capturas = 2;
+    } else if (capturas > REGISTRO_MAX_CAPTURAS) {
+        capturas = REGISTRO_MAX_CAPTURAS;
+    }
+    uint8_t codigo = tomar_capturas(s, capturas, avisar, &r);
+    if (codigo == AS608_OK) {
+        codigo = combinar(s, posicion, &r);
+    }
+    if (codigo == AS608_OK && verificar) {
+        codigo = verificar_modelo(s, posicion, avisar, &r);
+    }
+    if (resultado) {
+        *resultado = r;
+    }
+    return codigo;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file registro.h
+ * @brief Registro de huellas eligiendo el mejor par entre N capturas.
+ *
+ * El AS608 combina en RegModel exactamente las plantillas de CharBuffer1 y CharBuffer2. En lugar de
+ * quedarse con las dos primeras capturas, se extraen N plantillas, se guardan en RAM (UpChar) y se
+ * compara cada una con las anteriores (DownChar + Match). El par con mayor puntaje es el que se
+ * combina y se almacena; opcionalmente se verifica el modelo guardado con una captura nueva antes de
+ * darlo por bueno.
+ */
+
+#ifndef REGISTRO_H
+#define REGISTRO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "as608.h"
+
+#define REGISTRO_MAX_CAPTURAS 5     ///< Plantillas que se guardan en RAM (512 bytes cada una)
+#define REGISTRO_PUNTAJE_MINIMO 60  ///< Puntaje de Match mínimo del par elegido
+#define REGISTRO_INTENTOS_EXTRA 2   ///< Capturas fallidas toleradas además de las N pedidas
+
+#ifndef REGISTRO_VERIFICAR
+#define REGISTRO_VERIFICAR true     ///< Verificar el modelo guardado con una captura nueva
+#endif
+
+/**
+ * @brief Muestra una indicación al usuario (LCD).
+ */
+typedef void (*registro_aviso_t)(const char *mensaje);
+
+/**
+ * @brief Resumen de un registro.
+ */
+typedef struct {
+    uint8_t capturas;          ///< Plantillas extraídas con éxito
+    uint8_t fallidas;          ///< Capturas descartadas (sin dedo, imagen mala, pocos rasgos)
+    uint8_t par[2];            ///< Capturas combinadas (índices desde 0)
+    uint16_t puntaje_par;      ///< Puntaje de Match del par elegido
+    uint16_t puntaje_verificacion; ///< Puntaje contra el modelo guardado (0 si no se verificó)
+} registro_resultado_t;
+
+/**
+ * @brief Registra una huella en una posición con N capturas.
+ *
+ * @param s Lector en el que se captura y se guarda.
+ * @param posicion Posición de la biblioteca del lector.
+ * @param capturas Capturas a tomar (2 a REGISTRO_MAX_CAPTURAS).
+ * @param verificar Comparar el modelo guardado con una captura nueva; si no coincide se borra.
+ * @param avisar Indicaciones para el usuario.
+ * @param resultado Resumen del registro (puede ser NULL).
+ * @return uint8_t AS608_OK, AS608_SIN_COMBINAR si ningún par alcanza REGISTRO_PUNTAJE_MINIMO,
+ * AS608_NO_COINCIDE si falla la verificación, o el código de la instrucción que falló.
+ */
+uint8_t registro_mejor_de(as608_t *s, uint16_t posicion, uint8_t capturas, bool verificar,
+                          registro_aviso_t avisar, registro_resultado_t *resultado);
+
+#endif // REGISTRO_H
@@ -0,0 +1,149 @@
+/**
+ * @file reloj.c
+ * @brief Gobernador del reloj del sistema con funciones de ajuste por periférico.
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
+#include "hardware/vreg.h"
+#include "reloj.h"
+#include "latencia.h"
+
+typedef struct {
+    uint32_t khz;
+    enum vreg_voltage vreg;
+} reloj_punto_t;
+
+static const reloj_punto_t puntos[] = {
+    [RELOJ_BAJO] = {RELOJ_BAJO_KHZ, RELOJ_BAJO_VREG},
+    [RELOJ_NOMINAL] = {SYS_CLK_KHZ, RELOJ_NOMINAL_VREG},
+    [RELOJ_ALTO] = {RELOJ_ALTO_KHZ, RELOJ_ALTO_VREG},
+};
+
+static struct {
+    reloj_ajuste_t ajuste;
+    void *ctx;
+} ajustes[RELOJ_AJUSTES];
+static uint8_t num_ajustes = 0;
+
+static reloj_perfil_t base = RELOJ_NOMINAL;
+static uint8_t impulsos = 0;
+static uint32_t khz_actual = SYS_CLK_KHZ;
+static enum vreg_voltage vreg_actual = RELOJ_NOMINAL_VREG;
+static uint32_t cambios = 0;
+
+bool reloj_registrar(reloj_ajuste_t ajuste, void *ctx) {
+    if (num_ajustes == RELOJ_AJUSTES) {
+        return false;
+    }
+    ajustes[num_ajustes].ajuste = ajuste;
+    ajustes[num_ajustes].ctx = ctx;
+    num_ajustes++;
+    return true;
+}
+
+static void notificar(void) {
+    for (uint8_t i = 0; i < num_ajustes; i++) {
+        ajustes[i].ajuste(ajustes[i].ctx);
+    }
+}
+
+/**
+ * @brief Deja clk_peri en el PLL de USB (48 MHz), fuera del camino de clk_sys.
+ */
+static void fijar_peri(void) {
+    clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB, 48 * MHZ, 48 * MHZ);
+}
+
+void reloj_init(void) {
+    fijar_peri();
+    notificar();
+}
+
+// Solo la subida necesita esperar: al bajar, la frecuencia ya es la que soporta la tensión nueva
+static void fijar_tension(enum vreg_voltage vreg) {
+    if (vreg != vreg_actual) {
+        vreg_set_voltage(vreg);
+        if (vreg > vreg_actual) {
+            sleep_us(RELOJ_VREG_US);
+        }
+        vreg_actual = vreg;
+    }
+}
+
+/**
+ * @brief Lleva clk_sys al punto del perfil y reprograma los periféricos.
+ *
+ * Igual que set_sys_clock_khz, pero sin tocar clk_peri: mientras el PLL del sistema se reconfigura
+ * clk_sys sale del PLL de USB, así que el UART, el I2C y el SPI no ven ningún salto a mitad de una
+ * trama. Solo lo que cuenta con clk_sys (el PWM) cambia de ritmo.
+ *
+ * @param forzar Reprograma aunque la frecuencia registrada sea la misma (los relojes cambiaron
+ * por fuera del gobernador).
+ */
+static void aplicar(reloj_perfil_t perfil, bool forzar) {
+    const reloj_punto_t *p = &puntos[perfil];
+    uint vco, div1, div2;
+    uint64_t inicio = time_us_64();
+
+    if (p->khz == khz_actual && !forzar) {
+        return;
+    }
+    if (!check_sys_clock_khz(p->khz, &vco, &div1, &div2)) {
+        return;
+    }
+    if (p->vreg > vreg_actual) {
+        fijar_tension(p->vreg);
+    }
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX,
+                    CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB, 48 * MHZ, 48 * MHZ);
+    pll_init(pll_sys, 1, vco, div1, div2);
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX,
+                    CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS, p->khz * KHZ, p->khz * KHZ);
+    khz_actual = p->khz;
+    fijar_tension(p->vreg);
+    notificar();
+    cambios++;
+    latencia_registrar(LAT_RELOJ, (uint32_t)(time_us_64() - inicio));
+}
+
+void reloj_base(reloj_perfil_t perfil) {
+    base = perfil;
+    if (!impulsos) {
+        aplicar(base, false);
+    }
+}
+
+void reloj_impulsar(void) {
+    if (impulsos++ == 0) {
+        aplicar(RELOJ_ALTO, false);
+    }
+}
+
+void reloj_soltar(void) {
+    if (impulsos && --impulsos == 0) {
+        aplicar(base, false);
+    }
+}
+
+void reloj_tension_nominal(void) {
+    if (vreg_actual < RELOJ_NOMINAL_VREG) {
+        fijar_tension(RELOJ_NOMINAL_VREG);
+    }
+}
+
+void reloj_restituir(void) {
+    // clocks_init deja clk_sys en SYS_CLK_KHZ y clk_peri en clk_sys; no toca el regulador
+    khz_actual = SYS_CLK_KHZ;
+    fijar_peri();
+    aplicar(impulsos ? RELOJ_ALTO : base, true);
+}
+
+uint32_t reloj_khz(void) {
+    return khz_actual;
+}
+
+uint32_t reloj_cambios(void) {
+    return cambios;
+}
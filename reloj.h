@@ -0,0 +1,110 @@
+/**
+ * @file reloj.h
+ * @brief Gobernador del reloj del sistema: frecuencia y tensión bajas mientras la caja espera,
+ * y un impulso a frecuencia alta durante el cálculo en el microcontrolador (hash del PIN,
+ * evaluación de la imagen).
+ *
+ * set_sys_clock_khz del SDK también mueve clk_peri, y con él los divisores efectivos del UART, el
+ * I2C y el SPI. El gobernador en cambio deja clk_peri fijo en el PLL de USB (48 MHz) y solo cambia
+ * clk_sys, del que cuenta el PWM. Cada controlador registra una función de ajuste que reprograma
+ * su divisor a partir de clock_get_hz; el gobernador las llama tras cada cambio, y también cuando
+ * clk_peri cambia (reloj_init, o clocks_init al salir de dormant). Los plazos (time_us_64,
+ * sleep_ms) salen del timer, que cuenta con clk_ref y no se ve afectado.
+ *
+ * La tensión se sube antes de subir la frecuencia y se baja después de bajarla.
+ */
+
+#ifndef RELOJ_H
+#define RELOJ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef RELOJ_BAJO_KHZ
+#define RELOJ_BAJO_KHZ 48000     ///< Espera de teclas y del lector (PLL a 1440 MHz / 6 / 5)
+#endif
+#ifndef RELOJ_BAJO_VREG
+#define RELOJ_BAJO_VREG VREG_VOLTAGE_0_95
+#endif
+#ifndef RELOJ_ALTO_KHZ
+#define RELOJ_ALTO_KHZ 133000    ///< Máximo del datasheet; -DRELOJ_ALTO_KHZ=200000 con -DRELOJ_ALTO_VREG=VREG_VOLTAGE_1_15
+#endif
+#ifndef RELOJ_ALTO_VREG
+#define RELOJ_ALTO_VREG VREG_VOLTAGE_1_10
+#endif
+#define RELOJ_NOMINAL_VREG VREG_VOLTAGE_1_10  ///< Tensión de arranque del SDK (SYS_CLK_KHZ)
+#define RELOJ_VREG_US 1000       ///< Estabilización del regulador tras subir la tensión
+#define RELOJ_AJUSTES 8          ///< Funciones de ajuste registrables
+
+/**
+ * @brief Perfiles de reloj.
+ */
+typedef enum {
+    RELOJ_BAJO,     ///< RELOJ_BAJO_KHZ a RELOJ_BAJO_VREG
+    RELOJ_NOMINAL,  ///< SYS_CLK_KHZ, como tras el arranque
+    RELOJ_ALTO,     ///< RELOJ_ALTO_KHZ a RELOJ_ALTO_VREG
+} reloj_perfil_t;
+
+/**
+ * @brief Reprograma los divisores de un periférico tras un cambio de reloj.
+ *
+ * @param ctx Contexto dado al registrarla.
+ */
+typedef void (*reloj_ajuste_t)(void *ctx);
+
+/**
+ * @brief Pasa clk_peri al PLL de USB y llama a las funciones de ajuste ya registradas.
+ */
+void reloj_init(void);
+
+/**
+ * @brief Registra una función de ajuste; se llama después de cada cambio de frecuencia.
+ *
+ * @param ajuste Función de ajuste.
+ * @param ctx Contexto que recibe.
+ * @return true si había lugar.
+ */
+bool reloj_registrar(reloj_ajuste_t ajuste, void *ctx);
+
+/**
+ * @brief Fija el perfil fuera de los impulsos.
+ *
+ * @param perfil Perfil base.
+ */
+void reloj_base(reloj_perfil_t perfil);
+
+/**
+ * @brief Pasa a RELOJ_ALTO hasta el reloj_soltar correspondiente; se pueden anidar.
+ */
+void reloj_impulsar(void);
+
+/**
+ * @brief Termina un impulso; con el último se vuelve al perfil base.
+ */
+void reloj_soltar(void);
+
+/**
+ * @brief Sube la tensión a la nominal si hace falta, antes de que otro código lleve clk_sys a
+ * SYS_CLK_KHZ (clocks_init al salir de dormant).
+ */
+void reloj_tension_nominal(void);
+
+/**
+ * @brief Vuelve a aplicar el perfil vigente después de que otro código reconfiguró los relojes
+ * (clocks_init al salir de dormant).
+ */
+void reloj_restituir(void);
+
+/**
+ * @brief Frecuencia actual de clk_sys.
+ *
+ * @return uint32_t Frecuencia en kHz.
+ */
+uint32_t reloj_khz(void);
+
+/**
+ * @brief Cuenta los cambios de frecuencia hechos desde el arranque.
+ */
+uint32_t reloj_cambios(void);
+
+#endif // RELOJ_H
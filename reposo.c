@@ -0,0 +1,119 @@
+/**
+ * @file reposo.c
+ * @brief Reposo tras inactividad: dormant del RP2040 sin USB, __wfi con USB.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/pll.h"
+#include "hardware/xosc.h"
+#include "hardware/structs/rosc.h"
+#include "reposo.h"
+#include "pantalla.h"
+#include "latencia.h"
+#include "reloj.h"
+#include "ram.h"
+
+#ifndef XOSC_MHZ
+#define XOSC_MHZ 12
+#endif
+
+static uint32_t pines_despertar = 0;
+static uint64_t ultima_actividad = 0;
+static bool dormido = false;
+static volatile bool despierta = false;
+
+void reposo_init(uint32_t pines) {
+    pines_despertar = pines;
+    ultima_actividad = time_us_64();
+}
+
+void EN_RAM(reposo_despertar)(void) {
+    if (dormido && !despierta) {
+        latencia_abrir(LAT_DESPERTAR);
+        despierta = true;
+    }
+}
+
+void reposo_actividad(void) {
+    ultima_actividad = time_us_64();
+    reposo_despertar();
+}
+
+bool reposo_vencido(void) {
+    return REPOSO_SEGUNDOS > 0 && !dormido &&
+           time_us_64() - ultima_actividad >= (uint64_t)REPOSO_SEGUNDOS * 1000000;
+}
+
+/**
+ * @brief Dormant hasta un flanco de subida en pines_despertar y vuelta a los relojes normales.
+ *
+ * Mismo orden que sleep_run_from_xosc y sleep_goto_dormant_until_pin de pico-extras: clk_ref y
+ * clk_sys pasan al XOSC, se detienen clk_usb y clk_adc y los PLL, y se apaga el ROSC; al detener
+ * el XOSC se detiene todo. El timer también se detiene, así que el tiempo en dormant no cuenta.
+ */
+static void dormant(void) {
+    const uint32_t hz = XOSC_MHZ * MHZ;
+
+    clock_configure(clk_ref, CLOCKS_CLK_REF_CTRL_SRC_VALUE_XOSC_CLKSRC, 0, hz, hz);
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF, 0, hz, hz);
+    clock_stop(clk_usb);
+    clock_stop(clk_adc);
+    clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS, hz, hz);
+    pll_deinit(pll_sys);
+    pll_deinit(pll_usb);
+    rosc_hw->ctrl = (rosc_hw->ctrl & ~ROSC_CTRL_ENABLE_BITS) | (ROSC_CTRL_ENABLE_VALUE_DISABLE << ROSC_CTRL_ENABLE_LSB);
+
+    for (uint pin = 0; pin < 32; pin++) {
+        if (pines_despertar & (1u << pin)) {
+            gpio_set_dormant_irq_enabled(pin, GPIO_IRQ_EDGE_RISE, true);
+        }
+    }
+    xosc_dormant();
+    // El XOSC ya arrancó: desde aquí se mide hasta la operación completa. Las IRQ del flanco
+    // quedan pendientes y llegan por el callback de siempre (que también llama a reposo_despertar).
+    reposo_despertar();
+    for (uint pin = 0; pin < 32; pin++) {
+        if (pines_despertar & (1u << pin)) {
+            gpio_set_dormant_irq_enabled(pin, GPIO_IRQ_EDGE_RISE, false);
+        }
+    }
+
+    rosc_hw->ctrl = (rosc_hw->ctrl & ~ROSC_CTRL_ENABLE_BITS) | (ROSC_CTRL_ENABLE_VALUE_ENABLE << ROSC_CTRL_ENABLE_LSB);
+    // clocks_init vuelve a SYS_CLK_KHZ con clk_peri en clk_sys; el gobernador retoma su perfil
+    reloj_tension_nominal();
+    clocks_init();
+    reloj_restituir();
+}
+
+void reposo_entrar(void) {
+    bool usb = stdio_usb_connected();
+
+    printf("Reposo (%s)\n", usb ? "wfi, USB conectado" : "dormant");
+    stdio_flush();
+    pantalla_encender(false);
+    despierta = false;
+    dormido = true;
+    if (!usb) {
+        dormant();
+    }
+}
+
+bool reposo_dormido(void) {
+    return dormido;
+}
+
+bool reposo_despierta(void) {
+    return despierta;
+}
+
+void reposo_salir(void) {
+    pantalla_encender(true);
+    dormido = false;
+    despierta = false;
+    ultima_actividad = time_us_64();
+    latencia_cerrar(LAT_DESPERTAR);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file reposo.h
+ * @brief Reposo de bajo consumo tras un tiempo sin actividad, con el teclado y la línea de toque
+ * del lector como fuentes de despertar.
+ *
+ * En reposo la pantalla se apaga (luz de fondo del LCD u OLED) y, sin anfitrión USB (con batería
+ * de respaldo), el RP2040 pasa a dormant: los relojes se mueven al XOSC, se apagan los PLL y el
+ * ROSC, y el XOSC se detiene hasta un flanco de subida en uno de los pines de despertar. Con USB
+ * conectado la placa se alimenta del anfitrión y el dormant cortaría el enlace de gestión, así que
+ * el ciclo principal solo duerme con __wfi hasta una interrupción.
+ *
+ * Quien llama prepara el teclado antes de reposo_entrar (sin secuencia de filas, todas activas para
+ * que cualquier tecla suba su columna) y lo restituye al despertar, antes de reposo_salir. La
+ * latencia desde el despertar hasta la operación completa se mide en LAT_DESPERTAR.
+ */
+
+#ifndef REPOSO_H
+#define REPOSO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef REPOSO_SEGUNDOS
+#define REPOSO_SEGUNDOS 30  ///< Inactividad antes del reposo; 0 lo desactiva
+#endif
+
+/**
+ * @brief Fija los pines que despiertan (flanco de subida) y empieza a contar la inactividad.
+ *
+ * @param pines Máscara de GPIO.
+ */
+void reposo_init(uint32_t pines);
+
+/**
+ * @brief Registra actividad desde el ciclo principal (tecla atendida, etapa del lector, USB).
+ * En reposo ligero también despierta.
+ */
+void reposo_actividad(void);
+
+/**
+ * @brief Registra un flanco de despertar desde una interrupción GPIO.
+ */
+void reposo_despertar(void);
+
+/**
+ * @brief Indica si pasaron REPOSO_SEGUNDOS sin actividad y aún no se está en reposo.
+ */
+bool reposo_vencido(void);
+
+/**
+ * @brief Apaga la pantalla y duerme.
+ *
+ * Sin USB bloquea en dormant hasta un flanco y restituye los relojes antes de volver; con USB vuelve
+ * enseguida y el ciclo principal debe dormir con __wfi mientras reposo_dormido() y no
+ * reposo_despierta().
+ */
+void reposo_entrar(void);
+
+/**
+ * @brief Indica si se está en reposo (desde reposo_entrar hasta reposo_salir).
+ */
+bool reposo_dormido(void);
+
+/**
+ * @brief Indica si llegó un flanco o hubo actividad desde reposo_entrar.
+ */
+bool reposo_despierta(void);
+
+/**
+ * @brief Enciende la pantalla, cierra la medición de LAT_DESPERTAR y vuelve a contar la inactividad.
+ */
+void reposo_salir(void);
+
+#endif // REPOSO_H
@@ -0,0 +1,468 @@
+/**
+ * @file as608_emu.c
+ * @brief Emulador del lector AS608: habla el protocolo de paquetes real (0xEF01, checksum)
+ * con latencias de procesamiento configurables por instrucción.
+ *
+ * Las "huellas" son identificadores enteros: un dedo con id N produce una plantilla sintética
+ * cuyo contenido codifica N, de modo que UpChar/DownChar conservan la identidad.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+#define EMU_MAX_PAQUETE 300
+#define EMU_MAX_POSICIONES 1000
+#define EMU_PLANTILLA 512
+#define EMU_IMAGEN_ANCHO 256
+#define EMU_IMAGEN_ALTO 288
+#define EMU_IMAGEN_BYTES (EMU_IMAGEN_ANCHO * EMU_IMAGEN_ALTO / 2)
+
+typedef enum {
+    RX_EF,
+    RX_01,
+    RX_DIRECCION,
+    RX_PID,
+    RX_LEN_H,
+    RX_LEN_L,
+    RX_CONTENIDO
+} emu_rx_estado_t;
+
+typedef struct {
+    emu_rx_estado_t estado;
+    uint8_t paquete[EMU_MAX_PAQUETE];
+    size_t n;
+    size_t longitud;
+    uint8_t pid;
+
+    uint64_t ocupado_hasta;       ///< El sensor procesa una instrucción a la vez
+    uint32_t latencia_ms[256];
+    bool no_soportada[256];       ///< Instrucciones que este firmware del módulo rechaza
+    uint16_t capacidad;
+    uint16_t tam_paquete;         ///< Longitud de los paquetes de datos
+    int biblioteca[EMU_MAX_POSICIONES];
+    int imagen;                   ///< Huella en el buffer de imagen (-1 = vacío)
+    int buffer_car[2];            ///< Huellas en CharBuffer1/2
+    int dedo;                     ///< Dedo sobre el sensor (-1 = ninguno)
+    bool mala_calidad;
+
+    int descarga_buffer;          ///< CharBuffer destino de un DownChar en curso (-1 = ninguno)
+    uint8_t descarga[EMU_PLANTILLA * 2];
+    size_t descarga_n;
+} as608_emu_t;
+
+static as608_emu_t emus[2];
+
+static void latencias_por_defecto(as608_emu_t *e) {
+    for (int i = 0; i < 256; i++) {
+        e->latencia_ms[i] = 5;
+    }
+    e->latencia_ms[0x01] = 200; // GenImg
+    e->latencia_ms[0x02] = 300; // Img2Tz
+    e->latencia_ms[0x03] = 50;  // Match
+    e->latencia_ms[0x04] = 300; // Search
+    e->latencia_ms[0x05] = 100; // RegModel
+    e->latencia_ms[0x06] = 60;  // Store
+    e->latencia_ms[0x07] = 30;  // LoadChar
+    e->latencia_ms[0x0C] = 40;  // DeletChar
+    e->latencia_ms[0x0D] = 150; // Empty
+    e->latencia_ms[0x11] = 600; // Identify: Img2Tz + Search internos (GenImg se suma aparte)
+}
+
+void as608_emu_init(unsigned int uart) {
+    as608_emu_t *e = &emus[uart];
+    // La biblioteca y las latencias sobreviven a uart_init (se fijan desde el guion)
+    e->estado = RX_EF;
+    e->imagen = -1;
+    e->buffer_car[0] = e->buffer_car[1] = -1;
+    e->descarga_buffer = -1;
+    e->ocupado_hasta = 0;
+}
+
+static void __attribute__((constructor)) emus_arranque(void) {
+    for (unsigned int u = 0; u < 2; u++) {
+        as608_emu_t *e = &emus[u];
+        memset(e, 0, sizeof(*e));
+        latencias_por_defecto(e);
+        e->capacidad = 300;
+        e->tam_paquete = 128;
+        e->dedo = -1;
+        for (int i = 0; i < EMU_MAX_POSICIONES; i++) {
+            e->biblioteca[i] = -1;
+        }
+        as608_emu_init(u);
+    }
+}
+
+void as608_emu_dedo(unsigned int uart, int id, bool mala_calidad) {
+    emus[uart].dedo = id;
+    emus[uart].mala_calidad = mala_calidad;
+}
+
+void as608_emu_latencia(unsigned int uart, uint8_t instruccion, uint32_t ms) {
+    emus[uart].latencia_ms[instruccion] = ms;
+}
+
+void as608_emu_soportar(unsigned int uart, uint8_t instruccion, bool soportada) {
+    emus[uart].no_soportada[instruccion] = !soportada;
+}
+
+void as608_emu_huella(unsigned int uart, uint16_t posicion, int id) {
+    if (posicion < EMU_MAX_POSICIONES) {
+        emus[uart].biblioteca[posicion] = id;
+    }
+}
+
+void as608_emu_capacidad(unsigned int uart, uint16_t capacidad) {
+    emus[uart].capacidad = capacidad <= EMU_MAX_POSICIONES ? capacidad : EMU_MAX_POSICIONES;
+}
+
+/**
+ * @brief Encola un paquete de salida hacia el microcontrolador a partir del instante t.
+ *
+ * @return uint64_t Instante en que termina de transmitirse.
+ */
+static uint64_t enviar(unsigned int uart, uint8_t pid, const uint8_t *datos, size_t len, uint64_t t) {
+    uint32_t byte_us = sim_uart_us_por_byte(uart);
+    uint16_t longitud = len + 2;
+    uint8_t cab[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, pid, longitud >> 8, longitud & 0xFF};
+    uint16_t suma = pid + cab[7] + cab[8];
+
+    for (size_t i = 0; i < sizeof(cab); i++) {
+        sim_uart_rx(uart, cab[i], t += byte_us);
+    }
+    for (size_t i = 0; i < len; i++) {
+        suma += datos[i];
+        sim_uart_rx(uart, datos[i], t += byte_us);
+    }
+    sim_uart_rx(uart, suma >> 8, t += byte_us);
+    sim_uart_rx(uart, suma & 0xFF, t += byte_us);
+    return t;
+}
+
+static void plantilla(int id, uint8_t *datos) {
+    for (int i = 0; i < EMU_PLANTILLA; i++) {
+        datos[i] = (uint8_t)(id * 31 + i * 7);
+    }
+    datos[0] = 'F';
+    datos[1] = 'P';
+    datos[2] = id >> 8;
+    datos[3] = id & 0xFF;
+}
+
+static int plantilla_id(const uint8_t *datos, size_t len) {
+    if (len < 4 || datos[0] != 'F' || datos[1] != 'P') {
+        return -1;
+    }
+    return (datos[2] << 8) | datos[3];
+}
+
+/**
+ * @brief Imagen sintética de 4 bits por píxel: crestas concéntricas oscuras sobre fondo blanco
+ * dentro de una elipse; con mala calidad, bajo contraste y ruido.
+ */
+static void imagen(int id, bool mala, uint8_t *datos) {
+    uint32_t ruido = 0x12345678u ^ (uint32_t)id;
+    for (int y = 0; y < EMU_IMAGEN_ALTO; y++) {
+        for (int x = 0; x < EMU_IMAGEN_ANCHO; x++) {
+            int dx = x - EMU_IMAGEN_ANCHO / 2;
+            int dy = y - EMU_IMAGEN_ALTO / 2;
+            uint8_t v = 15;
+            if (dx * dx * 130 * 130 + dy * dy * 100 * 100 < 100 * 100 * 130 * 130) {
+                int r2 = dx * dx + dy * dy + id * 37;
+                int cresta = 0;
+                while ((cresta + 1) * (cresta + 1) * 36 <= r2) {
+                    cresta++;
+                }
+                ruido = ruido * 1103515245u + 12345u;
+                v = mala ? 6 + ((ruido >> 16) & 3) : ((cresta & 1) ? 2 : 12);
+            }
+            uint8_t *b = &datos[(y * EMU_IMAGEN_ANCHO + x) / 2];
+            *b = (x & 1) ? ((*b & 0xF0) | v) : (uint8_t)((v << 4) | (*b & 0x0F));
+        }
+    }
+}
+
+/**
+ * @brief Busca la huella de un CharBuffer en la biblioteca; deja posición y puntaje en resp[1..4].
+ */
+static uint8_t buscar(as608_emu_t *e, int buscado, uint32_t inicio, uint32_t cantidad, uint8_t *resp) {
+    for (uint32_t i = inicio; i < inicio + cantidad && i < e->capacidad; i++) {
+        if (buscado >= 0 && e->biblioteca[i] == buscado) {
+            resp[1] = i >> 8;
+            resp[2] = i & 0xFF;
+            resp[3] = 0;
+            resp[4] = 150;
+            return 0x00;
+        }
+    }
+    return 0x09;
+}
+
+/**
+ * @brief Ejecuta una instrucción recibida en el instante t y programa la respuesta.
+ */
+static void ejecutar(unsigned int uart, const uint8_t *p, size_t len, uint64_t t) {
+    as608_emu_t *e = &emus[uart];
+    uint8_t resp[64] = {0};
+    size_t n = 1;
+    uint8_t ins = p[0];
+
+    if (t < e->ocupado_hasta) {
+        t = e->ocupado_hasta;
+    }
+    if (ins == 0x11) {
+        // Sin dedo el módulo responde tras la captura, sin extraer ni buscar
+        t += (uint64_t)e->latencia_ms[0x01] * 1000;
+    }
+    if (ins != 0x11 || e->dedo >= 0) {
+        t += (uint64_t)e->latencia_ms[ins] * 1000;
+    }
+
+    if (e->no_soportada[ins]) {
+        resp[0] = 0x01;
+        e->ocupado_hasta = enviar(uart, 0x07, resp, n, t);
+        return;
+    }
+    switch (ins) {
+        case 0x01: // GenImg
+            if (e->dedo >= 0) {
+                e->imagen = e->dedo;
+            } else {
+                resp[0] = 0x02;
+            }
+            break;
+        case 0x02: // Img2Tz
+            if (len < 2 || p[1] < 1 || p[1] > 2) {
+                resp[0] = 0x01;
+            } else if (e->imagen < 0) {
+                resp[0] = 0x15;
+            } else if (e->mala_calidad) {
+                resp[0] = 0x06;
+                e->buffer_car[p[1] - 1] = -1; // La extracción fallida pisa el buffer
+            } else {
+                e->buffer_car[p[1] - 1] = e->imagen;
+            }
+            break;
+        case 0x03: // Match
+            if (e->buffer_car[0] >= 0 && e->buffer_car[0] == e->buffer_car[1]) {
+                resp[1] = 0;
+                resp[2] = 180;
+            } else {
+                resp[0] = 0x08;
+            }
+            n = 3;
+            break;
+        case 0x04: { // Search: buffer, inicio, cantidad
+            uint16_t inicio = (p[2] << 8) | p[3];
+            uint16_t cantidad = (p[4] << 8) | p[5];
+            resp[0] = buscar(e, e->buffer_car[(p[1] == 2) ? 1 : 0], inicio, cantidad, resp);
+            n = 5;
+            break;
+        }
+        case 0x05: // RegModel
+            if (e->buffer_car[0] < 0 || e->buffer_car[0] != e->buffer_car[1]) {
+                resp[0] = 0x0A;
+            }
+            break;
+        case 0x06: { // Store: buffer, posición
+            uint16_t pos = (p[2] << 8) | p[3];
+            int car = e->buffer_car[(p[1] == 2) ? 1 : 0];
+            if (pos >= e->capacidad) {
+                resp[0] = 0x0B;
+            } else if (car < 0) {
+                resp[0] = 0x18;
+            } else {
+                e->biblioteca[pos] = car;
+            }
+            break;
+        }
+        case 0x07: { // LoadChar
+            uint16_t pos = (p[2] << 8) | p[3];
+            if (pos >= e->capacidad) {
+                resp[0] = 0x0B;
+            } else if (e->biblioteca[pos] < 0) {
+                resp[0] = 0x0C;
+            } else {
+                e->buffer_car[(p[1] == 2) ? 1 : 0] = e->biblioteca[pos];
+            }
+            break;
+        }
+        case 0x08: { // UpChar: confirmación y luego la plantilla en paquetes de datos
+            uint8_t datos[EMU_PLANTILLA];
+            int car = e->buffer_car[(p[1] == 2) ? 1 : 0];
+            if (car < 0) {
+                resp[0] = 0x0D;
+                break;
+            }
+            plantilla(car, datos);
+            t = enviar(uart, 0x07, resp, 1, t);
+            for (size_t i = 0; i < EMU_PLANTILLA; i += e->tam_paquete) {
+                size_t trozo = EMU_PLANTILLA - i < e->tam_paquete ? EMU_PLANTILLA - i : e->tam_paquete;
+                t = enviar(uart, (i + trozo < EMU_PLANTILLA) ? 0x02 : 0x08, &datos[i], trozo, t);
+            }
+            e->ocupado_hasta = t;
+            return;
+        }
+        case 0x09: // DownChar: los paquetes de datos llegan después de la confirmación
+            e->descarga_buffer = (p[1] == 2) ? 1 : 0;
+            e->descarga_n = 0;
+            break;
+        case 0x0A: { // UpImage: confirmación y luego la imagen en paquetes de datos
+            static uint8_t datos[EMU_IMAGEN_BYTES];
+            if (e->imagen < 0) {
+                resp[0] = 0x0F;
+                break;
+            }
+            imagen(e->imagen, e->mala_calidad, datos);
+            t = enviar(uart, 0x07, resp, 1, t);
+            for (size_t i = 0; i < EMU_IMAGEN_BYTES; i += e->tam_paquete) {
+                t = enviar(uart, (i + e->tam_paquete < EMU_IMAGEN_BYTES) ? 0x02 : 0x08, &datos[i], e->tam_paquete, t);
+            }
+            e->ocupado_hasta = t;
+            return;
+        }
+        case 0x0C: { // DeletChar: posición, cantidad
+            uint16_t pos = (p[1] << 8) | p[2];
+            uint16_t cantidad = (p[3] << 8) | p[4];
+            if (pos >= e->capacidad || (uint32_t)pos + cantidad > e->capacidad) {
+                resp[0] = 0x10;
+                break;
+            }
+            for (uint16_t i = 0; i < cantidad; i++) {
+                e->biblioteca[pos + i] = -1;
+            }
+            break;
+        }
+        case 0x0D: // Empty
+            for (int i = 0; i < EMU_MAX_POSICIONES; i++) {
+                e->biblioteca[i] = -1;
+            }
+            break;
+        case 0x0E: // SetSysPara: parámetro, valor (solo la longitud de paquete)
+            if (p[1] == 6 && p[2] <= 3) {
+                e->tam_paquete = 32u << p[2];
+            } else {
+                resp[0] = 0x1A;
+            }
+            break;
+        case 0x0F: // ReadSysPara: 16 bytes
+            resp[5] = e->capacidad >> 8;
+            resp[6] = e->capacidad & 0xFF;
+            resp[8] = 3;
+            resp[9] = resp[10] = resp[11] = resp[12] = 0xFF;
+            resp[14] = __builtin_ctz(e->tam_paquete / 32);
+            resp[16] = 6;
+            n = 17;
+            break;
+        case 0x11: // Identify: captura, extracción a CharBuffer1 y búsqueda en toda la biblioteca
+            n = 5;
+            if (e->dedo < 0) {
+                resp[0] = 0x02;
+            } else if (e->mala_calidad) {
+                e->imagen = e->dedo;
+                resp[0] = 0x06;
+            } else {
+                e->imagen = e->buffer_car[0] = e->dedo;
+                resp[0] = buscar(e, e->dedo, 0, e->capacidad, resp);
+            }
+            break;
+        case 0x13: // VfyPwd
+            break;
+        case 0x1D: { // TempleteNum
+            uint16_t cuenta = 0;
+            for (int i = 0; i < e->capacidad; i++) {
+                cuenta += e->biblioteca[i] >= 0;
+            }
+            resp[1] = cuenta >> 8;
+            resp[2] = cuenta & 0xFF;
+            n = 3;
+            break;
+        }
+        case 0x1F: // ReadConList: página de 256 posiciones
+            for (int i = 0; i < 256; i++) {
+                int pos = p[1] * 256 + i;
+                if (pos < e->capacidad && e->biblioteca[pos] >= 0) {
+                    resp[1 + i / 8] |= 1 << (i % 8);
+                }
+            }
+            n = 33;
+            break;
+        default:
+            // Instrucción no soportada por este firmware del módulo
+            resp[0] = 0x01;
+            break;
+    }
+    e->ocupado_hasta = enviar(uart, 0x07, resp, n, t);
+}
+
+/**
+ * @brief Paquete de datos recibido durante un DownChar.
+ */
+static void recibir_datos(unsigned int uart, uint8_t pid, const uint8_t *datos, size_t len) {
+    as608_emu_t *e = &emus[uart];
+    if (e->descarga_buffer < 0) {
+        return;
+    }
+    if (e->descarga_n + len <= sizeof(e->descarga)) {
+        memcpy(&e->descarga[e->descarga_n], datos, len);
+        e->descarga_n += len;
+    }
+    if (pid == 0x08) {
+        e->buffer_car[e->descarga_buffer] = plantilla_id(e->descarga, e->descarga_n);
+        e->descarga_buffer = -1;
+    }
+}
+
+void as608_emu_recibir(unsigned int uart, uint8_t byte, uint64_t t) {
+    as608_emu_t *e = &emus[uart];
+
+    switch (e->estado) {
+        case RX_EF:
+            if (byte == 0xEF) {
+                e->estado = RX_01;
+            }
+            break;
+        case RX_01:
+            e->estado = (byte == 0x01) ? RX_DIRECCION : RX_EF;
+            e->n = 0;
+            break;
+        case RX_DIRECCION:
+            if (++e->n == 4) {
+                e->estado = RX_PID;
+            }
+            break;
+        case RX_PID:
+            e->pid = byte;
+            e->estado = RX_LEN_H;
+            break;
+        case RX_LEN_H:
+            e->longitud = byte << 8;
+            e->estado = RX_LEN_L;
+            break;
+        case RX_LEN_L:
+            e->longitud |= byte;
+            e->n = 0;
+            e->estado = (e->longitud >= 2 && e->longitud <= EMU_MAX_PAQUETE) ? RX_CONTENIDO : RX_EF;
+            break;
+        case RX_CONTENIDO:
+            e->paquete[e->n++] = byte;
+            if (e->n == e->longitud) {
+                size_t len = e->longitud - 2;
+                uint16_t suma = e->pid + (e->longitud >> 8) + (e->longitud & 0xFF);
+                for (size_t i = 0; i < len; i++) {
+                    suma += e->paquete[i];
+                }
+                e->estado = RX_EF;
+                if (((e->paquete[len] << 8) | e->paquete[len + 1]) != suma) {
+                    uint8_t error = 0x01;
+                    e->ocupado_hasta = enviar(uart, 0x07, &error, 1, t);
+                } else if (e->pid == 0x01 && len > 0) {
+                    ejecutar(uart, e->paquete, len, t);
+                } else if (e->pid == 0x02 || e->pid == 0x08) {
+                    recibir_datos(uart, e->pid, e->paquete, len);
+                }
+            }
+            break;
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * @file calidad_banco.c
+ * @brief Banco de pruebas en el host del estimador de calidad (calidad.c) con imágenes grabadas.
+ *
+ * Lee imágenes PGM de 256x288 (las que guarda `gestion.py imagen`), las pasa a calidad_bloque en
+ * bloques del tamaño de un paquete de UpImage, e imprime los puntajes, el veredicto y el tiempo
+ * medio por imagen.
+ *
+ * Con -e lista.txt las imágenes salen de la lista (líneas "imagen veredicto", rutas relativas a la
+ * lista, veredicto como ok, poco_contacto, descentrada o borrosa) y el programa termina con código 1
+ * si algún veredicto no coincide. sim/capturas/veredictos.txt es la lista de referencia.
+ *
+ * Uso: calidad_banco [-n repeticiones] [-b pixeles_por_bloque] imagen.pgm ...
+ *      calidad_banco [-n repeticiones] [-b pixeles_por_bloque] -e lista.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "calidad.h"
+
+static const char *const veredictos[] = {"ok", "poco contacto", "descentrada", "borrosa"};
+static const char *const claves[] = {"ok", "poco_contacto", "descentrada", "borrosa"}; ///< Como en las listas
+
+static bool leer_pgm(const char *ruta, uint8_t *pixeles) {
+    FILE *f = fopen(ruta, "rb");
+    int ancho, alto, maximo;
+    if (!f) {
+        return false;
+    }
+    bool ok = fscanf(f, "P5 %d %d %d", &ancho, &alto, &maximo) == 3 && ancho == CALIDAD_ANCHO &&
+              alto == CALIDAD_ALTO && maximo == 255 && fgetc(f) != EOF &&
+              fread(pixeles, 1, CALIDAD_ANCHO * CALIDAD_ALTO, f) == CALIDAD_ANCHO * CALIDAD_ALTO;
+    fclose(f);
+    return ok;
+}
+
+static uint64_t ahora_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+/**
+ * @brief Evalúa una imagen, imprime su fila y devuelve el veredicto (-1 si no se pudo leer).
+ */
+static int evaluar(const char *ruta, int repeticiones, size_t bloque) {
+    static uint8_t pixeles[CALIDAD_ANCHO * CALIDAD_ALTO];
+    calidad_t c;
+    calidad_resultado_t r;
+
+    if (!leer_pgm(ruta, pixeles)) {
+        fprintf(stderr, "%s: no es un PGM de %dx%d\n", ruta, CALIDAD_ANCHO, CALIDAD_ALTO);
+        return -1;
+    }
+    uint64_t t0 = ahora_ns();
+    for (int k = 0; k < repeticiones; k++) {
+        calidad_iniciar(&c);
+        for (size_t d = 0; d < sizeof(pixeles); d += bloque) {
+            size_t n = sizeof(pixeles) - d < bloque ? sizeof(pixeles) - d : bloque;
+            calidad_bloque(&pixeles[d], n, (uint32_t)d, &c);
+        }
+        calidad_resultado(&c, &r);
+    }
+    double us = (ahora_ns() - t0) / 1000.0 / repeticiones;
+    printf("%-32s %9u %9u %10u %8d %8d %-16s %9.1f\n", ruta, r.contraste, r.cobertura, r.coherencia,
+           r.centro_x, r.centro_y, veredictos[r.veredicto], us);
+    return r.veredicto;
+}
+
+/**
+ * @brief Evalúa las imágenes de una lista y compara cada veredicto con el esperado.
+ */
+static int verificar_lista(const char *lista, int repeticiones, size_t bloque) {
+    FILE *f = fopen(lista, "r");
+    char linea[512], nombre[256], esperado[32], ruta[800];
+    int fallas = 0, imagenes = 0;
+    const char *barra = strrchr(lista, '/');
+    int dir = barra ? (int)(barra - lista + 1) : 0;
+
+    if (!f) {
+        perror(lista);
+        return 2;
+    }
+    while (fgets(linea, sizeof(linea), f)) {
+        if (linea[0] == '#' || sscanf(linea, "%255s %31s", nombre, esperado) != 2) {
+            continue;
+        }
+        snprintf(ruta, sizeof(ruta), "%.*s%s", dir, lista, nombre);
+        int v = evaluar(ruta, repeticiones, bloque);
+        if (v < 0) {
+            fclose(f);
+            return 1;
+        }
+        imagenes++;
+        if (strcmp(claves[v], esperado)) {
+            printf("FALLA %s: veredicto %s, se esperaba %s\n", nombre, claves[v], esperado);
+            fallas++;
+        }
+    }
+    fclose(f);
+    printf("%d imagenes, %d veredictos distintos de los esperados\n", imagenes, fallas);
+    return (fallas || imagenes == 0) ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    int repeticiones = 1000;
+    size_t bloque = 512;
+    const char *lista = NULL;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; i += 2) {
+        if (i + 1 >= argc) {
+            break;
+        }
+        if (!strcmp(argv[i], "-n")) {
+            repeticiones = atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-b")) {
+            bloque = (size_t)atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-e")) {
+            lista = argv[i + 1];
+        }
+    }
+    if ((i >= argc && !lista) || repeticiones < 1 || bloque < 1) {
+        fprintf(stderr, "uso: %s [-n repeticiones] [-b pixeles_por_bloque] (imagen.pgm ... | -e lista.txt)\n", argv[0]);
+        return 2;
+    }
+    printf("%-32s contraste cobertura coherencia centro_x centro_y veredicto        us/imagen\n", "imagen");
+    if (lista) {
+        return verificar_lista(lista, repeticiones, bloque);
+    }
+    for (; i < argc; i++) {
+        if (evaluar(argv[i], repeticiones, bloque) < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
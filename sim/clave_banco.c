@@ -0,0 +1,101 @@
+/**
+ * @file clave_banco.c
+ * @brief Banco de pruebas en el host del hash de contraseñas (clave.c).
+ *
+ * Comprueba clave_sha256 con los vectores de FIPS 180-2, clave_hmac con el de RFC 4231 y mide clave_benchmark, el mismo camino
+ * que el firmware ejecuta con -DCLAVE_BENCHMARK; aquí time_us_64 sale del reloj del PC. También
+ * compara el tiempo de clave_verificar con un PIN correcto y con uno incorrecto, que debe ser el
+ * mismo (comparación en tiempo constante).
+ *
+ * Uso: clave_banco [-n rondas]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "clave.h"
+
+/// Temporizador del SDK que usa clave_benchmark, sobre el reloj monotónico del PC
+uint64_t time_us_64(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000u + t.tv_nsec / 1000;
+}
+
+static bool vector_sha256(const char *texto, const char *esperado) {
+    uint8_t resumen[CLAVE_HASH_BYTES];
+    char hex[2 * CLAVE_HASH_BYTES + 1];
+    clave_sha256((const uint8_t *)texto, strlen(texto), resumen);
+    for (int i = 0; i < CLAVE_HASH_BYTES; i++) {
+        sprintf(&hex[2 * i], "%02x", resumen[i]);
+    }
+    if (strcmp(hex, esperado)) {
+        printf("SHA-256(\"%s\") = %s, se esperaba %s\n", texto, hex, esperado);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Microsegundos promedio de clave_verificar con un PIN.
+ */
+static double medir_verificar(const clave_registro_t *reg, const uint8_t *pin, uint32_t rondas, bool *resultado) {
+    uint64_t t0 = time_us_64();
+    for (uint32_t i = 0; i < rondas; i++) {
+        *resultado = clave_verificar(reg, pin);
+    }
+    return (double)(time_us_64() - t0) / rondas;
+}
+
+int main(int argc, char **argv) {
+    uint32_t rondas = 2000;
+    if (argc == 3 && !strcmp(argv[1], "-n")) {
+        rondas = (uint32_t)atoi(argv[2]);
+    } else if (argc != 1) {
+        fprintf(stderr, "uso: %s [-n rondas]\n", argv[0]);
+        return 2;
+    }
+    if (rondas < 1) {
+        rondas = 1;
+    }
+
+    if (!vector_sha256("abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad") ||
+        !vector_sha256("", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855") ||
+        !vector_sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+                       "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1")) {
+        return 1;
+    }
+    printf("SHA-256: vectores de FIPS 180-2 correctos\n");
+
+    // RFC 4231, caso 1: llave de 20 bytes 0x0b (el resto de la llave de 32 bytes va en cero)
+    static const uint8_t llave[CLAVE_HASH_BYTES] = {0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+                                                   0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b};
+    static const uint8_t hmac_esperado[CLAVE_HASH_BYTES] = {
+        0xb0, 0x34, 0x4c, 0x61, 0xd8, 0xdb, 0x38, 0x53, 0x5c, 0xa8, 0xaf, 0xce, 0xaf, 0x0b, 0xf1, 0x2b,
+        0x88, 0x1d, 0xc2, 0x00, 0xc9, 0x83, 0x3d, 0xa7, 0x26, 0xe9, 0x37, 0x6c, 0x2e, 0x32, 0xcf, 0xf7};
+    uint8_t codigo[CLAVE_HASH_BYTES];
+    clave_hmac(llave, (const uint8_t *)"Hi There", 8, codigo);
+    if (memcmp(codigo, hmac_esperado, sizeof(codigo))) {
+        printf("HMAC-SHA256 no coincide con RFC 4231\n");
+        return 1;
+    }
+    printf("HMAC-SHA256: vector de RFC 4231 correcto\n");
+
+    clave_benchmark(rondas);
+
+    static const uint8_t sal[CLAVE_SAL_BYTES] = {0x5A, 0x17, 0x03};
+    const uint8_t correcto[CLAVE_LONGITUD] = {1, 2, 3, 4};
+    const uint8_t incorrecto[CLAVE_LONGITUD] = {9, 2, 3, 4};
+    clave_registro_t reg;
+    bool ok, mal;
+    clave_crear(&reg, sal, correcto);
+    double us_ok = medir_verificar(&reg, correcto, rondas, &ok);
+    double us_mal = medir_verificar(&reg, incorrecto, rondas, &mal);
+    printf("clave_verificar: %.2f us con el PIN correcto, %.2f us con uno incorrecto\n", us_ok, us_mal);
+    if (!ok || mal) {
+        printf("clave_verificar devolvio %d/%d, se esperaba 1/0\n", ok, mal);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+/**
+ * @file guion.c
+ * @brief Punto de entrada de la simulación: lee el guion de eventos y arranca el firmware.
+ *
+ * Formato del guion (una orden por línea, '#' inicia un comentario). Las órdenes se ejecutan en
+ * un cursor de tiempo virtual que sólo avanzan 'espera' y 'tecla':
+ *
+ *   espera <ms>               avanza el cursor
+ *   tecla <c> [ms]            presiona la tecla c durante ms (150 por defecto); el cursor avanza ms + 350
+ *                             ('numeral' es la tecla '#', que no puede escribirse en el guion)
+ *   dedo <id> [mala] [uart]   coloca el dedo id sobre el sensor (mala = imagen de baja calidad)
+ *   retirar [uart]            retira el dedo
+ *   roce <ms>                 contacto parcial: la línea de toque sube durante ms sin dejar imagen
+ *   usb <texto>               envía texto por la consola USB
+ *   usbhex <b0> <b1> ...      envía bytes por la consola USB
+ *   latencia <ins> <ms> [uart] latencia de una instrucción del AS608 (ins en hexadecimal)
+ *   capacidad <n> [uart]      posiciones de la biblioteca del sensor
+ *   sin <ins> [uart]          el módulo no soporta la instrucción ins (hexadecimal): responde 0x01
+ *   huella <pos> <id> [uart]  huella id ya registrada en la posición pos
+ *   fin [ms]                  termina la simulación ms después del cursor (10000 por defecto)
+ *
+ * Expectativas (si alguna no se cumple, la simulación termina con código 1):
+ *
+ *   aperturas <n>             al terminar, el relé se activó n veces
+ *   lcd "<texto>"             el texto apareció en una línea del LCD a más tardar en el cursor y
+ *                             después de la expectativa lcd anterior (se cumplen en orden)
+ *   latencia_max <etapa> <ms> al terminar, la etapa tiene muestras y ninguna pasa de ms ('_' en el
+ *                             nombre de latencia.h vale por un espacio: isr_pit)
+ *   respuesta <cmd> <estado>  la próxima respuesta del protocolo de gestión (hexadecimal)
+ *
+ * Uso: cajafuerte_sim [-q] [-f flash.bin] [-p dir] guion.txt
+ *
+ * -p guarda cada cuadro del panel SPI (compilación con -DPANTALLA_SPI) como dir/panel_NNNN.png.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "latencia.h"
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+#define SIM_PULSACION_MS 150
+#define SIM_PAUSA_MS 350 ///< Entre teclas: el antirrebote necesita dos periodos de 100 ms sin tecla
+#define SIM_FIN_MS 10000
+#define SIM_MAX_EXPECTATIVAS 64
+
+int firmware_main(void);
+
+static const char *ruta_flash = NULL;
+
+static const char *ruta_guion;
+static int fallas = 0;
+static int comprobadas = 0;
+static long aperturas_esperadas = -1;
+static int aperturas_linea;
+
+static struct {
+    char texto[17];
+    int linea;
+} lcd_esperado[SIM_MAX_EXPECTATIVAS];
+static int num_lcd = 0, lcd_proxima = 0;
+
+static struct {
+    int etapa;
+    uint32_t max_us;
+    int linea;
+} latencia_esperada[SIM_MAX_EXPECTATIVAS];
+static int num_latencias = 0;
+
+static struct {
+    uint8_t cmd, estado;
+    int linea;
+} respuesta_esperada[SIM_MAX_EXPECTATIVAS];
+static int num_respuestas = 0, respuesta_proxima = 0;
+
+static void fallar(int linea, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void fallar(int linea, const char *fmt, ...) {
+    va_list ap;
+    fprintf(stderr, "FALLA %s:%d: ", ruta_guion, linea);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    fallas++;
+}
+
+void guion_lcd_cuadro(const char lineas[2][17]) {
+    // Un cuadro puede cumplir varias expectativas seguidas (p. ej. una por línea)
+    while (lcd_proxima < num_lcd &&
+           (strstr(lineas[0], lcd_esperado[lcd_proxima].texto) || strstr(lineas[1], lcd_esperado[lcd_proxima].texto))) {
+        lcd_proxima++;
+        comprobadas++;
+    }
+}
+
+void guion_lcd_plazo(int i) {
+    if (lcd_proxima <= i) {
+        fallar(lcd_esperado[i].linea, "el LCD no mostro \"%s\"", lcd_esperado[i].texto);
+        lcd_proxima = i + 1;
+    }
+}
+
+void guion_respuesta(uint8_t cmd, uint8_t estado) {
+    if (respuesta_proxima == num_respuestas) {
+        return;
+    }
+    int i = respuesta_proxima++;
+    if (respuesta_esperada[i].cmd != cmd || respuesta_esperada[i].estado != estado) {
+        fallar(respuesta_esperada[i].linea, "respuesta %02X con estado %02X, se esperaba %02X con estado %02X", cmd,
+               estado, respuesta_esperada[i].cmd, respuesta_esperada[i].estado);
+    } else {
+        comprobadas++;
+    }
+}
+
+int guion_verificar(void) {
+    if (aperturas_esperadas >= 0) {
+        if ((long)sim_aperturas() != aperturas_esperadas) {
+            fallar(aperturas_linea, "%zu aperturas, se esperaban %ld", sim_aperturas(), aperturas_esperadas);
+        } else {
+            comprobadas++;
+        }
+    }
+    for (int i = 0; i < num_latencias; i++) {
+        const latencia_histograma_t *h = latencia_histograma(latencia_esperada[i].etapa);
+        const char *nombre = latencia_nombre(latencia_esperada[i].etapa);
+        if (h->total == 0) {
+            fallar(latencia_esperada[i].linea, "la etapa %s no tiene muestras", nombre);
+        } else if (h->max > latencia_esperada[i].max_us) {
+            fallar(latencia_esperada[i].linea, "la etapa %s llego a %.3f ms, limite %.3f ms", nombre, h->max / 1000.0,
+                   latencia_esperada[i].max_us / 1000.0);
+        } else {
+            comprobadas++;
+        }
+    }
+    for (int i = respuesta_proxima; i < num_respuestas; i++) {
+        fallar(respuesta_esperada[i].linea, "falta la respuesta %02X", respuesta_esperada[i].cmd);
+    }
+    fprintf(stderr, "Expectativas: %d cumplidas, %d fallas\n", comprobadas, fallas);
+    return fallas;
+}
+
+/**
+ * @brief Etapa de latencia.h por nombre; '_' equivale a un espacio. -1 si no existe.
+ */
+static int etapa_por_nombre(const char *nombre) {
+    char buscado[32];
+    snprintf(buscado, sizeof(buscado), "%s", nombre);
+    for (char *c = buscado; *c; c++) {
+        if (*c == '_') {
+            *c = ' ';
+        }
+    }
+    for (int e = 0; e < LAT_ETAPAS; e++) {
+        if (!strcmp(latencia_nombre(e), buscado)) {
+            return e;
+        }
+    }
+    return -1;
+}
+
+static void guardar_flash(void) {
+    if (ruta_flash && !sim_flash_guardar(ruta_flash)) {
+        fprintf(stderr, "sim: no se pudo guardar %s\n", ruta_flash);
+    }
+}
+
+static unsigned int opcional(const char *s, unsigned int defecto) {
+    return s ? (unsigned int)strtoul(s, NULL, 0) : defecto;
+}
+
+static bool cargar_guion(const char *ruta) {
+    FILE *f = fopen(ruta, "r");
+    char linea[256];
+    uint64_t cursor = 0;
+    bool hay_fin = false;
+    int num = 0;
+
+    if (!f) {
+        perror(ruta);
+        return false;
+    }
+    while (fgets(linea, sizeof(linea), f)) {
+        num++;
+        char *com = strchr(linea, '#');
+        if (com) {
+            *com = '\0';
+        }
+        // El texto entre comillas de lcd puede tener espacios: se toma antes de separar las palabras
+        char texto[sizeof(linea)] = "";
+        char *comilla = strchr(linea, '"');
+        char *cierre = comilla ? strrchr(comilla + 1, '"') : NULL;
+        if (cierre) {
+            *cierre = '\0';
+            strcpy(texto, comilla + 1);
+        }
+        char *orden = strtok(linea, " \t\r\n");
+        if (!orden) {
+            continue;
+        }
+        char *arg[64];
+        int n = 0;
+        while (n < (int)count_of(arg) && (arg[n] = strtok(NULL, " \t\r\n")) != NULL) {
+            n++;
+        }
+        char *a1 = n > 0 ? arg[0] : NULL;
+        char *a2 = n > 1 ? arg[1] : NULL;
+        char *a3 = n > 2 ? arg[2] : NULL;
+
+        if (!strcmp(orden, "espera") && a1) {
+            cursor += (uint64_t)atoi(a1) * 1000;
+        } else if (!strcmp(orden, "tecla") && a1) {
+            uint64_t dur = (uint64_t)opcional(a2, SIM_PULSACION_MS) * 1000;
+            char tecla = !strcmp(a1, "numeral") ? '#' : a1[0];
+            sim_programar(cursor, SIM_EV_TECLA_PRESIONA, tecla, 0);
+            sim_programar(cursor + dur, SIM_EV_TECLA_SUELTA, tecla, 0);
+            cursor += dur + SIM_PAUSA_MS * 1000;
+        } else if (!strcmp(orden, "dedo") && a1) {
+            bool mala = a2 && !strcmp(a2, "mala");
+            unsigned int uart = opcional(mala ? a3 : a2, 1);
+            sim_programar(cursor, SIM_EV_DEDO, atoi(a1), (int)(uart << 1 | mala));
+        } else if (!strcmp(orden, "retirar")) {
+            sim_programar(cursor, SIM_EV_RETIRAR, (int)opcional(a1, 1), 0);
+        } else if (!strcmp(orden, "roce") && a1) {
+            sim_programar(cursor, SIM_EV_TOQUE, 1, 0);
+            sim_programar(cursor + (uint64_t)atoi(a1) * 1000, SIM_EV_TOQUE, 0, 0);
+        } else if (!strcmp(orden, "usb") && a1) {
+            for (const char *c = a1; *c; c++) {
+                sim_programar(cursor, SIM_EV_USB, (uint8_t)*c, 0);
+            }
+        } else if (!strcmp(orden, "usbhex") && a1) {
+            for (int i = 0; i < n; i++) {
+                sim_programar(cursor, SIM_EV_USB, (int)strtoul(arg[i], NULL, 16), 0);
+            }
+        } else if (!strcmp(orden, "latencia") && a1 && a2) {
+            as608_emu_latencia(opcional(a3, 1), (uint8_t)strtoul(a1, NULL, 16), (uint32_t)atoi(a2));
+        } else if (!strcmp(orden, "sin") && a1) {
+            as608_emu_soportar(opcional(a2, 1), (uint8_t)strtoul(a1, NULL, 16), false);
+        } else if (!strcmp(orden, "capacidad") && a1) {
+            as608_emu_capacidad(opcional(a2, 1), (uint16_t)atoi(a1));
+        } else if (!strcmp(orden, "huella") && a1 && a2) {
+            as608_emu_huella(opcional(a3, 1), (uint16_t)atoi(a1), atoi(a2));
+        } else if (!strcmp(orden, "aperturas") && a1) {
+            aperturas_esperadas = atol(a1);
+            aperturas_linea = num;
+        } else if (!strcmp(orden, "lcd") && cierre && strlen(texto) <= 16 && num_lcd < SIM_MAX_EXPECTATIVAS) {
+            strcpy(lcd_esperado[num_lcd].texto, texto);
+            lcd_esperado[num_lcd].linea = num;
+            sim_programar(cursor, SIM_EV_LCD, num_lcd++, 0);
+        } else if (!strcmp(orden, "latencia_max") && a1 && a2 && etapa_por_nombre(a1) >= 0 &&
+                   num_latencias < SIM_MAX_EXPECTATIVAS) {
+            latencia_esperada[num_latencias].etapa = etapa_por_nombre(a1);
+            latencia_esperada[num_latencias].max_us = (uint32_t)(atof(a2) * 1000);
+            latencia_esperada[num_latencias++].linea = num;
+        } else if (!strcmp(orden, "respuesta") && a1 && a2 && num_respuestas < SIM_MAX_EXPECTATIVAS) {
+            respuesta_esperada[num_respuestas].cmd = (uint8_t)strtoul(a1, NULL, 16);
+            respuesta_esperada[num_respuestas].estado = (uint8_t)strtoul(a2, NULL, 16);
+            respuesta_esperada[num_respuestas++].linea = num;
+        } else if (!strcmp(orden, "fin")) {
+            sim_programar(cursor + (uint64_t)opcional(a1, SIM_FIN_MS) * 1000, SIM_EV_FIN, 0, 0);
+            hay_fin = true;
+        } else {
+            fprintf(stderr, "%s:%d: orden desconocida '%s'\n", ruta, num, orden);
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+    if (!hay_fin) {
+        sim_programar(cursor + SIM_FIN_MS * 1000, SIM_EV_FIN, 0, 0);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *guion = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-q")) {
+            sim_silencio(true);
+        } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            ruta_flash = argv[++i];
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            panel_modelo_png(argv[++i]);
+        } else {
+            guion = argv[i];
+        }
+    }
+    if (!guion) {
+        fprintf(stderr, "uso: %s [-q] [-f flash.bin] [-p dir] guion.txt\n", argv[0]);
+        return 2;
+    }
+    if (ruta_flash) {
+        sim_flash_cargar(ruta_flash);
+        atexit(guardar_flash);
+    }
+    ruta_guion = guion;
+    if (!cargar_guion(guion)) {
+        return 2;
+    }
+    firmware_main();
+    return 0;
+}
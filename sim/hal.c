@@ -0,0 +1,1469 @@
+/**
+ * @file hal.c
+ * @brief HAL simulado: reloj virtual, eventos del guion, IRQ, PWM, SysTick, GPIO (teclado y relé),
+ * UART, DMA, I2C, SPI, relojes y dormant, flash y stdio.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "latencia.h"
+#include "gestion.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "hardware/exception.h"
+#include "hardware/flash.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/pll.h"
+#include "hardware/pwm.h"
+#include "hardware/spi.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hardware/vreg.h"
+#include "hardware/xosc.h"
+#include "hardware/structs/rosc.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/systick.h"
+#include "pico/stdio_usb.h"
+#include "pico/rand.h"
+
+#define SIM_MAX_EVENTOS 1024
+#define SIM_UART_FIFO 32
+#define SIM_UART_COLA 65536 ///< Cabe una imagen completa (UpImage, 36 KiB)
+#define SIM_PWM_SLICES 8
+#define SIM_MAX_APERTURAS 64
+
+// ------------------------------------------------------------------------------------------
+// Reloj virtual y eventos
+// ------------------------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t t;
+    sim_evento_tipo_t tipo;
+    int arg;
+    int arg2;
+} sim_evento_t;
+
+static uint64_t ahora = 0;
+static sim_evento_t eventos[SIM_MAX_EVENTOS];
+static size_t num_eventos = 0;
+static bool en_isr = false;
+static unsigned int excepcion = 0; ///< Número de la excepción en curso, como el IPSR
+static bool irq_deshabilitadas = false;
+static bool silencio = false;
+
+/// Frecuencias tras el arranque del SDK; el PWM cuenta con clk_sys y el UART, I2C y SPI con clk_peri
+static uint32_t relojes_hz[CLK_COUNT] = {
+    [clk_ref] = 12 * MHZ, [clk_sys] = SYS_CLK_KHZ * KHZ, [clk_peri] = SYS_CLK_KHZ * KHZ,
+    [clk_usb] = 48 * MHZ, [clk_adc] = 48 * MHZ, [clk_rtc] = 46875,
+};
+
+/**
+ * @brief Tasa real de un periférico cuyo divisor se calculó con clk_peri a peri_hz.
+ */
+static unsigned int tasa_efectiva(unsigned int tasa, uint32_t peri_hz) {
+    return (unsigned int)((uint64_t)tasa * relojes_hz[clk_peri] / peri_hz);
+}
+
+static uint64_t t_ultimo_dedo = 0, t_ultima_tecla = 0;
+static bool hubo_dedo = false, hubo_tecla = false;
+static uint64_t aperturas[SIM_MAX_APERTURAS][3]; ///< {t, dedo->relé, tecla->relé}
+static size_t num_aperturas = 0;
+
+static void despachar(void);
+static void pwm_vencer(unsigned int slice);
+static uint64_t pwm_proximo(unsigned int *slice);
+static void systick_revisar(void);
+static uint64_t systick_proximo(void);
+static void systick_vencer(void);
+static void systick_actualizar(void);
+static void usb_encolar(uint8_t byte);
+
+uint64_t sim_ahora(void) {
+    return ahora;
+}
+
+size_t sim_aperturas(void) {
+    return num_aperturas;
+}
+
+static void marca(uint64_t t, const char *fmt, va_list ap) {
+    fprintf(stderr, "[%10.3f ms] ", t / 1000.0);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+}
+
+void sim_marca(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    marca(ahora, fmt, ap);
+    va_end(ap);
+}
+
+void sim_marca_en(uint64_t t, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    marca(t, fmt, ap);
+    va_end(ap);
+}
+
+void sim_silencio(bool s) {
+    silencio = s;
+}
+
+void sim_programar(uint64_t t, sim_evento_tipo_t tipo, int arg, int arg2) {
+    if (num_eventos == SIM_MAX_EVENTOS) {
+        fprintf(stderr, "sim: demasiados eventos en el guion\n");
+        exit(2);
+    }
+    // Inserción ordenada; a igual tiempo se conserva el orden del guion
+    size_t i = num_eventos++;
+    while (i > 0 && eventos[i - 1].t > t) {
+        eventos[i] = eventos[i - 1];
+        i--;
+    }
+    eventos[i] = (sim_evento_t){t, tipo, arg, arg2};
+}
+
+static void resumen(void) {
+    char lineas[2][17];
+    lcd_modelo_texto(lineas);
+    sim_marca("FIN  LCD |%s|%s|", lineas[0], lineas[1]);
+    panel_modelo_resumen();
+    fprintf(stderr, "Resumen: %zu aperturas\n", num_aperturas);
+    for (size_t i = 0; i < num_aperturas; i++) {
+        fprintf(stderr, "  apertura %zu en %.3f ms: dedo->rele %.3f ms, ultima tecla->rele %.3f ms\n", i + 1,
+                aperturas[i][0] / 1000.0, aperturas[i][1] / 1000.0, aperturas[i][2] / 1000.0);
+    }
+    // Los mismos histogramas que el firmware exporta por USB, medidos en tiempo virtual
+    fprintf(stderr, "Latencias (ms):     n      min      p50      p90      p99      max\n");
+    for (int e = 0; e < LAT_ETAPAS; e++) {
+        const latencia_histograma_t *h = latencia_histograma(e);
+        if (h->total) {
+            fprintf(stderr, "  %-11s %6u %8.3f %8.3f %8.3f %8.3f %8.3f\n", latencia_nombre(e), (unsigned)h->total,
+                    h->min / 1000.0, latencia_percentil(e, 500) / 1000.0, latencia_percentil(e, 900) / 1000.0,
+                    latencia_percentil(e, 990) / 1000.0, h->max / 1000.0);
+        }
+    }
+}
+
+static void ejecutar_evento(const sim_evento_t *ev) {
+    switch (ev->tipo) {
+        case SIM_EV_TECLA_PRESIONA:
+            sim_marca("TECLA %c", ev->arg);
+            t_ultima_tecla = ahora;
+            hubo_tecla = true;
+            sim_teclado((char)ev->arg, true);
+            break;
+        case SIM_EV_TECLA_SUELTA:
+            sim_teclado((char)ev->arg, false);
+            break;
+        case SIM_EV_DEDO:
+            sim_marca("DEDO %d%s", ev->arg, (ev->arg2 & 1) ? " (mala calidad)" : "");
+            t_ultimo_dedo = ahora;
+            hubo_dedo = true;
+            as608_emu_dedo(ev->arg2 >> 1, ev->arg, ev->arg2 & 1);
+            sim_gpio_entrada(SIM_PIN_TOQUE, true);
+            break;
+        case SIM_EV_RETIRAR:
+            sim_marca("RETIRAR");
+            as608_emu_dedo(ev->arg, -1, false);
+            sim_gpio_entrada(SIM_PIN_TOQUE, false);
+            break;
+        case SIM_EV_TOQUE:
+            sim_marca("TOQUE %s", ev->arg ? "alto" : "bajo");
+            sim_gpio_entrada(SIM_PIN_TOQUE, ev->arg);
+            break;
+        case SIM_EV_USB:
+            usb_encolar((uint8_t)ev->arg);
+            break;
+        case SIM_EV_LCD:
+            guion_lcd_plazo(ev->arg);
+            break;
+        case SIM_EV_FIN:
+            fflush(stdout);
+            resumen();
+            exit(guion_verificar() ? 1 : 0);
+    }
+}
+
+/**
+ * @brief Avanza el reloj virtual hasta t procesando eventos e interrupciones en orden.
+ */
+void sim_avanzar_hasta(uint64_t t) {
+    while (true) {
+        unsigned int slice;
+        systick_revisar();
+        uint64_t t_pwm = pwm_proximo(&slice);
+        uint64_t t_tick = systick_proximo();
+        uint64_t t_ev = num_eventos ? eventos[0].t : UINT64_MAX;
+        uint64_t siguiente = t_pwm < t_ev ? t_pwm : t_ev;
+        if (t_tick < siguiente) {
+            siguiente = t_tick;
+        }
+        if (siguiente > t) {
+            break;
+        }
+        if (siguiente > ahora) {
+            ahora = siguiente;
+        }
+        lcd_modelo_revisar();
+        panel_modelo_revisar();
+        if (t_tick == siguiente) {
+            systick_vencer();
+        } else if (t_pwm <= t_ev) {
+            pwm_vencer(slice);
+        } else {
+            sim_evento_t ev = eventos[0];
+            memmove(&eventos[0], &eventos[1], (--num_eventos) * sizeof(sim_evento_t));
+            ejecutar_evento(&ev);
+        }
+        systick_actualizar();
+        despachar();
+    }
+    if (t > ahora) {
+        ahora = t;
+    }
+    systick_actualizar();
+    lcd_modelo_revisar();
+    panel_modelo_revisar();
+}
+
+static void avanzar(uint64_t us) {
+    sim_avanzar_hasta(ahora + us);
+}
+
+void sim_poll(void) {
+    avanzar(1);
+}
+
+void sim_wfi(void) {
+    unsigned int slice;
+    systick_revisar();
+    uint64_t t_pwm = pwm_proximo(&slice);
+    uint64_t t_tick = systick_proximo();
+    uint64_t t_ev = num_eventos ? eventos[0].t : UINT64_MAX;
+    uint64_t siguiente = t_pwm < t_ev ? t_pwm : t_ev;
+    if (t_tick < siguiente) {
+        siguiente = t_tick;
+    }
+    sim_avanzar_hasta(siguiente == UINT64_MAX ? ahora + 1000 : siguiente);
+}
+
+// ------------------------------------------------------------------------------------------
+// Tiempo
+// ------------------------------------------------------------------------------------------
+
+absolute_time_t get_absolute_time(void) {
+    return ahora;
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us) {
+    return ahora + us;
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return ahora + (uint64_t)ms * 1000;
+}
+
+bool time_reached(absolute_time_t t) {
+    return ahora >= t;
+}
+
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000);
+}
+
+uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+void sleep_us(uint64_t us) {
+    avanzar(us);
+}
+
+void sleep_ms(uint32_t ms) {
+    avanzar((uint64_t)ms * 1000);
+}
+
+void sleep_until(absolute_time_t t) {
+    sim_avanzar_hasta(t);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t t) {
+    sim_wfi();
+    return time_reached(t);
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)ahora;
+}
+
+uint64_t time_us_64(void) {
+    return ahora;
+}
+
+uint64_t get_rand_64(void) {
+    static uint64_t semilla = 0;
+    uint64_t z = (semilla += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// ------------------------------------------------------------------------------------------
+// IRQ y secciones críticas
+// ------------------------------------------------------------------------------------------
+
+static irq_handler_t manejadores[SIM_NUM_IRQS];
+static bool irq_habilitada[SIM_NUM_IRQS];
+static uint8_t prioridad[SIM_NUM_IRQS];
+
+void irq_set_enabled(unsigned int num, bool enabled) {
+    irq_habilitada[num] = enabled;
+}
+
+bool irq_is_enabled(unsigned int num) {
+    return irq_habilitada[num];
+}
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler) {
+    manejadores[num] = handler;
+}
+
+void irq_add_shared_handler(unsigned int num, irq_handler_t handler, uint8_t order_priority) {
+    (void)order_priority;
+    manejadores[num] = handler;
+}
+
+void irq_set_priority(unsigned int num, uint8_t hardware_priority) {
+    prioridad[num] = hardware_priority;
+}
+
+unsigned int irq_get_priority(unsigned int num) {
+    return prioridad[num];
+}
+
+unsigned int __get_current_exception(void) {
+    return excepcion;
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    uint32_t previo = irq_deshabilitadas;
+    irq_deshabilitadas = true;
+    return previo;
+}
+
+void restore_interrupts(uint32_t status) {
+    irq_deshabilitadas = status != 0;
+    despachar();
+}
+
+// ------------------------------------------------------------------------------------------
+// PWM como PIT
+// ------------------------------------------------------------------------------------------
+
+typedef struct {
+    bool habilitado;
+    bool irq;
+    bool fase_correcta;
+    float div;
+    uint16_t wrap;
+    uint64_t vence;
+} sim_pwm_t;
+
+static sim_pwm_t pwm[SIM_PWM_SLICES];
+static uint32_t pwm_estado_irq = 0;
+
+static uint64_t pwm_periodo_us(const sim_pwm_t *s) {
+    double ciclos = (double)(s->wrap + 1) * (s->fase_correcta ? 2 : 1) * s->div;
+    uint64_t us = (uint64_t)(ciclos * 1000000.0 / relojes_hz[clk_sys]);
+    return us ? us : 1;
+}
+
+static uint64_t pwm_proximo(unsigned int *slice) {
+    uint64_t t = UINT64_MAX;
+    for (unsigned int i = 0; i < SIM_PWM_SLICES; i++) {
+        if (pwm[i].habilitado && pwm[i].vence < t) {
+            t = pwm[i].vence;
+            *slice = i;
+        }
+    }
+    return t;
+}
+
+static void pwm_vencer(unsigned int slice) {
+    pwm[slice].vence += pwm_periodo_us(&pwm[slice]);
+    if (pwm[slice].irq) {
+        pwm_estado_irq |= 1u << slice;
+    }
+}
+
+pwm_config pwm_get_default_config(void) {
+    return (pwm_config){false, 1.0f, 0xFFFF};
+}
+
+void pwm_config_set_phase_correct(pwm_config *c, bool phase_correct) {
+    c->phase_correct = phase_correct;
+}
+
+void pwm_config_set_clkdiv(pwm_config *c, float div) {
+    c->clkdiv = div;
+}
+
+void pwm_config_set_clkdiv_mode(pwm_config *c, enum pwm_clkdiv_mode mode) {
+    (void)c;
+    (void)mode;
+}
+
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) {
+    c->wrap = wrap;
+}
+
+void pwm_init(unsigned int slice, pwm_config *c, bool start) {
+    pwm[slice].fase_correcta = c->phase_correct;
+    pwm[slice].div = c->clkdiv;
+    pwm[slice].wrap = c->wrap;
+    pwm_set_enabled(slice, start);
+}
+
+void pwm_set_enabled(unsigned int slice, bool enabled) {
+    if (enabled && !pwm[slice].habilitado) {
+        pwm[slice].vence = ahora + pwm_periodo_us(&pwm[slice]);
+    }
+    pwm[slice].habilitado = enabled;
+}
+
+void pwm_set_clkdiv(unsigned int slice, float div) {
+    pwm[slice].div = div;
+}
+
+void pwm_set_wrap(unsigned int slice, uint16_t wrap) {
+    pwm[slice].wrap = wrap;
+}
+
+void pwm_set_counter(unsigned int slice, uint16_t c) {
+    (void)c;
+    pwm[slice].vence = ahora + pwm_periodo_us(&pwm[slice]);
+}
+
+// Cuenta desde el último vencimiento; la rutina de interrupción corre sin demora, así que en
+// ella siempre vale 0
+uint16_t pwm_get_counter(unsigned int slice) {
+    const sim_pwm_t *s = &pwm[slice];
+    uint64_t periodo = pwm_periodo_us(s);
+    uint64_t desde = ahora + periodo - s->vence;
+    uint32_t tics = (uint32_t)(desde * (relojes_hz[clk_sys] / 1000000.0) / s->div);
+    uint32_t tope = (uint32_t)s->wrap + 1;
+    if (!s->habilitado) {
+        return 0;
+    }
+    if (s->fase_correcta && tics >= tope) {
+        return (uint16_t)(2 * tope - 1 - tics > s->wrap ? 0 : 2 * tope - 1 - tics);
+    }
+    return (uint16_t)(tics % tope);
+}
+
+void pwm_set_irq_enabled(unsigned int slice, bool enabled) {
+    pwm[slice].irq = enabled;
+}
+
+uint32_t pwm_get_irq_status_mask(void) {
+    return pwm_estado_irq;
+}
+
+void pwm_clear_irq(unsigned int slice) {
+    pwm_estado_irq &= ~(1u << slice);
+}
+
+// ------------------------------------------------------------------------------------------
+// SysTick: cuenta ciclos de clk_sys con el reloj virtual (resolución de 1 us); se detiene en dormant
+// ------------------------------------------------------------------------------------------
+
+systick_hw_t sim_systick;
+armv6m_scb_hw_t sim_scb;
+static exception_handler_t systick_manejador;
+static uint8_t systick_prioridad = 0;
+static uint32_t systick_csr_visto = 0;
+static uint32_t systick_rvr_visto = 0;
+static uint32_t systick_cvr_escrito = 0;
+static uint64_t systick_inicio = 0; ///< Instante en que la cuenta partió de RVR
+static bool systick_detenido = false;
+
+exception_handler_t exception_set_exclusive_handler(enum exception_number num, exception_handler_t handler) {
+    exception_handler_t previo = systick_manejador;
+    if (num == SYSTICK_EXCEPTION) {
+        systick_manejador = handler;
+    }
+    return previo;
+}
+
+bool exception_set_priority(unsigned int num, uint8_t hardware_priority) {
+    (void)num;
+    systick_prioridad = hardware_priority;
+    return true;
+}
+
+unsigned int exception_get_priority(unsigned int num) {
+    (void)num;
+    return systick_prioridad;
+}
+
+static uint64_t systick_periodo_us(void) {
+    uint64_t us = ((uint64_t)sim_systick.rvr + 1) * 1000000u / relojes_hz[clk_sys];
+    return us ? us : 1;
+}
+
+/**
+ * @brief Aplica lo que el firmware escribió desde el último avance: una escritura a CSR, RVR o CVR
+ * reinicia la cuenta, y PENDSTCLR quita el SysTick pendiente.
+ */
+static void systick_revisar(void) {
+    if (sim_systick.csr != systick_csr_visto || sim_systick.rvr != systick_rvr_visto ||
+        sim_systick.cvr != systick_cvr_escrito) {
+        systick_inicio = ahora;
+        systick_csr_visto = sim_systick.csr;
+        systick_rvr_visto = sim_systick.rvr;
+        systick_actualizar();
+    }
+    if (sim_scb.icsr & M0PLUS_ICSR_PENDSTCLR_BITS) {
+        sim_scb.icsr &= ~(M0PLUS_ICSR_PENDSTSET_BITS | M0PLUS_ICSR_PENDSTCLR_BITS);
+    }
+}
+
+static uint64_t systick_proximo(void) {
+    if (!(sim_systick.csr & M0PLUS_SYST_CSR_ENABLE_BITS) || systick_detenido) {
+        return UINT64_MAX;
+    }
+    return systick_inicio + systick_periodo_us();
+}
+
+static void systick_vencer(void) {
+    systick_inicio += systick_periodo_us();
+    if (sim_systick.csr & M0PLUS_SYST_CSR_TICKINT_BITS) {
+        sim_scb.icsr |= M0PLUS_ICSR_PENDSTSET_BITS;
+    }
+}
+
+/// Deja en CVR la cuenta del instante actual
+static void systick_actualizar(void) {
+    uint64_t ciclos = (ahora - systick_inicio) * relojes_hz[clk_sys] / 1000000u;
+    uint32_t cvr = ciclos >= sim_systick.rvr ? 0 : sim_systick.rvr - (uint32_t)ciclos;
+    sim_systick.cvr = systick_cvr_escrito = cvr;
+}
+
+// ------------------------------------------------------------------------------------------
+// GPIO, teclado 4x4 (filas 10-13, columnas 14-17) y relé
+// ------------------------------------------------------------------------------------------
+
+#define SIM_FILAS 0x00003C00u
+#define SIM_COLUMNAS 0x0003C000u
+
+static uint32_t gpio_salida = 0;
+static uint32_t gpio_dir = 0;
+static uint32_t gpio_columnas = 0;
+static uint32_t gpio_externas = 0; ///< Entradas manejadas por el guion (línea de toque)
+static uint32_t gpio_irq_flanco_subida = 0;
+static uint32_t gpio_irq_flanco_bajada = 0;
+static uint32_t gpio_dormant_subida = 0;   ///< Pines que sacan de dormant con un flanco de subida
+static bool gpio_dormant_despierta = false;
+static uint32_t gpio_pendiente = 0;
+static uint32_t gpio_pendiente_eventos[32];
+static gpio_irq_callback_t gpio_callback = NULL;
+static uint16_t teclas = 0; ///< Bit (fila * 4 + columna) por tecla presionada
+
+/// Tecla -> (fila, columna) según la tabla de keyDecode en main.c
+static const char mapa_teclas[4][4] = {
+    {'D', '#', '0', '*'},
+    {'C', '9', '8', '7'},
+    {'B', '6', '5', '4'},
+    {'A', '3', '2', '1'},
+};
+
+static void gpio_flanco(unsigned int pin, uint32_t evento) {
+    gpio_pendiente |= 1u << pin;
+    gpio_pendiente_eventos[pin] |= evento;
+}
+
+static void teclado_actualizar(void) {
+    uint32_t columnas = 0;
+    for (int f = 0; f < 4; f++) {
+        if (!(gpio_salida & gpio_dir & (1u << (10 + f)))) {
+            continue;
+        }
+        for (int c = 0; c < 4; c++) {
+            if (teclas & (1u << (f * 4 + c))) {
+                columnas |= 1u << (14 + c);
+            }
+        }
+    }
+    uint32_t suben = columnas & ~gpio_columnas;
+    uint32_t bajan = gpio_columnas & ~columnas;
+    gpio_columnas = columnas;
+    if (suben & gpio_dormant_subida) {
+        gpio_dormant_despierta = true;
+    }
+    for (unsigned int pin = 14; pin < 18; pin++) {
+        if ((suben & (1u << pin)) && (gpio_irq_flanco_subida & (1u << pin))) {
+            gpio_flanco(pin, GPIO_IRQ_EDGE_RISE);
+        }
+        if ((bajan & (1u << pin)) && (gpio_irq_flanco_bajada & (1u << pin))) {
+            gpio_flanco(pin, GPIO_IRQ_EDGE_FALL);
+        }
+    }
+}
+
+void sim_gpio_entrada(unsigned int pin, bool nivel) {
+    uint32_t bit = 1u << pin;
+    if (!!(gpio_externas & bit) == nivel) {
+        return;
+    }
+    gpio_externas = nivel ? (gpio_externas | bit) : (gpio_externas & ~bit);
+    if (nivel && (gpio_dormant_subida & bit)) {
+        gpio_dormant_despierta = true;
+    }
+    uint32_t habilitadas = nivel ? gpio_irq_flanco_subida : gpio_irq_flanco_bajada;
+    if (habilitadas & bit) {
+        gpio_flanco(pin, nivel ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL);
+    }
+}
+
+bool sim_teclado(char tecla, bool presionada) {
+    for (int f = 0; f < 4; f++) {
+        for (int c = 0; c < 4; c++) {
+            if (mapa_teclas[f][c] == tecla) {
+                uint16_t bit = 1u << (f * 4 + c);
+                teclas = presionada ? (teclas | bit) : (teclas & ~bit);
+                teclado_actualizar();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Ejecuta las interrupciones pendientes si están habilitadas y no hay otra en curso.
+ */
+static void despachar(void) {
+    if (en_isr || irq_deshabilitadas) {
+        return;
+    }
+    en_isr = true;
+    systick_revisar();
+    if ((sim_scb.icsr & M0PLUS_ICSR_PENDSTSET_BITS) && systick_manejador) {
+        sim_scb.icsr &= ~M0PLUS_ICSR_PENDSTSET_BITS;
+        excepcion = 15;
+        systick_manejador();
+    }
+    if (pwm_estado_irq && irq_habilitada[PWM_IRQ_WRAP] && manejadores[PWM_IRQ_WRAP]) {
+        excepcion = 16 + PWM_IRQ_WRAP;
+        manejadores[PWM_IRQ_WRAP]();
+        // Un manejador que no reconoce la IRQ la dejaría pendiente para siempre
+        pwm_estado_irq = 0;
+    }
+    while (gpio_pendiente && gpio_callback) {
+        unsigned int pin = __builtin_ctz(gpio_pendiente);
+        uint32_t ev = gpio_pendiente_eventos[pin];
+        gpio_pendiente &= ~(1u << pin);
+        gpio_pendiente_eventos[pin] = 0;
+        excepcion = 16 + IO_IRQ_BANK0;
+        gpio_callback(pin, ev);
+    }
+    excepcion = 0;
+    en_isr = false;
+}
+
+void gpio_init(unsigned int gpio) {
+    gpio_dir &= ~(1u << gpio);
+    gpio_salida &= ~(1u << gpio);
+}
+
+void gpio_init_mask(uint32_t mask) {
+    gpio_dir &= ~mask;
+    gpio_salida &= ~mask;
+}
+
+void gpio_set_function(unsigned int gpio, enum gpio_function fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_set_dir(unsigned int gpio, bool out) {
+    gpio_dir = out ? (gpio_dir | (1u << gpio)) : (gpio_dir & ~(1u << gpio));
+    teclado_actualizar();
+}
+
+void gpio_set_dir_in_masked(uint32_t mask) {
+    gpio_dir &= ~mask;
+    teclado_actualizar();
+}
+
+void gpio_set_dir_out_masked(uint32_t mask) {
+    gpio_dir |= mask;
+    teclado_actualizar();
+}
+
+static void rele_revisar(uint32_t anterior) {
+    uint32_t bit = 1u << SIM_PIN_RELE;
+    if (!(gpio_dir & bit) || !((anterior ^ gpio_salida) & bit)) {
+        return;
+    }
+    if (!(gpio_salida & bit)) {
+        uint64_t dedo = hubo_dedo ? ahora - t_ultimo_dedo : 0;
+        uint64_t tecla = hubo_tecla ? ahora - t_ultima_tecla : 0;
+        sim_marca("RELE ACTIVADO (dedo->rele %.3f ms, ultima tecla->rele %.3f ms)", dedo / 1000.0, tecla / 1000.0);
+        if (num_aperturas < SIM_MAX_APERTURAS) {
+            aperturas[num_aperturas][0] = ahora;
+            aperturas[num_aperturas][1] = dedo;
+            aperturas[num_aperturas][2] = tecla;
+            num_aperturas++;
+        }
+    } else {
+        sim_marca("RELE DESACTIVADO");
+    }
+}
+
+void gpio_put(unsigned int gpio, bool value) {
+    uint32_t anterior = gpio_salida;
+    gpio_salida = value ? (gpio_salida | (1u << gpio)) : (gpio_salida & ~(1u << gpio));
+    rele_revisar(anterior);
+    teclado_actualizar();
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value) {
+    uint32_t anterior = gpio_salida;
+    gpio_salida = (gpio_salida & ~mask) | (value & mask);
+    rele_revisar(anterior);
+    teclado_actualizar();
+}
+
+bool gpio_get(unsigned int gpio) {
+    return (gpio_get_all() >> gpio) & 1;
+}
+
+uint32_t gpio_get_all(void) {
+    return (gpio_salida & gpio_dir) | ((gpio_columnas | gpio_externas) & ~gpio_dir);
+}
+
+void gpio_pull_up(unsigned int gpio) {
+    (void)gpio;
+}
+
+void gpio_pull_down(unsigned int gpio) {
+    (void)gpio;
+}
+
+void gpio_disable_pulls(unsigned int gpio) {
+    (void)gpio;
+}
+
+void gpio_set_irq_enabled(unsigned int gpio, uint32_t events, bool enabled) {
+    uint32_t bit = 1u << gpio;
+    if (events & GPIO_IRQ_EDGE_RISE) {
+        gpio_irq_flanco_subida = enabled ? (gpio_irq_flanco_subida | bit) : (gpio_irq_flanco_subida & ~bit);
+    }
+    if (events & GPIO_IRQ_EDGE_FALL) {
+        gpio_irq_flanco_bajada = enabled ? (gpio_irq_flanco_bajada | bit) : (gpio_irq_flanco_bajada & ~bit);
+    }
+    if (!enabled) {
+        gpio_pendiente &= ~bit;
+        gpio_pendiente_eventos[gpio] = 0;
+    }
+}
+
+void gpio_set_irq_enabled_with_callback(unsigned int gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback) {
+    gpio_callback = callback;
+    gpio_set_irq_enabled(gpio, events, enabled);
+}
+
+// Solo el flanco de subida: es el único que usa reposo.c
+void gpio_set_dormant_irq_enabled(unsigned int gpio, uint32_t events, bool enabled) {
+    uint32_t bit = 1u << gpio;
+    if (events & GPIO_IRQ_EDGE_RISE) {
+        gpio_dormant_subida = enabled ? (gpio_dormant_subida | bit) : (gpio_dormant_subida & ~bit);
+    }
+}
+
+void gpio_acknowledge_irq(unsigned int gpio, uint32_t events) {
+    gpio_pendiente_eventos[gpio] &= ~events;
+    if (!gpio_pendiente_eventos[gpio]) {
+        gpio_pendiente &= ~(1u << gpio);
+    }
+}
+
+// ------------------------------------------------------------------------------------------
+// UART: FIFO de recepción de 32 bytes con desbordamiento, como el PL011
+// ------------------------------------------------------------------------------------------
+
+struct uart_inst {
+    uart_hw_t hw;
+    unsigned int indice;
+    unsigned int baud;
+    uint32_t peri_hz;                    ///< clk_peri con el que se calculó el divisor
+    bool desajuste;
+    uint64_t tx_libre;                   ///< Instante en que termina el último byte transmitido
+    struct { uint8_t b; uint64_t t; } cola[SIM_UART_COLA];
+    size_t cola_ini, cola_fin;
+    uint8_t fifo[SIM_UART_FIFO];
+    size_t fifo_ini, fifo_n;
+    uint32_t desbordes;
+};
+
+static struct uart_inst uarts[2] = {{.indice = 0, .baud = 115200, .peri_hz = SYS_CLK_KHZ * KHZ},
+                                     {.indice = 1, .baud = 115200, .peri_hz = SYS_CLK_KHZ * KHZ}};
+uart_inst_t *const sim_uart0 = &uarts[0];
+uart_inst_t *const sim_uart1 = &uarts[1];
+
+uint32_t sim_uart_us_por_byte(unsigned int uart) {
+    return 10u * 1000000u / uarts[uart].baud;
+}
+
+void sim_uart_rx(unsigned int uart, uint8_t byte, uint64_t t) {
+    struct uart_inst *u = &uarts[uart];
+    size_t sig = (u->cola_fin + 1) % SIM_UART_COLA;
+    if (sig == u->cola_ini) {
+        return;
+    }
+    u->cola[u->cola_fin].b = byte;
+    u->cola[u->cola_fin].t = t;
+    u->cola_fin = sig;
+}
+
+static bool dma_uart_rx(unsigned int uart, uint8_t byte);
+
+/**
+ * @brief Pasa al FIFO (o al canal DMA activo) los bytes que ya llegaron; los que no caben se pierden.
+ */
+static void uart_materializar(struct uart_inst *u) {
+    // El DMA vacía primero lo que ya estaba en el FIFO
+    while (u->fifo_n && dma_uart_rx(u->indice, u->fifo[u->fifo_ini])) {
+        u->fifo_ini = (u->fifo_ini + 1) % SIM_UART_FIFO;
+        u->fifo_n--;
+    }
+    while (u->cola_ini != u->cola_fin && u->cola[u->cola_ini].t <= ahora) {
+        if (!u->fifo_n && dma_uart_rx(u->indice, u->cola[u->cola_ini].b)) {
+            // Copiado por el DMA
+        } else if (u->fifo_n < SIM_UART_FIFO) {
+            u->fifo[(u->fifo_ini + u->fifo_n++) % SIM_UART_FIFO] = u->cola[u->cola_ini].b;
+        } else {
+            u->hw.rsr |= UART_UARTRSR_OE_BITS;
+            if (u->desbordes++ == 0) {
+                sim_marca("UART%u: desbordamiento del FIFO de recepcion", u->indice);
+            }
+        }
+        u->cola_ini = (u->cola_ini + 1) % SIM_UART_COLA;
+    }
+}
+
+unsigned int uart_init(uart_inst_t *uart, unsigned int baudrate) {
+    uart->baud = baudrate;
+    uart->peri_hz = relojes_hz[clk_peri];
+    uart->fifo_n = 0;
+    as608_emu_init(uart->indice);
+    return baudrate;
+}
+
+unsigned int uart_set_baudrate(uart_inst_t *uart, unsigned int baudrate) {
+    uart->baud = baudrate;
+    uart->peri_hz = relojes_hz[clk_peri];
+    uart->desajuste = false;
+    return baudrate;
+}
+
+unsigned int uart_get_index(uart_inst_t *uart) {
+    return uart->indice;
+}
+
+void uart_putc_raw(uart_inst_t *uart, char c) {
+    uint32_t byte_us = sim_uart_us_por_byte(uart->indice);
+    // Con el FIFO de transmisión lleno la CPU espera
+    if (uart->tx_libre > ahora + SIM_UART_FIFO * byte_us) {
+        sim_avanzar_hasta(uart->tx_libre - SIM_UART_FIFO * byte_us);
+    }
+    uint64_t inicio = uart->tx_libre > ahora ? uart->tx_libre : ahora;
+    uart->tx_libre = inicio + byte_us;
+    // Con clk_peri cambiado y el divisor viejo el módulo no entiende los bytes (más de 2 % de error)
+    unsigned int real = tasa_efectiva(uart->baud, uart->peri_hz);
+    if (real * 50u > uart->baud * 51u || real * 50u < uart->baud * 49u) {
+        if (!uart->desajuste) {
+            sim_marca("UART%u: divisor desajustado (%u baudios reales, %u configurados)", uart->indice, real, uart->baud);
+            uart->desajuste = true;
+        }
+        return;
+    }
+    as608_emu_recibir(uart->indice, (uint8_t)c, uart->tx_libre);
+}
+
+void uart_putc(uart_inst_t *uart, char c) {
+    uart_putc_raw(uart, c);
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uart_putc_raw(uart, src[i]);
+    }
+}
+
+void uart_tx_wait_blocking(uart_inst_t *uart) {
+    sim_avanzar_hasta(uart->tx_libre);
+}
+
+bool uart_is_readable(uart_inst_t *uart) {
+    uart_materializar(uart);
+    if (uart->fifo_n) {
+        return true;
+    }
+    // Un sondeo sin datos consume tiempo: salta al próximo byte o avanza un poco
+    uint64_t sig = uart->cola_ini != uart->cola_fin ? uart->cola[uart->cola_ini].t : UINT64_MAX;
+    sim_avanzar_hasta(sig < ahora + 20 ? sig : ahora + 20);
+    uart_materializar(uart);
+    return uart->fifo_n != 0;
+}
+
+bool uart_is_readable_within_us(uart_inst_t *uart, uint32_t us) {
+    uint64_t limite = ahora + us;
+    while (!uart_is_readable(uart)) {
+        if (ahora >= limite) {
+            return false;
+        }
+    }
+    return true;
+}
+
+char uart_getc(uart_inst_t *uart) {
+    while (!uart_is_readable(uart)) {
+    }
+    char c = (char)uart->fifo[uart->fifo_ini];
+    uart->fifo_ini = (uart->fifo_ini + 1) % SIM_UART_FIFO;
+    uart->fifo_n--;
+    return c;
+}
+
+void uart_read_blocking(uart_inst_t *uart, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = (uint8_t)uart_getc(uart);
+    }
+}
+
+uart_hw_t *uart_get_hw(uart_inst_t *uart) {
+    return &uart->hw;
+}
+
+unsigned int uart_get_dreq(uart_inst_t *uart, bool is_tx) {
+    return uart->indice ? (is_tx ? DREQ_UART1_TX : DREQ_UART1_RX) : (is_tx ? DREQ_UART0_TX : DREQ_UART0_RX);
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data) {
+    (void)uart;
+    (void)rx_has_data;
+    (void)tx_needs_data;
+}
+
+// ------------------------------------------------------------------------------------------
+// SPI hacia el modelo del panel (solo transmisión)
+// ------------------------------------------------------------------------------------------
+
+struct spi_inst {
+    spi_hw_t hw;
+    unsigned int indice;
+    unsigned int baud;
+    uint32_t peri_hz;         ///< clk_peri con el que se calculó el divisor
+    uint64_t libre;           ///< Instante en que termina de salir el último byte
+};
+
+static struct spi_inst spis[2] = {{.indice = 0, .baud = 1000000, .peri_hz = SYS_CLK_KHZ * KHZ},
+                                   {.indice = 1, .baud = 1000000, .peri_hz = SYS_CLK_KHZ * KHZ}};
+spi_inst_t *const sim_spi0 = &spis[0];
+spi_inst_t *const sim_spi1 = &spis[1];
+
+/**
+ * @brief Entrega len bytes al panel (si CS está bajo) y ocupa el bus el tiempo que tardan en salir.
+ *
+ * @return uint64_t Instante en que sale el último byte.
+ */
+static uint64_t spi_transmitir(struct spi_inst *s, const uint8_t *src, size_t len) {
+    bool dc = gpio_get(SIM_PIN_PANEL_DC);
+    if (!gpio_get(SIM_PIN_PANEL_CS)) {
+        for (size_t i = 0; i < len; i++) {
+            panel_modelo_escribir(src[i], dc);
+        }
+    }
+    uint64_t inicio = s->libre > ahora ? s->libre : ahora;
+    unsigned int baud = tasa_efectiva(s->baud, s->peri_hz);
+    s->libre = inicio + ((uint64_t)len * 8 * 1000000 + baud - 1) / baud;
+    return s->libre;
+}
+
+unsigned int spi_init(spi_inst_t *spi, unsigned int baudrate) {
+    spi->baud = baudrate;
+    spi->peri_hz = relojes_hz[clk_peri];
+    return baudrate;
+}
+
+unsigned int spi_set_baudrate(spi_inst_t *spi, unsigned int baudrate) {
+    spi->baud = baudrate;
+    spi->peri_hz = relojes_hz[clk_peri];
+    return baudrate;
+}
+
+void spi_set_format(spi_inst_t *spi, unsigned int data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {
+    (void)spi;
+    (void)data_bits;
+    (void)cpol;
+    (void)cpha;
+    (void)order;
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len) {
+    sim_avanzar_hasta(spi_transmitir(spi, src, len));
+    return (int)len;
+}
+
+bool spi_is_busy(const spi_inst_t *spi) {
+    return spi->libre > ahora;
+}
+
+spi_hw_t *spi_get_hw(spi_inst_t *spi) {
+    return &spi->hw;
+}
+
+unsigned int spi_get_dreq(spi_inst_t *spi, bool is_tx) {
+    return spi->indice ? (is_tx ? DREQ_SPI1_TX : DREQ_SPI1_RX) : (is_tx ? DREQ_SPI0_TX : DREQ_SPI0_RX);
+}
+
+// ------------------------------------------------------------------------------------------
+// DMA: canales que leen el registro de datos de un UART con su DREQ de recepción, o que
+// escriben en el de un SPI con su DREQ de transmisión
+// ------------------------------------------------------------------------------------------
+
+static struct {
+    bool reclamado;
+    bool activo;
+    int uart;                 ///< UART de origen (-1 = otra fuente, no simulada)
+    int spi;                  ///< SPI de destino (-1 = ninguno)
+    uint64_t fin;             ///< Hacia un SPI: instante en que sale el último byte
+    volatile uint8_t *escritura;
+    bool incrementa;
+    unsigned int restantes;
+} canales_dma[NUM_DMA_CHANNELS];
+
+/**
+ * @brief Entrega un byte recibido al canal activo del UART, si lo hay.
+ */
+static bool dma_uart_rx(unsigned int uart, uint8_t byte) {
+    for (int c = 0; c < NUM_DMA_CHANNELS; c++) {
+        if (canales_dma[c].activo && canales_dma[c].uart == (int)uart) {
+            *canales_dma[c].escritura = byte;
+            if (canales_dma[c].incrementa) {
+                canales_dma[c].escritura++;
+            }
+            canales_dma[c].activo = --canales_dma[c].restantes != 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (int c = 0; c < NUM_DMA_CHANNELS; c++) {
+        if (!canales_dma[c].reclamado) {
+            canales_dma[c].reclamado = true;
+            return c;
+        }
+    }
+    if (required) {
+        fprintf(stderr, "sim: no quedan canales DMA\n");
+        exit(1);
+    }
+    return -1;
+}
+
+void dma_channel_unclaim(unsigned int channel) {
+    canales_dma[channel].reclamado = false;
+    canales_dma[channel].activo = false;
+}
+
+dma_channel_config dma_channel_get_default_config(unsigned int channel) {
+    (void)channel;
+    dma_channel_config c = {DMA_SIZE_32, true, false, 0x3F};
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->tamano = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->incrementa_lectura = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->incrementa_escritura = incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq) {
+    c->dreq = dreq;
+}
+
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, unsigned int transfer_count, bool trigger) {
+    canales_dma[channel].uart = -1;
+    canales_dma[channel].spi = -1;
+    // Hacia un SPI: los bytes llegan al panel con el DC de ahora y el canal sigue ocupado hasta que
+    // sale el último; la CPU queda libre mientras tanto
+    for (unsigned int s = 0; s < 2; s++) {
+        if (write_addr == &spis[s].hw.dr && config->dreq == spi_get_dreq(&spis[s], true) &&
+            config->tamano == DMA_SIZE_8 && config->incrementa_lectura) {
+            canales_dma[channel].spi = s;
+            canales_dma[channel].activo = trigger && transfer_count > 0;
+            if (canales_dma[channel].activo) {
+                canales_dma[channel].fin = spi_transmitir(&spis[s], (const uint8_t *)read_addr, transfer_count);
+            }
+            return;
+        }
+    }
+    for (unsigned int u = 0; u < 2; u++) {
+        if (read_addr == &uarts[u].hw.dr && config->dreq == uart_get_dreq(&uarts[u], false) &&
+            config->tamano == DMA_SIZE_8 && !config->incrementa_lectura) {
+            canales_dma[channel].uart = u;
+        }
+    }
+    if (canales_dma[channel].uart < 0) {
+        fprintf(stderr, "sim: configuracion DMA no soportada en el canal %u\n", channel);
+        exit(1);
+    }
+    canales_dma[channel].escritura = write_addr;
+    canales_dma[channel].incrementa = config->incrementa_escritura;
+    canales_dma[channel].restantes = transfer_count;
+    canales_dma[channel].activo = trigger && transfer_count > 0;
+    if (canales_dma[channel].activo) {
+        uart_materializar(&uarts[canales_dma[channel].uart]);
+    }
+}
+
+bool dma_channel_is_busy(unsigned int channel) {
+    if (!canales_dma[channel].activo) {
+        return false;
+    }
+    if (canales_dma[channel].spi >= 0) {
+        canales_dma[channel].activo = ahora < canales_dma[channel].fin;
+        return canales_dma[channel].activo;
+    }
+    // Como el sondeo del UART: salta al próximo byte o avanza un poco
+    struct uart_inst *u = &uarts[canales_dma[channel].uart];
+    uart_materializar(u);
+    if (canales_dma[channel].activo) {
+        uint64_t sig = u->cola_ini != u->cola_fin ? u->cola[u->cola_ini].t : UINT64_MAX;
+        sim_avanzar_hasta(sig < ahora + 20 ? sig : ahora + 20);
+        uart_materializar(u);
+    }
+    return canales_dma[channel].activo;
+}
+
+void dma_channel_abort(unsigned int channel) {
+    canales_dma[channel].activo = false;
+}
+
+// ------------------------------------------------------------------------------------------
+// I2C hacia el modelo del LCD
+// ------------------------------------------------------------------------------------------
+
+struct i2c_inst {
+    unsigned int baud;
+    uint32_t peri_hz; ///< clk_peri con el que se calculó el divisor
+};
+
+static struct i2c_inst i2c_0 = {100000, SYS_CLK_KHZ * KHZ};
+i2c_inst_t *const sim_i2c0 = &i2c_0;
+
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate) {
+    i2c->baud = baudrate;
+    i2c->peri_hz = relojes_hz[clk_peri];
+    return baudrate;
+}
+
+unsigned int i2c_set_baudrate(i2c_inst_t *i2c, unsigned int baudrate) {
+    i2c->baud = baudrate;
+    i2c->peri_hz = relojes_hz[clk_peri];
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    (void)nostop;
+    // Dirección + datos, 9 bits por byte (incluye ACK)
+    avanzar((uint64_t)(len + 1) * 9 * 1000000 / tasa_efectiva(i2c->baud, i2c->peri_hz));
+    for (size_t i = 0; i < len; i++) {
+        lcd_modelo_escribir(addr, src[i]);
+    }
+    return (int)len;
+}
+
+// ------------------------------------------------------------------------------------------
+// Relojes, regulador y dormant: las frecuencias cambian el ritmo del PWM (clk_sys) y las tasas del
+// UART, I2C y SPI (clk_peri); xosc_dormant detiene la CPU (sin interrupciones) hasta un flanco de
+// despertar y suma el arranque del cristal
+// ------------------------------------------------------------------------------------------
+
+#define SIM_XOSC_ARRANQUE_US 1000
+
+struct pll_inst {
+    bool encendido;
+};
+
+static struct pll_inst plls[2] = {{true}, {true}};
+PLL const sim_pll_sys = &plls[0];
+PLL const sim_pll_usb = &plls[1];
+rosc_hw_t sim_rosc = {.ctrl = ROSC_CTRL_ENABLE_VALUE_ENABLE << ROSC_CTRL_ENABLE_LSB};
+static enum vreg_voltage vreg = VREG_VOLTAGE_1_10;
+
+bool clock_configure(enum clock_index clk_index, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq) {
+    (void)src;
+    (void)auxsrc;
+    (void)src_freq;
+    relojes_hz[clk_index] = freq;
+    // Tensión mínima del datasheet por frecuencia: 1,10 V hasta 133 MHz, 0,95 V hasta unos 60 MHz
+    if (clk_index == clk_sys && ((freq > 133 * MHZ && vreg < VREG_VOLTAGE_1_15) ||
+                                 (freq > 60 * MHZ && vreg < VREG_VOLTAGE_1_10))) {
+        sim_marca("Aviso: clk_sys a %lu kHz con tensión insuficiente", (unsigned long)(freq / KHZ));
+    }
+    return true;
+}
+
+void clock_stop(enum clock_index clk_index) {
+    relojes_hz[clk_index] = 0;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    return relojes_hz[clk_index];
+}
+
+void clocks_init(void) {
+    relojes_hz[clk_ref] = 12 * MHZ;
+    relojes_hz[clk_sys] = SYS_CLK_KHZ * KHZ;
+    relojes_hz[clk_peri] = SYS_CLK_KHZ * KHZ;
+    relojes_hz[clk_usb] = 48 * MHZ;
+    relojes_hz[clk_adc] = 48 * MHZ;
+    relojes_hz[clk_rtc] = 46875;
+    plls[0].encendido = plls[1].encendido = true;
+}
+
+void vreg_set_voltage(enum vreg_voltage voltage) {
+    vreg = voltage;
+}
+
+/// Como en el SDK: primer VCO (de mayor a menor, entre 750 y 1600 MHz) con dos divisores exactos
+bool check_sys_clock_khz(uint32_t freq_khz, unsigned int *vco_freq_out, unsigned int *post_div1_out,
+                         unsigned int *post_div2_out) {
+    for (unsigned int fbdiv = 320; fbdiv >= 16; fbdiv--) {
+        unsigned int vco = fbdiv * 12000;
+        if (vco < 750000 || vco > 1600000) {
+            continue;
+        }
+        for (unsigned int d1 = 7; d1 >= 1; d1--) {
+            for (unsigned int d2 = d1; d2 >= 1; d2--) {
+                if (vco % (d1 * d2) == 0 && vco / (d1 * d2) == freq_khz) {
+                    *vco_freq_out = vco * 1000;
+                    *post_div1_out = d1;
+                    *post_div2_out = d2;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required) {
+    unsigned int vco, d1, d2;
+    if (!check_sys_clock_khz(freq_khz, &vco, &d1, &d2)) {
+        return false;
+    }
+    (void)required;
+    relojes_hz[clk_sys] = relojes_hz[clk_peri] = freq_khz * KHZ;
+    return true;
+}
+
+void pll_init(PLL pll, unsigned int ref_div, unsigned int vco_freq, unsigned int post_div1, unsigned int post_div2) {
+    (void)ref_div;
+    (void)vco_freq;
+    (void)post_div1;
+    (void)post_div2;
+    pll->encendido = true;
+}
+
+void pll_deinit(PLL pll) {
+    pll->encendido = false;
+}
+
+void xosc_init(void) {
+}
+
+void xosc_disable(void) {
+}
+
+void xosc_dormant(void) {
+    uint64_t desde = ahora;
+    bool previo = irq_deshabilitadas;
+
+    if (plls[0].encendido || plls[1].encendido) {
+        sim_marca("Aviso: dormant con un PLL encendido");
+    }
+    sim_marca("DORMANT");
+    irq_deshabilitadas = true;
+    systick_detenido = true;
+    gpio_dormant_despierta = false;
+    while (!gpio_dormant_despierta) {
+        sim_wfi();
+    }
+    avanzar(SIM_XOSC_ARRANQUE_US);
+    systick_detenido = false;
+    systick_inicio = ahora;
+    systick_actualizar();
+    irq_deshabilitadas = previo;
+    despachar();
+    sim_marca("DESPIERTA tras %llu ms", (unsigned long long)((ahora - desde) / 1000));
+}
+
+// ------------------------------------------------------------------------------------------
+// Flash
+// ------------------------------------------------------------------------------------------
+
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+
+static void __attribute__((constructor)) flash_borrada(void) {
+    memset(sim_flash, 0xFF, sizeof(sim_flash));
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    assert(flash_offs % FLASH_SECTOR_SIZE == 0 && count % FLASH_SECTOR_SIZE == 0);
+    memset(&sim_flash[flash_offs], 0xFF, count);
+    avanzar(45000 * (count / FLASH_SECTOR_SIZE)); // ~45 ms por sector (W25Q16)
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    assert(flash_offs % FLASH_PAGE_SIZE == 0 && count % FLASH_PAGE_SIZE == 0);
+    for (size_t i = 0; i < count; i++) {
+        sim_flash[flash_offs + i] &= data[i]; // NOR: sólo se pueden bajar bits
+    }
+    avanzar(700 * (count / FLASH_PAGE_SIZE)); // ~0.7 ms por página
+}
+
+bool sim_flash_cargar(const char *ruta) {
+    FILE *f = fopen(ruta, "rb");
+    if (!f) {
+        return false;
+    }
+    size_t n = fread(sim_flash, 1, sizeof(sim_flash), f);
+    fclose(f);
+    return n == sizeof(sim_flash);
+}
+
+bool sim_flash_guardar(const char *ruta) {
+    FILE *f = fopen(ruta, "wb");
+    if (!f) {
+        return false;
+    }
+    size_t n = fwrite(sim_flash, 1, sizeof(sim_flash), f);
+    fclose(f);
+    return n == sizeof(sim_flash);
+}
+
+// ------------------------------------------------------------------------------------------
+// stdio por USB
+// ------------------------------------------------------------------------------------------
+
+static uint8_t usb_rx[4096];
+static size_t usb_ini = 0, usb_fin = 0;
+
+bool stdio_usb_connected(void) {
+    return false;
+}
+
+static void usb_encolar(uint8_t byte) {
+    usb_rx[usb_fin] = byte;
+    usb_fin = (usb_fin + 1) % sizeof(usb_rx);
+}
+
+bool stdio_init_all(void) {
+    if (silencio) {
+        if (!freopen("/dev/null", "w", stdout)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    uint64_t limite = ahora + timeout_us;
+    do {
+        if (usb_ini != usb_fin) {
+            int c = usb_rx[usb_ini];
+            usb_ini = (usb_ini + 1) % sizeof(usb_rx);
+            return c;
+        }
+        // Un sondeo del CDC cuesta algunos microsegundos aunque el plazo sea 0
+        avanzar(timeout_us ? (timeout_us < 100 ? timeout_us : 100) : 10);
+    } while (ahora < limite);
+    return PICO_ERROR_TIMEOUT;
+}
+
+/**
+ * @brief Sigue las tramas de gestion.c que salen por USB y entrega el estado de cada respuesta.
+ */
+static void usb_tx(uint8_t byte) {
+    static int fase = 0;
+    static uint8_t cmd;
+    static uint16_t len, n;
+
+    switch (fase) {
+        case 0:
+            fase = (byte == GESTION_SOF1) ? 1 : 0;
+            break;
+        case 1:
+            fase = (byte == GESTION_SOF2) ? 2 : (byte == GESTION_SOF1) ? 1 : 0;
+            break;
+        case 2:
+            cmd = byte;
+            fase = 3;
+            break;
+        case 3:
+            len = byte;
+            fase = 4;
+            break;
+        case 4:
+            len |= byte << 8;
+            n = 0;
+            fase = len ? 5 : 6;
+            break;
+        case 5:
+            if (n == 0 && (cmd & GESTION_RESPUESTA)) {
+                guion_respuesta(cmd & ~GESTION_RESPUESTA, byte);
+            }
+            fase = (++n == len) ? 6 : 5;
+            break;
+        case 6: // CRC
+            fase = 7;
+            break;
+        default:
+            fase = 0;
+            break;
+    }
+}
+
+int putchar_raw(int c) {
+    usb_tx((uint8_t)c);
+    return putchar(c);
+}
+
+void stdio_flush(void) {
+    fflush(stdout);
+}
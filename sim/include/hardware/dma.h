@@ -0,0 +1,42 @@
+/**
+ * @file dma.h
+ * @brief HAL simulado: canales DMA de 8 bits desde el registro de datos de un UART (DREQ de recepción).
+ *
+ * Solo cubre lo que usa el firmware: un canal que copia los bytes recibidos por el UART a un
+ * buffer en RAM. Mientras el canal está activo los bytes no pasan por el FIFO de recepción.
+ */
+
+#ifndef SIM_HARDWARE_DMA_H
+#define SIM_HARDWARE_DMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct {
+    enum dma_channel_transfer_size tamano;
+    bool incrementa_lectura;
+    bool incrementa_escritura;
+    unsigned int dreq;
+} dma_channel_config;
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(unsigned int channel);
+dma_channel_config dma_channel_get_default_config(unsigned int channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq);
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, unsigned int transfer_count, bool trigger);
+bool dma_channel_is_busy(unsigned int channel);
+void dma_channel_abort(unsigned int channel);
+
+#endif // SIM_HARDWARE_DMA_H
@@ -0,0 +1,23 @@
+/**
+ * @file exception.h
+ * @brief HAL simulado: excepciones del núcleo (solo el SysTick).
+ */
+
+#ifndef SIM_HARDWARE_EXCEPTION_H
+#define SIM_HARDWARE_EXCEPTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum exception_number {
+    PENDSV_EXCEPTION = -2,
+    SYSTICK_EXCEPTION = -1,
+};
+
+typedef void (*exception_handler_t)(void);
+
+exception_handler_t exception_set_exclusive_handler(enum exception_number num, exception_handler_t handler);
+bool exception_set_priority(unsigned int num, uint8_t hardware_priority);
+unsigned int exception_get_priority(unsigned int num);
+
+#endif // SIM_HARDWARE_EXCEPTION_H
@@ -0,0 +1,25 @@
+/**
+ * @file i2c.h
+ * @brief HAL simulado: bus I2C conectado al modelo PCF8574 + HD44780.
+ */
+
+#ifndef SIM_HARDWARE_I2C_H
+#define SIM_HARDWARE_I2C_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t *const sim_i2c0;
+#define i2c0 sim_i2c0
+#define i2c_default sim_i2c0
+#define PICO_DEFAULT_I2C_SDA_PIN 4
+#define PICO_DEFAULT_I2C_SCL_PIN 5
+
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate);
+unsigned int i2c_set_baudrate(i2c_inst_t *i2c, unsigned int baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+
+#endif // SIM_HARDWARE_I2C_H
@@ -0,0 +1,39 @@
+/**
+ * @file irq.h
+ * @brief HAL simulado: controlador de interrupciones.
+ */
+
+#ifndef SIM_HARDWARE_IRQ_H
+#define SIM_HARDWARE_IRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMER_IRQ_0 0
+#define TIMER_IRQ_1 1
+#define TIMER_IRQ_2 2
+#define TIMER_IRQ_3 3
+#define PWM_IRQ_WRAP 4
+#define USBCTRL_IRQ 5
+#define DMA_IRQ_0 11
+#define DMA_IRQ_1 12
+#define IO_IRQ_BANK0 13
+#define SIO_IRQ_PROC0 15
+#define SIO_IRQ_PROC1 16
+#define UART0_IRQ 20
+#define UART1_IRQ 21
+#define SIM_NUM_IRQS 32
+
+#define PICO_DEFAULT_IRQ_PRIORITY 0x80
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_enabled(unsigned int num, bool enabled);
+bool irq_is_enabled(unsigned int num);
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler);
+void irq_add_shared_handler(unsigned int num, irq_handler_t handler, uint8_t order_priority);
+void irq_set_priority(unsigned int num, uint8_t hardware_priority);
+unsigned int irq_get_priority(unsigned int num);
+
+#endif // SIM_HARDWARE_IRQ_H
@@ -0,0 +1,20 @@
+/**
+ * @file pll.h
+ * @brief HAL simulado: PLL del sistema y de USB.
+ */
+
+#ifndef SIM_HARDWARE_PLL_H
+#define SIM_HARDWARE_PLL_H
+
+typedef struct pll_inst pll_inst_t;
+typedef pll_inst_t *PLL;
+
+extern PLL const sim_pll_sys;
+extern PLL const sim_pll_usb;
+#define pll_sys sim_pll_sys
+#define pll_usb sim_pll_usb
+
+void pll_init(PLL pll, unsigned int ref_div, unsigned int vco_freq, unsigned int post_div1, unsigned int post_div2);
+void pll_deinit(PLL pll);
+
+#endif // SIM_HARDWARE_PLL_H
@@ -0,0 +1,39 @@
+/**
+ * @file pwm.h
+ * @brief HAL simulado: rebanadas PWM usadas como PIT.
+ */
+
+#ifndef SIM_HARDWARE_PWM_H
+#define SIM_HARDWARE_PWM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PWM_IRQ_WRAP 4
+
+enum pwm_clkdiv_mode {
+    PWM_DIV_FREE_RUNNING = 0
+};
+
+typedef struct {
+    bool phase_correct;
+    float clkdiv;
+    uint16_t wrap;
+} pwm_config;
+
+pwm_config pwm_get_default_config(void);
+void pwm_config_set_phase_correct(pwm_config *c, bool phase_correct);
+void pwm_config_set_clkdiv(pwm_config *c, float div);
+void pwm_config_set_clkdiv_mode(pwm_config *c, enum pwm_clkdiv_mode mode);
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap);
+void pwm_init(unsigned int slice, pwm_config *c, bool start);
+void pwm_set_enabled(unsigned int slice, bool enabled);
+void pwm_set_clkdiv(unsigned int slice, float div);
+void pwm_set_wrap(unsigned int slice, uint16_t wrap);
+void pwm_set_counter(unsigned int slice, uint16_t c);
+uint16_t pwm_get_counter(unsigned int slice);
+void pwm_set_irq_enabled(unsigned int slice, bool enabled);
+uint32_t pwm_get_irq_status_mask(void);
+void pwm_clear_irq(unsigned int slice);
+
+#endif // SIM_HARDWARE_PWM_H
@@ -0,0 +1,44 @@
+/**
+ * @file spi.h
+ * @brief HAL simulado: SPI de solo transmisión conectado al modelo del panel SSD1306.
+ *
+ * Los bytes llegan al modelo con el nivel de DC del momento y ocupan el bus 8 bits a la tasa
+ * configurada; spi_is_busy informa si el último byte sigue saliendo.
+ */
+
+#ifndef SIM_HARDWARE_SPI_H
+#define SIM_HARDWARE_SPI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct spi_inst spi_inst_t;
+
+extern spi_inst_t *const sim_spi0;
+extern spi_inst_t *const sim_spi1;
+#define spi0 sim_spi0
+#define spi1 sim_spi1
+
+#define DREQ_SPI0_TX 16
+#define DREQ_SPI0_RX 17
+#define DREQ_SPI1_TX 18
+#define DREQ_SPI1_RX 19
+
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+typedef struct {
+    volatile uint32_t dr; ///< Registro de datos (solo como dirección de escritura del DMA)
+} spi_hw_t;
+
+unsigned int spi_init(spi_inst_t *spi, unsigned int baudrate);
+unsigned int spi_set_baudrate(spi_inst_t *spi, unsigned int baudrate);
+void spi_set_format(spi_inst_t *spi, unsigned int data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+bool spi_is_busy(const spi_inst_t *spi);
+spi_hw_t *spi_get_hw(spi_inst_t *spi);
+unsigned int spi_get_dreq(spi_inst_t *spi, bool is_tx);
+
+#endif // SIM_HARDWARE_SPI_H
@@ -0,0 +1,23 @@
+/**
+ * @file rosc.h
+ * @brief HAL simulado: registros del oscilador en anillo (solo CTRL).
+ */
+
+#ifndef SIM_HARDWARE_STRUCTS_ROSC_H
+#define SIM_HARDWARE_STRUCTS_ROSC_H
+
+#include <stdint.h>
+
+#define ROSC_CTRL_ENABLE_LSB 12
+#define ROSC_CTRL_ENABLE_BITS 0x00fff000u
+#define ROSC_CTRL_ENABLE_VALUE_DISABLE 0xd1e
+#define ROSC_CTRL_ENABLE_VALUE_ENABLE 0xfab
+
+typedef struct {
+    volatile uint32_t ctrl;
+} rosc_hw_t;
+
+extern rosc_hw_t sim_rosc;
+#define rosc_hw (&sim_rosc)
+
+#endif // SIM_HARDWARE_STRUCTS_ROSC_H
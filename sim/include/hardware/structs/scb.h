@@ -0,0 +1,22 @@
+/**
+ * @file scb.h
+ * @brief HAL simulado: bloque de control del sistema (solo ICSR, para el SysTick pendiente).
+ */
+
+#ifndef SIM_HARDWARE_STRUCTS_SCB_H
+#define SIM_HARDWARE_STRUCTS_SCB_H
+
+#include <stdint.h>
+
+#define M0PLUS_ICSR_PENDSTSET_BITS 0x04000000u
+#define M0PLUS_ICSR_PENDSTCLR_BITS 0x02000000u
+
+typedef struct {
+    volatile uint32_t cpuid;
+    volatile uint32_t icsr;
+} armv6m_scb_hw_t;
+
+extern armv6m_scb_hw_t sim_scb;
+#define scb_hw (&sim_scb)
+
+#endif // SIM_HARDWARE_STRUCTS_SCB_H
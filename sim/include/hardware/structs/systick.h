@@ -0,0 +1,26 @@
+/**
+ * @file systick.h
+ * @brief HAL simulado: registros del SysTick. CVR se actualiza con el reloj virtual; una
+ * escritura a CVR o a RVR reinicia la cuenta en el siguiente avance.
+ */
+
+#ifndef SIM_HARDWARE_STRUCTS_SYSTICK_H
+#define SIM_HARDWARE_STRUCTS_SYSTICK_H
+
+#include <stdint.h>
+
+#define M0PLUS_SYST_CSR_ENABLE_BITS 0x00000001u
+#define M0PLUS_SYST_CSR_TICKINT_BITS 0x00000002u
+#define M0PLUS_SYST_CSR_CLKSOURCE_BITS 0x00000004u
+
+typedef struct {
+    volatile uint32_t csr;
+    volatile uint32_t rvr;
+    volatile uint32_t cvr;
+    volatile uint32_t calib;
+} systick_hw_t;
+
+extern systick_hw_t sim_systick;
+#define systick_hw (&sim_systick)
+
+#endif // SIM_HARDWARE_STRUCTS_SYSTICK_H
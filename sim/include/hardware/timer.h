@@ -0,0 +1,14 @@
+/**
+ * @file timer.h
+ * @brief HAL simulado: temporizador sobre el reloj virtual.
+ */
+
+#ifndef SIM_HARDWARE_TIMER_H
+#define SIM_HARDWARE_TIMER_H
+
+#include <stdint.h>
+
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+
+#endif // SIM_HARDWARE_TIMER_H
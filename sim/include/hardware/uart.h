@@ -0,0 +1,51 @@
+/**
+ * @file uart.h
+ * @brief HAL simulado: UART conectado al emulador del AS608.
+ */
+
+#ifndef SIM_HARDWARE_UART_H
+#define SIM_HARDWARE_UART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t *const sim_uart0;
+extern uart_inst_t *const sim_uart1;
+#define uart0 sim_uart0
+#define uart1 sim_uart1
+
+#define UART0_IRQ 20
+#define UART1_IRQ 21
+#define UART_IRQ_NUM(uart) (uart_get_index(uart) ? UART1_IRQ : UART0_IRQ)
+
+#define DREQ_UART0_TX 20
+#define DREQ_UART0_RX 21
+#define DREQ_UART1_TX 22
+#define DREQ_UART1_RX 23
+
+#define UART_UARTRSR_OE_BITS 0x00000008u
+
+typedef struct {
+    volatile uint32_t dr;  ///< Registro de datos (solo como dirección de lectura del DMA)
+    volatile uint32_t rsr; ///< Errores de recepción: OE tras un desbordamiento del FIFO
+} uart_hw_t;
+
+unsigned int uart_init(uart_inst_t *uart, unsigned int baudrate);
+unsigned int uart_set_baudrate(uart_inst_t *uart, unsigned int baudrate);
+unsigned int uart_get_index(uart_inst_t *uart);
+void uart_putc(uart_inst_t *uart, char c);
+void uart_putc_raw(uart_inst_t *uart, char c);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+void uart_tx_wait_blocking(uart_inst_t *uart);
+bool uart_is_readable(uart_inst_t *uart);
+bool uart_is_readable_within_us(uart_inst_t *uart, uint32_t us);
+char uart_getc(uart_inst_t *uart);
+void uart_read_blocking(uart_inst_t *uart, uint8_t *dst, size_t len);
+uart_hw_t *uart_get_hw(uart_inst_t *uart);
+unsigned int uart_get_dreq(uart_inst_t *uart, bool is_tx);
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data);
+
+#endif // SIM_HARDWARE_UART_H
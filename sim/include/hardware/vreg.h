@@ -0,0 +1,26 @@
+/**
+ * @file vreg.h
+ * @brief HAL simulado: regulador del núcleo. Solo se registra la tensión para avisar de una
+ * frecuencia que no la soporta.
+ */
+
+#ifndef SIM_HARDWARE_VREG_H
+#define SIM_HARDWARE_VREG_H
+
+enum vreg_voltage {
+    VREG_VOLTAGE_0_85 = 0x6,
+    VREG_VOLTAGE_0_90 = 0x7,
+    VREG_VOLTAGE_0_95 = 0x8,
+    VREG_VOLTAGE_1_00 = 0x9,
+    VREG_VOLTAGE_1_05 = 0xa,
+    VREG_VOLTAGE_1_10 = 0xb,
+    VREG_VOLTAGE_1_15 = 0xc,
+    VREG_VOLTAGE_1_20 = 0xd,
+    VREG_VOLTAGE_1_25 = 0xe,
+    VREG_VOLTAGE_1_30 = 0xf,
+    VREG_VOLTAGE_DEFAULT = VREG_VOLTAGE_1_10,
+};
+
+void vreg_set_voltage(enum vreg_voltage voltage);
+
+#endif // SIM_HARDWARE_VREG_H
@@ -0,0 +1,16 @@
+/**
+ * @file xosc.h
+ * @brief HAL simulado: oscilador de cristal.
+ *
+ * xosc_dormant detiene la CPU hasta un flanco en un pin habilitado con
+ * gpio_set_dormant_irq_enabled; mientras tanto el guion sigue avanzando.
+ */
+
+#ifndef SIM_HARDWARE_XOSC_H
+#define SIM_HARDWARE_XOSC_H
+
+void xosc_init(void);
+void xosc_disable(void);
+void xosc_dormant(void);
+
+#endif // SIM_HARDWARE_XOSC_H
@@ -0,0 +1,12 @@
+/**
+ * @file binary_info.h
+ * @brief HAL simulado: la información binaria no aplica en el host.
+ */
+
+#ifndef SIM_PICO_BINARY_INFO_H
+#define SIM_PICO_BINARY_INFO_H
+
+#define bi_decl(x)
+#define bi_2pins_with_func(p0, p1, func) 0
+
+#endif // SIM_PICO_BINARY_INFO_H
@@ -0,0 +1,14 @@
+/**
+ * @file rand.h
+ * @brief HAL simulado: subconjunto de pico/rand.h usado por el firmware.
+ */
+
+#ifndef SIM_PICO_RAND_H
+#define SIM_PICO_RAND_H
+
+#include <stdint.h>
+
+/// Secuencia fija (splitmix64 desde una semilla constante) para que los guiones sean reproducibles
+uint64_t get_rand_64(void);
+
+#endif // SIM_PICO_RAND_H
@@ -0,0 +1,14 @@
+/**
+ * @file stdio_usb.h
+ * @brief HAL simulado: la consola es la del guion, no un anfitrión USB.
+ */
+
+#ifndef SIM_PICO_STDIO_USB_H
+#define SIM_PICO_STDIO_USB_H
+
+#include <stdbool.h>
+
+/// Siempre falso: el reposo se simula con dormant
+bool stdio_usb_connected(void);
+
+#endif // SIM_PICO_STDIO_USB_H
@@ -0,0 +1,59 @@
+/**
+ * @file stdlib.h
+ * @brief HAL simulado: subconjunto de pico/stdlib.h usado por el firmware.
+ */
+
+#ifndef SIM_PICO_STDLIB_H
+#define SIM_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <assert.h>
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+typedef unsigned int uint;
+
+#ifndef SYS_CLK_KHZ
+#define SYS_CLK_KHZ 125000
+#endif
+
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT (-1)
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#define __not_in_flash(group)
+#define __not_in_flash_func(func) func
+#define __time_critical_func(func) func
+#define __scratch_x(group)
+#define __scratch_y(group)
+#define tight_loop_contents() sim_poll()
+#define __wfi() sim_wfi()
+#define __wfe() sim_wfi()
+#define __sev() do { } while (0)
+#define __dmb() do { } while (0)
+
+/// Consume tiempo virtual de un ciclo de sondeo activo (definido en hal.c)
+void sim_poll(void);
+/// Avanza el reloj virtual hasta el próximo evento (definido en hal.c)
+void sim_wfi(void);
+
+/// La simulación ejecuta un solo núcleo
+static inline uint get_core_num(void) {
+    return 0;
+}
+/// Número de la excepción en curso (IPSR), 0 fuera de las interrupciones (definido en hal.c)
+uint __get_current_exception(void);
+
+bool check_sys_clock_khz(uint32_t freq_khz, uint *vco_freq_out, uint *post_div1_out, uint *post_div2_out);
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+
+bool stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+int putchar_raw(int c);
+void stdio_flush(void);
+
+#endif // SIM_PICO_STDLIB_H
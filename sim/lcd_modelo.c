@@ -0,0 +1,117 @@
+/**
+ * @file lcd_modelo.c
+ * @brief Modelo del expansor PCF8574 y del controlador HD44780 en modo de 4 bits.
+ *
+ * Bits del PCF8574: P0 = RS, P1 = RW, P2 = EN, P3 = luz de fondo, P4-P7 = D4-D7.
+ * El controlador captura un nibble en cada flanco de bajada de EN.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+#define LCD_ADDR 0x27
+#define LCD_ESTABLE_US 20000 ///< Se imprime el contenido tras 20 ms sin escrituras
+
+static uint8_t puerto = 0;
+static bool nibble_alto = true;
+static uint8_t dato = 0;
+static uint8_t ddram[0x80];
+static uint8_t cgram[64];
+static uint8_t contador = 0;
+static bool en_cgram = false;
+static bool encendido = false;
+static bool luz = false;
+static bool luz_mostrada = false;
+static bool sucio = false;
+static uint64_t ultima_escritura = 0;
+static char mostrado[2][17];
+
+static void __attribute__((constructor)) lcd_arranque(void) {
+    memset(ddram, ' ', sizeof(ddram));
+}
+
+static void ejecutar(uint8_t valor, bool rs) {
+    if (rs) {
+        if (en_cgram) {
+            cgram[contador++ & 0x3F] = valor;
+        } else {
+            ddram[contador++ & 0x7F] = valor;
+        }
+        sucio = true;
+        return;
+    }
+    if (valor & 0x80) {
+        contador = valor & 0x7F;
+        en_cgram = false;
+    } else if (valor & 0x40) {
+        contador = valor & 0x3F;
+        en_cgram = true;
+    } else if (valor & 0x20) {
+        // Function set: siempre 4 bits / 2 líneas en este modelo
+    } else if (valor & 0x10) {
+        // Desplazamiento de cursor o pantalla: no se modela
+    } else if (valor & 0x08) {
+        encendido = valor & 0x04;
+        sucio = true;
+    } else if (valor & 0x04) {
+        // Entry mode: se asume incremento sin desplazamiento
+    } else if (valor & 0x02) {
+        contador = 0;
+        en_cgram = false;
+    } else if (valor & 0x01) {
+        memset(ddram, ' ', sizeof(ddram));
+        contador = 0;
+        en_cgram = false;
+        sucio = true;
+    }
+}
+
+void lcd_modelo_escribir(uint8_t addr, uint8_t val) {
+    if (addr != LCD_ADDR) {
+        return;
+    }
+    if ((puerto & 0x04) && !(val & 0x04)) {
+        // Flanco de bajada de EN: se captura el nibble presente en D4-D7
+        if (nibble_alto) {
+            dato = puerto & 0xF0;
+        } else {
+            ejecutar(dato | (puerto >> 4), puerto & 0x01);
+        }
+        nibble_alto = !nibble_alto;
+    }
+    if ((val & 0x08) != (puerto & 0x08)) {
+        sucio = true;
+    }
+    luz = val & 0x08;
+    puerto = val;
+    ultima_escritura = sim_ahora();
+}
+
+void lcd_modelo_texto(char lineas[2][17]) {
+    for (int l = 0; l < 2; l++) {
+        for (int c = 0; c < 16; c++) {
+            uint8_t ch = ddram[l * 0x40 + c];
+            // Los glifos de CGRAM (0-7) se muestran como su número
+            lineas[l][c] = (ch < 8) ? (char)('0' + ch) : (ch >= 0x20 && ch < 0x7F) ? (char)ch : '?';
+        }
+        lineas[l][16] = '\0';
+    }
+}
+
+void lcd_modelo_revisar(void) {
+    char lineas[2][17];
+    if (!sucio || sim_ahora() - ultima_escritura < LCD_ESTABLE_US) {
+        return;
+    }
+    sucio = false;
+    lcd_modelo_texto(lineas);
+    // Un cambio de la luz de fondo con el mismo texto también es un cuadro nuevo (reposo)
+    if (memcmp(lineas, mostrado, sizeof(lineas)) == 0 && luz == luz_mostrada) {
+        return;
+    }
+    memcpy(mostrado, lineas, sizeof(lineas));
+    luz_mostrada = luz;
+    guion_lcd_cuadro(lineas);
+    sim_marca_en(ultima_escritura + LCD_ESTABLE_US, "LCD |%s|%s|%s%s", lineas[0], lineas[1], encendido ? "" : " (apagado)", luz ? "" : " (sin luz)");
+}
@@ -0,0 +1,79 @@
+/**
+ * @file lectores_banco.c
+ * @brief Banco de dos lectores simultáneos sobre el emulador (uart1 y uart0).
+ *
+ * Compila el driver (as608.c) con la HAL simulada en lugar de main.c: firmware_main crea dos
+ * instancias y manda la misma instrucción Search a cada una, primero una tras otra con
+ * as608_command y después a la vez con as608_start/as608_poll. Con el guion lectores.txt cada
+ * Search tarda 300 ms en el emulador, así que la pasada concurrente debe durar como una sola
+ * instrucción y la secuencial como dos. También comprueba que el flanco de toque queda anotado
+ * solo en el lector indicado.
+ *
+ * Uso: lectores_banco [-q] lectores.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "as608.h"
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+
+#define SEARCH_MS 300 ///< Latencia de Search que fija lectores.txt en ambos emuladores
+
+/**
+ * @brief Espera a la vez la respuesta de los dos lectores.
+ */
+static void esperar_ambos(as608_t *a, as608_t *b, uint8_t *ra, uint8_t *rb) {
+    *ra = *rb = AS608_EN_CURSO;
+    while (*ra == AS608_EN_CURSO || *rb == AS608_EN_CURSO) {
+        if (*ra == AS608_EN_CURSO) {
+            *ra = as608_poll(a, NULL, 0);
+        }
+        if (*rb == AS608_EN_CURSO) {
+            *rb = as608_poll(b, NULL, 0);
+        }
+        sleep_ms(1);
+    }
+}
+
+int firmware_main(void) {
+    static as608_t a, b;
+    const as608_config_t config_a = AS608_CONFIG_PUERTA;
+    const as608_config_t config_b = {uart0, 12, 13, 57600, -1, -1};
+    const uint8_t search[] = {0x04, 1, 0, 0, 0, 100};
+    int fallas = 0;
+
+    as608_init(&a, &config_a);
+    as608_init(&b, &config_b);
+
+    uint64_t t0 = time_us_64();
+    uint8_t ra = as608_command(&a, search, sizeof(search), NULL, 0);
+    uint8_t rb = as608_command(&b, search, sizeof(search), NULL, 0);
+    uint64_t t1 = time_us_64();
+    as608_start(&a, search, sizeof(search));
+    as608_start(&b, search, sizeof(search));
+    uint8_t ca, cb;
+    esperar_ambos(&a, &b, &ca, &cb);
+    uint64_t t2 = time_us_64();
+
+    uint32_t secuencial = (uint32_t)((t1 - t0) / 1000), concurrente = (uint32_t)((t2 - t1) / 1000);
+    fprintf(stderr, "Search en dos lectores: %lu ms una tras otra, %lu ms a la vez (%02X %02X / %02X %02X)\n",
+            (unsigned long)secuencial, (unsigned long)concurrente, ra, rb, ca, cb);
+    if (ra == AS608_ERROR_COM || rb == AS608_ERROR_COM || ca == AS608_ERROR_COM || cb == AS608_ERROR_COM) {
+        fprintf(stderr, "un lector no respondio\n");
+        fallas++;
+    }
+    if (secuencial < 2 * SEARCH_MS || concurrente >= 3 * SEARCH_MS / 2) {
+        fprintf(stderr, "se esperaba ~%u ms a la vez y al menos %u ms una tras otra\n", SEARCH_MS, 2 * SEARCH_MS);
+        fallas++;
+    }
+
+    // El flanco de toque se anota en el lector que lo recibe, no en los demás
+    as608_touch_irq(&b, GPIO_IRQ_EDGE_RISE);
+    if (a.toque_abierto || !b.toque_abierto) {
+        fprintf(stderr, "el flanco de toque del segundo lector quedo anotado en %s\n",
+                a.toque_abierto ? "el primero" : "ninguno");
+        fallas++;
+    }
+    exit(fallas ? 1 : 0);
+}
@@ -0,0 +1,191 @@
+/**
+ * @file panel_modelo.c
+ * @brief Modelo del controlador SSD1306 (128x64) por SPI y volcado de cada cuadro a PNG.
+ *
+ * Solo modela lo que usa pantalla_spi.c: direccionamiento horizontal con ventana de columnas
+ * (0x21) y páginas (0x22) y encendido/apagado. Los demás comandos se aceptan con su cantidad de
+ * parámetros y se ignoran.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+#define PANEL_ANCHO 128
+#define PANEL_PAGINAS 8
+#define PANEL_ESTABLE_US 20000 ///< Igual que el LCD: se registra el cuadro tras 20 ms sin escrituras
+#define PANEL_ESCALA 2         ///< Píxeles del PNG por píxel del panel
+
+static uint8_t gddram[PANEL_PAGINAS][PANEL_ANCHO];
+static uint8_t mostrado[PANEL_PAGINAS][PANEL_ANCHO];
+static uint8_t col_ini = 0, col_fin = PANEL_ANCHO - 1, pag_ini = 0, pag_fin = PANEL_PAGINAS - 1;
+static uint8_t col = 0, pag = 0;
+static uint8_t orden = 0;      ///< Comando que espera parámetros
+static uint8_t params[2];
+static uint8_t faltan = 0;     ///< Parámetros que faltan de 'orden'
+static bool encendido = false;
+static bool encendido_mostrado = false;
+static bool sucio = false;
+static uint64_t ultima_escritura = 0;
+static uint32_t cuadros = 0;
+static uint32_t bytes_datos = 0, bytes_comandos = 0, bytes_cuadro = 0;
+static const char *dir_png = NULL;
+
+static uint8_t parametros(uint8_t c) {
+    switch (c) {
+        case 0x21: case 0x22:
+            return 2;
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void comando(uint8_t c) {
+    if (faltan) {
+        params[parametros(orden) - faltan] = c;
+        if (--faltan) {
+            return;
+        }
+        if (orden == 0x21) {
+            col_ini = col = params[0] & 0x7F;
+            col_fin = params[1] & 0x7F;
+        } else if (orden == 0x22) {
+            pag_ini = pag = params[0] & 0x07;
+            pag_fin = params[1] & 0x07;
+        }
+        return;
+    }
+    orden = c;
+    faltan = parametros(c);
+    if (c == 0xAE || c == 0xAF) {
+        encendido = c == 0xAF;
+        sucio = true;
+    }
+}
+
+void panel_modelo_escribir(uint8_t val, bool dc) {
+    if (dc) {
+        gddram[pag][col] = val;
+        if (col++ == col_fin) {
+            col = col_ini;
+            pag = (pag == pag_fin) ? pag_ini : pag + 1;
+        }
+        bytes_datos++;
+        bytes_cuadro++;
+        sucio = true;
+    } else {
+        comando(val);
+        bytes_comandos++;
+    }
+    ultima_escritura = sim_ahora();
+}
+
+// ---- PNG en escala de grises sin compresión (bloques "stored" de deflate) ----
+
+static uint32_t crc32_png(uint32_t crc, const uint8_t *p, size_t n) {
+    crc = ~crc;
+    while (n--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static void be32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void bloque_png(FILE *f, const char *tipo, const uint8_t *datos, uint32_t n) {
+    uint8_t cab[8];
+    be32(cab, n);
+    memcpy(cab + 4, tipo, 4);
+    uint32_t crc = crc32_png(crc32_png(0, cab + 4, 4), datos, n);
+    fwrite(cab, 1, 8, f);
+    fwrite(datos, 1, n, f);
+    be32(cab, crc);
+    fwrite(cab, 1, 4, f);
+}
+
+static void guardar_png(const char *ruta) {
+    enum { W = PANEL_ANCHO * PANEL_ESCALA, H = PANEL_PAGINAS * 8 * PANEL_ESCALA, FILA = W + 1 };
+    static uint8_t zlib[2 + 5 + H * FILA + 4];
+    uint8_t ihdr[13] = {0};
+    uint8_t *crudo = zlib + 7;
+    uint32_t a = 1, b = 0;
+    FILE *f = fopen(ruta, "wb");
+
+    if (!f) {
+        perror(ruta);
+        return;
+    }
+    for (int y = 0; y < H; y++) {
+        uint8_t *fila = crudo + y * FILA;
+        int py = y / PANEL_ESCALA;
+        fila[0] = 0; // Sin filtro
+        for (int x = 0; x < W; x++) {
+            bool on = encendido && (mostrado[py / 8][x / PANEL_ESCALA] >> (py % 8) & 1);
+            fila[1 + x] = on ? 0xFF : 0x00;
+        }
+    }
+    for (size_t i = 0; i < (size_t)H * FILA; i++) {
+        a = (a + crudo[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    zlib[0] = 0x78;
+    zlib[1] = 0x01;
+    zlib[2] = 0x01; // Último bloque, sin compresión
+    zlib[3] = (H * FILA) & 0xFF;
+    zlib[4] = (H * FILA) >> 8;
+    zlib[5] = ~zlib[3];
+    zlib[6] = ~zlib[4];
+    be32(crudo + H * FILA, (b << 16) | a);
+
+    be32(ihdr, W);
+    be32(ihdr + 4, H);
+    ihdr[8] = 8; // 8 bits por muestra, escala de grises
+    fwrite("\x89PNG\r\n\x1a\n", 1, 8, f);
+    bloque_png(f, "IHDR", ihdr, sizeof(ihdr));
+    bloque_png(f, "IDAT", zlib, sizeof(zlib));
+    bloque_png(f, "IEND", NULL, 0);
+    fclose(f);
+}
+
+void panel_modelo_png(const char *dir) {
+    dir_png = dir;
+}
+
+void panel_modelo_revisar(void) {
+    char ruta[512];
+    if (!sucio || sim_ahora() - ultima_escritura < PANEL_ESTABLE_US) {
+        return;
+    }
+    sucio = false;
+    if (memcmp(gddram, mostrado, sizeof(gddram)) == 0 && encendido == encendido_mostrado && cuadros) {
+        bytes_cuadro = 0;
+        return;
+    }
+    memcpy(mostrado, gddram, sizeof(gddram));
+    encendido_mostrado = encendido;
+    cuadros++;
+    if (dir_png) {
+        snprintf(ruta, sizeof(ruta), "%s/panel_%04u.png", dir_png, (unsigned)cuadros);
+        guardar_png(ruta);
+    }
+    sim_marca_en(ultima_escritura + PANEL_ESTABLE_US, "PANEL cuadro %u, %u bytes%s%s%s", (unsigned)cuadros,
+                 (unsigned)bytes_cuadro, encendido ? "" : " (apagado)", dir_png ? " -> " : "", dir_png ? ruta : "");
+    bytes_cuadro = 0;
+}
+
+void panel_modelo_resumen(void) {
+    if (bytes_datos || bytes_comandos) {
+        fprintf(stderr, "Panel: %u cuadros, %u bytes de datos y %u de comandos\n", (unsigned)cuadros,
+                (unsigned)bytes_datos, (unsigned)bytes_comandos);
+    }
+}
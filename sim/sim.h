@@ -0,0 +1,145 @@
+/**
+ * @file sim.h
+ * @brief API interna de la simulación en el host: reloj virtual, eventos y modelos de periféricos.
+ *
+ * El firmware (main.c, as608.c, lcd_i2c_16x2.c, cerradura.c, ...) se compila sin cambios contra
+ * los encabezados de sim/include. Todo el tiempo es virtual: sleep_ms y los sondeos avanzan el
+ * reloj, y en cada avance se disparan los eventos del guion y las interrupciones de PWM y GPIO.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SIM_PIN_RELE 19 ///< Mismo pin que cerradura.c
+#define SIM_PIN_TOQUE 20 ///< Línea de toque (WAK) del AS608, igual que AS608_TOUCH_PIN
+#define SIM_PIN_PANEL_DC 4 ///< DC del panel SPI, igual que PANEL_PIN_DC
+#define SIM_PIN_PANEL_CS 5 ///< CS del panel SPI, igual que PANEL_PIN_CS
+
+/**
+ * @brief Tipos de evento del guion.
+ */
+typedef enum {
+    SIM_EV_TECLA_PRESIONA,
+    SIM_EV_TECLA_SUELTA,
+    SIM_EV_DEDO,
+    SIM_EV_RETIRAR,
+    SIM_EV_TOQUE,
+    SIM_EV_USB,
+    SIM_EV_LCD, ///< Plazo de la expectativa lcd número arg
+    SIM_EV_FIN
+} sim_evento_tipo_t;
+
+// ---- Reloj y eventos (hal.c) ----
+
+/** @brief Tiempo virtual actual en microsegundos. */
+uint64_t sim_ahora(void);
+
+/** @brief Avanza el reloj virtual hasta t procesando eventos e interrupciones. */
+void sim_avanzar_hasta(uint64_t t);
+
+/** @brief Programa un evento del guion en el instante t. */
+void sim_programar(uint64_t t, sim_evento_tipo_t tipo, int arg, int arg2);
+
+/** @brief Imprime una marca de tiempo en stderr. */
+void sim_marca(const char *fmt, ...);
+
+/** @brief Igual que sim_marca pero con el instante t (no posterior al actual). */
+void sim_marca_en(uint64_t t, const char *fmt, ...);
+
+/** @brief Activaciones del relé hasta el momento. */
+size_t sim_aperturas(void);
+
+/** @brief Aplica el cambio de estado de una tecla del teclado 4x4. */
+bool sim_teclado(char tecla, bool presionada);
+
+/** @brief Fija el nivel de una entrada externa (p. ej. la línea de toque) y genera su flanco. */
+void sim_gpio_entrada(unsigned int pin, bool nivel);
+
+/** @brief Activa el modo silencioso (oculta el printf del firmware). */
+void sim_silencio(bool silencio);
+
+/** @brief Carga o guarda la imagen de la flash simulada. */
+bool sim_flash_cargar(const char *ruta);
+bool sim_flash_guardar(const char *ruta);
+
+// ---- UART ----
+
+/**
+ * @brief Encola un byte hacia el microcontrolador por el UART indicado.
+ *
+ * @param uart Índice del UART (0 o 1).
+ * @param byte Byte.
+ * @param t Instante de llegada al FIFO de recepción.
+ */
+void sim_uart_rx(unsigned int uart, uint8_t byte, uint64_t t);
+
+/** @brief Instante en que el UART termina de transmitir un byte a la tasa configurada. */
+uint32_t sim_uart_us_por_byte(unsigned int uart);
+
+// ---- Emulador AS608 (as608_emu.c) ----
+
+/** @brief Reinicia el emulador conectado al UART indicado. */
+void as608_emu_init(unsigned int uart);
+
+/** @brief Entrega al emulador un byte enviado por el microcontrolador. */
+void as608_emu_recibir(unsigned int uart, uint8_t byte, uint64_t t);
+
+/** @brief Coloca un dedo (id >= 0) o lo retira (id < 0). */
+void as608_emu_dedo(unsigned int uart, int id, bool mala_calidad);
+
+/** @brief Fija la latencia de procesamiento de una instrucción. */
+void as608_emu_latencia(unsigned int uart, uint8_t instruccion, uint32_t ms);
+
+/** @brief Hace que el módulo acepte o rechace (código 0x01) una instrucción. */
+void as608_emu_soportar(unsigned int uart, uint8_t instruccion, bool soportada);
+
+/** @brief Guarda una huella en la biblioteca del emulador. */
+void as608_emu_huella(unsigned int uart, uint16_t posicion, int id);
+
+/** @brief Número de posiciones de la biblioteca. */
+void as608_emu_capacidad(unsigned int uart, uint16_t capacidad);
+
+// ---- LCD (lcd_modelo.c) ----
+
+/** @brief Entrega al modelo PCF8574 + HD44780 un byte escrito por I2C. */
+void lcd_modelo_escribir(uint8_t addr, uint8_t val);
+
+/** @brief Imprime el contenido del LCD si cambió y ya está estable. */
+void lcd_modelo_revisar(void);
+
+/** @brief Copia el contenido visible (2 líneas de 16 caracteres). */
+void lcd_modelo_texto(char lineas[2][17]);
+
+// ---- Expectativas del guion (guion.c) ----
+
+/** @brief Ofrece un cuadro nuevo del LCD a la expectativa lcd pendiente. */
+void guion_lcd_cuadro(const char lineas[2][17]);
+
+/** @brief Vence el plazo de la expectativa lcd número i: falla si su texto no apareció. */
+void guion_lcd_plazo(int i);
+
+/** @brief Compara una respuesta del protocolo de gestión con la próxima expectativa respuesta. */
+void guion_respuesta(uint8_t cmd, uint8_t estado);
+
+/** @brief Comprueba las expectativas de fin de guion e imprime el balance. @return Fallas. */
+int guion_verificar(void);
+
+// ---- Panel SSD1306 por SPI (panel_modelo.c) ----
+
+/** @brief Entrega al modelo del SSD1306 un byte del SPI (dc: dato si es verdadero, comando si no). */
+void panel_modelo_escribir(uint8_t val, bool dc);
+
+/** @brief Registra el cuadro visible si cambió y ya está estable (y lo guarda como PNG). */
+void panel_modelo_revisar(void);
+
+/** @brief Guarda cada cuadro nuevo como dir/panel_NNNN.png. */
+void panel_modelo_png(const char *dir);
+
+/** @brief Imprime cuadros y bytes recibidos, si el panel se usó. */
+void panel_modelo_resumen(void);
+
+#endif // SIM_H
@@ -0,0 +1,345 @@
+/**
+ * @file usuarios.c
+ * @brief Directorio de usuarios ordenado por número, persistido en la flash.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "usuarios.h"
+#include "auditoria.h"
+#include "compactacion.h"
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+#define USUARIOS_MAGIA 0x32525355u ///< "USR2"
+#define USUARIOS_FABRICA 9         ///< Usuarios del directorio de fábrica
+
+typedef struct {
+    uint32_t magia;
+    uint32_t suma;
+    uint16_t cantidad;
+    uint16_t secuencia;  ///< Crece en cada guardado; manda la copia válida más reciente
+    usuario_t usuarios[USUARIOS_MAX];
+} usuarios_imagen_t;
+
+#define USUARIOS_IMAGEN_BYTES ((sizeof(usuarios_imagen_t) + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1))
+#define USUARIOS_SECTORES ((sizeof(usuarios_imagen_t) + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE)
+/// Dos copias inmediatamente anteriores a la región de la bitácora. Se escribe siempre la que no
+/// está en uso: un corte de alimentación a mitad de usuarios_guardar deja la anterior intacta.
+/// La copia 0 ocupa el lugar de la tabla de una sola copia.
+#define USUARIOS_OFFSET(copia) \
+    (PICO_FLASH_SIZE_BYTES - (AUDITORIA_SECTORES + ((copia) + 1) * USUARIOS_SECTORES) * FLASH_SECTOR_SIZE)
+
+/// Contraseñas de fábrica de los usuarios 1 a 9 (1234, 4321, 0000, 1111, ..., 6666) guardadas
+/// como sal + hash. Se regeneran con herramientas/clave_tabla.py.
+static const clave_registro_t clavesFabrica[USUARIOS_FABRICA] = {
+    { // User 1
+        {0x4F, 0x40, 0x27, 0x02, 0xAB, 0x99, 0xCC, 0x1D, 0x9A, 0x96, 0xCB, 0xE2, 0x06, 0xC9, 0x22, 0x6B},
+        {0xF3, 0x38, 0x12, 0x03, 0xB1, 0x9A, 0x25, 0xD9, 0xDD, 0xCA, 0x58, 0x41, 0xCA, 0x77, 0x1E, 0x21, 0xE7, 0xAD, 0xF2, 0x1C, 0xC1, 0x16, 0x89, 0xFE, 0x31, 0x73, 0x1D, 0x96, 0x4D, 0xA5, 0xB5, 0x95}
+    },
+    { // User 2
+        {0xE0, 0xFA, 0xA1, 0x15, 0x62, 0x49, 0xCB, 0x61, 0x4C, 0xD3, 0x9C, 0x87, 0x63, 0x9C, 0xCB, 0xD9},
+        {0x3D, 0xF6, 0xF9, 0x5C, 0xC7, 0x42, 0x43, 0xA9, 0xD8, 0x63, 0xEE, 0xC1, 0x19, 0xAA, 0x78, 0x0A, 0xF5, 0x4A, 0x20, 0x39, 0x52, 0xDE, 0xCB, 0x53, 0x3D, 0x1F, 0x83, 0x35, 0x92, 0x0E, 0x78, 0x52}
+    },
+    { // User 3
+        {0x24, 0x0D, 0x4F, 0x55, 0xA8, 0xF8, 0x4C, 0xE0, 0x7D, 0x78, 0x72, 0xB1, 0x7F, 0x1B, 0x46, 0x4E},
+        {0x82, 0x41, 0xF0, 0x09, 0xFC, 0x11, 0xD6, 0x78, 0x55, 0xA6, 0xEB, 0x5F, 0xCF, 0xA9, 0x54, 0x31, 0x41, 0x3E, 0xD3, 0x98, 0x3E, 0xAA, 0xC6, 0xDB, 0x1D, 0x10, 0x97, 0x0B, 0xEA, 0xD4, 0x8C, 0xD7}
+    },
+    { // User 4
+        {0xF9, 0x25, 0x76, 0x00, 0x56, 0xE8, 0x71, 0x29, 0x1D, 0x71, 0x51, 0xE1, 0x90, 0x1B, 0xCA, 0x08},
+        {0x8C, 0x8F, 0xE2, 0x7E, 0x25, 0xA6, 0x62, 0x29, 0x7D, 0xC5, 0x9F, 0xFB, 0xE3, 0x90, 0xDC, 0xC4, 0x83, 0x23, 0x49, 0x39, 0xF6, 0xC8, 0x71, 0x2B, 0xEB, 0xF3, 0xFC, 0xD7, 0x52, 0x12, 0x3F, 0x0A}
+    },
+    { // User 5
+        {0x7F, 0x97, 0xE1, 0x89, 0x3B, 0xC5, 0x82, 0x63, 0xE5, 0x61, 0x31, 0x3C, 0xFC, 0x54, 0x5C, 0x00},
+        {0xA7, 0xF3, 0x15, 0x5B, 0xCF, 0x0C, 0x8E, 0x41, 0xA1, 0xAA, 0xB3, 0x38, 0x50, 0xBF, 0x2A, 0x1F, 0x90, 0x7A, 0xA8, 0x02, 0x41, 0x19, 0x39, 0x55, 0x93, 0x48, 0x60, 0x90, 0xBF, 0x17, 0x11, 0xEB}
+    },
+    { // User 6
+        {0x75, 0xE9, 0x1E, 0xBD, 0x64, 0x0F, 0x14, 0x23, 0xB6, 0xC7, 0xAC, 0x3B, 0x7C, 0x0A, 0x23, 0x3B},
+        {0x85, 0xA3, 0x7C, 0x92, 0x76, 0x85, 0xD5, 0xC0, 0x70, 0x92, 0xC2, 0x29, 0xA6, 0xF1, 0xF8, 0x7A, 0x6E, 0xF6, 0xA3, 0x10, 0xBC, 0x52, 0x75, 0x4E, 0xDC, 0xFF, 0x80, 0x28, 0x53, 0x8A, 0x1C, 0x1C}
+    },
+    { // User 7
+        {0x7A, 0xC6, 0xCE, 0x18, 0x9C, 0xE2, 0xBD, 0xB6, 0x0D, 0x94, 0x82, 0x64, 0x53, 0x5F, 0x41, 0x08},
+        {0x6F, 0xB5, 0xEC, 0xC3, 0xD9, 0xC7, 0x5D, 0x83, 0x93, 0x31, 0x0B, 0x92, 0x97, 0x15, 0x37, 0x41, 0x87, 0xD7, 0x7D, 0x5E, 0x73, 0x45, 0xF0, 0xF8, 0x33, 0x61, 0x5F, 0xD7, 0x02, 0xF6, 0x44, 0xE1}
+    },
+    { // User 8
+        {0x93, 0x8A, 0x29, 0x08, 0xD9, 0xCD, 0x6E, 0xF0, 0x67, 0xDF, 0xA6, 0xF1, 0xF3, 0x8D, 0x27, 0xE6},
+        {0xAC, 0x0E, 0x4D, 0x81, 0xEA, 0x5E, 0xE8, 0x8C, 0x6A, 0xE4, 0x7E, 0x0C, 0x59, 0x65, 0xE5, 0x05, 0x5A, 0x82, 0xBB, 0x8D, 0x98, 0x58, 0x3A, 0xC9, 0xA0, 0x05, 0xDD, 0x8D, 0xC8, 0x75, 0xEF, 0x9B}
+    },
+    { // User 9
+        {0x2F, 0x05, 0x0A, 0x00, 0x63, 0x1C, 0x30, 0xDE, 0x01, 0xB6, 0x2F, 0xAE, 0x7C, 0x48, 0x8D, 0x06},
+        {0xF8, 0xE6, 0x91, 0x2E, 0x43, 0x40, 0x55, 0xBA, 0xE4, 0xF1, 0x38, 0x6E, 0x8C, 0x05, 0x84, 0x7D, 0x5B, 0x0B, 0x50, 0xD3, 0xA2, 0xD2, 0x01, 0x58, 0xB1, 0x47, 0xF8, 0xDF, 0xA9, 0xD8, 0xBA, 0xD9}
+    }
+};
+
+static union {
+    usuarios_imagen_t img;
+    uint8_t bytes[USUARIOS_IMAGEN_BYTES];
+} tabla;
+
+static uint16_t duenios[USUARIOS_POSICIONES]; ///< Mapa inverso posición → usuario (0 = libre)
+static uint8_t copia_activa = 1;              ///< Copia de la flash cargada; se guarda en la otra
+
+/**
+ * @brief Bytes ocupados por la cabecera y los primeros n registros.
+ */
+static size_t bytes_usados(uint16_t n) {
+    return offsetof(usuarios_imagen_t, usuarios) + (size_t)n * sizeof(usuario_t);
+}
+
+static uint32_t suma_tabla(const usuarios_imagen_t *img) {
+    const uint8_t *p = (const uint8_t *)&img->cantidad;
+    size_t n = bytes_usados(img->cantidad) - offsetof(usuarios_imagen_t, cantidad);
+    uint32_t suma = USUARIOS_MAGIA;
+    for (size_t i = 0; i < n; i++) {
+        suma = (suma << 5) + suma + p[i];
+    }
+    return suma;
+}
+
+/**
+ * @brief Búsqueda binaria: índice del usuario, o del lugar donde se insertaría.
+ */
+static uint16_t indice(uint16_t id, bool *encontrado) {
+    uint16_t bajo = 0, alto = tabla.img.cantidad;
+    while (bajo < alto) {
+        uint16_t medio = (bajo + alto) / 2;
+        if (tabla.img.usuarios[medio].id < id) {
+            bajo = medio + 1;
+        } else {
+            alto = medio;
+        }
+    }
+    *encontrado = bajo < tabla.img.cantidad && tabla.img.usuarios[bajo].id == id;
+    return bajo;
+}
+
+static usuario_t *buscar(uint16_t id) {
+    bool encontrado;
+    uint16_t i = indice(id, &encontrado);
+    return encontrado ? &tabla.img.usuarios[i] : NULL;
+}
+
+/**
+ * @brief Reconstruye el mapa inverso a partir de los registros.
+ */
+static void reconstruir_duenios(void) {
+    memset(duenios, 0, sizeof(duenios));
+    for (uint16_t i = 0; i < tabla.img.cantidad; i++) {
+        const usuario_t *u = &tabla.img.usuarios[i];
+        for (uint8_t d = 0; d < u->dedos; d++) {
+            if (u->posiciones[d] < USUARIOS_POSICIONES) {
+                duenios[u->posiciones[d]] = u->id;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Copia de la flash, o NULL si no es válida.
+ */
+static const usuarios_imagen_t *copia_flash(uint8_t copia) {
+    const usuarios_imagen_t *flash = (const usuarios_imagen_t *)(XIP_BASE + USUARIOS_OFFSET(copia));
+
+    if (flash->magia == USUARIOS_MAGIA && flash->cantidad <= USUARIOS_MAX && flash->suma == suma_tabla(flash)) {
+        return flash;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Carga el directorio desde la copia válida más reciente de la flash, o el de fábrica si
+ * ninguna es válida.
+ */
+void usuarios_init(void) {
+    const usuarios_imagen_t *flash = copia_flash(0);
+    const usuarios_imagen_t *otra = copia_flash(1);
+
+    copia_activa = 0;
+    if (otra != NULL && (flash == NULL || (int16_t)(otra->secuencia - flash->secuencia) > 0)) {
+        flash = otra;
+        copia_activa = 1;
+    }
+    memset(tabla.bytes, 0xFF, sizeof(tabla.bytes));
+    if (flash != NULL) {
+        memcpy(tabla.bytes, flash, bytes_usados(flash->cantidad));
+    } else {
+        copia_activa = 1;
+        printf("Usuarios: tabla de fabrica\n");
+        tabla.img.magia = USUARIOS_MAGIA;
+        tabla.img.cantidad = USUARIOS_FABRICA;
+        for (uint16_t i = 0; i < USUARIOS_FABRICA; i++) {
+            usuario_t *u = &tabla.img.usuarios[i];
+            memset(u, 0, sizeof(*u));
+            u->id = i + 1;
+            u->dedos = 1;
+            u->posiciones[0] = i + 1;
+            u->clave = clavesFabrica[i];
+        }
+    }
+    reconstruir_duenios();
+}
+
+/**
+ * @brief Busca un usuario (búsqueda binaria).
+ */
+const usuario_t *usuarios_buscar(uint16_t id) {
+    return buscar(id);
+}
+
+uint16_t usuarios_cantidad(void) {
+    return tabla.img.cantidad;
+}
+
+const usuario_t *usuarios_en(uint16_t i) {
+    return i < tabla.img.cantidad ? &tabla.img.usuarios[i] : NULL;
+}
+
+/**
+ * @brief Crea un usuario (insertándolo en orden) o cambia su contraseña.
+ */
+bool usuarios_definir(uint16_t id, const clave_registro_t *clave) {
+    bool encontrado;
+
+    if (id < 1 || id > USUARIOS_ID_MAX) {
+        return false;
+    }
+    uint16_t i = indice(id, &encontrado);
+    if (!encontrado) {
+        if (tabla.img.cantidad >= USUARIOS_MAX) {
+            return false;
+        }
+        memmove(&tabla.img.usuarios[i + 1], &tabla.img.usuarios[i],
+                (tabla.img.cantidad - i) * sizeof(usuario_t));
+        tabla.img.cantidad++;
+        memset(&tabla.img.usuarios[i], 0, sizeof(usuario_t));
+        tabla.img.usuarios[i].id = id;
+    }
+    tabla.img.usuarios[i].clave = *clave;
+    return true;
+}
+
+/**
+ * @brief Quita un usuario del directorio y libera sus posiciones.
+ */
+bool usuarios_borrar(uint16_t id) {
+    bool encontrado;
+    uint16_t i = indice(id, &encontrado);
+
+    if (!encontrado) {
+        return false;
+    }
+    usuarios_quitar_dedos(id);
+    tabla.img.cantidad--;
+    memmove(&tabla.img.usuarios[i], &tabla.img.usuarios[i + 1], (tabla.img.cantidad - i) * sizeof(usuario_t));
+    return true;
+}
+
+uint16_t usuarios_duenio(uint16_t posicion) {
+    return posicion < USUARIOS_POSICIONES ? duenios[posicion] : 0;
+}
+
+uint16_t usuarios_limite(void) {
+    uint16_t p = USUARIOS_POSICIONES;
+    while (p > 0 && duenios[p - 1] == 0) {
+        p--;
+    }
+    return p;
+}
+
+uint16_t usuarios_posicion_libre(void) {
+    for (uint16_t p = 0; p < USUARIOS_POSICIONES; p++) {
+        if (duenios[p] == 0 && !compactacion_reservada(p)) {
+            return p;
+        }
+    }
+    return USUARIOS_SIN_POSICION;
+}
+
+bool usuarios_agregar_dedo(uint16_t id, uint16_t posicion) {
+    usuario_t *u = buscar(id);
+
+    if (u == NULL || u->dedos >= USUARIOS_DEDOS_MAX || posicion >= USUARIOS_POSICIONES || duenios[posicion] ||
+        compactacion_reservada(posicion)) {
+        return false;
+    }
+    u->posiciones[u->dedos++] = posicion;
+    duenios[posicion] = id;
+    return true;
+}
+
+bool usuarios_mover_dedo(uint16_t origen, uint16_t destino) {
+    usuario_t *u = buscar(usuarios_duenio(origen));
+
+    if (u == NULL || destino >= USUARIOS_POSICIONES || duenios[destino]) {
+        return false;
+    }
+    for (uint8_t d = 0; d < u->dedos; d++) {
+        if (u->posiciones[d] == origen) {
+            u->posiciones[d] = destino;
+        }
+    }
+    duenios[destino] = u->id;
+    duenios[origen] = 0;
+    return true;
+}
+
+bool usuarios_liberar_posicion(uint16_t posicion) {
+    usuario_t *u = buscar(usuarios_duenio(posicion));
+
+    if (u == NULL) {
+        return false;
+    }
+    for (uint8_t d = 0; d < u->dedos; d++) {
+        if (u->posiciones[d] == posicion) {
+            u->dedos--;
+            memmove(&u->posiciones[d], &u->posiciones[d + 1], (u->dedos - d) * sizeof(u->posiciones[0]));
+            break;
+        }
+    }
+    duenios[posicion] = 0;
+    return true;
+}
+
+void usuarios_quitar_dedos(uint16_t id) {
+    usuario_t *u = buscar(id);
+
+    if (u == NULL) {
+        return;
+    }
+    for (uint8_t d = 0; d < u->dedos; d++) {
+        if (u->posiciones[d] < USUARIOS_POSICIONES) {
+            duenios[u->posiciones[d]] = 0;
+        }
+    }
+    u->dedos = 0;
+}
+
+void usuarios_vaciar_dedos(void) {
+    for (uint16_t i = 0; i < tabla.img.cantidad; i++) {
+        tabla.img.usuarios[i].dedos = 0;
+    }
+    memset(duenios, 0, sizeof(duenios));
+}
+
+/**
+ * @brief Escribe el directorio en la copia de la flash que no está en uso; solo se borran y
+ * programan los sectores que ocupa. La copia nueva pasa a mandar cuando su suma queda escrita.
+ */
+void usuarios_guardar(void) {
+    size_t bytes = (bytes_usados(tabla.img.cantidad) + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+    size_t sectores = (bytes + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+    uint8_t copia = copia_activa ^ 1;
+
+    tabla.img.secuencia++;
+    tabla.img.suma = suma_tabla(&tabla.img);
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(USUARIOS_OFFSET(copia), sectores * FLASH_SECTOR_SIZE);
+    flash_range_program(USUARIOS_OFFSET(copia), tabla.bytes, bytes);
+    restore_interrupts(ints);
+    copia_activa = copia;
+}
+
+uint32_t usuarios_flash_inicio(void) {
+    return USUARIOS_OFFSET(1);
+}
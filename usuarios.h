@@ -0,0 +1,165 @@
+/**
+ * @file usuarios.h
+ * @brief Directorio de usuarios persistido en la flash: número de usuario → registro de contraseña
+ * con sal y posiciones de sus huellas en el lector.
+ *
+ * Los registros se guardan ordenados por número de usuario, así que una búsqueda es binaria
+ * (O(log n)). Un mapa inverso posición → usuario, reconstruido al cargar, responde en O(1) a quién
+ * pertenece la huella que encontró el lector y cuál es la próxima posición libre. El tamaño está
+ * pensado para la biblioteca completa del AS608: hasta USUARIOS_POSICIONES usuarios con al menos
+ * una huella cada uno.
+ *
+ * La flash guarda dos copias del directorio que se escriben alternadamente, así que cambiar las
+ * posiciones de varios usuarios y guardar es atómico frente a un corte de alimentación.
+ */
+
+#ifndef USUARIOS_H
+#define USUARIOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "clave.h"
+
+#define USUARIOS_POSICIONES 300               ///< Capacidad de la biblioteca del AS608
+#define USUARIOS_MAX USUARIOS_POSICIONES      ///< Registros del directorio
+#define USUARIOS_PAGINAS ((USUARIOS_POSICIONES + 255) / 256) ///< Páginas de ReadConList que cubren las posiciones
+#define USUARIOS_DEDOS_MAX 3                  ///< Huellas por usuario
+#define USUARIOS_ID_DIGITOS 4                 ///< Dígitos de un número de usuario en el teclado
+#define USUARIOS_ID_MAX 9999                  ///< Números de usuario válidos: 1 a USUARIOS_ID_MAX
+#define USUARIOS_SIN_POSICION 0xFFFF          ///< No hay posición libre en el lector
+
+/**
+ * @brief Registro de un usuario.
+ */
+typedef struct {
+    uint16_t id;                              ///< Número de usuario
+    uint8_t dedos;                            ///< Huellas registradas
+    uint8_t reservado;
+    uint16_t posiciones[USUARIOS_DEDOS_MAX];  ///< Posiciones de sus huellas en el lector
+    clave_registro_t clave;                   ///< Sal y hash de la contraseña
+} usuario_t;
+
+/**
+ * @brief Carga el directorio desde la flash, o el de fábrica si la flash no tiene uno válido.
+ *
+ * El de fábrica tiene los usuarios 1 a 9, cada uno con la huella de la posición de su mismo
+ * número (la distribución anterior al directorio).
+ */
+void usuarios_init(void);
+
+/**
+ * @brief Busca un usuario.
+ *
+ * @param id Número de usuario.
+ * @return const usuario_t* Registro, o NULL si no existe.
+ */
+const usuario_t *usuarios_buscar(uint16_t id);
+
+/**
+ * @brief Cantidad de usuarios del directorio.
+ */
+uint16_t usuarios_cantidad(void);
+
+/**
+ * @brief Usuario en la posición i del directorio (orden creciente de número).
+ *
+ * @param i 0 a usuarios_cantidad() - 1.
+ * @return const usuario_t* Registro, o NULL si i está fuera de rango.
+ */
+const usuario_t *usuarios_en(uint16_t i);
+
+/**
+ * @brief Crea un usuario o cambia su contraseña (sólo en RAM hasta usuarios_guardar).
+ *
+ * @param id Número de usuario (1 a USUARIOS_ID_MAX).
+ * @param clave Registro de contraseña ya calculado.
+ * @return true si el número es válido y hay lugar en el directorio.
+ */
+bool usuarios_definir(uint16_t id, const clave_registro_t *clave);
+
+/**
+ * @brief Quita un usuario del directorio y libera sus posiciones (sólo en RAM hasta usuarios_guardar).
+ *
+ * Las plantillas quedan en el lector; sin dueño, ninguna búsqueda las acepta.
+ *
+ * @param id Número de usuario.
+ * @return true si el usuario existía.
+ */
+bool usuarios_borrar(uint16_t id);
+
+/**
+ * @brief Dueño de una posición del lector.
+ *
+ * @param posicion Posición de la biblioteca.
+ * @return uint16_t Número de usuario, o 0 si la posición está libre.
+ */
+uint16_t usuarios_duenio(uint16_t posicion);
+
+/**
+ * @brief Primera posición del lector sin dueño y fuera del diario de una compactación pendiente
+ * (compactacion_reservada).
+ *
+ * @return uint16_t Posición, o USUARIOS_SIN_POSICION si están todas asignadas.
+ */
+uint16_t usuarios_posicion_libre(void);
+
+/**
+ * @brief Posiciones que tiene que recorrer una búsqueda para cubrir todas las huellas con dueño.
+ *
+ * @return uint16_t Última posición con dueño + 1 (0 si no hay ninguna).
+ */
+uint16_t usuarios_limite(void);
+
+/**
+ * @brief Asigna una posición del lector a un usuario (sólo en RAM hasta usuarios_guardar).
+ *
+ * @param id Número de usuario.
+ * @param posicion Posición con la huella ya almacenada.
+ * @return true si el usuario existe, tiene lugar para otra huella y la posición está libre y fuera
+ * de una compactación pendiente.
+ */
+bool usuarios_agregar_dedo(uint16_t id, uint16_t posicion);
+
+/**
+ * @brief Pasa una huella de su posición a otra libre, conservando el dueño (sólo en RAM hasta
+ * usuarios_guardar).
+ *
+ * @param origen Posición actual, con dueño.
+ * @param destino Posición nueva, sin dueño.
+ * @return true si se movió.
+ */
+bool usuarios_mover_dedo(uint16_t origen, uint16_t destino);
+
+/**
+ * @brief Quita una posición a su dueño, p. ej. tras borrarla del lector (sólo en RAM hasta
+ * usuarios_guardar).
+ *
+ * @param posicion Posición del lector.
+ * @return true si tenía dueño.
+ */
+bool usuarios_liberar_posicion(uint16_t posicion);
+
+/**
+ * @brief Libera todas las posiciones de un usuario (sólo en RAM hasta usuarios_guardar).
+ *
+ * @param id Número de usuario.
+ */
+void usuarios_quitar_dedos(uint16_t id);
+
+/**
+ * @brief Libera las posiciones de todos los usuarios (tras vaciar el lector).
+ */
+void usuarios_vaciar_dedos(void);
+
+/**
+ * @brief Escribe el directorio en la flash (solo los sectores que ocupa).
+ */
+void usuarios_guardar(void);
+
+/**
+ * @brief Comienzo (offset) de la región de la flash que ocupa el directorio; lo que esté por
+ * debajo queda libre para otros módulos.
+ */
+uint32_t usuarios_flash_inicio(void);
+
+#endif // USUARIOS_H